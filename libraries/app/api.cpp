@@ -208,11 +208,45 @@ namespace graphene { namespace app {
        return _app.p2p_node()->get_connected_peers();
     }
 
+    std::vector<net::peer_sync_statistics> network_node_api::get_sync_statistics() const
+    {
+       return _app.p2p_node()->get_sync_statistics();
+    }
+
+    net::message_cache_statistics network_node_api::get_message_cache_statistics() const
+    {
+       return _app.p2p_node()->get_message_cache_statistics();
+    }
+
+    std::vector<net::peer_traffic_statistics> network_node_api::get_peer_traffic_statistics() const
+    {
+       return _app.p2p_node()->get_peer_traffic_statistics();
+    }
+
+    net::transaction_admission_statistics network_node_api::get_transaction_admission_statistics() const
+    {
+       return _app.p2p_node()->get_transaction_admission_statistics();
+    }
+
     std::vector<net::potential_peer_record> network_node_api::get_potential_peers() const
     {
        return _app.p2p_node()->get_potential_peers();
     }
 
+    graphene::chain::pending_transaction_pool_stats network_node_api::get_pending_transaction_pool_stats() const
+    {
+       return _app.chain_database()->get_pending_transaction_pool().get_stats();
+    }
+
+    graphene::chain::state_snapshot_header network_node_api::create_state_snapshot( const std::string& file_name )
+    {
+       FC_ASSERT( !file_name.empty() && file_name.find_first_of( "/\\" ) == std::string::npos && file_name != ".." && file_name != ".",
+                  "Snapshot file name must not contain directories" );
+       const fc::path dir = _app.chain_database()->get_data_dir() / "snapshots";
+       fc::create_directories( dir );
+       return _app.create_state_snapshot( dir / file_name );
+    }
+
     fc::variant_object network_node_api::get_advanced_node_parameters() const
     {
        return _app.p2p_node()->get_advanced_node_parameters();
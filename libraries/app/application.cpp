@@ -28,6 +28,7 @@
 
 #include <graphene/chain/protocol/fee_schedule.hpp>
 #include <graphene/chain/protocol/types.hpp>
+#include <graphene/chain/block_summary_object.hpp>
 
 #include <graphene/egenesis/egenesis.hpp>
 
@@ -70,6 +71,7 @@ using chain::block_header;
 using chain::signed_block_header;
 using chain::signed_block;
 using chain::block_id_type;
+using chain::packed_block;
 
 using std::vector;
 
@@ -112,6 +114,29 @@ namespace detail {
       fc::optional<fc::temp_file> _lock_file;
       bool _is_block_producer = false;
       bool _force_validate = false;
+      uint32_t _state_snapshot_objects_per_slice = GRAPHENE_DEFAULT_STATE_SNAPSHOT_OBJECTS_PER_SLICE;
+      fc::future<void> _state_snapshot_done;
+
+      /**
+       * Writes the snapshot started by application::create_state_snapshot() a slice at a time, letting the
+       * blocks, transactions and API calls that come in meanwhile through between the slices
+       */
+      void write_state_snapshot()
+      {
+         try
+         {
+            while( !_chain_db->continue_state_snapshot( _state_snapshot_objects_per_slice ) )
+               fc::yield();
+         }
+         catch( const fc::canceled_exception& )
+         {
+            throw;
+         }
+         catch( const fc::exception& e )
+         {
+            elog( "Unable to write state snapshot: ${e}", ("e",e.to_detail_string()) );
+         }
+      }
 
       void reset_p2p_node(const fc::path& data_dir)
       { try {
@@ -374,11 +399,51 @@ namespace detail {
          }
          _chain_db->add_checkpoints( loaded_checkpoints );
 
+         graphene::chain::pending_transaction_pool_limits pool_limits;
+         if( _options->count("pending-tx-max-bytes") )
+            pool_limits.max_bytes = _options->at("pending-tx-max-bytes").as<uint64_t>();
+         if( _options->count("pending-tx-max-count") )
+            pool_limits.max_transactions = _options->at("pending-tx-max-count").as<uint32_t>();
+         if( _options->count("pending-tx-max-per-account") )
+            pool_limits.max_per_account = _options->at("pending-tx-max-per-account").as<uint32_t>();
+         _chain_db->set_pending_transaction_pool_limits( pool_limits );
+
+         if( _options->count("compress-object-database") )
+            _chain_db->set_compression( _options->at("compress-object-database").as<bool>() );
+         if( _options->count("object-database-threads") )
+            _chain_db->set_io_threads( _options->at("object-database-threads").as<uint32_t>() );
+         if( _options->count("parallel-apply-threads") )
+            _chain_db->set_parallel_apply_threads( _options->at("parallel-apply-threads").as<uint32_t>() );
+         if( _options->count("state-checkpoint-interval") )
+            _chain_db->set_state_checkpoint_interval( _options->at("state-checkpoint-interval").as<uint32_t>(),
+                                                      _options->at("state-checkpoint-objects-per-block").as<uint32_t>() );
+         if( _options->count("block-log-chunk-size") )
+            _chain_db->set_block_log_chunk_size( _options->at("block-log-chunk-size").as<uint32_t>() );
+
+         auto write_db_version = [&]()
+         {
+            const auto mode = std::ios::out | std::ios::binary | std::ios::trunc;
+            std::ofstream db_version( (_data_dir / "db_version").generic_string().c_str(), mode );
+            std::string version_string = GRAPHENE_CURRENT_DB_VERSION;
+            db_version.write( version_string.c_str(), version_string.size() );
+            db_version.close();
+         };
+
+         bool snapshot_loaded = false;
+         if( _options->count("load-snapshot") )
+         {
+            const auto snapshot = _options->at("load-snapshot").as<boost::filesystem::path>();
+            fc::remove_all( _data_dir / "db_version" );
+            _chain_db->open_from_state_snapshot( _data_dir / "blockchain", snapshot );
+            write_db_version();
+            snapshot_loaded = true;
+         }
+
          bool replay = false;
          std::string replay_reason = "reason not provided";
 
          // never replay if data dir is empty
-         if( fc::exists( _data_dir ) && fc::directory_iterator( _data_dir ) != fc::directory_iterator() )
+         if( !snapshot_loaded && fc::exists( _data_dir ) && fc::directory_iterator( _data_dir ) != fc::directory_iterator() )
          {
             if( _options->count("replay-blockchain") )
             {
@@ -408,7 +473,7 @@ namespace detail {
             }
          }
 
-         if( !replay )
+         if( !replay && !snapshot_loaded )
          {
             try
             {
@@ -423,19 +488,41 @@ namespace detail {
             }
          }
 
+         // after a crash only the blocks since the last state checkpoint need to be replayed
+         if( replay && !clean && !_options->count("replay-blockchain") && fc::exists( _data_dir / "db_version" ) )
+         {
+            std::string version_string;
+            fc::read_file_contents( _data_dir / "db_version", version_string );
+            if( version_string == GRAPHENE_CURRENT_DB_VERSION )
+            {
+               try
+               {
+                  replay = !_chain_db->resume_from_state_checkpoint( _data_dir / "blockchain" );
+               }
+               catch( const fc::exception& e )
+               {
+                  elog( "Unable to resume from state checkpoint: ${e}", ("e", e.to_detail_string()) );
+               }
+            }
+         }
+
          if( replay )
          {
             ilog( "Replaying blockchain due to: ${reason}", ("reason", replay_reason) );
 
             fc::remove_all( _data_dir / "db_version" );
             _chain_db->reindex( _data_dir / "blockchain", initial_state() );
+            write_db_version();
+         }
 
-            const auto mode = std::ios::out | std::ios::binary | std::ios::trunc;
-            std::ofstream db_version( (_data_dir / "db_version").generic_string().c_str(), mode );
-            std::string version_string = GRAPHENE_CURRENT_DB_VERSION;
-            db_version.write( version_string.c_str(), version_string.size() );
-            db_version.close();
+         if( _options->count("create-snapshot") )
+         {
+            // written in one go before the node connects to peers or serves APIs
+            const auto snapshot = _options->at("create-snapshot").as<boost::filesystem::path>();
+            _chain_db->create_state_snapshot( snapshot );
          }
+         if( _options->count("state-snapshot-objects-per-slice") )
+            _state_snapshot_objects_per_slice = _options->at("state-snapshot-objects-per-slice").as<uint32_t>();
 
          if( _options->count("force-validate") )
          {
@@ -580,6 +667,35 @@ namespace detail {
          _chain_db->push_transaction( transaction_message.trx );
       } FC_CAPTURE_AND_RETHROW( (transaction_message) ) }
 
+      /**
+       * The checks of database::push_transaction() that need neither signature recovery nor an undo session, so a
+       * peer relaying junk costs us little
+       */
+      virtual graphene::net::transaction_precheck_result precheck_transaction(const graphene::net::trx_message& transaction_message) override
+      { try {
+         const signed_transaction& trx = transaction_message.trx;
+         if( _chain_db->is_known_transaction( trx.id() ) )
+            return graphene::net::transaction_duplicate;
+
+         const chain_parameters& parameters = _chain_db->get_global_properties().parameters;
+         if( fc::raw::pack_size( trx ) > parameters.maximum_transaction_size )
+            return graphene::net::transaction_oversized;
+
+         if( _chain_db->head_block_num() > 0 )
+         {
+            const fc::time_point_sec now = _chain_db->head_block_time();
+            if( trx.expiration < now )
+               return graphene::net::transaction_expired;
+            if( trx.expiration > now + parameters.maximum_time_until_expiration )
+               return graphene::net::transaction_expiration_too_far;
+
+            const block_summary_object* tapos_block_summary = _chain_db->find( block_summary_id_type( trx.ref_block_num ) );
+            if( !tapos_block_summary || tapos_block_summary->block_id._hash[1] != trx.ref_block_prefix )
+               return graphene::net::transaction_unknown_tapos_block;
+         }
+         return graphene::net::transaction_precheck_passed;
+      } FC_CAPTURE_AND_RETHROW( (transaction_message) ) }
+
       virtual void handle_message(const message& message_to_process) override
       {
          // not a transaction, not a block
@@ -611,7 +727,6 @@ namespace detail {
          if( _chain_db->head_block_num() == 0 )
             return result;
 
-         result.reserve(limit);
          block_id_type last_known_block_id;
 
          if (blockchain_synopsis.empty() ||
@@ -637,11 +752,14 @@ namespace detail {
            if (!found_a_block_in_synopsis)
              FC_THROW_EXCEPTION(graphene::net::peer_is_on_an_unreachable_fork, "Unable to provide a list of blocks starting at any of the blocks in peer's synopsis");
          }
-         for( uint32_t num = block_header::num_from_id(last_known_block_id);
-              num <= _chain_db->head_block_num() && result.size() < limit;
-              ++num )
-            if( num > 0 )
-               result.push_back(_chain_db->get_block_id_for_num(num));
+         const uint32_t first_block_num = std::max<uint32_t>( block_header::num_from_id(last_known_block_id), 1 );
+         if( first_block_num < _chain_db->first_stored_block_num() )
+            FC_THROW_EXCEPTION( graphene::net::peer_is_on_an_unreachable_fork,
+                                "Our block log starts at block ${f} from a state snapshot, unable to provide blocks from ${n}",
+                                ("f",_chain_db->first_stored_block_num())("n",first_block_num) );
+         if( first_block_num <= _chain_db->head_block_num() && limit > 0 )
+            result = _chain_db->get_block_ids_for_nums( first_block_num,
+                                                        std::min( limit, _chain_db->head_block_num() - first_block_num + 1 ) );
 
          if( !result.empty() && block_header::num_from_id(result.back()) < _chain_db->head_block_num() )
             remaining_item_count = _chain_db->head_block_num() - block_header::num_from_id(result.back());
@@ -657,6 +775,11 @@ namespace detail {
         // ilog("Request for item ${id}", ("id", id));
          if( id.item_type == graphene::net::block_message_type )
          {
+            // blocks of our chain are served as stored, without unpacking them
+            vector<packed_block> stored = _chain_db->fetch_packed_blocks( block_header::num_from_id(id.item_hash), 1 );
+            if( !stored.empty() && stored.front().id == id.item_hash )
+               return graphene::net::packed_block_message( stored.front().id, std::move( stored.front().data ) );
+
             auto opt_block = _chain_db->fetch_block_by_id(id.item_hash);
             if( !opt_block )
                elog("Couldn't find block ${id} -- corresponding ID in our chain is ${id2}",
@@ -668,6 +791,18 @@ namespace detail {
          return trx_message( _chain_db->get_recent_transaction( id.item_hash ) );
       } FC_CAPTURE_AND_RETHROW( (id) ) }
 
+      virtual std::vector<message> get_blocks(const std::vector<item_hash_t>& block_ids, uint64_t max_total_size) override
+      { try {
+         std::vector<message> result;
+         if( block_ids.empty() )
+            return result;
+         vector<packed_block> stored = _chain_db->fetch_packed_blocks( block_header::num_from_id(block_ids.front()),
+                                                                       block_ids.size(), max_total_size );
+         for( size_t i = 0; i < stored.size() && stored[i].id == block_ids[i]; ++i )
+            result.push_back( graphene::net::packed_block_message( stored[i].id, std::move( stored[i].data ) ) );
+         return result;
+      } FC_CAPTURE_AND_RETHROW( (block_ids)(max_total_size) ) }
+
       virtual chain_id_type get_chain_id()const override
       {
          return _chain_db->get_chain_id();
@@ -930,6 +1065,8 @@ application::application()
 
 application::~application()
 {
+   if( my->_state_snapshot_done.valid() && !my->_state_snapshot_done.ready() )
+      my->_state_snapshot_done.cancel_and_wait( "application is shutting down" );
    if( my->_p2p_network )
    {
       my->_p2p_network->close();
@@ -956,6 +1093,26 @@ void application::set_program_options(boost::program_options::options_descriptio
          ("genesis-json", bpo::value<boost::filesystem::path>(), "File to read Genesis State from")
          ("dbg-init-key", bpo::value<string>(), "Block signing key to use for init witnesses, overrides genesis file")
          ("api-access", bpo::value<boost::filesystem::path>(), "JSON file specifying API permissions")
+         ("pending-tx-max-bytes", bpo::value<uint64_t>()->default_value(GRAPHENE_DEFAULT_MAX_PENDING_TRANSACTION_BYTES),
+          "Maximum total size of pending transactions, 0 for no limit")
+         ("pending-tx-max-count", bpo::value<uint32_t>()->default_value(GRAPHENE_DEFAULT_MAX_PENDING_TRANSACTIONS),
+          "Maximum number of pending transactions, 0 for no limit")
+         ("pending-tx-max-per-account", bpo::value<uint32_t>()->default_value(GRAPHENE_DEFAULT_MAX_PENDING_TRANSACTIONS_PER_ACCOUNT),
+          "Maximum number of pending transactions paid for by one account, 0 for no limit")
+         ("compress-object-database", bpo::value<bool>()->default_value(false), "Compress the object database files written on shutdown")
+         ("object-database-threads", bpo::value<uint32_t>()->default_value(0),
+          "Number of threads used to save and load the object database, 0 for one per core")
+         ("parallel-apply-threads", bpo::value<uint32_t>()->default_value(1),
+          "Number of threads checking the signatures of a block's transactions ahead of applying them, "
+          "1 to check them one by one, 0 for one per core")
+         ("state-checkpoint-interval", bpo::value<uint32_t>()->default_value(GRAPHENE_DEFAULT_STATE_CHECKPOINT_INTERVAL),
+          "Save the irreversible state every this many blocks so that an unclean shutdown does not require a full replay, 0 to disable")
+         ("state-snapshot-objects-per-slice", bpo::value<uint32_t>()->default_value(GRAPHENE_DEFAULT_STATE_SNAPSHOT_OBJECTS_PER_SLICE),
+          "Number of objects of a state snapshot requested through the API written before other work gets to run")
+         ("state-checkpoint-objects-per-block", bpo::value<uint32_t>()->default_value(GRAPHENE_DEFAULT_STATE_CHECKPOINT_OBJECTS_PER_BLOCK),
+          "Number of objects of a state checkpoint saved with each block, which bounds how long a checkpoint holds up a block")
+         ("block-log-chunk-size", bpo::value<uint32_t>()->default_value(0),
+          "Compress irreversible blocks of a newly created block log in chunks of this many blocks, 0 to store them uncompressed")
          ;
    command_line_options.add(configuration_file_options);
    command_line_options.add_options()
@@ -963,6 +1120,12 @@ void application::set_program_options(boost::program_options::options_descriptio
           "Path to create a Genesis State at. If a well-formed JSON file exists at the path, it will be parsed and any "
           "missing fields in a Genesis State will be added, and any unknown fields will be removed. If no file or an "
           "invalid file is found, it will be replaced with an example Genesis State.")
+         ("load-snapshot", bpo::value<boost::filesystem::path>(),
+          "Start from a state snapshot written with --create-snapshot or network_node_api.create_state_snapshot instead of the local state")
+         ("create-snapshot", bpo::value<boost::filesystem::path>(),
+          "Write the state at the last irreversible block to this file while starting up, before connecting to peers. "
+          "Right after a replay this needs the head block to be irreversible, use network_node_api.create_state_snapshot "
+          "once the node has synced otherwise")
          ("replay-blockchain", "Rebuild object graph by replaying all blocks")
          ("resync-blockchain", "Delete all blocks and re-sync with network from scratch")
          ("force-validate", "Force validation of all transactions")
@@ -1055,6 +1218,13 @@ std::shared_ptr<chain::database> application::chain_database() const
    return my->_chain_db;
 }
 
+chain::state_snapshot_header application::create_state_snapshot( const fc::path& file )
+{
+   const chain::state_snapshot_header header = my->_chain_db->start_state_snapshot( file );
+   my->_state_snapshot_done = fc::async( [this]() { my->write_state_snapshot(); }, "write_state_snapshot" );
+   return header;
+}
+
 void application::set_block_production(bool producing_blocks)
 {
    my->_is_block_producer = producing_blocks;
@@ -1088,6 +1258,8 @@ void application::shutdown_plugins()
 }
 void application::shutdown()
 {
+   if( my->_state_snapshot_done.valid() && !my->_state_snapshot_done.ready() )
+      my->_state_snapshot_done.cancel_and_wait( "application is shutting down" );
    if( my->_p2p_network )
       my->_p2p_network->close();
    if( my->_chain_db )
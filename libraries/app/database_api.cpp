@@ -23,6 +23,7 @@
  */
 
 #include <graphene/app/database_api.hpp>
+#include <graphene/app/impacted.hpp>
 #include <graphene/chain/get_config.hpp>
 #include <graphene/chain/token_evaluator.hpp>
 #include <graphene/chain/global.hpp>
@@ -104,6 +105,8 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       // Accounts
       vector<optional<account_object>> get_accounts(const vector<account_id_type>& account_ids)const;
       std::map<string,full_account> get_full_accounts( const vector<string>& names_or_ids, bool subscribe );
+      std::map<string,full_account> get_full_accounts_paged( const vector<string>& names_or_ids, bool subscribe,
+                                                             const full_account_query& query );
       optional<account_object> get_account_by_name( string name )const;
       vector<account_id_type> get_account_references( account_id_type account_id )const;
       vector<optional<account_object>> lookup_account_names(const vector<string>& account_names)const;
@@ -132,9 +135,11 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       void subscribe_to_market(std::function<void(const variant&)> callback, asset_id_type a, asset_id_type b);
       void unsubscribe_from_market(asset_id_type a, asset_id_type b);
       market_ticker                      get_ticker( const string& base, const string& quote )const;
+      vector<market_ticker>              get_all_tickers()const;
       market_volume                      get_24_volume( const string& base, const string& quote )const;
       order_book                         get_order_book( const string& base, const string& quote, unsigned limit = 50 )const;
       vector<market_trade>               get_trade_history( const string& base, const string& quote, fc::time_point_sec start, fc::time_point_sec stop, unsigned limit = 100 )const;
+      market_ticker                      make_ticker( const asset_object& base, const asset_object& quote, const market_ticker_object* t )const;
 
       // Witnesses
       vector<optional<witness_object>> get_witnesses(const vector<witness_id_type>& witness_ids)const;
@@ -771,6 +776,22 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       void on_objects_changed(const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts);
       void on_objects_removed(const vector<object_id_type>& ids, const vector<const object*>& objs, const flat_set<account_id_type>& impacted_accounts);
       void on_applied_block();
+      void on_pending_transaction( const signed_transaction& trx );
+
+      /** everything but the votes of a @ref full_account, which refer to objects that change with every block */
+      full_account build_full_account( const account_object& account, const full_account_query& query )const;
+      void invalidate_full_accounts( const flat_set<account_id_type>& impacted_accounts );
+
+      struct cached_full_account
+      {
+         full_account_query query;
+         full_account       result;
+      };
+      /// results of get_full_accounts until the account is impacted by a change, see invalidate_full_accounts
+      std::map<account_id_type, cached_full_account> _full_account_cache;
+      /// a pending transaction was applied since the last block, its effects may not be in the next block
+      bool _full_account_cache_has_pending = false;
+      uint32_t _full_account_cache_block_num = 0;
 
       bool _notify_remove_create = false;
       mutable fc::bloom_filter _subscribe_filter;
@@ -814,6 +835,7 @@ database_api_impl::database_api_impl( graphene::chain::database& db ):_db(db)
    _applied_block_connection = _db.applied_block.connect([this](const signed_block&){ on_applied_block(); });
 
    _pending_trx_connection = _db.on_pending_transaction.connect([this](const signed_transaction& trx ){
+                         on_pending_transaction( trx );
                          if( _pending_trx_callback ) _pending_trx_callback( fc::variant(trx) );
                       });
 }
@@ -1053,52 +1075,27 @@ vector<vector<account_id_type>> database_api::get_key_references( vector<public_
  */
 vector<vector<account_id_type>> database_api_impl::get_key_references( vector<public_key_type> keys )const
 {
-   wdump( (keys) );
+   const auto& idx = _db.get_index_type<account_index>();
+   const auto& aidx = dynamic_cast<const primary_index<account_index>&>(idx);
+   const auto& refs = aidx.get_secondary_index<graphene::chain::key_reference_index>();
+
    vector< vector<account_id_type> > final_result;
    final_result.reserve(keys.size());
 
    for( auto& key : keys )
    {
-
-      address a1( pts_address(key, false, 56) );
-      address a2( pts_address(key, true, 56) );
-      address a3( pts_address(key, false, 0)  );
-      address a4( pts_address(key, true, 0)  );
-      address a5( key );
-
       subscribe_to_item( key );
-      subscribe_to_item( a1 );
-      subscribe_to_item( a2 );
-      subscribe_to_item( a3 );
-      subscribe_to_item( a4 );
-      subscribe_to_item( a5 );
-
-      const auto& idx = _db.get_index_type<account_index>();
-      const auto& aidx = dynamic_cast<const primary_index<account_index>&>(idx);
-      const auto& refs = aidx.get_secondary_index<graphene::chain::account_member_index>();
-      auto itr = refs.account_to_key_memberships.find(key);
-      vector<account_id_type> result;
-
-      for( auto& a : {a1,a2,a3,a4,a5} )
+      // the legacy address forms are only subscribed to if an account can reference them
+      if( !refs.address_to_accounts.empty() )
       {
-          auto itr = refs.account_to_address_memberships.find(a);
-          if( itr != refs.account_to_address_memberships.end() )
-          {
-             result.reserve( itr->second.size() );
-             for( auto item : itr->second )
-             {
-                wdump((a)(item)(item(_db).name));
-                result.push_back(item);
-             }
-          }
+         subscribe_to_item( address( pts_address(key, false, 56) ) );
+         subscribe_to_item( address( pts_address(key, true, 56) ) );
+         subscribe_to_item( address( pts_address(key, false, 0) ) );
+         subscribe_to_item( address( pts_address(key, true, 0) ) );
       }
+      subscribe_to_item( address( key ) );
 
-      if( itr != refs.account_to_key_memberships.end() )
-      {
-         result.reserve( itr->second.size() );
-         for( auto item : itr->second ) result.push_back(item);
-      }
-      final_result.emplace_back( std::move(result) );
+      final_result.emplace_back( refs.get_key_references( key ) );
    }
 
    for( auto i : final_result )
@@ -1129,11 +1126,8 @@ bool database_api_impl::is_public_key_registered(string public_key) const
     }
     const auto& idx = _db.get_index_type<account_index>();
     const auto& aidx = dynamic_cast<const primary_index<account_index>&>(idx);
-    const auto& refs = aidx.get_secondary_index<graphene::chain::account_member_index>();
-    auto itr = refs.account_to_key_memberships.find(key);
-    bool is_known = itr != refs.account_to_key_memberships.end();
-
-    return is_known;
+    const auto& refs = aidx.get_secondary_index<graphene::chain::key_reference_index>();
+    return refs.is_key_referenced(key);
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -1169,7 +1163,20 @@ std::map<string,full_account> database_api::get_full_accounts( const vector<stri
 
 std::map<std::string, full_account> database_api_impl::get_full_accounts( const vector<std::string>& names_or_ids, bool subscribe)
 {
-   idump((names_or_ids));
+   return get_full_accounts_paged( names_or_ids, subscribe, full_account_query() );
+}
+
+std::map<string,full_account> database_api::get_full_accounts_paged( const vector<string>& names_or_ids, bool subscribe,
+                                                                     const full_account_query& query )
+{
+   return my->get_full_accounts_paged( names_or_ids, subscribe, query );
+}
+
+std::map<std::string, full_account> database_api_impl::get_full_accounts_paged( const vector<std::string>& names_or_ids,
+                                                                                bool subscribe,
+                                                                                const full_account_query& query )
+{
+   FC_ASSERT( query.limit > 0 && query.limit <= 1000 );
    std::map<std::string, full_account> results;
 
    for (const std::string& account_name_or_id : names_or_ids)
@@ -1194,88 +1201,119 @@ std::map<std::string, full_account> database_api_impl::get_full_accounts( const
          subscribe_to_item( account->id );
       }
 
-      // fc::mutable_variant_object full_account;
-      full_account acnt;
-      acnt.account = *account;
-      acnt.statistics = account->statistics(_db);
-      acnt.registrar_name = account->registrar(_db).name;
-      acnt.referrer_name = account->referrer(_db).name;
-      acnt.lifetime_referrer_name = account->lifetime_referrer(_db).name;
-      acnt.votes = lookup_vote_ids( vector<vote_id_type>(account->options.votes.begin(),account->options.votes.end()) );
-
-      // Add the account itself, its statistics object, cashback balance, and referral account names
-      /*
-      full_account("account", *account)("statistics", account->statistics(_db))
-            ("registrar_name", account->registrar(_db).name)("referrer_name", account->referrer(_db).name)
-            ("lifetime_referrer_name", account->lifetime_referrer(_db).name);
-            */
-      if (account->cashback_vb)
+      auto cached = _full_account_cache.find( account->id );
+      if( cached == _full_account_cache.end() || !( cached->second.query == query ) )
       {
-         acnt.cashback_balance = account->cashback_balance(_db);
+         if( cached == _full_account_cache.end() && _full_account_cache.size() >= 10000 )
+            _full_account_cache.clear();
+         cached_full_account& entry = _full_account_cache[ account->id ];
+         entry.query = query;
+         entry.result = build_full_account( *account, query );
+         cached = _full_account_cache.find( account->id );
       }
-      // Add the account's proposals
-      const auto& proposal_idx = _db.get_index_type<proposal_index>();
-      const auto& pidx = dynamic_cast<const primary_index<proposal_index>&>(proposal_idx);
-      const auto& proposals_by_account = pidx.get_secondary_index<graphene::chain::required_approval_index>();
-      auto  required_approvals_itr = proposals_by_account._account_to_proposals.find( account->id );
-      if( required_approvals_itr != proposals_by_account._account_to_proposals.end() )
-      {
-         acnt.proposals.reserve( required_approvals_itr->second.size() );
-         for( auto proposal_id : required_approvals_itr->second )
-            acnt.proposals.push_back( proposal_id(_db) );
-      }
-
-
-      // Add the account's balances
-      auto balance_range = _db.get_index_type<account_balance_index>().indices().get<by_account_asset>().equal_range(boost::make_tuple(account->id));
-      //vector<account_balance_object> balances;
-      std::for_each(balance_range.first, balance_range.second,
-                    [&acnt](const account_balance_object& balance) {
-                       acnt.balances.emplace_back(balance);
-                    });
 
-      // Add the account's vesting balances
-      auto vesting_range = _db.get_index_type<vesting_balance_index>().indices().get<by_account>().equal_range(account->id);
-      std::for_each(vesting_range.first, vesting_range.second,
-                    [&acnt](const vesting_balance_object& balance) {
-                       acnt.vesting_balances.emplace_back(balance);
-                    });
+      full_account& acnt = results[account_name_or_id];
+      acnt = cached->second.result;
+      acnt.votes = lookup_vote_ids( vector<vote_id_type>(account->options.votes.begin(),account->options.votes.end()) );
+   }
+   return results;
+}
 
-      // Add the account's orders
-      auto order_range = _db.get_index_type<limit_order_index>().indices().get<by_account>().equal_range(account->id);
-      std::for_each(order_range.first, order_range.second,
-                    [&acnt] (const limit_order_object& order) {
-                       acnt.limit_orders.emplace_back(order);
-                    });
-      auto call_range = _db.get_index_type<call_order_index>().indices().get<by_account>().equal_range(account->id);
-      std::for_each(call_range.first, call_range.second,
-                    [&acnt] (const call_order_object& call) {
-                       acnt.call_orders.emplace_back(call);
-                    });
-      auto settle_range = _db.get_index_type<force_settlement_index>().indices().get<by_account>().equal_range(account->id);
-      std::for_each(settle_range.first, settle_range.second,
-                    [&acnt] (const force_settlement_object& settle) {
-                       acnt.settle_orders.emplace_back(settle);
-                    });
+/// Appends the converted items of [itr, end) to @p out up to @p limit items, returns whether any were left out
+template< typename Iterator, typename Result, typename Convert >
+static bool copy_page( Iterator itr, const Iterator& end, vector<Result>& out, uint32_t limit, Convert convert )
+{
+   for( ; itr != end; ++itr )
+   {
+      if( out.size() >= limit )
+         return true;
+      out.emplace_back( convert( *itr ) );
+   }
+   return false;
+}
 
-      // get assets issued by user
-      auto asset_range = _db.get_index_type<asset_index>().indices().get<by_issuer>().equal_range(account->id);
-      std::for_each(asset_range.first, asset_range.second,
-                    [&acnt] (const asset_object& asset) {
-                       acnt.assets.emplace_back(asset.id);
-                    });
+template< typename Iterator, typename Result >
+static bool copy_page( Iterator itr, const Iterator& end, vector<Result>& out, uint32_t limit )
+{
+   return copy_page( itr, end, out, limit, []( const Result& r ) -> const Result& { return r; } );
+}
 
-      // get withdraws permissions
-      auto withdraw_range = _db.get_index_type<withdraw_permission_index>().indices().get<by_from>().equal_range(account->id);
-      std::for_each(withdraw_range.first, withdraw_range.second,
-                    [&acnt] (const withdraw_permission_object& withdraw) {
-                       acnt.withdraws.emplace_back(withdraw);
-                    });
+full_account database_api_impl::build_full_account( const account_object& account, const full_account_query& query )const
+{
+   const uint32_t limit = query.limit;
 
+   // Add the account itself, its statistics object, cashback balance, and referral account names
+   full_account acnt;
+   acnt.account = account;
+   acnt.statistics = account.statistics(_db);
+   acnt.registrar_name = account.registrar(_db).name;
+   acnt.referrer_name = account.referrer(_db).name;
+   acnt.lifetime_referrer_name = account.lifetime_referrer(_db).name;
+   if (account.cashback_vb)
+   {
+      acnt.cashback_balance = account.cashback_balance(_db);
+   }
 
-      results[account_name_or_id] = acnt;
+   // Add the account's proposals
+   const auto& proposal_idx = _db.get_index_type<proposal_index>();
+   const auto& pidx = dynamic_cast<const primary_index<proposal_index>&>(proposal_idx);
+   const auto& proposals_by_account = pidx.get_secondary_index<graphene::chain::required_approval_index>();
+   auto  required_approvals_itr = proposals_by_account._account_to_proposals.find( account.id );
+   if( required_approvals_itr != proposals_by_account._account_to_proposals.end() )
+   {
+      const auto& proposals = required_approvals_itr->second;
+      acnt.more_data_available.proposals = copy_page( proposals.lower_bound( query.proposals_start ), proposals.end(),
+            acnt.proposals, limit, [this]( proposal_id_type id ) -> const proposal_object& { return id(_db); } );
    }
-   return results;
+
+   // Add the account's balances
+   const auto& balance_idx = _db.get_index_type<account_balance_index>().indices().get<by_account_asset>();
+   acnt.more_data_available.balances = copy_page(
+         balance_idx.lower_bound( boost::make_tuple( account.id, query.balances_start ) ),
+         balance_idx.upper_bound( boost::make_tuple( account.id ) ), acnt.balances, limit );
+
+   // Add the account's vesting balances
+   const auto& vesting_idx = _db.get_index_type<vesting_balance_index>().indices().get<by_account>();
+   acnt.more_data_available.vesting_balances = copy_page(
+         vesting_idx.lower_bound( boost::make_tuple( account.id, object_id_type( query.vesting_balances_start ) ) ),
+         vesting_idx.upper_bound( boost::make_tuple( account.id ) ), acnt.vesting_balances, limit );
+
+   // Add the account's orders
+   const auto& order_idx = _db.get_index_type<limit_order_index>().indices().get<by_account>();
+   acnt.more_data_available.limit_orders = copy_page(
+         order_idx.lower_bound( boost::make_tuple( account.id, object_id_type( query.limit_orders_start ) ) ),
+         order_idx.upper_bound( boost::make_tuple( account.id ) ), acnt.limit_orders, limit );
+   const auto& call_idx = _db.get_index_type<call_order_index>().indices().get<by_account>();
+   acnt.more_data_available.call_orders = copy_page(
+         call_idx.lower_bound( boost::make_tuple( account.id, query.call_orders_start ) ),
+         call_idx.upper_bound( boost::make_tuple( account.id ) ), acnt.call_orders, limit );
+   const auto& settle_idx = _db.get_index_type<force_settlement_index>().indices().get<by_account>();
+   acnt.more_data_available.settle_orders = copy_page(
+         settle_idx.lower_bound( boost::make_tuple( account.id, object_id_type( query.settle_orders_start ) ) ),
+         settle_idx.upper_bound( boost::make_tuple( account.id ) ), acnt.settle_orders, limit );
+
+   // get assets issued by user
+   const auto& asset_idx = _db.get_index_type<asset_index>().indices().get<by_issuer>();
+   acnt.more_data_available.assets = copy_page(
+         asset_idx.lower_bound( boost::make_tuple( account.id, object_id_type( query.assets_start ) ) ),
+         asset_idx.upper_bound( boost::make_tuple( account.id ) ), acnt.assets, limit,
+         []( const asset_object& a ) { return a.get_id(); } );
+
+   // get withdraws permissions
+   const auto& withdraw_idx = _db.get_index_type<withdraw_permission_index>().indices().get<by_from>();
+   acnt.more_data_available.withdraws = copy_page(
+         withdraw_idx.lower_bound( boost::make_tuple( account.id, object_id_type( query.withdraws_start ) ) ),
+         withdraw_idx.upper_bound( boost::make_tuple( account.id ) ), acnt.withdraws, limit );
+
+   return acnt;
+}
+
+void database_api_impl::invalidate_full_accounts( const flat_set<account_id_type>& impacted_accounts )
+{
+   if( _full_account_cache.empty() )
+      return;
+   for( const account_id_type& account : impacted_accounts )
+      _full_account_cache.erase( account );
 }
 
 optional<account_object> database_api::get_account_by_name( string name )const
@@ -1695,9 +1733,39 @@ market_ticker database_api_impl::get_ticker( const string& base, const string& q
     FC_ASSERT( assets[0], "Invalid base asset symbol: ${s}", ("s",base) );
     FC_ASSERT( assets[1], "Invalid quote asset symbol: ${s}", ("s",quote) );
 
+    try {
+        asset_id_type a = assets[0]->id;
+        asset_id_type b = assets[1]->id;
+        if( a > b ) std::swap( a, b );
+
+        const auto& ticker_idx = _db.get_index_type<market_ticker_index>().indices().get<by_market>();
+        auto itr = ticker_idx.find( boost::make_tuple( a, b ) );
+        return make_ticker( *assets[0], *assets[1], itr == ticker_idx.end() ? nullptr : &*itr );
+    } FC_CAPTURE_AND_RETHROW( (base)(quote) )
+}
+
+vector<market_ticker> database_api::get_all_tickers()const
+{
+    return my->get_all_tickers();
+}
+
+vector<market_ticker> database_api_impl::get_all_tickers()const
+{
+    const auto& ticker_idx = _db.get_index_type<market_ticker_index>().indices().get<by_market>();
+
+    vector<market_ticker> result;
+    result.reserve( ticker_idx.size() );
+    for( const market_ticker_object& t : ticker_idx )
+       result.push_back( make_ticker( t.base(_db), t.quote(_db), &t ) );
+
+    return result;
+}
+
+market_ticker database_api_impl::make_ticker( const asset_object& base, const asset_object& quote, const market_ticker_object* t )const
+{
     market_ticker result;
-    result.base = base;
-    result.quote = quote;
+    result.base = base.symbol;
+    result.quote = quote.symbol;
     result.latest = 0;
     result.lowest_ask = 0;
     result.highest_bid = 0;
@@ -1705,45 +1773,28 @@ market_ticker database_api_impl::get_ticker( const string& base, const string& q
     result.base_volume = 0;
     result.quote_volume = 0;
 
-    try {
-        const fc::time_point_sec now = fc::time_point::now();
-        const fc::time_point_sec yesterday = fc::time_point_sec( now.sec_since_epoch() - 86400 );
-        const auto batch_size = 100;
-
-        vector<market_trade> trades = get_trade_history( base, quote, now, yesterday, batch_size );
-        if( !trades.empty() )
+    if( t != nullptr )
+    {
+        const bool flipped = t->base != base.id;
+        auto amount_to_real = [&]( share_type a, const asset_object& asst ) { return double( a.value ) / pow( 10, asst.precision ); };
+        auto price_to_real = [&]( share_type t_base, share_type t_quote )
         {
-            result.latest = trades[0].price;
+            if( flipped ) std::swap( t_base, t_quote );
+            return amount_to_real( t_base, base ) / amount_to_real( t_quote, quote );
+        };
 
-            while( !trades.empty() )
-            {
-                for( const market_trade& t: trades )
-                {
-                    result.base_volume += t.value;
-                    result.quote_volume += t.amount;
-                }
-
-                trades = get_trade_history( base, quote, trades.back().date, yesterday, batch_size );
-            }
+        if( t->latest_quote != 0 )
+            result.latest = price_to_real( t->latest_base, t->latest_quote );
+        result.base_volume = amount_to_real( flipped ? t->quote_volume : t->base_volume, base );
+        result.quote_volume = amount_to_real( flipped ? t->base_volume : t->quote_volume, quote );
 
-            const auto last_trade_yesterday = get_trade_history( base, quote, yesterday, fc::time_point_sec(), 1 );
-            if( !last_trade_yesterday.empty() )
-            {
-                const auto price_yesterday = last_trade_yesterday[0].price;
-                result.percent_change = ( (result.latest / price_yesterday) - 1 ) * 100;
-            }
-        }
-        else
-        {
-            const auto last_trade = get_trade_history( base, quote, now, fc::time_point_sec(), 1 );
-            if( !last_trade.empty() )
-                result.latest = last_trade[0].price;
-        }
+        if( t->oldest_time != fc::time_point_sec::maximum() && t->open_quote != 0 )
+            result.percent_change = ( ( result.latest / price_to_real( t->open_base, t->open_quote ) ) - 1 ) * 100;
+    }
 
-        const auto orders = get_order_book( base, quote, 1 );
-        if( !orders.asks.empty() ) result.lowest_ask = orders.asks[0].price;
-        if( !orders.bids.empty() ) result.highest_bid = orders.bids[0].price;
-    } FC_CAPTURE_AND_RETHROW( (base)(quote) )
+    const auto orders = get_order_book( result.base, result.quote, 1 );
+    if( !orders.asks.empty() ) result.lowest_ask = orders.asks[0].price;
+    if( !orders.bids.empty() ) result.highest_bid = orders.bids[0].price;
 
     return result;
 }
@@ -2437,6 +2488,7 @@ void database_api_impl::broadcast_market_updates( const market_queue_type& queue
 
 void database_api_impl::on_objects_removed( const vector<object_id_type>& ids, const vector<const object*>& objs, const flat_set<account_id_type>& impacted_accounts)
 {
+   invalidate_full_accounts( impacted_accounts );
    handle_object_changed(_notify_remove_create, false, ids, impacted_accounts,
       [objs](object_id_type id) -> const object* {
          auto it = std::find_if(
@@ -2453,6 +2505,7 @@ void database_api_impl::on_objects_removed( const vector<object_id_type>& ids, c
 
 void database_api_impl::on_objects_new(const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts)
 {
+   invalidate_full_accounts( impacted_accounts );
    handle_object_changed(_notify_remove_create, true, ids, impacted_accounts,
       std::bind(&object_database::find_object, &_db, std::placeholders::_1)
    );
@@ -2460,6 +2513,7 @@ void database_api_impl::on_objects_new(const vector<object_id_type>& ids, const
 
 void database_api_impl::on_objects_changed(const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts)
 {
+   invalidate_full_accounts( impacted_accounts );
    handle_object_changed(false, true, ids, impacted_accounts,
       std::bind(&object_database::find_object, &_db, std::placeholders::_1)
    );
@@ -2516,8 +2570,24 @@ void database_api_impl::handle_object_changed(bool force_notify, bool full_objec
 /** note: this method cannot yield because it is called in the middle of
  * apply a block.
  */
+void database_api_impl::on_pending_transaction( const signed_transaction& trx )
+{
+   // changes made by pending transactions are not reported through the object notifications
+   flat_set<account_id_type> impacted_accounts;
+   transaction_get_impacted_accounts( trx, impacted_accounts );
+   invalidate_full_accounts( impacted_accounts );
+   _full_account_cache_has_pending = true;
+}
+
 void database_api_impl::on_applied_block()
 {
+   // pending transactions are undone before a block is applied and may not come back, a fork switch undoes blocks
+   // without notifications
+   if( _full_account_cache_has_pending || _db.head_block_num() != _full_account_cache_block_num + 1 )
+      _full_account_cache.clear();
+   _full_account_cache_has_pending = false;
+   _full_account_cache_block_num = _db.head_block_num();
+
    if (_block_applied_callback)
    {
       auto capture_this = shared_from_this();
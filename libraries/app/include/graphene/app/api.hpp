@@ -242,6 +242,26 @@ namespace graphene { namespace app {
           */
          std::vector<net::peer_status> get_connected_peers() const;
 
+         /**
+          * @brief Get the block sync window, delivery rate and round trip time measured for each peer
+          */
+         std::vector<net::peer_sync_statistics> get_sync_statistics() const;
+
+         /**
+          * @brief Get the size and hit counters of the cache of recent blocks and transactions relayed to peers
+          */
+         net::message_cache_statistics get_message_cache_statistics() const;
+
+         /**
+          * @brief Get the traffic with each peer, broken out by message type and by send queue
+          */
+         std::vector<net::peer_traffic_statistics> get_peer_traffic_statistics() const;
+
+         /**
+          * @brief Get how many transactions peers sent us and why those that weren't relayed were dropped
+          */
+         net::transaction_admission_statistics get_transaction_admission_statistics() const;
+
          /**
           * @brief Get advanced node parameters, such as desired and max
           *        number of connections
@@ -260,6 +280,20 @@ namespace graphene { namespace app {
           */
          std::vector<net::potential_peer_record> get_potential_peers() const;
 
+         /**
+          * @brief Return the size of the pending transaction pool and how many transactions it accepted,
+          *        evicted, refused and expired
+          */
+         graphene::chain::pending_transaction_pool_stats get_pending_transaction_pool_stats() const;
+
+         /**
+          * @brief Start writing the state at the last irreversible block to snapshots/<file_name> in the blockchain
+          *        data directory, to be loaded by another node with --load-snapshot
+          * @param file_name plain file name, without directories
+          * @return the header of the snapshot, whose file appears once all of it has been written in the background
+          */
+         graphene::chain::state_snapshot_header create_state_snapshot( const std::string& file_name );
+
       private:
          application& _app;
    };
@@ -407,9 +441,15 @@ FC_API(graphene::app::network_node_api,
        (get_info)
        (add_node)
        (get_connected_peers)
+       (get_sync_statistics)
+       (get_message_cache_statistics)
+       (get_peer_traffic_statistics)
+       (get_transaction_admission_statistics)
        (get_potential_peers)
        (get_advanced_node_parameters)
        (set_advanced_node_parameters)
+       (get_pending_transaction_pool_stats)
+       (create_state_snapshot)
      )
 FC_API(graphene::app::crypto_api,
        (blind_sign)
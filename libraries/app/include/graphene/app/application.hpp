@@ -80,6 +80,12 @@ namespace graphene { namespace app {
          net::node_ptr                    p2p_node();
          std::shared_ptr<chain::database> chain_database()const;
 
+         /**
+          * Starts writing the state at the last irreversible block to @p file.  The snapshot is written a slice at
+          * a time by a task of its own while the node keeps running, and is renamed to @p file once complete.
+          */
+         chain::state_snapshot_header create_state_snapshot( const fc::path& file );
+
          void set_block_production(bool producing_blocks);
          fc::optional< api_access_info > get_api_access_info( const string& username )const;
          void set_api_access_info(const string& username, api_access_info&& permissions);
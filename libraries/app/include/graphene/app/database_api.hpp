@@ -253,9 +253,23 @@ class database_api
        * accounts. If any of the strings in @ref names_or_ids cannot be tied to an account, that input will be
        * ignored. All other accounts will be retrieved and subscribed.
        *
+       * Each list of objects holds at most 100 entries, see @ref get_full_accounts_paged for the remaining ones.
        */
       std::map<string,full_account> get_full_accounts( const vector<string>& names_or_ids, bool subscribe );
 
+      /**
+       * @brief Fetch a page of the objects relevant to the specified accounts and optionally subscribe to updates
+       * @param names_or_ids Each item must be the name or ID of an account to retrieve
+       * @param subscribe Whether to subscribe to updates of the accounts
+       * @param query Maximum number of entries (at most 1000) and first entry of each list of the results
+       * @return Map of string from @ref names_or_ids to the corresponding account
+       *
+       * @ref get_full_accounts returns the first page with the default query.  Results are cached until an object
+       * relevant to the account changes, so that repeated calls within a block do not walk the indexes again.
+       */
+      std::map<string,full_account> get_full_accounts_paged( const vector<string>& names_or_ids, bool subscribe,
+                                                             const full_account_query& query );
+
       optional<account_object> get_account_by_name( string name )const;
 
       /**
@@ -403,6 +417,12 @@ class database_api
        */
       market_ticker get_ticker( const string& base, const string& quote )const;
 
+      /**
+       * @brief Returns the ticker of every market that has traded, quoted with the lower asset id as base
+       * @return The market tickers for the past 24 hours.
+       */
+      vector<market_ticker> get_all_tickers()const;
+
       /**
        * @brief Returns the 24 hour volume for the market assetA:assetB
        * @param a String name of the first asset
@@ -661,6 +681,7 @@ FC_API(graphene::app::database_api,
    // Accounts
    (get_accounts)
    (get_full_accounts)
+   (get_full_accounts_paged)
    (get_account_by_name)
    (get_account_references)
    (lookup_account_names)
@@ -688,6 +709,7 @@ FC_API(graphene::app::database_api,
    (subscribe_to_market)
    (unsubscribe_from_market)
    (get_ticker)
+   (get_all_tickers)
    (get_24_volume)
    (get_trade_history)
 
@@ -28,9 +28,50 @@
 #include <graphene/chain/market_evaluator.hpp>
 #include <graphene/chain/withdraw_permission_object.hpp>
 
+#include <tuple>
+
 namespace graphene { namespace app {
    using namespace graphene::chain;
 
+   /**
+    * Limits the lists returned in a @ref full_account.  Each list is ordered by object id, except balances and call
+    * orders which are ordered by asset id, and starts at the first entry not below its start value.  A list which was
+    * cut off at @ref limit is flagged in @ref full_account::more_data_available, the next page starts after its last
+    * entry.
+    */
+   struct full_account_query
+   {
+      uint32_t                    limit = 100;
+      asset_id_type               balances_start;
+      vesting_balance_id_type     vesting_balances_start;
+      limit_order_id_type         limit_orders_start;
+      asset_id_type               call_orders_start;
+      force_settlement_id_type    settle_orders_start;
+      proposal_id_type            proposals_start;
+      asset_id_type               assets_start;
+      withdraw_permission_id_type withdraws_start;
+
+      bool operator == ( const full_account_query& o )const
+      {
+         return std::tie( limit, balances_start, vesting_balances_start, limit_orders_start, call_orders_start,
+                          settle_orders_start, proposals_start, assets_start, withdraws_start )
+             == std::tie( o.limit, o.balances_start, o.vesting_balances_start, o.limit_orders_start, o.call_orders_start,
+                          o.settle_orders_start, o.proposals_start, o.assets_start, o.withdraws_start );
+      }
+   };
+
+   struct more_data
+   {
+      bool balances = false;
+      bool vesting_balances = false;
+      bool limit_orders = false;
+      bool call_orders = false;
+      bool settle_orders = false;
+      bool proposals = false;
+      bool assets = false;
+      bool withdraws = false;
+   };
+
    struct full_account
    {
       account_object                   account;
@@ -48,10 +89,34 @@ namespace graphene { namespace app {
       vector<proposal_object>          proposals;
       vector<asset_id_type>            assets;
       vector<withdraw_permission_object> withdraws;
+      more_data                        more_data_available;
    };
 
 } }
 
+FC_REFLECT( graphene::app::full_account_query,
+            (limit)
+            (balances_start)
+            (vesting_balances_start)
+            (limit_orders_start)
+            (call_orders_start)
+            (settle_orders_start)
+            (proposals_start)
+            (assets_start)
+            (withdraws_start)
+          )
+
+FC_REFLECT( graphene::app::more_data,
+            (balances)
+            (vesting_balances)
+            (limit_orders)
+            (call_orders)
+            (settle_orders)
+            (proposals)
+            (assets)
+            (withdraws)
+          )
+
 FC_REFLECT( graphene::app::full_account,
             (account)
             (statistics)
@@ -68,4 +133,5 @@ FC_REFLECT( graphene::app::full_account,
             (proposals)
             (assets)
             (withdraws)
+            (more_data_available)
           )
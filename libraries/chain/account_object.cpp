@@ -110,34 +110,13 @@ void account_statistics_object::pay_fee( share_type core_fee, share_type cashbac
       pending_vested_fees += core_fee;
 }
 
-set<account_id_type> account_member_index::get_account_members(const account_object& a)const
+void account_member_index::get_account_members( const account_object& a, flat_set<account_id_type>& result )
 {
-   set<account_id_type> result;
-   for( auto auth : a.owner.account_auths )
+   result.clear();
+   for( const auto& auth : a.owner.account_auths )
       result.insert(auth.first);
-   for( auto auth : a.active.account_auths )
+   for( const auto& auth : a.active.account_auths )
       result.insert(auth.first);
-   return result;
-}
-set<public_key_type> account_member_index::get_key_members(const account_object& a)const
-{
-   set<public_key_type> result;
-   for( auto auth : a.owner.key_auths )
-      result.insert(auth.first);
-   for( auto auth : a.active.key_auths )
-      result.insert(auth.first);
-   result.insert( a.options.memo_key );
-   return result;
-}
-set<address> account_member_index::get_address_members(const account_object& a)const
-{
-   set<address> result;
-   for( auto auth : a.owner.address_auths )
-      result.insert(auth.first);
-   for( auto auth : a.active.address_auths )
-      result.insert(auth.first);
-   result.insert( a.options.memo_key );
-   return result;
 }
 
 void account_member_index::object_inserted(const object& obj)
@@ -145,17 +124,9 @@ void account_member_index::object_inserted(const object& obj)
     assert( dynamic_cast<const account_object*>(&obj) ); // for debug only
     const account_object& a = static_cast<const account_object&>(obj);
 
-    auto account_members = get_account_members(a);
-    for( auto item : account_members )
-       account_to_account_memberships[item].insert(obj.id);
-
-    auto key_members = get_key_members(a);
-    for( auto item : key_members )
-       account_to_key_memberships[item].insert(obj.id);
-
-    auto address_members = get_address_members(a);
-    for( auto item : address_members )
-       account_to_address_memberships[item].insert(obj.id);
+    get_account_members( a, after_account_members );
+    for( auto item : after_account_members )
+       account_to_account_memberships[item].insert(a.id);
 }
 
 void account_member_index::object_removed(const object& obj)
@@ -163,28 +134,20 @@ void account_member_index::object_removed(const object& obj)
     assert( dynamic_cast<const account_object*>(&obj) ); // for debug only
     const account_object& a = static_cast<const account_object&>(obj);
 
-    auto key_members = get_key_members(a);
-    for( auto item : key_members )
-       account_to_key_memberships[item].erase( obj.id );
-
-    auto address_members = get_address_members(a);
-    for( auto item : address_members )
-       account_to_address_memberships[item].erase( obj.id );
-
-    auto account_members = get_account_members(a);
-    for( auto item : account_members )
-       account_to_account_memberships[item].erase( obj.id );
+    get_account_members( a, before_account_members );
+    for( auto item : before_account_members )
+    {
+       auto itr = account_to_account_memberships.find(item);
+       if( itr != account_to_account_memberships.end() && itr->second.erase(a.id) && itr->second.empty() )
+          account_to_account_memberships.erase(itr);
+    }
 }
 
 void account_member_index::about_to_modify(const object& before)
 {
-   before_key_members.clear();
-   before_account_members.clear();
    assert( dynamic_cast<const account_object*>(&before) ); // for debug only
    const account_object& a = static_cast<const account_object&>(before);
-   before_key_members     = get_key_members(a);
-   before_address_members = get_address_members(a);
-   before_account_members = get_account_members(a);
+   get_account_members( a, before_account_members );
 }
 
 void account_member_index::object_modified(const object& after)
@@ -192,66 +155,132 @@ void account_member_index::object_modified(const object& after)
     assert( dynamic_cast<const account_object*>(&after) ); // for debug only
     const account_object& a = static_cast<const account_object&>(after);
 
-    {
-       set<account_id_type> after_account_members = get_account_members(a);
-       vector<account_id_type> removed; removed.reserve(before_account_members.size());
-       std::set_difference(before_account_members.begin(), before_account_members.end(),
-                           after_account_members.begin(), after_account_members.end(),
-                           std::inserter(removed, removed.end()));
-
-       for( auto itr = removed.begin(); itr != removed.end(); ++itr )
-          account_to_account_memberships[*itr].erase(after.id);
-
-       vector<object_id_type> added; added.reserve(after_account_members.size());
-       std::set_difference(after_account_members.begin(), after_account_members.end(),
-                           before_account_members.begin(), before_account_members.end(),
-                           std::inserter(added, added.end()));
-
-       for( auto itr = added.begin(); itr != added.end(); ++itr )
-          account_to_account_memberships[*itr].insert(after.id);
-    }
-
+    // most modifications do not touch the authorities, the member buffers keep their capacity so comparing them
+    // does not allocate
+    get_account_members( a, after_account_members );
+    if( after_account_members == before_account_members )
+       return;
 
+    for( auto item : before_account_members )
     {
-       set<public_key_type> after_key_members = get_key_members(a);
+       if( after_account_members.find(item) != after_account_members.end() )
+          continue;
+       auto itr = account_to_account_memberships.find(item);
+       if( itr != account_to_account_memberships.end() && itr->second.erase(a.id) && itr->second.empty() )
+          account_to_account_memberships.erase(itr);
+    }
+    for( auto item : after_account_members )
+       if( before_account_members.find(item) == before_account_members.end() )
+          account_to_account_memberships[item].insert(a.id);
+}
 
-       vector<public_key_type> removed; removed.reserve(before_key_members.size());
-       std::set_difference(before_key_members.begin(), before_key_members.end(),
-                           after_key_members.begin(), after_key_members.end(),
-                           std::inserter(removed, removed.end()));
+flat_set<public_key_type> key_reference_index::get_keys( const account_object& a )
+{
+   flat_set<public_key_type> result;
+   result.reserve( a.owner.key_auths.size() + a.active.key_auths.size() + 1 );
+   for( const auto& auth : a.owner.key_auths )
+      result.insert( auth.first );
+   for( const auto& auth : a.active.key_auths )
+      result.insert( auth.first );
+   result.insert( a.options.memo_key );
+   return result;
+}
 
-       for( auto itr = removed.begin(); itr != removed.end(); ++itr )
-          account_to_key_memberships[*itr].erase(after.id);
+flat_set<address> key_reference_index::get_addresses( const account_object& a )
+{
+   flat_set<address> result;
+   for( const auto& auth : a.owner.address_auths )
+      result.insert( auth.first );
+   for( const auto& auth : a.active.address_auths )
+      result.insert( auth.first );
+   return result;
+}
 
-       vector<public_key_type> added; added.reserve(after_key_members.size());
-       std::set_difference(after_key_members.begin(), after_key_members.end(),
-                           before_key_members.begin(), before_key_members.end(),
-                           std::inserter(added, added.end()));
+template< typename Map, typename Key >
+void key_reference_index::update( Map& map, const flat_set<Key>& before, const flat_set<Key>& after,
+                                  account_id_type account )
+{
+   // both sets are sorted, so a single merge pass finds the removed and the added members
+   auto b = before.begin();
+   auto a = after.begin();
+   while( b != before.end() || a != after.end() )
+   {
+      if( a == after.end() || ( b != before.end() && *b < *a ) )
+      {
+         auto itr = map.find( *b );
+         if( itr != map.end() && itr->second.erase( account ) && itr->second.empty() )
+            map.erase( itr );
+         ++b;
+      }
+      else if( b == before.end() || *a < *b )
+      {
+         map[*a].insert( account );
+         ++a;
+      }
+      else
+      {
+         ++a;
+         ++b;
+      }
+   }
+}
 
-       for( auto itr = added.begin(); itr != added.end(); ++itr )
-          account_to_key_memberships[*itr].insert(after.id);
-    }
+void key_reference_index::object_inserted( const object& obj )
+{
+   assert( dynamic_cast<const account_object*>(&obj) ); // for debug only
+   const account_object& a = static_cast<const account_object&>(obj);
+   update( key_to_accounts, flat_set<public_key_type>(), get_keys(a), a.id );
+   update( address_to_accounts, flat_set<address>(), get_addresses(a), a.id );
+}
 
-    {
-       set<address> after_address_members = get_address_members(a);
+void key_reference_index::object_removed( const object& obj )
+{
+   assert( dynamic_cast<const account_object*>(&obj) ); // for debug only
+   const account_object& a = static_cast<const account_object&>(obj);
+   update( key_to_accounts, get_keys(a), flat_set<public_key_type>(), a.id );
+   update( address_to_accounts, get_addresses(a), flat_set<address>(), a.id );
+}
 
-       vector<address> removed; removed.reserve(before_address_members.size());
-       std::set_difference(before_address_members.begin(), before_address_members.end(),
-                           after_address_members.begin(), after_address_members.end(),
-                           std::inserter(removed, removed.end()));
+void key_reference_index::about_to_modify( const object& before )
+{
+   assert( dynamic_cast<const account_object*>(&before) ); // for debug only
+   const account_object& a = static_cast<const account_object&>(before);
+   before_keys = get_keys(a);
+   before_addresses = get_addresses(a);
+}
 
-       for( auto itr = removed.begin(); itr != removed.end(); ++itr )
-          account_to_address_memberships[*itr].erase(after.id);
+void key_reference_index::object_modified( const object& after )
+{
+   assert( dynamic_cast<const account_object*>(&after) ); // for debug only
+   const account_object& a = static_cast<const account_object&>(after);
+   update( key_to_accounts, before_keys, get_keys(a), a.id );
+   update( address_to_accounts, before_addresses, get_addresses(a), a.id );
+}
 
-       vector<address> added; added.reserve(after_address_members.size());
-       std::set_difference(after_address_members.begin(), after_address_members.end(),
-                           before_address_members.begin(), before_address_members.end(),
-                           std::inserter(added, added.end()));
+vector<account_id_type> key_reference_index::get_key_references( const public_key_type& key )const
+{
+   vector<account_id_type> result;
+   if( !address_to_accounts.empty() )
+   {
+      for( const address& a : { address( pts_address( key, false, 56 ) ), address( pts_address( key, true, 56 ) ),
+                                address( pts_address( key, false, 0 ) ), address( pts_address( key, true, 0 ) ),
+                                address( key ) } )
+      {
+         auto itr = address_to_accounts.find( a );
+         if( itr != address_to_accounts.end() )
+            result.insert( result.end(), itr->second.begin(), itr->second.end() );
+      }
+   }
 
-       for( auto itr = added.begin(); itr != added.end(); ++itr )
-          account_to_address_memberships[*itr].insert(after.id);
-    }
+   auto itr = key_to_accounts.find( key );
+   if( itr != key_to_accounts.end() )
+      result.insert( result.end(), itr->second.begin(), itr->second.end() );
+   return result;
+}
 
+bool key_reference_index::is_key_referenced( const public_key_type& key )const
+{
+   return key_to_accounts.find( key ) != key_to_accounts.end();
 }
 
 void account_referrer_index::object_inserted( const object& obj )
@@ -158,3 +158,30 @@ string asset_object::amount_to_string(share_type amount) const
       result += "." + fc::to_string(scaled_precision.value + decimals).erase(0,1);
    return result;
 }
+
+void market_issued_asset_index::object_inserted( const object& obj )
+{
+   assert( dynamic_cast<const asset_object*>(&obj) ); // for debug only
+   const asset_object& a = static_cast<const asset_object&>(obj);
+   if( !a.bitasset_data_id.valid() )
+      return;
+   bitasset_to_asset[*a.bitasset_data_id] = a.id;
+   changed_assets.insert( a.id );
+}
+
+void market_issued_asset_index::object_removed( const object& obj )
+{
+   assert( dynamic_cast<const asset_object*>(&obj) ); // for debug only
+   const asset_object& a = static_cast<const asset_object&>(obj);
+   if( a.bitasset_data_id.valid() )
+      bitasset_to_asset.erase( *a.bitasset_data_id );
+   changed_assets.erase( a.id );
+}
+
+void market_issued_asset_index::object_modified( const object& after )
+{
+   assert( dynamic_cast<const asset_object*>(&after) ); // for debug only
+   const asset_object& a = static_cast<const asset_object&>(after);
+   if( a.bitasset_data_id.valid() )
+      changed_assets.insert( a.id );
+}
@@ -23,9 +23,12 @@
  */
 #include <graphene/chain/block_database.hpp>
 #include <graphene/chain/protocol/fee_schedule.hpp>
+#include <fc/compress/zlib.hpp>
 #include <fc/io/raw.hpp>
 #include <fc/smart_ref_impl.hpp>
 
+#include <algorithm>
+
 namespace graphene { namespace chain {
 
 struct index_entry
@@ -34,29 +37,105 @@ struct index_entry
    uint32_t      block_size = 0;
    block_id_type block_id;
 };
+
+/**
+ * Stored in front of the compressed data of a chunk.  The decompressed data is the concatenation of the chunk's
+ * blocks in block number order, the size of each block is kept in its index entry.
+ */
+struct block_chunk_header
+{
+   uint32_t         first_block_num = 0;
+   vector<uint32_t> offsets;
+   uint32_t         compressed_size = 0;
+};
+
+struct decompressed_chunk
+{
+   uint64_t           pos = 0;
+   block_chunk_header header;
+   std::string        data;
+};
  }}
 FC_REFLECT( graphene::chain::index_entry, (block_pos)(block_size)(block_id) );
+FC_REFLECT( graphene::chain::block_chunk_header, (first_block_num)(offsets)(compressed_size) );
 
 namespace graphene { namespace chain {
 
+/// set in index_entry::block_pos when the block is stored in the chunk at the remaining bits' position
+static const uint64_t chunked_flag = uint64_t(1) << 63;
+static const size_t   chunk_cache_size = 8;
+
 void block_database::open( const fc::path& dbdir )
 { try {
    fc::create_directories(dbdir);
+   _dbdir = dbdir;
+   _blocks_per_chunk = 0;
+   _next_chunk = 0;
+   _chunk_cache.clear();
+   _first_block_num = 1;
+   if( fc::exists( dbdir/"first_block" ) )
+   {
+      std::ifstream in( (dbdir/"first_block").generic_string().c_str() );
+      FC_ASSERT( in >> _first_block_num && _first_block_num > 0, "Corrupt first_block file in block database" );
+   }
    _block_num_to_pos.exceptions(std::ios_base::failbit | std::ios_base::badbit);
    _blocks.exceptions(std::ios_base::failbit | std::ios_base::badbit);
 
-   if( !fc::exists( dbdir/"index" ) )
+   const bool is_new = !fc::exists( dbdir/"index" );
+   const bool chunked = is_new ? _chunk_size > 0 : fc::exists( dbdir/"chunks" );
+   const fc::path data_file = dbdir / ( chunked ? "chunks" : "blocks" );
+   if( is_new )
    {
      _block_num_to_pos.open( (dbdir/"index").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
-     _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
+     _blocks.open( data_file.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
    }
    else
    {
      _block_num_to_pos.open( (dbdir/"index").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
-     _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+     _blocks.open( data_file.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
    }
+
+   if( chunked )
+   {
+      // the chunks file starts with the number of blocks per chunk
+      if( is_new )
+      {
+         fc::remove_all( dbdir/"raw" );
+         _blocks_per_chunk = _chunk_size;
+         _blocks.write( (const char*)&_blocks_per_chunk, sizeof(_blocks_per_chunk) );
+      }
+      else
+      {
+         _blocks.seekg( 0 );
+         _blocks.read( (char*)&_blocks_per_chunk, sizeof(_blocks_per_chunk) );
+         FC_ASSERT( _blocks_per_chunk > 0, "Corrupt chunks file in block database" );
+      }
+      fc::create_directories( dbdir/"raw" );
+
+      _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
+      _next_chunk = uint32_t( _block_num_to_pos.tellg() / sizeof(index_entry) ) / _blocks_per_chunk;
+      for( fc::directory_iterator itr( dbdir/"raw" ); itr != fc::directory_iterator(); ++itr )
+         _next_chunk = std::min( _next_chunk, uint32_t( std::stoul( (*itr).filename().string() ) ) );
+   }
+   else if( _chunk_size > 0 )
+      wlog( "Block database in ${d} is not chunked, convert it with block_log_util to compress it", ("d",dbdir) );
 } FC_CAPTURE_AND_RETHROW( (dbdir) ) }
 
+void block_database::set_first_block_num( uint32_t block_num )
+{ try {
+   FC_ASSERT( block_num > 0 );
+   const fc::path file = _dbdir / "first_block";
+   const fc::path staging = _dbdir / "first_block.tmp";
+   {
+      std::ofstream out( staging.generic_string().c_str(), std::ios::out | std::ios::trunc );
+      out << block_num;
+      out.flush();
+      FC_ASSERT( out, "Unable to write ${f}", ("f",staging) );
+   }
+   fc::rename( staging, file );
+   _first_block_num = block_num;
+} FC_CAPTURE_AND_RETHROW( (block_num) ) }
+
 bool block_database::is_open()const
 {
   return _blocks.is_open();
@@ -66,12 +145,182 @@ void block_database::close()
 {
   _blocks.close();
   _block_num_to_pos.close();
+  _raw_files.clear();
+  _chunk_cache.clear();
 }
 
 void block_database::flush()
 {
   _blocks.flush();
   _block_num_to_pos.flush();
+  for( auto& raw : _raw_files )
+     raw.second->flush();
+}
+
+fc::path block_database::raw_file_path( uint32_t chunk )const
+{
+   return _dbdir / "raw" / fc::to_string( chunk );
+}
+
+std::fstream& block_database::raw_file( uint32_t chunk )const
+{
+   auto itr = _raw_files.find( chunk );
+   if( itr != _raw_files.end() )
+      return *itr->second;
+
+   const fc::path path = raw_file_path( chunk );
+   auto mode = std::fstream::binary | std::fstream::in | std::fstream::out;
+   if( !fc::exists( path ) )
+      mode |= std::fstream::trunc;
+   std::unique_ptr<std::fstream> file( new std::fstream );
+   file->exceptions( std::ios_base::failbit | std::ios_base::badbit );
+   file->open( path.generic_string().c_str(), mode );
+   return *_raw_files.emplace( chunk, std::move( file ) ).first->second;
+}
+
+std::shared_ptr<const decompressed_chunk> block_database::load_chunk( uint64_t pos )const
+{
+   for( auto itr = _chunk_cache.begin(); itr != _chunk_cache.end(); ++itr )
+   {
+      if( (*itr)->pos == pos )
+      {
+         _chunk_cache.splice( _chunk_cache.begin(), _chunk_cache, itr );
+         return _chunk_cache.front();
+      }
+   }
+
+   auto chunk = std::make_shared<decompressed_chunk>();
+   chunk->pos = pos;
+   uint32_t header_size = 0;
+   _blocks.seekg( pos );
+   _blocks.read( (char*)&header_size, sizeof(header_size) );
+   vector<char> header( header_size );
+   _blocks.read( header.data(), header.size() );
+   chunk->header = fc::raw::unpack<block_chunk_header>( header );
+   std::string compressed( chunk->header.compressed_size, '\0' );
+   _blocks.read( &compressed[0], compressed.size() );
+   chunk->data = fc::zlib_decompress( compressed );
+
+   _chunk_cache.push_front( chunk );
+   if( _chunk_cache.size() > chunk_cache_size )
+      _chunk_cache.pop_back();
+   return chunk;
+}
+
+bool block_database::read_entry( uint32_t block_num, index_entry& e )const
+{
+   auto index_pos = sizeof(e)*block_num;
+   _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
+   if ( _block_num_to_pos.tellg() <= int64_t(index_pos) )
+      return false;
+   _block_num_to_pos.seekg( index_pos );
+   _block_num_to_pos.read( (char*)&e, sizeof(e) );
+   return true;
+}
+
+vector<index_entry> block_database::read_entries( uint32_t first_block_num, uint32_t count )const
+{
+   _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
+   const uint64_t entries_in_index = uint64_t( _block_num_to_pos.tellg() ) / sizeof(index_entry);
+   if( entries_in_index <= first_block_num )
+      return vector<index_entry>();
+   vector<index_entry> entries( std::min<uint64_t>( count, entries_in_index - first_block_num ) );
+   _block_num_to_pos.seekg( sizeof(index_entry) * uint64_t(first_block_num) );
+   _block_num_to_pos.read( (char*)entries.data(), sizeof(index_entry) * entries.size() );
+   return entries;
+}
+
+std::fstream& block_database::data_file( const index_entry& e )const
+{
+   if( !_blocks_per_chunk )
+      return _blocks;
+   const uint32_t chunk = block_header::num_from_id( e.block_id ) / _blocks_per_chunk;
+   FC_ASSERT( _raw_files.count( chunk ) || fc::exists( raw_file_path( chunk ) ), "Missing raw block file" );
+   return raw_file( chunk );
+}
+
+vector<char> block_database::read_block( const index_entry& e )const
+{
+   vector<char> data( e.block_size );
+   if( e.block_pos & chunked_flag )
+   {
+      const auto chunk = load_chunk( e.block_pos & ~chunked_flag );
+      const uint32_t index = block_header::num_from_id( e.block_id ) - chunk->header.first_block_num;
+      FC_ASSERT( index < chunk->header.offsets.size(), "Block not contained in chunk" );
+      const uint32_t offset = chunk->header.offsets[index];
+      FC_ASSERT( uint64_t(offset) + e.block_size <= chunk->data.size(), "Corrupt chunk in block database" );
+      std::copy( chunk->data.begin() + offset, chunk->data.begin() + offset + e.block_size, data.begin() );
+      return data;
+   }
+
+   std::fstream& file = data_file( e );
+   file.seekg( e.block_pos );
+   if( e.block_size )
+      file.read( data.data(), e.block_size );
+   return data;
+}
+
+void block_database::compress_until( uint32_t block_num )
+{ try {
+   if( !_blocks_per_chunk )
+      return;
+   while( uint64_t(_next_chunk + 1) * _blocks_per_chunk <= uint64_t(block_num) + 1 )
+   {
+      compress_chunk( _next_chunk );
+      ++_next_chunk;
+   }
+} FC_CAPTURE_AND_RETHROW( (block_num) ) }
+
+void block_database::compress_chunk( uint32_t chunk )
+{
+   const uint32_t first = chunk * _blocks_per_chunk;
+   block_chunk_header header;
+   header.first_block_num = first;
+   vector<index_entry> entries;
+   std::string payload;
+   bool has_raw_blocks = false;
+   for( uint32_t num = first; num < first + _blocks_per_chunk; ++num )
+   {
+      index_entry e;
+      if( !read_entry( num, e ) )
+         break;
+      header.offsets.push_back( payload.size() );
+      entries.push_back( e );
+      if( e.block_size == 0 )
+         continue;
+      has_raw_blocks |= !( e.block_pos & chunked_flag );
+      const vector<char> data = read_block( e );
+      payload.append( data.data(), data.size() );
+   }
+
+   if( has_raw_blocks )
+   {
+      // append the chunk before pointing the index at it, the raw file stays valid until both are written
+      const std::string compressed = fc::zlib_compress( payload );
+      header.compressed_size = compressed.size();
+      const vector<char> packed_header = fc::raw::pack( header );
+      const uint32_t header_size = packed_header.size();
+      _blocks.seekp( 0, _blocks.end );
+      const uint64_t pos = _blocks.tellp();
+      _blocks.write( (const char*)&header_size, sizeof(header_size) );
+      _blocks.write( packed_header.data(), packed_header.size() );
+      _blocks.write( compressed.data(), compressed.size() );
+      _blocks.flush();
+
+      for( uint32_t i = 0; i < entries.size(); ++i )
+      {
+         if( entries[i].block_size == 0 )
+            continue;
+         entries[i].block_pos = pos | chunked_flag;
+         _block_num_to_pos.seekp( sizeof(index_entry) * ( first + i ) );
+         _block_num_to_pos.write( (const char*)&entries[i], sizeof(index_entry) );
+      }
+      _block_num_to_pos.flush();
+   }
+
+   _raw_files.erase( chunk );
+   if( fc::exists( raw_file_path( chunk ) ) )
+      fc::remove( raw_file_path( chunk ) );
 }
 
 void block_database::store( const block_id_type& _id, const signed_block& b )
@@ -83,14 +332,17 @@ void block_database::store( const block_id_type& _id, const signed_block& b )
       elog( "id argument of block_database::store() was not initialized for block ${id}", ("id", id) );
    }
    auto num = block_header::num_from_id(id);
+   std::fstream& data_file = _blocks_per_chunk ? raw_file( num / _blocks_per_chunk ) : _blocks;
+   if( _blocks_per_chunk )
+      _next_chunk = std::min( _next_chunk, num / _blocks_per_chunk );
    _block_num_to_pos.seekp( sizeof( index_entry ) * num );
    index_entry e;
-   _blocks.seekp( 0, _blocks.end );
+   data_file.seekp( 0, data_file.end );
    auto vec = fc::raw::pack( b );
-   e.block_pos  = _blocks.tellp();
+   e.block_pos  = data_file.tellp();
    e.block_size = vec.size();
    e.block_id   = id;
-   _blocks.write( vec.data(), vec.size() );
+   data_file.write( vec.data(), vec.size() );
    _block_num_to_pos.write( (char*)&e, sizeof(e) );
 }
 
@@ -160,12 +412,9 @@ optional<signed_block> block_database::fetch_optional( const block_id_type& id )
 
       if( e.block_id != id ) return optional<signed_block>();
 
-      vector<char> data( e.block_size );
-      _blocks.seekg( e.block_pos );
-      if (e.block_size)
-         _blocks.read( data.data(), e.block_size );
+      vector<char> data = read_block( e );
       auto result = fc::raw::unpack<signed_block>(data);
-      FC_ASSERT( result.id() == e.block_id );
+      FC_ASSERT( result.cached_id() == e.block_id );
       return result;
    }
    catch (const fc::exception&)
@@ -190,11 +439,9 @@ optional<signed_block> block_database::fetch_by_number( uint32_t block_num )cons
       _block_num_to_pos.seekg( index_pos, _block_num_to_pos.beg );
       _block_num_to_pos.read( (char*)&e, sizeof(e) );
 
-      vector<char> data( e.block_size );
-      _blocks.seekg( e.block_pos );
-      _blocks.read( data.data(), e.block_size );
+      vector<char> data = read_block( e );
       auto result = fc::raw::unpack<signed_block>(data);
-      FC_ASSERT( result.id() == e.block_id );
+      FC_ASSERT( result.cached_id() == e.block_id );
       return result;
    }
    catch (const fc::exception&)
@@ -229,9 +476,7 @@ optional<signed_block> block_database::last()const
       if( e.block_size == 0 )
          return optional<signed_block>();
 
-      vector<char> data( e.block_size );
-      _blocks.seekg( e.block_pos );
-      _blocks.read( data.data(), e.block_size );
+      vector<char> data = read_block( e );
       auto result = fc::raw::unpack<signed_block>(data);
       return result;
    }
@@ -279,4 +524,61 @@ optional<block_id_type> block_database::last_id()const
 }
 
 
+vector<block_id_type> block_database::fetch_block_ids( uint32_t first_block_num, uint32_t count )const
+{ try {
+   vector<block_id_type> ids;
+   const vector<index_entry> entries = read_entries( first_block_num, count );
+   ids.reserve( entries.size() );
+   for( const index_entry& e : entries )
+   {
+      if( e.block_id == block_id_type() )
+         break;
+      ids.push_back( e.block_id );
+   }
+   return ids;
+} FC_CAPTURE_AND_RETHROW( (first_block_num)(count) ) }
+
+vector<packed_block> block_database::fetch_packed_blocks( uint32_t first_block_num, uint32_t count, uint64_t max_size )const
+{ try {
+   vector<index_entry> entries = read_entries( first_block_num, count );
+   uint64_t total_size = 0;
+   size_t usable = 0;
+   while( usable < entries.size() && entries[usable].block_size > 0 &&
+          ( usable == 0 || total_size + entries[usable].block_size <= max_size ) )
+      total_size += entries[usable++].block_size;
+   entries.resize( usable );
+
+   vector<packed_block> blocks( entries.size() );
+   for( size_t first = 0; first < entries.size(); )
+   {
+      // blocks appended one after the other to the same file are read together
+      size_t end = first + 1;
+      if( !( entries[first].block_pos & chunked_flag ) )
+      {
+         std::fstream& file = data_file( entries[first] );
+         while( end < entries.size() &&
+                !( entries[end].block_pos & chunked_flag ) &&
+                entries[end].block_pos == entries[end - 1].block_pos + entries[end - 1].block_size &&
+                ( !_blocks_per_chunk || ( first_block_num + end ) / _blocks_per_chunk == ( first_block_num + first ) / _blocks_per_chunk ) )
+            ++end;
+         const uint64_t run_size = entries[end - 1].block_pos + entries[end - 1].block_size - entries[first].block_pos;
+         vector<char> run( run_size );
+         file.seekg( entries[first].block_pos );
+         file.read( run.data(), run.size() );
+         for( size_t i = first; i < end; ++i )
+         {
+            const auto begin = run.begin() + ( entries[i].block_pos - entries[first].block_pos );
+            blocks[i].data.assign( begin, begin + entries[i].block_size );
+         }
+      }
+      else
+         blocks[first].data = read_block( entries[first] );
+
+      for( size_t i = first; i < end; ++i )
+         blocks[i].id = entries[i].block_id;
+      first = end;
+   }
+   return blocks;
+} FC_CAPTURE_AND_RETHROW( (first_block_num)(count)(max_size) ) }
+
 } }
@@ -38,6 +38,10 @@
 #include <graphene/chain/evaluator.hpp>
 
 #include <fc/smart_ref_impl.hpp>
+#include <fc/scoped_exit.hpp>
+
+#include <algorithm>
+#include <unordered_set>
 
 namespace graphene { namespace chain {
 
@@ -61,6 +65,16 @@ block_id_type  database::get_block_id_for_num( uint32_t block_num )const
    return _block_id_to_block.fetch_block_id( block_num );
 } FC_CAPTURE_AND_RETHROW( (block_num) ) }
 
+vector<block_id_type> database::get_block_ids_for_nums( uint32_t first_block_num, uint32_t count )const
+{ try {
+   return _block_id_to_block.fetch_block_ids( first_block_num, count );
+} FC_CAPTURE_AND_RETHROW( (first_block_num)(count) ) }
+
+vector<packed_block> database::fetch_packed_blocks( uint32_t first_block_num, uint32_t count, uint64_t max_size )const
+{ try {
+   return _block_id_to_block.fetch_packed_blocks( first_block_num, count, max_size );
+} FC_CAPTURE_AND_RETHROW( (first_block_num)(count)(max_size) ) }
+
 optional<signed_block> database::fetch_block_by_id( const block_id_type& id )const
 {
    auto b = _fork_db.fetch_block( id );
@@ -114,21 +128,35 @@ std::vector<block_id_type> database::get_block_ids_on_fork(block_id_type head_of
 bool database::push_block(const signed_block& new_block, uint32_t skip)
 {
 //   idump((new_block.block_num())(new_block.id())(new_block.timestamp)(new_block.previous));
+   new_block.invalidate_cached_ids();
+   const uint64_t reused_before = get_id_cache_counters().reused;
    bool result;
    detail::with_skip_flags( *this, skip, [&]()
    {
-      detail::without_pending_transactions( *this, std::move(_pending_tx),
+      detail::without_pending_transactions( *this, _pending_tx.take_all(),
       [&]()
       {
          result = _push_block(new_block);
+         continue_state_checkpoint();
       });
    });
+   _id_hashes_avoided_last_block = get_id_cache_counters().reused - reused_before;
+   // only a block that was applied moves the clock pending transactions expire against
+   _pending_tx.remove_expired( head_block_time() );
+
+   try {
+      _block_id_to_block.compress_until( get_dynamic_global_properties().last_irreversible_block_num );
+   } catch( const fc::exception& e ) {
+      // the blocks stay readable uncompressed, compression is retried after the next block
+      elog( "Unable to compress the block log: ${e}", ("e",e.to_detail_string()) );
+   }
    return result;
 }
 
 bool database::_push_block(const signed_block& new_block)
 { try {
    uint32_t skip = get_node_properties().skip_flags;
+   const block_id_type& new_block_id = new_block.cached_id();
    if( !(skip&skip_fork_db) )
    {
       /// TODO: if the block is greater than the head block and before the next maitenance interval
@@ -142,8 +170,8 @@ bool database::_push_block(const signed_block& new_block)
          //Only switch forks if new_head is actually higher than head
          if( new_head->data.block_num() > head_block_num() )
          {
-            wlog( "Switching to fork: ${id}", ("id",new_head->data.id()) );
-            auto branches = _fork_db.fetch_branch_from(new_head->data.id(), head_block_id());
+            wlog( "Switching to fork: ${id}", ("id",new_head->id) );
+            auto branches = _fork_db.fetch_branch_from(new_head->id, head_block_id());
 
             // pop blocks until we hit the forked block
             while( head_block_id() != branches.second.back()->data.previous )
@@ -152,7 +180,7 @@ bool database::_push_block(const signed_block& new_block)
             // push all blocks on the new fork
             for( auto ritr = branches.first.rbegin(); ritr != branches.first.rend(); ++ritr )
             {
-                ilog( "pushing blocks from fork ${n} ${id}", ("n",(*ritr)->data.block_num())("id",(*ritr)->data.id()) );
+                ilog( "pushing blocks from fork ${n} ${id}", ("n",(*ritr)->num)("id",(*ritr)->id) );
                 optional<fc::exception> except;
                 try {
                    undo_database::session session = _undo_db.start_undo_session();
@@ -167,7 +195,7 @@ bool database::_push_block(const signed_block& new_block)
                    // remove the rest of branches.first from the fork_db, those blocks are invalid
                    while( ritr != branches.first.rend() )
                    {
-                      _fork_db.remove( (*ritr)->data.id() );
+                      _fork_db.remove( (*ritr)->id );
                       ++ritr;
                    }
                    _fork_db.set_head( branches.second.front() );
@@ -181,7 +209,7 @@ bool database::_push_block(const signed_block& new_block)
                    {
                       auto session = _undo_db.start_undo_session();
                       apply_block( (*ritr)->data, skip );
-                      _block_id_to_block.store( new_block.id(), (*ritr)->data );
+                      _block_id_to_block.store( (*ritr)->id, (*ritr)->data );
                       session.commit();
                    }
                    throw *except;
@@ -196,11 +224,11 @@ bool database::_push_block(const signed_block& new_block)
    try {
       auto session = _undo_db.start_undo_session();
       apply_block(new_block, skip);
-      _block_id_to_block.store(new_block.id(), new_block);
+      _block_id_to_block.store(new_block_id, new_block);
       session.commit();
    } catch ( const fc::exception& e ) {
       elog("Failed to push new block:\n${e}", ("e", e.to_detail_string()));
-      _fork_db.remove(new_block.id());
+      _fork_db.remove(new_block_id);
       throw;
    }
 
@@ -218,6 +246,7 @@ bool database::_push_block(const signed_block& new_block)
  */
 processed_transaction database::push_transaction( const signed_transaction& trx, uint32_t skip )
 { try {
+   trx.invalidate_cached_id();
    processed_transaction result;
    detail::with_skip_flags( *this, skip, [&]()
    {
@@ -228,6 +257,12 @@ processed_transaction database::push_transaction( const signed_transaction& trx,
 
 processed_transaction database::_push_transaction( const signed_transaction& trx )
 {
+   // Refuse the transaction before evaluating it if the pool has no room for it at its fee rate.
+   const account_id_type fee_payer = pending_transaction_pool::get_fee_payer( trx );
+   const uint32_t trx_size = fc::raw::pack_size( trx );
+   const uint64_t fee_rate = pending_transaction_pool::calculate_fee_rate( get_core_fee_amount( trx ), trx_size );
+   _pending_tx.check_admission( fee_payer, fee_rate, trx_size );
+
    // If this is the first transaction pushed after applying a block, start a new undo session.
    // This allows us to quickly rewind to the clean state of the head block, in case a new block arrives.
    if( !_pending_tx_session.valid() )
@@ -240,19 +275,233 @@ processed_transaction database::_push_transaction( const signed_transaction& trx
 
    auto temp_session = _undo_db.start_undo_session();
    auto processed_trx = _apply_transaction( trx );
-   _pending_tx.push_back(processed_trx);
+   const vector<transaction_id_type> evicted = _pending_tx.insert( processed_trx, fee_payer, fee_rate, trx_size );
+   append_to_block_candidate( processed_trx );
+   record_pending_transaction_dependencies( processed_trx.cached_id() );
 
    // notify_changed_objects();
    // The transaction applied successfully. Merge its changes into the pending block session.
    temp_session.merge();
 
+   if( !evicted.empty() )
+   {
+      rebuild_pending_transactions( evicted );
+      FC_ASSERT( _pending_tx.contains( processed_trx.cached_id() ),
+                 "Transaction depends on a pending transaction it evicted from the pool" );
+   }
+
    // notify anyone listening to pending transactions
    on_pending_transaction( trx );
    return processed_trx;
 }
 
+void database::_push_pending_transactions( const vector<processed_transaction>& pending,
+                                           optional< flat_set<object_id_type> > changed_objects )
+{
+   const uint32_t skip = get_node_properties().skip_flags;
+   uint64_t reverified_tx_count = 0;
+   uint64_t unaffected_tx_count = 0;
+   for( const processed_transaction& tx : pending )
+   {
+      const transaction_id_type& trx_id = tx.cached_id();
+      // transactions included in the new block are dropped here
+      if( is_known_transaction( trx_id ) )
+         continue;
+
+      optional<pending_transaction_dependencies> previous;
+      auto itr = _pending_tx_deps.find( trx_id );
+      if( itr != _pending_tx_deps.end() )
+         previous = itr->second;
+
+      const bool unaffected = pending_transaction_unaffected( trx_id, changed_objects );
+      try
+      {
+         _implied_skip_flags = unaffected ? (skip_transaction_signatures & ~skip) : 0;
+         detail::with_skip_flags( *this, skip | _implied_skip_flags, [&]()
+         {
+            _push_transaction( tx );
+         });
+         _implied_skip_flags = 0;
+      }
+      catch( const fc::exception& )
+      {
+         _implied_skip_flags = 0;
+         // the transaction's writes are gone now, so transactions reading them must be verified again
+         mark_pending_transaction_writes_changed( trx_id, changed_objects );
+         _pending_tx_deps.erase( trx_id );
+         continue;
+      }
+      unaffected ? ++unaffected_tx_count : ++reverified_tx_count;
+
+      itr = _pending_tx_deps.find( trx_id );
+      if( !changed_objects.valid() || itr == _pending_tx_deps.end() )
+         continue;
+      if( !previous.valid() )
+      {
+         // without the earlier write set we cannot tell whether later transactions now see other state
+         changed_objects.reset();
+         continue;
+      }
+      if( unaffected )
+         itr->second.authority_reads = previous->authority_reads;
+      if( itr->second.writes != previous->writes )
+      {
+         changed_objects->insert( previous->writes.begin(), previous->writes.end() );
+         changed_objects->insert( itr->second.writes.begin(), itr->second.writes.end() );
+      }
+   }
+
+   if( _pending_tx_deps.size() > _pending_tx.size() )
+   {
+      for( auto itr = _pending_tx_deps.begin(); itr != _pending_tx_deps.end(); )
+      {
+         if( !_pending_tx.contains( itr->first ) )
+            itr = _pending_tx_deps.erase( itr );
+         else
+            ++itr;
+      }
+   }
+
+   if( reverified_tx_count + unaffected_tx_count > 0 )
+      dlog( "Restored ${n} pending transactions, ${r} of them re-verified",
+            ("n",reverified_tx_count + unaffected_tx_count)("r",reverified_tx_count) );
+}
+
+void database::rebuild_pending_transactions( const vector<transaction_id_type>& evicted )
+{
+   // only transactions reading what the evicted ones wrote see other state when applied again
+   optional< flat_set<object_id_type> > changed_objects = flat_set<object_id_type>();
+   for( const transaction_id_type& evicted_id : evicted )
+   {
+      mark_pending_transaction_writes_changed( evicted_id, changed_objects );
+      _pending_tx_deps.erase( evicted_id );
+   }
+   vector<processed_transaction> pending = _pending_tx.take_all();
+   reset_block_candidate();
+   _pending_tx_session.reset();
+   _push_pending_transactions( pending, std::move(changed_objects) );
+}
+
+optional< flat_set<object_id_type> > database::get_head_session_writes()const
+{
+   if( !_undo_db.enabled() || _undo_db.size() == 0 )
+      return optional< flat_set<object_id_type> >();
+
+   const auto& state = _undo_db.head();
+   vector<object_id_type> ids;
+   ids.reserve( state.old_values.size() + state.new_ids.size() + state.removed.size() );
+   for( const auto& item : state.old_values )
+      ids.push_back( item.first );
+   for( const auto& id : state.new_ids )
+      ids.push_back( id );
+   for( const auto& item : state.removed )
+      ids.push_back( item.first );
+   return flat_set<object_id_type>( ids.begin(), ids.end() );
+}
+
+bool database::pending_transaction_unaffected( const transaction_id_type& trx_id,
+                                               const optional< flat_set<object_id_type> >& changed_objects )const
+{
+   if( !changed_objects.valid() )
+      return false;
+   auto itr = _pending_tx_deps.find( trx_id );
+   if( itr == _pending_tx_deps.end() || !itr->second.authority_reads.valid() )
+      return false;
+   for( const auto& id : *itr->second.authority_reads )
+      if( changed_objects->find( id ) != changed_objects->end() )
+         return false;
+   return true;
+}
+
+void database::record_pending_transaction_dependencies( const transaction_id_type& trx_id )
+{
+   auto writes = get_head_session_writes();
+   if( !writes.valid() )
+   {
+      _pending_tx_deps.erase( trx_id );
+      return;
+   }
+   auto& deps = _pending_tx_deps[trx_id];
+   deps.authority_reads = std::move( _current_trx_authority_reads );
+   deps.writes = std::move( *writes );
+   _current_trx_authority_reads.reset();
+}
+
+void database::mark_pending_transaction_writes_changed( const transaction_id_type& trx_id,
+                                                        optional< flat_set<object_id_type> >& changed_objects )const
+{
+   if( !changed_objects.valid() )
+      return;
+   auto itr = _pending_tx_deps.find( trx_id );
+   if( itr == _pending_tx_deps.end() )
+   {
+      changed_objects.reset();
+      return;
+   }
+   changed_objects->insert( itr->second.writes.begin(), itr->second.writes.end() );
+}
+
+share_type database::get_core_fee_amount( const transaction& trx )const
+{
+   share_type result = 0;
+   for( const operation& op : trx.operations )
+   {
+      const asset fee = pending_transaction_pool::get_operation_fee( op );
+      if( fee.asset_id == asset_id_type() )
+         result += fee.amount;
+      else if( fee.amount > 0 )
+      {
+         const asset_object* fee_asset = find( fee.asset_id );
+         if( fee_asset != nullptr )
+            result += ( fee * fee_asset->options.core_exchange_rate ).amount;
+      }
+   }
+   return result;
+}
+
+void database::set_pending_transaction_pool_limits( const pending_transaction_pool_limits& limits )
+{
+   _pending_tx.set_limits( limits );
+}
+
+void database::set_block_preassembly( bool enabled )
+{
+   _block_candidate.enabled = enabled;
+   reset_block_candidate();
+   // transactions already pending were not recorded
+   _block_candidate.valid = _pending_tx.empty();
+}
+
+bool database::has_preassembled_block( uint32_t skip )const
+{
+   return _block_candidate.enabled && _block_candidate.valid
+       && !_pending_tx.empty() && _block_candidate.merkle_leaves.size() == _pending_tx.size()
+       && _block_candidate.head_block_id == head_block_id()
+       && ( _block_candidate.skip_flags & ~skip ) == 0;
+}
+
+void database::reset_block_candidate()
+{
+   _block_candidate.valid = true;
+   _block_candidate.merkle_leaves.clear();
+   _block_candidate.total_size = 0;
+   _block_candidate.skip_flags = 0;
+}
+
+void database::append_to_block_candidate( const processed_transaction& trx )
+{
+   if( !_block_candidate.enabled || !_block_candidate.valid )
+      return;
+   if( _block_candidate.merkle_leaves.empty() )
+      _block_candidate.head_block_id = head_block_id();
+   _block_candidate.merkle_leaves.push_back( trx.merkle_digest() );
+   _block_candidate.total_size += fc::raw::pack_size( trx );
+   _block_candidate.skip_flags |= get_node_properties().skip_flags & ~_implied_skip_flags;
+}
+
 processed_transaction database::validate_transaction( const signed_transaction& trx )
 {
+   trx.invalidate_cached_id();
    auto session = _undo_db.start_undo_session();
    return _apply_transaction( trx );
 }
@@ -336,8 +585,19 @@ signed_block database::_generate_block(
 
    signed_block pending_block;
 
+   // The pending session already holds the pending transactions applied in arrival order on top of the head
+   // block, so a preassembled block can be taken from the pool as it is.
+   const bool preassembled = has_preassembled_block( skip )
+                             && total_block_size + _block_candidate.total_size < maximum_block_size;
+   if( preassembled )
+   {
+      pending_block.transactions.reserve( _pending_tx.size() );
+      for( const auto& e : _pending_tx.indices().get<pending_transaction_pool::by_sequence>() )
+         pending_block.transactions.push_back( e.trx );
+   }
+
    //
-   // The following code throws away existing pending_tx_session and
+   // Otherwise the following code throws away existing pending_tx_session and
    // rebuilds it by re-applying pending transactions.
    //
    // This rebuild is necessary because pending transactions' validity
@@ -348,11 +608,34 @@ signed_block database::_generate_block(
    // re-apply pending transactions in this method.
    //
    _pending_tx_session.reset();
-   _pending_tx_session = _undo_db.start_undo_session();
+   if( !preassembled )
+      _pending_tx_session = _undo_db.start_undo_session();
 
    uint64_t postponed_tx_count = 0;
-   // pop pending state (reset to head block state)
-   for( const processed_transaction& tx : _pending_tx )
+   // Objects whose state differs from what the pending transactions saw when they were pushed.  Only
+   // transactions reading their authorities from one of them need their signatures verified again.
+   optional< flat_set<object_id_type> > changed_objects = flat_set<object_id_type>();
+
+   // As long as all pending transactions fit, include them in arrival order so that transactions depending on
+   // earlier ones still apply.  Otherwise the block is filled by fee rate and transactions that failed, possibly
+   // because they depend on one not applied yet, get a second chance at the end.
+   const bool fill_by_fee_rate = total_block_size + _pending_tx.total_bytes() >= maximum_block_size;
+   vector<const processed_transaction*> candidates;
+   if( !preassembled && fill_by_fee_rate )
+   {
+      candidates.reserve( _pending_tx.size() );
+      for( const auto& e : _pending_tx.indices().get<pending_transaction_pool::by_fee_rate>() )
+         candidates.push_back( &e.trx );
+   }
+   else if( !preassembled )
+   {
+      candidates.reserve( _pending_tx.size() );
+      for( const auto& e : _pending_tx.indices().get<pending_transaction_pool::by_sequence>() )
+         candidates.push_back( &e.trx );
+   }
+
+   vector<const processed_transaction*> retries;
+   auto include_transaction = [&]( const processed_transaction& tx, bool can_retry )
    {
       size_t new_total_size = total_block_size + fc::raw::pack_size( tx );
 
@@ -360,13 +643,31 @@ signed_block database::_generate_block(
       if( new_total_size >= maximum_block_size )
       {
          postponed_tx_count++;
-         continue;
+         mark_pending_transaction_writes_changed( tx.cached_id(), changed_objects );
+         return;
       }
 
       try
       {
          auto temp_session = _undo_db.start_undo_session();
-         processed_transaction ptx = _apply_transaction( tx );
+         const bool unaffected = pending_transaction_unaffected( tx.cached_id(), changed_objects );
+         processed_transaction ptx;
+         detail::with_skip_flags( *this, unaffected ? (skip | skip_transaction_signatures) : skip, [&]()
+         {
+            ptx = _apply_transaction( tx );
+         });
+         if( changed_objects.valid() )
+         {
+            auto itr = _pending_tx_deps.find( tx.cached_id() );
+            auto writes = get_head_session_writes();
+            if( itr == _pending_tx_deps.end() || !writes.valid() )
+               changed_objects.reset();
+            else if( *writes != itr->second.writes )
+            {
+               changed_objects->insert( writes->begin(), writes->end() );
+               changed_objects->insert( itr->second.writes.begin(), itr->second.writes.end() );
+            }
+         }
          temp_session.merge();
 
          // We have to recompute pack_size(ptx) because it may be different
@@ -378,10 +679,23 @@ signed_block database::_generate_block(
       catch ( const fc::exception& e )
       {
          // Do nothing, transaction will not be re-applied
+         mark_pending_transaction_writes_changed( tx.cached_id(), changed_objects );
+         if( can_retry )
+         {
+            retries.push_back( &tx );
+            return;
+         }
          wlog( "Transaction was not processed while generating block due to ${e}", ("e", e) );
          wlog( "The transaction was ${t}", ("t", tx) );
       }
-   }
+   };
+
+   // pop pending state (reset to head block state)
+   for( const processed_transaction* tx : candidates )
+      include_transaction( *tx, fill_by_fee_rate );
+   for( const processed_transaction* tx : retries )
+      include_transaction( *tx, false );
+
    if( postponed_tx_count > 0 )
    {
       wlog( "Postponed ${n} transactions due to block size limit", ("n", postponed_tx_count) );
@@ -397,7 +711,9 @@ signed_block database::_generate_block(
 
    pending_block.previous = head_block_id();
    pending_block.timestamp = when;
-   pending_block.transaction_merkle_root = pending_block.calculate_merkle_root();
+   pending_block.transaction_merkle_root = preassembled
+      ? signed_block::calculate_merkle_root( _block_candidate.merkle_leaves )
+      : pending_block.calculate_merkle_root();
    pending_block.witness = witness_id;
 
    if( !(skip & skip_witness_signature) )
@@ -437,6 +753,7 @@ void database::clear_pending()
 { try {
    assert( (_pending_tx.size() == 0) || _pending_tx_session.valid() );
    _pending_tx.clear();
+   reset_block_candidate();
    _pending_tx_session.reset();
 } FC_CAPTURE_AND_RETHROW() }
 
@@ -475,7 +792,7 @@ void database::apply_block( const signed_block& next_block, uint32_t skip )
    {
       auto itr = _checkpoints.find( block_num );
       if( itr != _checkpoints.end() )
-         FC_ASSERT( next_block.id() == itr->second, "Block did not match checkpoint", ("checkpoint",*itr)("block_id",next_block.id()) );
+         FC_ASSERT( next_block.cached_id() == itr->second, "Block did not match checkpoint", ("checkpoint",*itr)("block_id",next_block.cached_id()) );
 
       if( _checkpoints.rbegin()->first >= block_num )
          skip = ~0;// WE CAN SKIP ALMOST EVERYTHING
@@ -504,8 +821,34 @@ void database::_apply_block( const signed_block& next_block )
    _current_block_num    = next_block_num;
    _current_trx_in_block = 0;
 
+   // Check the transactions ahead in parallel, then apply them in order, checking again those whose
+   // authorities were written by an earlier transaction of the block
+   const bool verify_ahead = _parallel_apply_threads != 1 && next_block.transactions.size() > 1 &&
+                             !(skip & (skip_transaction_signatures | skip_authority_check));
+   vector< optional< flat_set<object_id_type> > > authority_reads;
+   std::unordered_set<object_id_type> block_writes;
+   if( verify_ahead )
+   {
+      authority_reads = verify_transactions_ahead( next_block );
+      track_writes( &block_writes );
+   }
+   auto stop_tracking = fc::make_scoped_exit( [&]() {
+      track_writes( nullptr );
+      _current_trx_verified_ahead = false;
+   } );
+
    for( const auto& trx : next_block.transactions )
    {
+      if( verify_ahead )
+      {
+         const auto& reads = authority_reads[_current_trx_in_block];
+         _current_trx_verified_ahead = reads.valid() &&
+            std::none_of( reads->begin(), reads->end(), [&]( const object_id_type& id ) {
+               return block_writes.find( id ) != block_writes.end();
+            } );
+         _current_trx_verified_ahead ? ++_parallel_apply_counters.verified_ahead
+                                     : ++_parallel_apply_counters.reverified;
+      }
       /* We do not need to push the undo state for each transaction
        * because they either all apply and are valid or the
        * entire block fails to apply.  We only need an "undo" state
@@ -515,6 +858,7 @@ void database::_apply_block( const signed_block& next_block )
       apply_transaction( trx, skip );
       ++_current_trx_in_block;
    }
+   track_writes( nullptr );
 
    update_global_dynamic_data(next_block);
    update_signing_witness(signing_witness, next_block);
@@ -562,16 +906,46 @@ processed_transaction database::apply_transaction(const signed_transaction& trx,
    return result;
 }
 
+vector< optional< flat_set<object_id_type> > > database::verify_transactions_ahead( const signed_block& next_block )const
+{
+   const chain_id_type& chain_id = get_chain_id();
+   const uint32_t max_authority_depth = get_global_properties().parameters.max_authority_depth;
+   vector< optional< flat_set<object_id_type> > > result( next_block.transactions.size() );
+   // only reads the indexes, nothing modifies them until all threads are done
+   run_in_parallel( result.size(), _parallel_apply_threads, [&]( size_t i ) {
+      const signed_transaction& trx = next_block.transactions[i];
+      flat_set<object_id_type> reads;
+      reads.insert( global_property_id_type() );
+      auto get_active = [&]( account_id_type id ) { reads.insert( id ); return &id(*this).active; };
+      auto get_owner  = [&]( account_id_type id ) { reads.insert( id ); return &id(*this).owner;  };
+      try
+      {
+         trx.validate();
+         graphene::chain::verify_authority( trx.operations, trx.get_signature_keys_for_digest( trx.cached_sig_digest( chain_id ) ),
+                                            get_active, get_owner, max_authority_depth );
+      }
+      catch( ... )
+      {
+         // applied with the regular checks, which fail the block if this still fails
+         return;
+      }
+      result[i] = std::move( reads );
+   } );
+   return result;
+}
+
 processed_transaction database::_apply_transaction(const signed_transaction& trx)
 { try {
    uint32_t skip = get_node_properties().skip_flags;
+   const bool verified_ahead = _current_trx_verified_ahead;
+   _current_trx_verified_ahead = false;
 
-   if( true || !(skip&skip_validate) )   /* issue #505 explains why this skip_flag is disabled */
+   if( !verified_ahead )   /* issue #505 explains why skip_validate is ignored here */
       trx.validate();
 
    auto& trx_idx = get_mutable_index_type<transaction_index>();
    const chain_id_type& chain_id = get_chain_id();
-   auto trx_id = trx.id();
+   const transaction_id_type& trx_id = trx.cached_id();
    ilog( "_apply_transaction: ${trx_id}", ("trx_id", trx_id) );
    FC_ASSERT( (skip & skip_transaction_dupe_check) ||
               trx_idx.indices().get<by_trx_id>().find(trx_id) == trx_idx.indices().get<by_trx_id>().end() );
@@ -579,11 +953,16 @@ processed_transaction database::_apply_transaction(const signed_transaction& trx
    const chain_parameters& chain_parameters = get_global_properties().parameters;
    eval_state._trx = &trx;
 
-   if( !(skip & (skip_transaction_signatures | skip_authority_check) ) )
+   _current_trx_authority_reads.reset();
+   if( !verified_ahead && !(skip & (skip_transaction_signatures | skip_authority_check) ) )
    {
-      auto get_active = [&]( account_id_type id ) { return &id(*this).active; };
-      auto get_owner  = [&]( account_id_type id ) { return &id(*this).owner;  };
-      trx.verify_authority( chain_id, get_active, get_owner, get_global_properties().parameters.max_authority_depth );
+      _current_trx_authority_reads = flat_set<object_id_type>();
+      auto& authority_reads = *_current_trx_authority_reads;
+      authority_reads.insert( global_property_id_type() );
+      auto get_active = [&]( account_id_type id ) { authority_reads.insert( id ); return &id(*this).active; };
+      auto get_owner  = [&]( account_id_type id ) { authority_reads.insert( id ); return &id(*this).owner;  };
+      graphene::chain::verify_authority( trx.operations, trx.get_signature_keys_for_digest( trx.cached_sig_digest( chain_id ) ),
+                                         get_active, get_owner, get_global_properties().parameters.max_authority_depth );
    }
 
    //Skip all manner of expiration and TaPoS checking if we're on block 1; It's impossible that the transaction is
@@ -683,7 +1062,7 @@ void database::create_block_summary(const signed_block& next_block)
 {
    block_summary_id_type sid(next_block.block_num() & 0xffff );
    modify( sid(*this), [&](block_summary_object& p) {
-         p.block_id = next_block.id();
+         p.block_id = next_block.cached_id();
    });
 }
 
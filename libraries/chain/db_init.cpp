@@ -215,11 +215,13 @@ void database::initialize_indexes()
    _undo_db.set_max_size( GRAPHENE_MIN_UNDO_HISTORY );
 
    //Protocol object indexes
-   add_index< primary_index<asset_index> >();
+   auto asset_idx = add_index< primary_index<asset_index> >();
+   _market_issued_assets = asset_idx->add_secondary_index<market_issued_asset_index>();
    add_index< primary_index<force_settlement_index> >();
 
    auto acnt_index = add_index< primary_index<account_index> >();
    acnt_index->add_secondary_index<account_member_index>();
+   acnt_index->add_secondary_index<key_reference_index>();
    acnt_index->add_secondary_index<account_referrer_index>();
 
    add_index< primary_index<committee_member_index> >();
@@ -241,7 +243,8 @@ void database::initialize_indexes()
    //Implementation object indexes
    add_index< primary_index<transaction_index                             > >();
    add_index< primary_index<account_balance_index                         > >();
-   add_index< primary_index<asset_bitasset_data_index                     > >();
+   auto bitasset_idx = add_index< primary_index<asset_bitasset_data_index > >();
+   _bitasset_changes = bitasset_idx->add_secondary_index<bitasset_change_index>();
    add_index< primary_index<simple_index<global_property_object          >> >();
    add_index< primary_index<simple_index<dynamic_global_property_object  >> >();
    add_index< primary_index<simple_index<account_statistics_object       >> >();
@@ -28,10 +28,14 @@
 #include <graphene/chain/protocol/fee_schedule.hpp>
 
 #include <fc/io/fstream.hpp>
+#include <fc/io/json.hpp>
+#include <fc/interprocess/file_mapping.hpp>
 
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <limits>
+#include <set>
 
 namespace graphene { namespace chain {
 
@@ -53,6 +57,11 @@ void database::reindex(fc::path data_dir, const genesis_state_type& initial_allo
    wipe(data_dir, false);
    open(data_dir, [&initial_allocation]{return initial_allocation;});
 
+   replay_block_log();
+} FC_CAPTURE_AND_RETHROW( (data_dir) ) }
+
+void database::replay_block_log()
+{ try {
    auto start = fc::time_point::now();
    auto last_block = _block_id_to_block.last();
    if( !last_block ) {
@@ -62,17 +71,21 @@ void database::reindex(fc::path data_dir, const genesis_state_type& initial_allo
    }
 
    const auto last_block_num = last_block->block_num();
+   FC_ASSERT( head_block_num() + 1 >= _block_id_to_block.first_block_num(),
+              "The block log starts at block ${f} because the node was started from a state snapshot, so the state "
+              "cannot be rebuilt from block ${n}; load the snapshot again with --load-snapshot",
+              ("f",_block_id_to_block.first_block_num())("n",head_block_num() + 1) );
 
    ilog( "Replaying blocks..." );
    _undo_db.disable();
    _undo_db.set_reindex_status(true);
-   for( uint32_t i = 1; i <= last_block_num; ++i )
+   for( uint32_t i = head_block_num() + 1; i <= last_block_num; ++i )
    {
       if( i % 10000 == 0 ) std::cerr << "   " << double(i*100)/last_block_num << "%   "<<i << " of " <<last_block_num<<"   \n";
       fc::optional< signed_block > block = _block_id_to_block.fetch_by_number(i);
       if( !block.valid() )
       {
-         wlog( "Reindexing terminated due to gap:  Block ${i} does not exist!", ("i", i) );
+         wlog( "Replay terminated due to gap:  Block ${i} does not exist!", ("i", i) );
          uint32_t dropped_count = 0;
          while( true )
          {
@@ -103,16 +116,294 @@ void database::reindex(fc::path data_dir, const genesis_state_type& initial_allo
    _undo_db.set_reindex_status(false);
    _undo_db.enable();
    auto end = fc::time_point::now();
-   ilog( "Done reindexing, elapsed time: ${t} sec", ("t",double((end-start).count())/1000000.0 ) );
+   ilog( "Done replaying, elapsed time: ${t} sec", ("t",double((end-start).count())/1000000.0 ) );
+} FC_CAPTURE_AND_RETHROW() }
+
+/// block numbers of the complete state checkpoints in dir, oldest first
+static vector<uint32_t> list_state_checkpoints( const fc::path& dir )
+{
+   vector<uint32_t> result;
+   if( !fc::exists( dir ) )
+      return result;
+   for( fc::directory_iterator itr( dir ); itr != fc::directory_iterator(); ++itr )
+   {
+      const std::string name = (*itr).filename().string();
+      if( name.empty() || name.find_first_not_of( "0123456789" ) != std::string::npos )
+         continue;
+      // the block id is written last, a checkpoint without it was interrupted
+      if( fc::exists( *itr / "object_database" ) && fc::exists( *itr / "head_block_id" ) )
+         result.push_back( std::stoul( name ) );
+   }
+   std::sort( result.begin(), result.end() );
+   return result;
+}
+
+void database::continue_state_checkpoint()
+{ try {
+   if( !_state_checkpoint_progress )
+   {
+      const uint32_t irreversible_num = get_dynamic_global_properties().last_irreversible_block_num;
+      if( _state_checkpoint_interval == 0 || irreversible_num < _last_state_checkpoint + _state_checkpoint_interval )
+         return;
+      if( head_block_num() - irreversible_num > _undo_db.size() )
+      {
+         wlog( "Not enough undo history to checkpoint block ${n}", ("n",irreversible_num) );
+         return;
+      }
+      const fc::path dir = get_data_dir() / "state_checkpoints" / fc::to_string( irreversible_num );
+      fc::remove_all( dir );
+      fc::create_directories( dir );
+      _state_checkpoint_block = irreversible_num;
+      _state_checkpoint_start = fc::time_point::now();
+      _state_checkpoint_progress = start_saving_state( dir / "object_database" );
+   }
+
+   // update_global_dynamic_data() keeps the undo history back to the checkpoint's block until it is complete
+   const size_t undo_states = head_block_num() - _state_checkpoint_block;
+   FC_ASSERT( undo_states <= _undo_db.size(), "Lost the undo history back to block ${n}", ("n",_state_checkpoint_block) );
+   if( !save_state_slice( *_state_checkpoint_progress, _undo_db.rewind( undo_states ), _state_checkpoint_objects_per_block ) )
+      return;
+   _state_checkpoint_progress.reset();
+   finish_state_checkpoint( _state_checkpoint_block, _state_checkpoint_start );
+} catch( const fc::exception& e ) {
+   // a failed checkpoint must not fail the block that triggered it, the next block starts it over
+   elog( "Unable to save state checkpoint: ${e}", ("e",e.to_detail_string()) );
+   _state_checkpoint_progress.reset();
+} }
+
+void database::write_state_checkpoint( uint32_t block_num, size_t undo_states )
+{ try {
+   const auto start = fc::time_point::now();
+   const fc::path dir = get_data_dir() / "state_checkpoints" / fc::to_string( block_num );
+   fc::remove_all( dir );
+   fc::create_directories( dir );
+   save_state( dir / "object_database", undo_states );
+   finish_state_checkpoint( block_num, start );
+} FC_CAPTURE_AND_RETHROW( (block_num)(undo_states) ) }
+
+void database::finish_state_checkpoint( uint32_t block_num, fc::time_point start )
+{
+   const fc::path checkpoints_dir = get_data_dir() / "state_checkpoints";
+   fc::json::save_to_file( _block_id_to_block.fetch_block_id( block_num ), checkpoints_dir / fc::to_string( block_num ) / "head_block_id" );
+   _last_state_checkpoint = block_num;
+
+   // drop the older checkpoints, and any left incomplete by a shutdown while it was being written
+   const auto checkpoints = list_state_checkpoints( checkpoints_dir );
+   const std::set<uint32_t> kept( checkpoints.end() - std::min<size_t>( checkpoints.size(), GRAPHENE_STATE_CHECKPOINTS_TO_KEEP ),
+                                  checkpoints.end() );
+   vector<fc::path> stale;
+   for( fc::directory_iterator itr( checkpoints_dir ); itr != fc::directory_iterator(); ++itr )
+   {
+      const std::string name = (*itr).filename().string();
+      if( !name.empty() && name.find_first_not_of( "0123456789" ) == std::string::npos && kept.count( std::stoul( name ) ) == 0 )
+         stale.push_back( *itr );
+   }
+   for( const fc::path& dir : stale )
+      fc::remove_all( dir );
+
+   ilog( "Saved state checkpoint at block ${n} in ${t} ms",
+         ("n",block_num)("t",(fc::time_point::now() - start).count() / 1000) );
+}
+
+bool database::resume_from_state_checkpoint( const fc::path& data_dir )
+{ try {
+   const fc::path checkpoints_dir = data_dir / "state_checkpoints";
+   const auto checkpoints = list_state_checkpoints( checkpoints_dir );
+
+   // the newest checkpoint whose block is still part of the stored chain
+   optional<uint32_t> checkpoint_num;
+   {
+      block_database blocks;
+      blocks.open( data_dir / "database" / "block_num_to_block" );
+      for( auto itr = checkpoints.rbegin(); itr != checkpoints.rend() && !checkpoint_num; ++itr )
+      {
+         try {
+            const auto id = fc::json::from_file( checkpoints_dir / fc::to_string( *itr ) / "head_block_id" ).as<block_id_type>();
+            const optional<signed_block> block = blocks.fetch_by_number( *itr );
+            if( block.valid() && block->id() == id )
+               checkpoint_num = *itr;
+         } catch( const fc::exception& e ) {
+            wlog( "Skipping state checkpoint at block ${n}: ${e}", ("n",*itr)("e",e.to_detail_string()) );
+         }
+      }
+      blocks.close();
+   }
+   if( !checkpoint_num )
+      return false;
+
+   ilog( "Resuming from the state checkpoint at block ${n}", ("n",*checkpoint_num) );
+   object_database::wipe( data_dir );
+   object_database::open( data_dir, checkpoints_dir / fc::to_string( *checkpoint_num ) / "object_database" );
+   _block_id_to_block.open( data_dir / "database" / "block_num_to_block" );
+   FC_ASSERT( head_block_num() == *checkpoint_num, "State checkpoint does not match its block",
+              ("head_block_num",head_block_num())("checkpoint",*checkpoint_num) );
+
+   fc::optional<signed_block> last_block = _block_id_to_block.last();
+   if( last_block.valid() )
+      _fork_db.start_block( *last_block );
+   _last_state_checkpoint = *checkpoint_num;
+
+   replay_block_log();
+   return true;
 } FC_CAPTURE_AND_RETHROW( (data_dir) ) }
 
+/// sha256 of a snapshot file, fed in pieces because the encoder takes 32 bit lengths
+static fc::sha256 hash_snapshot( const char* data, uint64_t size )
+{
+   const uint64_t piece = 64 * 1024 * 1024;
+   fc::sha256::encoder enc;
+   for( uint64_t pos = 0; pos < size; pos += piece )
+      enc.write( data + pos, uint32_t( std::min( piece, size - pos ) ) );
+   return enc.result();
+}
+
+state_snapshot_header database::create_state_snapshot( const fc::path& file )
+{
+   const state_snapshot_header header = start_state_snapshot( file );
+   // a slice without a limit writes all of it
+   continue_state_snapshot( std::numeric_limits<size_t>::max() );
+   return header;
+}
+
+static fc::path snapshot_staging_path( const fc::path& file )
+{
+   return file.parent_path() / ( file.filename().string() + ".tmp" );
+}
+
+state_snapshot_header database::start_state_snapshot( const fc::path& file )
+{ try {
+   FC_ASSERT( !_state_snapshot_progress, "State snapshot ${f} is still being written", ("f",_state_snapshot_file) );
+   const uint32_t irreversible_num = get_dynamic_global_properties().last_irreversible_block_num;
+   // pending transactions sit in their own undo state on top of those of the blocks
+   const size_t undo_states = head_block_num() - irreversible_num + ( _pending_tx_session.valid() ? 1 : 0 );
+   FC_ASSERT( undo_states <= _undo_db.size(),
+              "The undo history does not reach back from head block ${h} to the last irreversible block ${n}, as "
+              "after a replay; a snapshot can be written once block ${h} is irreversible",
+              ("h",head_block_num())("n",irreversible_num)("undo_states",_undo_db.size()) );
+
+   state_snapshot_header header;
+   header.chain_id = get_chain_id();
+   const optional<signed_block> head_block = fetch_block_by_number( irreversible_num );
+   FC_ASSERT( head_block.valid(), "Block ${n} is not in the block log", ("n",irreversible_num) );
+   header.head_block = *head_block;
+
+   const fc::path staging = snapshot_staging_path( file );
+   std::unique_ptr<std::ofstream> out( new std::ofstream( staging.generic_string(),
+                                                          std::ios::out | std::ios::binary | std::ios::trunc ) );
+   FC_ASSERT( *out, "Unable to create ${f}", ("f",staging) );
+   fc::raw::pack( *out, header );
+
+   _state_snapshot_out = std::move( out );
+   _state_snapshot_file = file;
+   _state_snapshot_block = irreversible_num;
+   _state_snapshot_start = fc::time_point::now();
+   _state_snapshot_progress.reset( new state_export_progress );
+   return header;
+} FC_CAPTURE_AND_RETHROW( (file) ) }
+
+bool database::continue_state_snapshot( size_t max_objects )
+{ try {
+   FC_ASSERT( _state_snapshot_progress, "No state snapshot is being written" );
+   const fc::path staging = snapshot_staging_path( _state_snapshot_file );
+   try {
+      // update_global_dynamic_data() keeps the undo history back to the snapshot's block until it is complete
+      const size_t undo_states = head_block_num() - _state_snapshot_block + ( _pending_tx_session.valid() ? 1 : 0 );
+      FC_ASSERT( undo_states <= _undo_db.size(), "Lost the undo history back to block ${n}", ("n",_state_snapshot_block) );
+      if( !export_state_slice( *_state_snapshot_out, *_state_snapshot_progress, _undo_db.rewind( undo_states ), max_objects ) )
+         return false;
+      _state_snapshot_out->flush();
+      FC_ASSERT( *_state_snapshot_out, "Unable to write ${f}", ("f",staging) );
+      _state_snapshot_out.reset();
+
+      fc::sha256 checksum;
+      {
+         fc::file_mapping fm( staging.generic_string().c_str(), fc::read_only );
+         fc::mapped_region mr( fm, fc::read_only, 0, fc::file_size( staging ) );
+         checksum = hash_snapshot( (const char*)mr.get_address(), mr.get_size() );
+      }
+      {
+         std::ofstream out( staging.generic_string(), std::ios::out | std::ios::binary | std::ios::app );
+         fc::raw::pack( out, checksum );
+         out.flush();
+         FC_ASSERT( out, "Unable to write ${f}", ("f",staging) );
+      }
+      fc::rename( staging, _state_snapshot_file );
+   } catch( const fc::exception& ) {
+      abandon_state_snapshot();
+      throw;
+   }
+   _state_snapshot_progress.reset();
+
+   ilog( "Saved state snapshot of block ${n} to ${f} in ${t} ms",
+         ("n",_state_snapshot_block)("f",_state_snapshot_file)
+         ("t",(fc::time_point::now() - _state_snapshot_start).count() / 1000) );
+   return true;
+} FC_CAPTURE_AND_RETHROW( (max_objects) ) }
+
+void database::abandon_state_snapshot()
+{
+   if( !_state_snapshot_progress )
+      return;
+   _state_snapshot_out.reset();
+   _state_snapshot_progress.reset();
+   fc::remove( snapshot_staging_path( _state_snapshot_file ) );
+}
+
+void database::open_from_state_snapshot( const fc::path& data_dir, const fc::path& snapshot )
+{ try {
+   const uint64_t size = fc::file_size( snapshot );
+   FC_ASSERT( size > sizeof( fc::sha256 ), "Snapshot ${f} is truncated", ("f",snapshot) );
+   fc::file_mapping fm( snapshot.generic_string().c_str(), fc::read_only );
+   fc::mapped_region mr( fm, fc::read_only, 0, size );
+   const char* data = (const char*)mr.get_address();
+   const uint64_t content_size = size - sizeof( fc::sha256 );
+
+   fc::sha256 checksum;
+   fc::datastream<const char*> checksum_ds( data + content_size, sizeof( fc::sha256 ) );
+   fc::raw::unpack( checksum_ds, checksum );
+   FC_ASSERT( hash_snapshot( data, content_size ) == checksum, "Snapshot ${f} is corrupted", ("f",snapshot) );
+
+   fc::datastream<const char*> ds( data, content_size );
+   state_snapshot_header header;
+   fc::raw::unpack( ds, header );
+   FC_ASSERT( header.version == GRAPHENE_STATE_SNAPSHOT_VERSION, "Unsupported snapshot version ${v}", ("v",header.version) );
+
+   const uint32_t head_num = header.head_block.block_num();
+   const block_id_type head_id = header.head_block.id();
+   ilog( "Loading state snapshot of block ${n}", ("n",head_num) );
+   object_database::wipe( data_dir );
+   object_database::open( data_dir );
+   import_state( ds );
+   FC_ASSERT( head_block_id() == head_id && get_chain_id() == header.chain_id, "Snapshot state does not match its header" );
+
+   _block_id_to_block.open( data_dir / "database" / "block_num_to_block" );
+   const optional<signed_block> stored = _block_id_to_block.fetch_by_number( head_num );
+   if( stored.valid() )
+      FC_ASSERT( stored->id() == head_id, "The block log in ${d} belongs to a different chain", ("d",data_dir) );
+   else
+   {
+      // the blocks before the snapshot are not available, the log starts here
+      _block_id_to_block.set_first_block_num( head_num );
+      _block_id_to_block.store( head_id, header.head_block );
+   }
+
+   _fork_db.start_block( *_block_id_to_block.last() );
+   // the block log cannot be replayed from genesis any more, so crash recovery starts from this checkpoint
+   write_state_checkpoint( head_num, 0 );
+
+   replay_block_log();
+} FC_CAPTURE_AND_RETHROW( (data_dir)(snapshot) ) }
+
 void database::wipe(const fc::path& data_dir, bool include_blocks)
 {
    ilog("Wiping database", ("include_blocks", include_blocks));
    close();
    object_database::wipe(data_dir);
    if( include_blocks )
+   {
       fc::remove_all( data_dir / "database" );
+      fc::remove_all( data_dir / "state_checkpoints" );
+   }
 }
 
 void database::open(
@@ -128,6 +419,9 @@ void database::open(
       if( !find(global_property_id_type()) )
          init_genesis(genesis_loader());
 
+      const auto checkpoints = list_state_checkpoints( data_dir / "state_checkpoints" );
+      _last_state_checkpoint = checkpoints.empty() ? head_block_num() : checkpoints.back();
+
       fc::optional<signed_block> last_block = _block_id_to_block.last();
       if( last_block.valid() )
       {
@@ -148,6 +442,9 @@ void database::close(bool rewind)
 {
    // TODO:  Save pending tx's on close()
    clear_pending();
+   // a checkpoint being written is left incomplete, it is discarded once the next one is complete
+   _state_checkpoint_progress.reset();
+   abandon_state_snapshot();
 
    // pop all of the blocks that we can given our undo history, this should
    // throw when there is no more undo history to pop
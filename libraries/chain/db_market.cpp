@@ -225,7 +225,9 @@ int database::match( const limit_order_object& usd, const OrderType& core, const
 
    asset usd_pays, usd_receives, core_pays, core_receives;
 
-   if( usd_for_sale <= core_for_sale * match_price )
+   // the value of the whole core order is needed by both branches, compute it only once
+   const asset core_for_sale_value = core_for_sale * match_price;
+   if( usd_for_sale <= core_for_sale_value )
    {
       core_receives = usd_for_sale;
       usd_receives  = usd_for_sale * match_price;
@@ -237,7 +239,7 @@ int database::match( const limit_order_object& usd, const OrderType& core, const
       //Although usd_for_sale is greater than core_for_sale * match_price, core_for_sale == usd_for_sale * match_price
       //Removing the assert seems to be safe -- apparently no asset is created or destroyed.
       usd_receives = core_for_sale;
-      core_receives = core_for_sale * match_price;
+      core_receives = core_for_sale_value;
    }
 
    core_pays = usd_receives;
@@ -548,13 +550,14 @@ bool database::check_call_orders(const asset_object& mia, bool enable_black_swan
 
 void database::pay_order( const account_object& receiver, const asset& receives, const asset& pays )
 {
-   const auto& balances = receiver.statistics(*this);
-   modify( balances, [&]( account_statistics_object& b ){
-         if( pays.asset_id == asset_id_type() )
-         {
+   // only core in orders is tracked, skip the lookup and the undo copy of the statistics otherwise
+   if( pays.asset_id == asset_id_type() )
+   {
+      const auto& balances = receiver.statistics(*this);
+      modify( balances, [&]( account_statistics_object& b ){
             b.total_core_in_orders -= pays.amount;
-         }
-   });
+      });
+   }
    adjust_balance(receiver.get_id(), receives);
 }
 
@@ -567,10 +570,17 @@ asset database::calculate_market_fee( const asset_object& trade_asset, const ass
    if( trade_asset.options.market_fee_percent == 0 )
       return trade_asset.amount(0);
 
+#ifdef __SIZEOF_INT128__
+   unsigned __int128 a = static_cast<uint64_t>(trade_amount.amount.value);
+   a *= trade_asset.options.market_fee_percent;
+   a /= GRAPHENE_100_PERCENT;
+   asset percent_fee = trade_asset.amount(static_cast<uint64_t>(a));
+#else
    fc::uint128 a(trade_amount.amount.value);
    a *= trade_asset.options.market_fee_percent;
    a /= GRAPHENE_100_PERCENT;
    asset percent_fee = trade_asset.amount(a.to_uint64());
+#endif
 
    if( percent_fee.amount > trade_asset.options.max_market_fee )
       percent_fee.amount = trade_asset.options.max_market_fee;
@@ -78,7 +78,7 @@ void database::update_global_dynamic_data( const signed_block& b )
          dgp.recently_missed_count--;
 
       dgp.head_block_number = b.block_num();
-      dgp.head_block_id = b.id();
+      dgp.head_block_id = b.cached_id();
       dgp.time = b.timestamp;
       dgp.current_witness = b.witness;
       dgp.recent_slots_filled = (
@@ -103,7 +103,13 @@ void database::update_global_dynamic_data( const signed_block& b )
                  ("recently_missed",_dgp.recently_missed_count)("max_undo",GRAPHENE_MAX_UNDO_HISTORY) );
    }
 
-   _undo_db.set_max_size( _dgp.head_block_number - _dgp.last_irreversible_block_num + 1 );
+   // state checkpoints and snapshots being written read the state of their block through the undo history
+   uint32_t undo_from = _dgp.last_irreversible_block_num;
+   if( _state_checkpoint_progress )
+      undo_from = std::min( undo_from, _state_checkpoint_block );
+   if( _state_snapshot_progress )
+      undo_from = std::min( undo_from, _state_snapshot_block );
+   _undo_db.set_max_size( _dgp.head_block_number - undo_from + 1 );
    _fork_db.set_max_size( _dgp.head_block_number - _dgp.last_irreversible_block_num + 1 );
 }
 
@@ -435,24 +441,47 @@ void database::clear_expired_orders()
 
 void database::update_expired_feeds()
 {
-   auto& asset_idx = get_index_type<asset_index>().indices().get<by_type>();
-   auto itr = asset_idx.lower_bound( true /** market issued */ );
-   while( itr != asset_idx.end() )
+   const auto head_time = head_block_time();
+   const bool after_hardfork_615 = head_time >= HARDFORK_615_TIME;
+
+   // The core exchange rate of an asset can only differ from its feed after one of them changed, and the feeds which
+   // expire now are found through the expiration index, so the other market issued assets need not be looked at.
+   // Changes made while updating are picked up again with the next block.
+   flat_set<asset_id_type> candidates;
+   candidates.swap( _market_issued_assets->changed_assets );
+   const auto& bitasset_to_asset = _market_issued_assets->bitasset_to_asset;
+   const auto add_candidate = [&]( asset_bitasset_data_id_type bitasset_id ) {
+      auto itr = bitasset_to_asset.find( bitasset_id );
+      if( itr != bitasset_to_asset.end() )
+         candidates.insert( itr->second );
+   };
+   for( const auto& bitasset_id : _bitasset_changes->changed_bitassets )
+      add_candidate( bitasset_id );
+   _bitasset_changes->changed_bitassets.clear();
+
+   // before hardfork 615 feeds which had not expired yet were treated as expired
+   const auto& expiration_idx = get_index_type<asset_bitasset_data_index>().indices().get<by_feed_expiration>();
+   auto expired_itr = after_hardfork_615 ? expiration_idx.begin() : expiration_idx.lower_bound( head_time );
+   const auto expired_end = after_hardfork_615 ? expiration_idx.upper_bound( head_time ) : expiration_idx.end();
+   for( ; expired_itr != expired_end; ++expired_itr )
+      add_candidate( expired_itr->id );
+
+   // in asset id order, like a scan of all market issued assets
+   for( const asset_id_type& asset_id : candidates )
    {
-      const asset_object& a = *itr;
-      ++itr;
+      const asset_object& a = asset_id(*this);
       assert( a.is_market_issued() );
 
       const asset_bitasset_data_object& b = a.bitasset_data(*this);
       bool feed_is_expired;
-      if( head_block_time() < HARDFORK_615_TIME )
-         feed_is_expired = b.feed_is_expired_before_hardfork_615( head_block_time() );
+      if( !after_hardfork_615 )
+         feed_is_expired = b.feed_is_expired_before_hardfork_615( head_time );
       else
-         feed_is_expired = b.feed_is_expired( head_block_time() );
+         feed_is_expired = b.feed_is_expired( head_time );
       if( feed_is_expired )
       {
-         modify(b, [this](asset_bitasset_data_object& a) {
-            a.update_median_feeds(head_block_time());
+         modify(b, [head_time](asset_bitasset_data_object& a) {
+            a.update_median_feeds(head_time);
          });
          check_call_orders(b.current_feed.settlement_price.base.asset_id(*this));
       }
@@ -25,6 +25,7 @@
 #include <graphene/chain/protocol/operations.hpp>
 #include <graphene/db/generic_index.hpp>
 #include <boost/multi_index/composite_key.hpp>
+#include <unordered_map>
 
 namespace graphene { namespace chain {
    class database;
@@ -267,8 +268,8 @@ namespace graphene { namespace chain {
    };
 
    /**
-    *  @brief This secondary index will allow a reverse lookup of all accounts that a particular key or account
-    *  is an potential signing authority.
+    *  @brief This secondary index will allow a reverse lookup of all accounts that reference an account in their
+    *  owner or active authority.  Keys and addresses are looked up through @ref key_reference_index.
     */
    class account_member_index : public secondary_index
    {
@@ -279,21 +280,54 @@ namespace graphene { namespace chain {
          virtual void object_modified( const object& after  ) override;
 
 
-         /** given an account or key, map it to the set of accounts that reference it in an active or owner authority */
-         map< account_id_type, set<account_id_type> > account_to_account_memberships;
-         map< public_key_type, set<account_id_type> > account_to_key_memberships;
-         /** some accounts use address authorities in the genesis block */
-         map< address, set<account_id_type> >         account_to_address_memberships;
+         /** given an account, map it to the set of accounts that reference it in an active or owner authority */
+         std::unordered_map< account_id_type, flat_set<account_id_type> > account_to_account_memberships;
 
 
       protected:
-         set<account_id_type>  get_account_members( const account_object& a )const;
-         set<public_key_type>  get_key_members( const account_object& a )const;
-         set<address>          get_address_members( const account_object& a )const;
+         /** fills @p result, whose capacity is kept between calls, with the accounts referenced by @p a */
+         static void get_account_members( const account_object& a, flat_set<account_id_type>& result );
 
-         set<account_id_type>  before_account_members;
-         set<public_key_type>  before_key_members;
-         set<address>          before_address_members;
+         flat_set<account_id_type>  before_account_members;
+         flat_set<account_id_type>  after_account_members;
+   };
+
+   /**
+    *  @brief Hashed reverse lookup of the accounts that reference a key in their owner or active authority or as
+    *  memo key, and of the accounts that reference an address in their authorities.
+    *
+    *  The legacy address forms of a key only need to be derived for a lookup while any account has an address
+    *  authority, which is limited to genesis accounts, otherwise a key lookup is a single hash probe.
+    */
+   class key_reference_index : public secondary_index
+   {
+      public:
+         struct key_hash
+         {
+            size_t operator()( const public_key_type& k )const { return std::hash<fc::ecc::public_key_data>()( k.key_data ); }
+         };
+
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+         virtual void about_to_modify( const object& before ) override;
+         virtual void object_modified( const object& after  ) override;
+
+         /** @return the accounts referencing @p key directly or through one of its address forms */
+         vector<account_id_type> get_key_references( const public_key_type& key )const;
+         bool                    is_key_referenced( const public_key_type& key )const;
+
+         std::unordered_map< public_key_type, flat_set<account_id_type>, key_hash > key_to_accounts;
+         std::unordered_map< address, flat_set<account_id_type> >                     address_to_accounts;
+
+      protected:
+         static flat_set<public_key_type> get_keys( const account_object& a );
+         static flat_set<address>         get_addresses( const account_object& a );
+
+         template< typename Map, typename Key >
+         static void update( Map& map, const flat_set<Key>& before, const flat_set<Key>& after, account_id_type account );
+
+         flat_set<public_key_type> before_keys;
+         flat_set<address>         before_addresses;
    };
 
 
@@ -26,6 +26,7 @@
 #include <boost/multi_index/composite_key.hpp>
 #include <graphene/db/flat_index.hpp>
 #include <graphene/db/generic_index.hpp>
+#include <unordered_map>
 
 /**
  * @defgroup prediction_market Prediction Market
@@ -239,7 +240,12 @@ namespace graphene { namespace chain {
       indexed_by<
          ordered_unique< tag<by_id>, member< object, object_id_type, &object::id > >,
          ordered_unique< tag<by_symbol>, member<asset_object, string, &asset_object::symbol> >,
-         ordered_non_unique< tag<by_issuer>, member<asset_object, account_id_type, &asset_object::issuer > >,
+         ordered_unique< tag<by_issuer>,
+            composite_key< asset_object,
+                member<asset_object, account_id_type, &asset_object::issuer >,
+                member< object, object_id_type, &object::id >
+            >
+         >,
          ordered_unique< tag<by_type>,
             composite_key< asset_object,
                 const_mem_fun<asset_object, bool, &asset_object::is_market_issued>,
@@ -250,6 +256,34 @@ namespace graphene { namespace chain {
    > asset_object_multi_index_type;
    typedef generic_index<asset_object, asset_object_multi_index_type> asset_index;
 
+   /**
+    *  @brief Maps bitasset data to its asset and tracks the market issued assets which were created, loaded or
+    *  modified since @ref database::update_expired_feeds last looked at them.
+    */
+   class market_issued_asset_index : public secondary_index
+   {
+      public:
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+         virtual void object_modified( const object& after  ) override;
+
+         std::unordered_map< asset_bitasset_data_id_type, asset_id_type > bitasset_to_asset;
+         flat_set<asset_id_type>                                         changed_assets;
+   };
+
+   /**
+    *  @brief Tracks the bitasset data which was created, loaded or modified since @ref database::update_expired_feeds
+    *  last looked at it.
+    */
+   class bitasset_change_index : public secondary_index
+   {
+      public:
+         virtual void object_inserted( const object& obj ) override { changed_bitassets.insert( obj.id ); }
+         virtual void object_modified( const object& after  ) override { changed_bitassets.insert( after.id ); }
+
+         flat_set<asset_bitasset_data_id_type> changed_bitassets;
+   };
+
 } } // graphene::chain
 
 FC_REFLECT_DERIVED( graphene::chain::asset_dynamic_data_object, (graphene::db::object),
@@ -23,9 +23,31 @@
  */
 #pragma once
 #include <fstream>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
 #include <graphene/chain/protocol/block.hpp>
 
 namespace graphene { namespace chain {
+   struct index_entry;
+   struct decompressed_chunk;
+
+   /** a block as it is stored, which is also how it is packed into a block_message */
+   struct packed_block
+   {
+      block_id_type id;
+      vector<char>  data;
+   };
+
+   /**
+    * Blocks are stored in a data file and located through a fixed size index entry per block number.
+    *
+    * A database created after @ref set_chunk_size is called with a non-zero value uses chunked storage: new blocks
+    * are appended to a raw file per group of consecutive block numbers and @ref compress_until moves complete groups
+    * of (irreversible) blocks into a single zlib compressed chunk.  Recently read chunks are kept decompressed in a
+    * small cache.  The storage mode of an existing database is detected on @ref open.
+    */
    class block_database 
    {
       public:
@@ -34,6 +56,21 @@ namespace graphene { namespace chain {
          void flush();
          void close();
 
+         /** Number of blocks per compressed chunk used when a new database is created, 0 for uncompressed storage */
+         void set_chunk_size( uint32_t blocks_per_chunk ) { _chunk_size = blocks_per_chunk; }
+         /** Number of blocks per compressed chunk of the open database, 0 if it is not chunked */
+         uint32_t blocks_per_chunk()const { return _blocks_per_chunk; }
+         /** Compress all complete chunks containing only blocks up to @p block_num, does nothing if not chunked */
+         void compress_until( uint32_t block_num );
+
+         /**
+          * The lowest block number the database holds blocks from: 1, unless it was started from a state snapshot,
+          * in which case there are no blocks before the snapshot's block
+          */
+         uint32_t first_block_num()const { return _first_block_num; }
+         /** Record that the database starts at @p block_num, kept in a file next to the index */
+         void set_first_block_num( uint32_t block_num );
+
          void store( const block_id_type& id, const signed_block& b );
          void remove( const block_id_type& id );
 
@@ -43,8 +80,41 @@ namespace graphene { namespace chain {
          optional<signed_block> fetch_by_number( uint32_t block_num )const;
          optional<signed_block> last()const;
          optional<block_id_type> last_id()const;
+
+         /**
+          * The ids of up to @p count blocks starting at @p first_block_num, read from the index in one go.  Stops at
+          * the first block number without a block.
+          */
+         vector<block_id_type>  fetch_block_ids( uint32_t first_block_num, uint32_t count )const;
+         /**
+          * Up to @p count consecutive blocks starting at @p first_block_num, without unpacking them.  Blocks stored
+          * back to back are read with a single read.  Stops at the first block number without a block, or before the
+          * block that would take the total size over @p max_size, though the first block is always returned.
+          */
+         vector<packed_block>   fetch_packed_blocks( uint32_t first_block_num, uint32_t count,
+                                                     uint64_t max_size = std::numeric_limits<uint64_t>::max() )const;
       private:
+         bool           read_entry( uint32_t block_num, index_entry& e )const;
+         vector<index_entry> read_entries( uint32_t first_block_num, uint32_t count )const;
+         vector<char>   read_block( const index_entry& e )const;
+         /// the file an index entry not in a compressed chunk points into
+         std::fstream&  data_file( const index_entry& e )const;
+         std::fstream&  raw_file( uint32_t chunk )const;
+         fc::path       raw_file_path( uint32_t chunk )const;
+         std::shared_ptr<const decompressed_chunk> load_chunk( uint64_t pos )const;
+         void           compress_chunk( uint32_t chunk );
+
+         fc::path             _dbdir;
+         uint32_t             _chunk_size = 0;
+         uint32_t             _blocks_per_chunk = 0;
+         /// first chunk which may still have blocks in a raw file
+         uint32_t             _next_chunk = 0;
+         uint32_t             _first_block_num = 1;
+
+         /// the blocks file, or the chunks file when chunked
          mutable std::fstream _blocks;
          mutable std::fstream _block_num_to_pos;
+         mutable std::map< uint32_t, std::unique_ptr<std::fstream> >       _raw_files;
+         mutable std::list< std::shared_ptr<const decompressed_chunk> >   _chunk_cache;
    };
 } }
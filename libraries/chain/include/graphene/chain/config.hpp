@@ -47,6 +47,14 @@
 #define GRAPHENE_DEFAULT_MAX_TRANSACTION_SIZE 2048
 #define GRAPHENE_DEFAULT_MAX_BLOCK_SIZE  (GRAPHENE_DEFAULT_MAX_TRANSACTION_SIZE*GRAPHENE_DEFAULT_BLOCK_INTERVAL*200000)
 #define GRAPHENE_DEFAULT_MAX_TIME_UNTIL_EXPIRATION (60*60*24) // seconds,  aka: 1 day
+#define GRAPHENE_DEFAULT_MAX_PENDING_TRANSACTION_BYTES         (64*1024*1024) ///< node-local bound on the pending pool
+#define GRAPHENE_DEFAULT_MAX_PENDING_TRANSACTIONS              100000
+#define GRAPHENE_DEFAULT_MAX_PENDING_TRANSACTIONS_PER_ACCOUNT  0 ///< unlimited
+#define GRAPHENE_DEFAULT_STATE_CHECKPOINT_INTERVAL             10000 ///< blocks between state checkpoints
+#define GRAPHENE_DEFAULT_STATE_CHECKPOINT_OBJECTS_PER_BLOCK    20000 ///< objects of a state checkpoint saved per block pushed
+#define GRAPHENE_DEFAULT_STATE_SNAPSHOT_OBJECTS_PER_SLICE      20000 ///< objects of a state snapshot written between other tasks
+#define GRAPHENE_STATE_CHECKPOINTS_TO_KEEP                     2
+#define GRAPHENE_DEFAULT_BLOCK_LOG_CHUNK_SIZE                  256 ///< blocks per compressed block log chunk
 #define GRAPHENE_DEFAULT_MAINTENANCE_INTERVAL  (60*60*24) // seconds, aka: 1 day
 #define GRAPHENE_DEFAULT_MAINTENANCE_SKIP_SLOTS 3  // number of slots to skip for maintenance interval
 
@@ -27,6 +27,8 @@
 #include <graphene/chain/account_object.hpp>
 #include <graphene/chain/asset_object.hpp>
 #include <graphene/chain/fork_database.hpp>
+#include <graphene/chain/pending_transaction_pool.hpp>
+#include <graphene/chain/state_snapshot.hpp>
 #include <graphene/chain/block_database.hpp>
 #include <graphene/chain/genesis_state.hpp>
 #include <graphene/chain/evaluator.hpp>
@@ -115,6 +117,69 @@ namespace graphene { namespace chain {
          void close(bool rewind = true);
          void flush_block();
 
+         /**
+          * @brief Save the state at the last irreversible block every @p blocks blocks, 0 disables checkpoints
+          *
+          * Checkpoints are written to the state_checkpoints directory next to the object database while blocks
+          * are pushed, see @ref resume_from_state_checkpoint.  Each push_block() saves at most
+          * @p objects_per_block objects of the checkpoint, so writing one is spread over as many blocks as it
+          * takes instead of holding up block processing.  Until it is complete the undo history is kept back to
+          * the checkpoint's block, through which the objects changed since are saved as they were then.
+          */
+         void set_state_checkpoint_interval( uint32_t blocks,
+                                             uint32_t objects_per_block = GRAPHENE_DEFAULT_STATE_CHECKPOINT_OBJECTS_PER_BLOCK )
+         {
+            _state_checkpoint_interval = blocks;
+            _state_checkpoint_objects_per_block = objects_per_block;
+         }
+
+         /**
+          * @brief Store irreversible blocks in compressed chunks of @p blocks blocks, 0 stores them uncompressed
+          *
+          * Only applies to a block log created by the next @ref open, an existing log keeps its storage mode.
+          */
+         void set_block_log_chunk_size( uint32_t blocks ) { _block_id_to_block.set_chunk_size( blocks ); }
+
+         /**
+          * @brief Open the database from the newest state checkpoint matching the block log and replay the blocks after it
+          *
+          * This is an alternative to @ref reindex after an unclean shutdown and must be called instead of @ref open.
+          * @return false if there is no usable checkpoint, in which case the database is left closed
+          */
+         bool resume_from_state_checkpoint( const fc::path& data_dir );
+
+         /**
+          * @brief Write the state at the last irreversible block to a single checksummed file
+          *
+          * The file is written next to its final name and renamed once complete.  The whole state is written
+          * before this returns, see @ref start_state_snapshot to write it while the node keeps running.
+          */
+         state_snapshot_header create_state_snapshot( const fc::path& file );
+
+         /**
+          * @brief Start writing the state at the last irreversible block to @p file a slice at a time
+          *
+          * Call @ref continue_state_snapshot until it returns true; blocks and transactions may be pushed in
+          * between, the undo history is kept back to the snapshot's block until it is complete.  The undo history
+          * must reach that block, which it does not right after a replay unless the head block is irreversible.
+          * One snapshot is written at a time.
+          */
+         state_snapshot_header start_state_snapshot( const fc::path& file );
+         /**
+          * @brief Write up to @p max_objects more objects of the snapshot started by @ref start_state_snapshot
+          * @return true once the snapshot is complete, a failure abandons it
+          */
+         bool continue_state_snapshot( size_t max_objects );
+         bool is_writing_state_snapshot()const { return _state_snapshot_progress != nullptr; }
+
+         /**
+          * @brief Bootstrap the database from a snapshot file instead of @ref open
+          *
+          * Blocks stored in data_dir after the snapshot's block are replayed, and the snapshot's block is added to
+          * an empty block log so that the node can sync from it.
+          */
+         void open_from_state_snapshot( const fc::path& data_dir, const fc::path& snapshot );
+
          //////////////////// db_block.cpp ////////////////////
 
          /**
@@ -128,6 +193,13 @@ namespace graphene { namespace chain {
          optional<signed_block>     fetch_block_by_number( uint32_t num )const;
          const signed_transaction&  get_recent_transaction( const transaction_id_type& trx_id )const;
          std::vector<block_id_type> get_block_ids_on_fork(block_id_type head_of_fork) const;
+         /** the lowest block number in the block log, above 1 if the node was started from a state snapshot */
+         uint32_t                   first_stored_block_num()const { return _block_id_to_block.first_block_num(); }
+         /** the ids of up to @p count blocks of our chain starting at @p first_block_num, see block_database::fetch_block_ids */
+         vector<block_id_type>      get_block_ids_for_nums( uint32_t first_block_num, uint32_t count )const;
+         /** consecutive blocks of our chain as they are stored, see block_database::fetch_packed_blocks */
+         vector<packed_block>       fetch_packed_blocks( uint32_t first_block_num, uint32_t count,
+                                                         uint64_t max_size = std::numeric_limits<uint64_t>::max() )const;
 
          /**
           *  Calculate the percent of block production slots that were missed in the
@@ -140,11 +212,33 @@ namespace graphene { namespace chain {
          bool before_last_checkpoint()const;
 
 
+         /**
+          * push_block() and push_transaction() drop any memoized ids on their argument before use, since the
+          * caller may have edited it since the ids were filled.  Within the call every id is hashed once.
+          */
          bool push_block( const signed_block& b, uint32_t skip = skip_nothing );
          processed_transaction push_transaction( const signed_transaction& trx, uint32_t skip = skip_nothing );
          bool _push_block( const signed_block& b );
          processed_transaction _push_transaction( const signed_transaction& trx );
 
+         /**
+          * Re-push transactions that were pending before the state was rewound for a new block.  Transactions
+          * already included in a block are dropped by id.  The others are re-evaluated, but their signatures
+          * are only verified again if an object their authorities were read from appears in @p changed_objects
+          * (the objects written since they were last applied), or if that set is unknown.
+          */
+         void _push_pending_transactions( const vector<processed_transaction>& pending,
+                                          optional< flat_set<object_id_type> > changed_objects );
+
+         /**
+          * Rewind the pending state and push the transactions left in the pool again, so that transactions the pool
+          * evicted leave neither writes nor duplicate entries behind.
+          */
+         void rebuild_pending_transactions( const vector<transaction_id_type>& evicted );
+
+         /// @return the objects written by the head undo session, or nothing if undo tracking is disabled
+         optional< flat_set<object_id_type> > get_head_session_writes()const;
+
          ///@throws fc::exception if the proposed transaction fails to apply.
          processed_transaction push_proposal( const proposal_object& proposal );
 
@@ -163,6 +257,40 @@ namespace graphene { namespace chain {
          void pop_block();
          void clear_pending();
 
+         /**
+          * The pending pool is bounded by these limits.  Once it is full a transaction is only accepted if it pays
+          * a higher core fee per kilobyte than the cheapest pending one, which is evicted and its effects undone;
+          * otherwise push_transaction() throws pending_pool_full before evaluating it.
+          */
+         void set_pending_transaction_pool_limits( const pending_transaction_pool_limits& limits );
+
+         /**
+          * While enabled, the block generate_block() would build from the pending transactions is kept assembled
+          * as they are pushed: their merkle digests and the block size are accumulated incrementally.  If nothing
+          * invalidated it when the slot arrives (a new head block, the block size limit, or pending
+          * transactions applied with skip flags the producer does not use), generate_block() takes the pending
+          * transactions as they are instead of applying them again, and only has to sign and push the block.
+          */
+         void set_block_preassembly( bool enabled );
+
+         /**
+          * With more than one thread, applying a block first validates all of its transactions and checks their
+          * signatures and authorities concurrently against the state before the block, recording the accounts each
+          * check read.  The transactions are then applied in block order as before, reusing those checks unless an
+          * earlier transaction of the block wrote one of the accounts read, in which case the check runs again.
+          * This yields the same state as serial application.  1 (the default) disables it, 0 uses one thread per core.
+          */
+         void set_parallel_apply_threads( uint32_t threads ) { _parallel_apply_threads = threads; }
+         struct parallel_apply_counters
+         {
+            uint64_t verified_ahead = 0; ///< transactions applied with the checks done ahead
+            uint64_t reverified     = 0; ///< transactions checked again because the check ahead failed or read stale state
+         };
+         const parallel_apply_counters& get_parallel_apply_counters()const { return _parallel_apply_counters; }
+         /// @return true if generate_block() with @p skip would use the preassembled block
+         bool has_preassembled_block( uint32_t skip = skip_nothing )const;
+         const pending_transaction_pool& get_pending_transaction_pool()const { return _pending_tx; }
+
          /**
           *  This method is used to track appied operations during the evaluation of a block, these
           *  operations should include any operation actually included in a transaction as well
@@ -427,6 +555,9 @@ namespace graphene { namespace chain {
           */
          processed_transaction validate_transaction( const signed_transaction& trx );
 
+         /// Number of block/transaction id hashes answered from the memoized ids while pushing the last block
+         uint64_t get_id_hashes_avoided_last_block()const { return _id_hashes_avoided_last_block; }
+
 
          /** when popping a block, the transactions that were removed get cached here so they
           * can be reapplied at the proper time */
@@ -458,6 +589,12 @@ namespace graphene { namespace chain {
       private:
          void                  _apply_block( const signed_block& next_block );
          processed_transaction _apply_transaction( const signed_transaction& trx );
+         /**
+          * Validates the transactions of @p next_block and checks their signatures and authorities against the
+          * current state on _parallel_apply_threads threads.
+          * @return per transaction the objects its authorities were read from, unset where a check failed
+          */
+         vector< optional< flat_set<object_id_type> > > verify_transactions_ahead( const signed_block& next_block )const;
 
          ///Steps involved in applying a new block
          ///@{
@@ -496,9 +633,79 @@ namespace graphene { namespace chain {
          ///@}
          ///@}
 
-         vector< processed_transaction >        _pending_tx;
+         pending_transaction_pool               _pending_tx;
          fork_database                          _fork_db;
 
+         /// the market issued assets update_expired_feeds has to check besides those with an expiring feed
+         market_issued_asset_index*             _market_issued_assets = nullptr;
+         bitasset_change_index*                 _bitasset_changes = nullptr;
+
+         /**
+          * What a pending transaction depended on when it was last applied: the objects its authorities were
+          * read from (unset if they were not verified) and the objects its evaluation wrote.
+          */
+         struct pending_transaction_dependencies
+         {
+            optional< flat_set<object_id_type> > authority_reads;
+            flat_set<object_id_type>             writes;
+         };
+         map< transaction_id_type, pending_transaction_dependencies > _pending_tx_deps;
+         /// the incrementally assembled next block, see set_block_preassembly()
+         struct block_candidate
+         {
+            bool                enabled = false;
+            bool                valid = true;
+            block_id_type       head_block_id;
+            vector<digest_type> merkle_leaves;
+            size_t              total_size = 0;
+            uint32_t            skip_flags = 0;
+         };
+         block_candidate                        _block_candidate;
+         /// skip flags added by _push_pending_transactions() that do not weaken the checks already performed
+         uint32_t                               _implied_skip_flags = 0;
+         void reset_block_candidate();
+         void append_to_block_candidate( const processed_transaction& trx );
+
+         uint32_t                               _state_checkpoint_interval = 0;
+         uint32_t                               _state_checkpoint_objects_per_block = GRAPHENE_DEFAULT_STATE_CHECKPOINT_OBJECTS_PER_BLOCK;
+         uint32_t                               _last_state_checkpoint = 0;
+         /// the checkpoint being written a slice per block, of the state at _state_checkpoint_block
+         std::unique_ptr<state_save_progress>   _state_checkpoint_progress;
+         uint32_t                               _state_checkpoint_block = 0;
+         fc::time_point                         _state_checkpoint_start;
+         /// starts a checkpoint once the interval has passed and saves the next slice of the one being written
+         void continue_state_checkpoint();
+         /// saves the state before the newest @p undo_states undo states as the checkpoint of block @p block_num
+         void write_state_checkpoint( uint32_t block_num, size_t undo_states );
+         /// marks the saved checkpoint of block @p block_num complete and drops the older ones
+         void finish_state_checkpoint( uint32_t block_num, fc::time_point start );
+
+         /// the state snapshot being written a slice at a time, of the state at _state_snapshot_block
+         std::unique_ptr<state_export_progress> _state_snapshot_progress;
+         std::unique_ptr<std::ofstream>         _state_snapshot_out;
+         fc::path                               _state_snapshot_file;
+         uint32_t                               _state_snapshot_block = 0;
+         fc::time_point                         _state_snapshot_start;
+         /// removes the partly written state snapshot
+         void abandon_state_snapshot();
+         /// applies the stored blocks following the head block, as done when reindexing
+         void replay_block_log();
+
+         /// authority reads gathered by the last _apply_transaction() call, unset if verification was skipped
+         optional< flat_set<object_id_type> >   _current_trx_authority_reads;
+         /// set by _apply_block() for the next _apply_transaction() call if its checks were done ahead
+         bool                                   _current_trx_verified_ahead = false;
+         uint32_t                               _parallel_apply_threads = 1;
+         parallel_apply_counters                _parallel_apply_counters;
+
+         bool pending_transaction_unaffected( const transaction_id_type& trx_id,
+                                              const optional< flat_set<object_id_type> >& changed_objects )const;
+         void record_pending_transaction_dependencies( const transaction_id_type& trx_id );
+         void mark_pending_transaction_writes_changed( const transaction_id_type& trx_id,
+                                                       optional< flat_set<object_id_type> >& changed_objects )const;
+         /// the fees of @p trx converted to the core asset at each fee asset's core exchange rate
+         share_type get_core_fee_amount( const transaction& trx )const;
+
          /**
           *  Note: we can probably store blocks by block num rather than
           *  block id because after the undo window is past the block ID
@@ -531,6 +738,8 @@ namespace graphene { namespace chain {
          flat_map<uint32_t,block_id_type>  _checkpoints;
 
          node_property_object              _node_property_object;
+
+         uint64_t                          _id_hashes_avoided_last_block = 0;
    };
 
    namespace detail
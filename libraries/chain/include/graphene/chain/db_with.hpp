@@ -76,10 +76,16 @@ struct pending_transactions_restorer
 
    ~pending_transactions_restorer()
    {
+      // Objects written by the block that was just pushed.  After a fork switch several blocks were
+      // applied, so the pending transactions are fully re-verified.
+      optional< flat_set<object_id_type> > changed_objects;
+      if( _db._popped_tx.empty() )
+         changed_objects = _db.get_head_session_writes();
+
       for( const auto& tx : _db._popped_tx )
       {
          try {
-            if( !_db.is_known_transaction( tx.id() ) ) {
+            if( !_db.is_known_transaction( tx.cached_id() ) ) {
                // since push_transaction() takes a signed_transaction,
                // the operation_results field will be ignored.
                _db._push_transaction( tx );
@@ -88,23 +94,13 @@ struct pending_transactions_restorer
          }
       }
       _db._popped_tx.clear();
-      for( const processed_transaction& tx : _pending_transactions )
+      try
       {
-         try
-         {
-            if( !_db.is_known_transaction( tx.id() ) ) {
-               // since push_transaction() takes a signed_transaction,
-               // the operation_results field will be ignored.
-               _db._push_transaction( tx );
-            }
-         }
-         catch( const fc::exception& e )
-         {
-            /*
-            wlog( "Pending transaction became invalid after switching to block ${b}  ${t}", ("b", _db.head_block_id())("t",_db.head_block_time()) );
-            wlog( "The invalid pending transaction caused exception ${e}", ("e", e.to_detail_string() ) );
-            */
-         }
+         _db._push_pending_transactions( _pending_transactions, std::move(changed_objects) );
+      }
+      catch( const fc::exception& e )
+      {
+         elog( "Failed to restore pending transactions: ${e}", ("e", e.to_detail_string()) );
       }
    }
 
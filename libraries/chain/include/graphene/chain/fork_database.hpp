@@ -38,7 +38,7 @@ namespace graphene { namespace chain {
    struct fork_item
    {
       fork_item( signed_block d )
-      :num(d.block_num()),id(d.id()),data( std::move(d) ){}
+      :num(d.block_num()),id(d.cached_id()),data( std::move(d) ){}
 
       block_id_type previous_id()const { return data.previous; }
 
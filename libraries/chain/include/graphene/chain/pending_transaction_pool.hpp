@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+#include <graphene/chain/protocol/transaction.hpp>
+#include <graphene/chain/config.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/composite_key.hpp>
+
+namespace graphene { namespace chain {
+   using boost::multi_index_container;
+   using namespace boost::multi_index;
+
+   /**
+    * Bounds on the pending transaction pool.  A limit of zero disables the corresponding check.
+    */
+   struct pending_transaction_pool_limits
+   {
+      uint64_t max_bytes        = GRAPHENE_DEFAULT_MAX_PENDING_TRANSACTION_BYTES;
+      uint32_t max_transactions = GRAPHENE_DEFAULT_MAX_PENDING_TRANSACTIONS;
+      uint32_t max_per_account  = GRAPHENE_DEFAULT_MAX_PENDING_TRANSACTIONS_PER_ACCOUNT;
+   };
+
+   struct pending_transaction_pool_stats
+   {
+      uint32_t transaction_count = 0;
+      uint64_t total_bytes       = 0;
+      uint64_t accepted          = 0; ///< transactions admitted since startup
+      uint64_t evicted           = 0; ///< transactions pushed out by ones paying a higher fee rate
+      uint64_t rejected          = 0; ///< transactions refused because the pool was full
+      uint64_t expired           = 0; ///< transactions dropped because they expired while pending
+   };
+
+   /**
+    * The transactions waiting to be included in a block, indexed by arrival order and by the core fee they pay per
+    * kilobyte.  When the pool is full a new transaction is only admitted if it pays a higher fee rate than the
+    * cheapest pending transaction, which is then evicted.
+    *
+    * The pool only tracks the transactions; their effects live in the database's pending undo session.  The effects
+    * of an evicted transaction therefore remain visible until the pending state is rebuilt on the next block.
+    */
+   class pending_transaction_pool
+   {
+      public:
+         struct entry
+         {
+            processed_transaction trx;
+            transaction_id_type   trx_id;
+            account_id_type       fee_payer;
+            time_point_sec        expiration;
+            uint64_t              fee_rate = 0; ///< core fee per 1024 bytes
+            uint32_t              size = 0;
+            uint64_t              sequence = 0;
+         };
+
+         struct by_sequence;
+         struct by_fee_rate;
+         struct by_fee_payer;
+         struct by_expiration;
+         struct by_trx_id;
+         typedef multi_index_container<
+            entry,
+            indexed_by<
+               ordered_unique< tag<by_sequence>, member< entry, uint64_t, &entry::sequence > >,
+               hashed_unique< tag<by_trx_id>, member< entry, transaction_id_type, &entry::trx_id >, std::hash<transaction_id_type> >,
+               ordered_unique< tag<by_fee_rate>,
+                  composite_key< entry,
+                     member< entry, uint64_t, &entry::fee_rate >,
+                     member< entry, uint64_t, &entry::sequence >
+                  >,
+                  composite_key_compare< std::greater<uint64_t>, std::less<uint64_t> >
+               >,
+               ordered_non_unique< tag<by_fee_payer>, member< entry, account_id_type, &entry::fee_payer > >,
+               ordered_non_unique< tag<by_expiration>, member< entry, time_point_sec, &entry::expiration > >
+            >
+         > index_type;
+
+         /// the account paying the fee of the first operation, which is the account the per-account limit applies to
+         static account_id_type get_fee_payer( const transaction& trx );
+         static asset get_operation_fee( const operation& op );
+         static uint64_t calculate_fee_rate( share_type core_fee, uint32_t size );
+
+         void set_limits( const pending_transaction_pool_limits& limits ) { _limits = limits; }
+         const pending_transaction_pool_limits& get_limits()const { return _limits; }
+
+         /**
+          * Checks whether a transaction could be admitted without modifying the pool, so that transactions which
+          * would be refused are not evaluated first.
+          *
+          * @throws pending_pool_full if the fee payer has too many pending transactions or the pool is full of
+          * transactions paying at least the same fee rate
+          */
+         void check_admission( account_id_type fee_payer, uint64_t fee_rate, uint32_t size )const;
+
+         /**
+          * Adds an applied transaction, evicting the cheapest transactions as needed to stay within the limits.
+          *
+          * @return the ids of the evicted transactions
+          */
+         vector<transaction_id_type> insert( const processed_transaction& trx, account_id_type fee_payer,
+                                             uint64_t fee_rate, uint32_t size );
+
+         /// drops transactions that expired before @p now, returns how many were dropped
+         uint32_t remove_expired( time_point_sec now );
+
+         /// empties the pool, returning the transactions in the order they arrived
+         vector<processed_transaction> take_all();
+         void clear();
+
+         bool contains( const transaction_id_type& trx_id )const;
+         size_t size()const { return _index.size(); }
+         bool empty()const { return _index.empty(); }
+         uint64_t total_bytes()const { return _total_bytes; }
+         const index_type& indices()const { return _index; }
+
+         pending_transaction_pool_stats get_stats()const;
+
+      private:
+         [[noreturn]] void reject( const char* reason, account_id_type fee_payer, uint64_t fee_rate )const;
+         bool fits( uint64_t total_bytes, size_t transaction_count )const;
+
+         pending_transaction_pool_limits _limits;
+         index_type                      _index;
+         uint64_t                        _total_bytes = 0;
+         uint64_t                        _next_sequence = 0;
+         mutable pending_transaction_pool_stats _stats;
+   };
+
+} } // graphene::chain
+
+FC_REFLECT( graphene::chain::pending_transaction_pool_limits, (max_bytes)(max_transactions)(max_per_account) )
+FC_REFLECT( graphene::chain::pending_transaction_pool_stats,
+            (transaction_count)(total_bytes)(accepted)(evicted)(rejected)(expired) )
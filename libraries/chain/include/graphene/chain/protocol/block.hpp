@@ -42,16 +42,29 @@ namespace graphene { namespace chain {
    struct signed_block_header : public block_header
    {
       block_id_type              id()const;
+      /**
+       * Memoized form of id(), computed on first use.  sign() clears the cache; code that edits header
+       * fields directly after the cache was filled must call invalidate_cached_id().
+       */
+      const block_id_type&       cached_id()const;
+      void                       invalidate_cached_id()const { _cached_id.reset(); }
       fc::ecc::public_key        signee()const;
       void                       sign( const fc::ecc::private_key& signer );
       bool                       validate_signee( const fc::ecc::public_key& expected_signee )const;
 
       signature_type             witness_signature;
+
+   private:
+      mutable optional<block_id_type> _cached_id;
    };
 
    struct signed_block : public signed_block_header
    {
       checksum_type calculate_merkle_root()const;
+      /// The merkle root of the given transaction merkle digests, in block order
+      static checksum_type calculate_merkle_root( vector<digest_type> ids );
+      /// Drops the memoized ids of the header and of every contained transaction
+      void invalidate_cached_ids()const;
       vector<processed_transaction> transactions;
    };
 
@@ -25,10 +25,24 @@
 #include <graphene/chain/protocol/operations.hpp>
 #include <graphene/chain/protocol/types.hpp>
 
+#include <atomic>
 #include <numeric>
 
 namespace graphene { namespace chain {
 
+   /**
+    * Process-wide counters for the memoized id accessors (@ref transaction::cached_id and
+    * @ref signed_block_header::cached_id).  @ref computed counts hashes actually performed,
+    * @ref reused counts calls answered from the cache.
+    */
+   struct id_cache_counters
+   {
+      std::atomic<uint64_t> computed{0};
+      std::atomic<uint64_t> reused{0};
+   };
+
+   id_cache_counters& get_id_cache_counters();
+
    /**
     * @defgroup transactions Transactions
     *
@@ -91,6 +105,15 @@ namespace graphene { namespace chain {
       /// Calculate the digest used for signature validation
       digest_type         sig_digest( const chain_id_type& chain_id )const;
 
+      /**
+       * Memoized forms of id() and sig_digest().  The values are computed on first use and reused until
+       * invalidate_cached_id() is called.  set_expiration() and set_reference_block() invalidate them, but code
+       * that edits fields directly after the cache was filled must invalidate it explicitly.
+       */
+      const transaction_id_type& cached_id()const;
+      const digest_type&         cached_sig_digest( const chain_id_type& chain_id )const;
+      void                       invalidate_cached_id()const { _cached_id.reset(); _cached_sig_digest.reset(); }
+
       void set_expiration( fc::time_point_sec expiration_time );
       void set_reference_block( const block_id_type& reference_block );
 
@@ -113,6 +136,10 @@ namespace graphene { namespace chain {
       }
 
       void get_required_authorities( flat_set<account_id_type>& active, flat_set<account_id_type>& owner, vector<authority>& other )const;
+
+   private:
+      mutable optional<transaction_id_type>                   _cached_id;
+      mutable optional<std::pair<chain_id_type,digest_type>> _cached_sig_digest;
    };
 
    /**
@@ -166,11 +193,13 @@ namespace graphene { namespace chain {
          ) const;
 
       flat_set<public_key_type> get_signature_keys( const chain_id_type& chain_id )const;
+      /// Recover the signing keys against an already computed signature digest (see @ref cached_sig_digest)
+      flat_set<public_key_type> get_signature_keys_for_digest( const digest_type& sig_digest )const;
 
       vector<signature_type> signatures;
 
       /// Removes all operations and signatures
-      void clear() { operations.clear(); signatures.clear(); }
+      void clear() { operations.clear(); signatures.clear(); invalidate_cached_id(); }
    };
 
    void verify_authority( const vector<operation>& ops, const flat_set<public_key_type>& sigs,
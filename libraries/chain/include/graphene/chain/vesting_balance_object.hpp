@@ -175,8 +175,11 @@ namespace graphene { namespace chain {
       vesting_balance_object,
       indexed_by<
          ordered_unique< tag<by_id>, member< object, object_id_type, &object::id > >,
-         ordered_non_unique< tag<by_account>,
-            member<vesting_balance_object, account_id_type, &vesting_balance_object::owner>
+         ordered_unique< tag<by_account>,
+            composite_key< vesting_balance_object,
+               member<vesting_balance_object, account_id_type, &vesting_balance_object::owner>,
+               member< object, object_id_type, &object::id >
+            >
          >
       >
    > vesting_balance_multi_index_type;
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/pending_transaction_pool.hpp>
+#include <graphene/chain/exceptions.hpp>
+
+namespace graphene { namespace chain {
+
+namespace {
+   struct fee_payer_visitor
+   {
+      typedef account_id_type result_type;
+      template<typename T>
+      account_id_type operator()( const T& op )const { return op.fee_payer(); }
+   };
+
+   struct fee_visitor
+   {
+      typedef asset result_type;
+      template<typename T>
+      asset operator()( const T& op )const { return op.fee; }
+   };
+}
+
+account_id_type pending_transaction_pool::get_fee_payer( const transaction& trx )
+{
+   if( trx.operations.empty() )
+      return account_id_type();
+   return trx.operations.front().visit( fee_payer_visitor() );
+}
+
+asset pending_transaction_pool::get_operation_fee( const operation& op )
+{
+   return op.visit( fee_visitor() );
+}
+
+uint64_t pending_transaction_pool::calculate_fee_rate( share_type core_fee, uint32_t size )
+{
+   if( core_fee <= 0 || size == 0 )
+      return 0;
+   return ( (fc::uint128( core_fee.value ) * 1024) / size ).to_uint64();
+}
+
+bool pending_transaction_pool::fits( uint64_t total_bytes, size_t transaction_count )const
+{
+   if( _limits.max_transactions != 0 && transaction_count > _limits.max_transactions )
+      return false;
+   if( _limits.max_bytes != 0 && total_bytes > _limits.max_bytes )
+      return false;
+   return true;
+}
+
+void pending_transaction_pool::reject( const char* reason, account_id_type fee_payer, uint64_t fee_rate )const
+{
+   ++_stats.rejected;
+   FC_THROW_EXCEPTION( pending_pool_full, "Pending transaction refused: ${r}",
+                       ("r",reason)("fee_payer",fee_payer)("fee_rate",fee_rate)
+                       ("pending",_index.size())("bytes",_total_bytes) );
+}
+
+void pending_transaction_pool::check_admission( account_id_type fee_payer, uint64_t fee_rate, uint32_t size )const
+{
+   if( _limits.max_per_account != 0 && _index.get<by_fee_payer>().count( fee_payer ) >= _limits.max_per_account )
+      reject( "too many pending transactions from this account", fee_payer, fee_rate );
+   if( _limits.max_bytes != 0 && size > _limits.max_bytes )
+      reject( "transaction is larger than the pool", fee_payer, fee_rate );
+   if( fits( _total_bytes + size, _index.size() + 1 ) )
+      return;
+
+   // walk the cheapest transactions until enough room would be freed; all of them must pay less than the new one
+   const auto& by_rate = _index.get<by_fee_rate>();
+   uint64_t freed_bytes = 0;
+   size_t   freed_count = 0;
+   for( auto itr = by_rate.rbegin(); itr != by_rate.rend(); ++itr )
+   {
+      if( itr->fee_rate >= fee_rate )
+         break;
+      freed_bytes += itr->size;
+      ++freed_count;
+      if( fits( _total_bytes - freed_bytes + size, _index.size() - freed_count + 1 ) )
+         return;
+   }
+   reject( "pool is full of transactions paying at least the same fee rate", fee_payer, fee_rate );
+}
+
+vector<transaction_id_type> pending_transaction_pool::insert( const processed_transaction& trx, account_id_type fee_payer,
+                                                              uint64_t fee_rate, uint32_t size )
+{
+   check_admission( fee_payer, fee_rate, size );
+
+   vector<transaction_id_type> evicted;
+   auto& by_rate = _index.get<by_fee_rate>();
+   while( !by_rate.empty() && !fits( _total_bytes + size, _index.size() + 1 ) )
+   {
+      auto itr = std::prev( by_rate.end() );
+      evicted.push_back( itr->trx_id );
+      _total_bytes -= itr->size;
+      by_rate.erase( itr );
+   }
+   _stats.evicted += evicted.size();
+
+   entry e;
+   e.trx        = trx;
+   e.trx_id     = trx.cached_id();
+   e.fee_payer  = fee_payer;
+   e.expiration = trx.expiration;
+   e.fee_rate   = fee_rate;
+   e.size       = size;
+   e.sequence   = _next_sequence++;
+   FC_ASSERT( _index.insert( std::move(e) ).second, "Transaction is already pending" );
+   _total_bytes += size;
+   ++_stats.accepted;
+
+   if( !evicted.empty() )
+      dlog( "Evicted ${n} pending transactions paying less than ${r} per KB", ("n",evicted.size())("r",fee_rate) );
+   return evicted;
+}
+
+uint32_t pending_transaction_pool::remove_expired( time_point_sec now )
+{
+   auto& by_exp = _index.get<by_expiration>();
+   uint32_t removed = 0;
+   while( !by_exp.empty() && by_exp.begin()->expiration < now )
+   {
+      _total_bytes -= by_exp.begin()->size;
+      by_exp.erase( by_exp.begin() );
+      ++removed;
+   }
+   _stats.expired += removed;
+   return removed;
+}
+
+vector<processed_transaction> pending_transaction_pool::take_all()
+{
+   vector<processed_transaction> result;
+   result.reserve( _index.size() );
+   for( const entry& e : _index.get<by_sequence>() )
+      result.push_back( e.trx );
+   clear();
+   return result;
+}
+
+void pending_transaction_pool::clear()
+{
+   _index.clear();
+   _total_bytes = 0;
+}
+
+bool pending_transaction_pool::contains( const transaction_id_type& trx_id )const
+{
+   const auto& by_id = _index.get<by_trx_id>();
+   return by_id.find( trx_id ) != by_id.end();
+}
+
+pending_transaction_pool_stats pending_transaction_pool::get_stats()const
+{
+   pending_transaction_pool_stats result = _stats;
+   result.transaction_count = _index.size();
+   result.total_bytes = _total_bytes;
+   return result;
+}
+
+} } // graphene::chain
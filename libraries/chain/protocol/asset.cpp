@@ -26,9 +26,22 @@
 #include <boost/multiprecision/cpp_int.hpp>
 
 namespace graphene { namespace chain {
-      typedef boost::multiprecision::uint128_t uint128_t;
       typedef boost::multiprecision::int128_t  int128_t;
 
+      /**
+       *  Price comparisons and conversions are evaluated for every order the market engine
+       *  touches.  Amounts are non-negative and below 2^63, so their products always fit in
+       *  128 bits; use the compiler's native type for them where it exists, it is several
+       *  times faster than the multiprecision backend.
+       */
+#ifdef __SIZEOF_INT128__
+      typedef unsigned __int128 uint128_t;
+      static inline int64_t to_int64( uint128_t v ) { return static_cast<int64_t>( v ); }
+#else
+      typedef boost::multiprecision::uint128_t uint128_t;
+      static inline int64_t to_int64( const uint128_t& v ) { return v.convert_to<int64_t>(); }
+#endif
+
       bool operator == ( const price& a, const price& b )
       {
          if( std::tie( a.base.asset_id, a.quote.asset_id ) != std::tie( b.base.asset_id, b.quote.asset_id ) )
@@ -53,9 +66,11 @@ namespace graphene { namespace chain {
          return amult < bmult;
       }
 
+      // operator < is a strict weak ordering in which equivalent prices are exactly the ones
+      // operator == accepts, so the remaining comparisons need a single cross multiplication
       bool operator <= ( const price& a, const price& b )
       {
-         return (a == b) || (a < b);
+         return !(b < a);
       }
 
       bool operator != ( const price& a, const price& b )
@@ -65,7 +80,7 @@ namespace graphene { namespace chain {
 
       bool operator > ( const price& a, const price& b )
       {
-         return !(a <= b);
+         return b < a;
       }
 
       bool operator >= ( const price& a, const price& b )
@@ -80,14 +95,14 @@ namespace graphene { namespace chain {
             FC_ASSERT( b.base.amount.value > 0 );
             uint128_t result = (uint128_t(a.amount.value) * b.quote.amount.value)/b.base.amount.value;
             FC_ASSERT( result <= GRAPHENE_MAX_SHARE_SUPPLY );
-            return asset( result.convert_to<int64_t>(), b.quote.asset_id );
+            return asset( to_int64( result ), b.quote.asset_id );
          }
          else if( a.asset_id == b.quote.asset_id )
          {
             FC_ASSERT( b.quote.amount.value > 0 );
             uint128_t result = (uint128_t(a.amount.value) * b.base.amount.value)/b.quote.amount.value;
             FC_ASSERT( result <= GRAPHENE_MAX_SHARE_SUPPLY );
-            return asset( result.convert_to<int64_t>(), b.base.asset_id );
+            return asset( to_int64( result ), b.base.asset_id );
          }
          FC_THROW_EXCEPTION( fc::assert_exception, "invalid asset * price", ("asset",a)("price",b) );
       }
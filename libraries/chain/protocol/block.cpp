@@ -47,6 +47,18 @@ namespace graphene { namespace chain {
       return result;
    }
 
+   const block_id_type& signed_block_header::cached_id()const
+   {
+      if( !_cached_id.valid() )
+      {
+         _cached_id = id();
+         ++get_id_cache_counters().computed;
+      }
+      else
+         ++get_id_cache_counters().reused;
+      return *_cached_id;
+   }
+
    fc::ecc::public_key signed_block_header::signee()const
    {
       return fc::ecc::public_key( witness_signature, digest(), true/*enforce canonical*/ );
@@ -55,6 +67,7 @@ namespace graphene { namespace chain {
    void signed_block_header::sign( const fc::ecc::private_key& signer )
    {
       witness_signature = signer.sign_compact( digest() );
+      invalidate_cached_id();
    }
 
    bool signed_block_header::validate_signee( const fc::ecc::public_key& expected_signee )const
@@ -62,16 +75,28 @@ namespace graphene { namespace chain {
       return signee() == expected_signee;
    }
 
-   checksum_type signed_block::calculate_merkle_root()const
+   void signed_block::invalidate_cached_ids()const
    {
-      if( transactions.size() == 0 ) 
-         return checksum_type();
+      invalidate_cached_id();
+      for( const auto& trx : transactions )
+         trx.invalidate_cached_id();
+   }
 
+   checksum_type signed_block::calculate_merkle_root()const
+   {
       vector<digest_type> ids;
       ids.resize( transactions.size() );
       for( uint32_t i = 0; i < transactions.size(); ++i )
          ids[i] = transactions[i].merkle_digest();
 
+      return calculate_merkle_root( std::move(ids) );
+   }
+
+   checksum_type signed_block::calculate_merkle_root( vector<digest_type> ids )
+   {
+      if( ids.size() == 0 )
+         return checksum_type();
+
       vector<digest_type>::size_type current_number_of_hashes = ids.size();
       while( current_number_of_hashes > 1 )
       {
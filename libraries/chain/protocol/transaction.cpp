@@ -30,6 +30,12 @@
 
 namespace graphene { namespace chain {
 
+id_cache_counters& get_id_cache_counters()
+{
+   static id_cache_counters counters;
+   return counters;
+}
+
 digest_type processed_transaction::merkle_digest()const
 {
    digest_type::encoder enc;
@@ -52,6 +58,18 @@ digest_type transaction::sig_digest( const chain_id_type& chain_id )const
    return enc.result();
 }
 
+const digest_type& transaction::cached_sig_digest( const chain_id_type& chain_id )const
+{
+   if( !_cached_sig_digest.valid() || _cached_sig_digest->first != chain_id )
+   {
+      _cached_sig_digest = std::make_pair( chain_id, sig_digest( chain_id ) );
+      ++get_id_cache_counters().computed;
+   }
+   else
+      ++get_id_cache_counters().reused;
+   return _cached_sig_digest->second;
+}
+
 void transaction::validate() const
 {
    FC_ASSERT( operations.size() > 0, "A transaction must have at least one operation", ("trx",*this) );
@@ -67,6 +85,18 @@ graphene::chain::transaction_id_type graphene::chain::transaction::id() const
    return result;
 }
 
+const transaction_id_type& transaction::cached_id()const
+{
+   if( !_cached_id.valid() )
+   {
+      _cached_id = id();
+      ++get_id_cache_counters().computed;
+   }
+   else
+      ++get_id_cache_counters().reused;
+   return *_cached_id;
+}
+
 const signature_type& graphene::chain::signed_transaction::sign(const private_key_type& key, const chain_id_type& chain_id)
 {
    digest_type h = sig_digest( chain_id );
@@ -85,12 +115,14 @@ signature_type graphene::chain::signed_transaction::sign(const private_key_type&
 void transaction::set_expiration( fc::time_point_sec expiration_time )
 {
     expiration = expiration_time;
+    invalidate_cached_id();
 }
 
 void transaction::set_reference_block( const block_id_type& reference_block )
 {
    ref_block_num = fc::endian_reverse_u32(reference_block._hash[0]);
    ref_block_prefix = reference_block._hash[1];
+   invalidate_cached_id();
 }
 
 void transaction::get_required_authorities( flat_set<account_id_type>& active, flat_set<account_id_type>& owner, vector<authority>& other )const
@@ -346,8 +378,12 @@ void verify_authority( const vector<operation>& ops, const flat_set<public_key_t
 
 
 flat_set<public_key_type> signed_transaction::get_signature_keys( const chain_id_type& chain_id )const
+{
+   return get_signature_keys_for_digest( sig_digest( chain_id ) );
+}
+
+flat_set<public_key_type> signed_transaction::get_signature_keys_for_digest( const digest_type& d )const
 { try {
-   auto d = sig_digest( chain_id );
    flat_set<public_key_type> result;
    for( const auto&  sig : signatures )
    {
@@ -93,6 +93,15 @@ namespace graphene { namespace db {
             } FC_CAPTURE_AND_RETHROW()
          }
 
+         virtual void inspect_objects_from( object_id_type start, std::function<bool(const object&)> inspector )const override
+         {
+            try {
+               for( size_t instance = start.instance(); instance < _objects.size(); ++instance )
+                  if( !inspector( _objects[instance] ) )
+                     return;
+            } FC_CAPTURE_AND_RETHROW( (start) )
+         }
+
          virtual fc::uint128 hash()const override {
             fc::uint128 result;
             for( const auto& ptr : _objects )
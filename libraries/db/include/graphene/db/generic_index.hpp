@@ -28,12 +28,24 @@
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/mem_fun.hpp>
 
+#include <algorithm>
+#include <type_traits>
+
 namespace graphene { namespace chain {
 
    using boost::multi_index_container;
    using namespace boost::multi_index;
 
    struct by_id{};
+
+   namespace detail {
+      /** whether a multi_index index is ordered, hashed indexes have no key_comp() */
+      template<typename Index, typename = void>
+      struct is_ordered_index : std::false_type {};
+      template<typename Index>
+      struct is_ordered_index<Index, decltype( void( std::declval<const Index&>().key_comp() ) )> : std::true_type {};
+   }
+
    /**
     *  Almost all objects can be tracked and managed via a boost::multi_index container that uses
     *  an unordered_unique key on the object ID.  This template class adapts the generic index interface
@@ -95,6 +107,14 @@ namespace graphene { namespace chain {
             } FC_CAPTURE_AND_RETHROW()
          }
 
+         virtual void inspect_objects_from( object_id_type start, std::function<bool(const object&)> inspector )const override
+         {
+            try {
+               inspect_objects_from( start, inspector,
+                                     detail::is_ordered_index<typename index_type::template nth_index<0>::type>() );
+            } FC_CAPTURE_AND_RETHROW( (start) )
+         }
+
          const index_type& indices()const { return _indices; }
 
          virtual fc::uint128 hash()const override {
@@ -108,6 +128,29 @@ namespace graphene { namespace chain {
          }
 
       private:
+         void inspect_objects_from( object_id_type start, const std::function<bool(const object&)>& inspector,
+                                    std::true_type )const
+         {
+            for( auto itr = _indices.lower_bound( start ); itr != _indices.end(); ++itr )
+               if( !inspector( *itr ) )
+                  return;
+         }
+
+         /// an index hashed by id has to be sorted first
+         void inspect_objects_from( object_id_type start, const std::function<bool(const object&)>& inspector,
+                                    std::false_type )const
+         {
+            std::vector<const ObjectType*> objects;
+            for( const auto& o : _indices )
+               if( !( o.id < start ) )
+                  objects.push_back( &o );
+            std::sort( objects.begin(), objects.end(),
+                       []( const ObjectType* a, const ObjectType* b ) { return a->id < b->id; } );
+            for( const ObjectType* o : objects )
+               if( !inspector( *o ) )
+                  return;
+         }
+
          fc::uint128 _current_hash;
          index_type  _indices;
    };
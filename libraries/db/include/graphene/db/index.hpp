@@ -27,7 +27,10 @@
 #include <fc/io/raw.hpp>
 #include <fc/io/json.hpp>
 #include <fc/crypto/sha256.hpp>
+#include <fc/compress/zlib.hpp>
 #include <fstream>
+#include <sstream>
+#include <unordered_map>
 
 namespace graphene { namespace db {
    class object_database;
@@ -65,6 +68,25 @@ namespace graphene { namespace db {
     *  at all possible save a pointer/reference to your objects rather than constantly
     *  looking them up by ID.
     */
+   /**
+    *  The state of the database some undo states back, as seen through the undo history: objects changed since
+    *  then map to their earlier value, or to nullptr if they did not exist yet, and indexes that allocated ids
+    *  since then map to their earlier next id.
+    */
+   struct rewound_state
+   {
+      std::unordered_map<object_id_type, const object*>  objects;
+      std::unordered_map<object_id_type, object_id_type> next_ids;
+   };
+
+   /** how far saving an index a slice at a time has got, see index::save_slice() */
+   struct index_save_progress
+   {
+      bool               started = false;
+      object_id_type     next;   ///< the lowest id not saved yet
+      std::ostringstream chunk;  ///< packed objects waiting to be compressed
+   };
+
    class index
    {
       public:
@@ -94,7 +116,26 @@ namespace graphene { namespace db {
           *  Opens the index loading objects from a file
           */
          virtual void open( const fc::path& db ) = 0;
-         virtual void save( const fc::path& db ) = 0;
+         /**
+          *  Loads objects from the contents of an index file held in memory
+          */
+         virtual void open( fc::datastream<const char*>& ds ) = 0;
+         /**
+          *  Streams every object in the index to a file, optionally as zlib compressed chunks.  If rewind is
+          *  given the index is saved as it was at that earlier state instead.
+          */
+         virtual void save( const fc::path& db, bool compress, const rewound_state* rewind = nullptr )const = 0;
+         virtual void save( std::ostream& out, bool compress, const rewound_state* rewind = nullptr )const = 0;
+         /**
+          *  Streams more objects of the index as save() does, continuing where the previous call for the same
+          *  progress stopped, until budget objects have been saved.  The objects are saved as rewind has them, so
+          *  calls made while the index changes in between still save a consistent state, as long as each is given
+          *  the rewound state of the same earlier block.
+          *  @param budget the number of objects that may still be saved, reduced by those saved
+          *  @return true once the whole index has been saved
+          */
+         virtual bool save_slice( std::ostream& out, bool compress, index_save_progress& progress,
+                                  size_t& budget, const rewound_state& rewind )const = 0;
 
 
 
@@ -127,6 +168,9 @@ namespace graphene { namespace db {
          }
 
          virtual void               inspect_all_objects(std::function<void(const object&)> inspector)const = 0;
+         /** calls inspector for the objects with an id of at least start in id order, until it returns false */
+         virtual void               inspect_objects_from( object_id_type start,
+                                                          std::function<bool(const object&)> inspector )const = 0;
          virtual fc::uint128        hash()const = 0;
          virtual void               add_observer( const shared_ptr<index_observer>& ) = 0;
 
@@ -223,6 +267,15 @@ namespace graphene { namespace db {
             return fc::sha256::hash(desc);
          }
 
+         /**
+          *  Version of the file layout written by save(): objects are packed back to back instead of each
+          *  being wrapped in its own length prefixed buffer, so neither side has to stage them.
+          */
+         fc::sha256 get_stream_version()const
+         {
+            return fc::sha256::hash( std::string( "1.1" ) );
+         }
+
          virtual void open( const path& db )override
          { 
             if( !fc::exists( db ) ) return;
@@ -230,36 +283,127 @@ namespace graphene { namespace db {
             fc::file_mapping fm( db.generic_string().c_str(), fc::read_only );
             fc::mapped_region mr( fm, fc::read_only, 0, fc::file_size(db) );
             fc::datastream<const char*> ds( (const char*)mr.get_address(), mr.get_size() );
+            open( ds );
+         }
+
+         virtual void open( fc::datastream<const char*>& ds )override
+         {
             fc::sha256 open_ver;
 
             fc::raw::unpack(ds, _next_id);
             fc::raw::unpack(ds, open_ver);
-            FC_ASSERT( open_ver == get_object_version(), "Incompatible Version, the serialization of objects in this index has changed" );
-            try {
-               vector<char> tmp;
-               while( true ) 
-               {
-                  fc::raw::unpack( ds, tmp );
-                  load( tmp );
-               }
-            } catch ( const fc::exception&  ){}
+            if( open_ver == get_object_version() )
+            {
+               try {
+                  vector<char> tmp;
+                  while( true ) 
+                  {
+                     fc::raw::unpack( ds, tmp );
+                     load( tmp );
+                  }
+               } catch ( const fc::exception&  ){}
+               return;
+            }
+            FC_ASSERT( open_ver == get_stream_version(), "Incompatible Version, the serialization of objects in this index has changed" );
+
+            uint8_t compressed = 0;
+            fc::raw::unpack( ds, compressed );
+            if( !compressed )
+            {
+               load_stream( ds );
+               return;
+            }
+            while( ds.remaining() > 0 )
+            {
+               std::string chunk;
+               fc::raw::unpack( ds, chunk );
+               const std::string objects = fc::zlib_decompress( chunk );
+               fc::datastream<const char*> chunk_ds( objects.data(), objects.size() );
+               load_stream( chunk_ds );
+            }
          }
 
-         virtual void save( const path& db ) override 
+         virtual void save( const path& db, bool compress, const rewound_state* rewind = nullptr )const override 
          {
         	ilog( "save index: ${path},${spaceid},${typeid}, ${nextid}",
         			("path", db.generic_string())("spaceid", object_space_id())("typeid", object_type_id())("nextid", _next_id.number) );
             std::ofstream out( db.generic_string(), 
                                std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
             FC_ASSERT( out );
-            auto ver  = get_object_version();
-            fc::raw::pack( out, _next_id );
-            fc::raw::pack( out, ver );
+            save( out, compress, rewind );
+            out.flush();
+            FC_ASSERT( out, "Unable to write index file ${path}", ("path", db.generic_string()) );
+         }
+
+         virtual void save( std::ostream& out, bool compress, const rewound_state* rewind = nullptr )const override
+         {
+            write_header( out, compress, rewind );
+            std::ostringstream chunk;
             this->inspect_all_objects( [&]( const object& o ) {
-                auto vec = fc::raw::pack( static_cast<const object_type&>(o) );
-                auto packed_vec = fc::raw::pack( vec );
-                out.write( packed_vec.data(), packed_vec.size() );
+               if( rewind != nullptr )
+               {
+                  auto itr = rewind->objects.find( o.id );
+                  if( itr != rewind->objects.end() )
+                  {
+                     if( itr->second != nullptr )
+                        write_object( out, chunk, compress, *itr->second );
+                     return;
+                  }
+               }
+               write_object( out, chunk, compress, o );
+            });
+            if( rewind != nullptr )
+            {
+               // objects that have been removed since
+               for( const auto& item : rewind->objects )
+                  if( item.second != nullptr && item.first.space() == object_space_id() && item.first.type() == object_type_id()
+                      && this->find( item.first ) == nullptr )
+                     write_object( out, chunk, compress, *item.second );
+            }
+            if( chunk.tellp() > 0 )
+               write_chunk( out, chunk );
+         }
+
+         virtual bool save_slice( std::ostream& out, bool compress, index_save_progress& progress,
+                                  size_t& budget, const rewound_state& rewind )const override
+         {
+            if( !progress.started )
+            {
+               write_header( out, compress, &rewind );
+               progress.started = true;
+               progress.next = object_id_type( object_space_id(), object_type_id(), 0 );
+            }
+
+            // the slice covers the ids from progress.next up to the first object that did not fit
+            fc::optional<object_id_type> end;
+            this->inspect_objects_from( progress.next, [&]( const object& o ) {
+               if( budget == 0 )
+               {
+                  end = o.id;
+                  return false;
+               }
+               --budget;
+               auto itr = rewind.objects.find( o.id );
+               if( itr == rewind.objects.end() )
+                  write_object( out, progress.chunk, compress, o );
+               else if( itr->second != nullptr )
+                  write_object( out, progress.chunk, compress, *itr->second );
+               return true;
             });
+            // objects of the slice that have been removed since
+            for( const auto& item : rewind.objects )
+               if( item.second != nullptr && item.first.space() == object_space_id() && item.first.type() == object_type_id()
+                   && !( item.first < progress.next ) && ( !end || item.first < *end ) && this->find( item.first ) == nullptr )
+                  write_object( out, progress.chunk, compress, *item.second );
+
+            if( end )
+            {
+               progress.next = *end;
+               return false;
+            }
+            if( progress.chunk.tellp() > 0 )
+               write_chunk( out, progress.chunk );
+            return true;
          }
 
          virtual const object&  load( const std::vector<char>& data )override
@@ -326,6 +470,54 @@ namespace graphene { namespace db {
          }
 
       private:
+         /** amount of packed objects compressed together when saving with compression */
+         static const std::streamoff compressed_chunk_size = 1024 * 1024;
+
+         void write_header( std::ostream& out, bool compress, const rewound_state* rewind )const
+         {
+            object_id_type next_id = _next_id;
+            if( rewind != nullptr )
+            {
+               auto itr = rewind->next_ids.find( object_id_type( object_space_id(), object_type_id(), 0 ) );
+               if( itr != rewind->next_ids.end() )
+                  next_id = itr->second;
+            }
+            auto ver  = get_stream_version();
+            fc::raw::pack( out, next_id );
+            fc::raw::pack( out, ver );
+            fc::raw::pack( out, uint8_t( compress ) );
+         }
+
+         static void write_chunk( std::ostream& out, std::ostringstream& chunk )
+         {
+            fc::raw::pack( out, fc::zlib_compress( chunk.str() ) );
+            chunk.str( std::string() );
+         }
+
+         static void write_object( std::ostream& out, std::ostringstream& chunk, bool compress, const object& o )
+         {
+            if( !compress )
+            {
+               fc::raw::pack( out, static_cast<const object_type&>(o) );
+               return;
+            }
+            fc::raw::pack( chunk, static_cast<const object_type&>(o) );
+            if( chunk.tellp() >= compressed_chunk_size )
+               write_chunk( out, chunk );
+         }
+
+         void load_stream( fc::datastream<const char*>& ds )
+         {
+            while( ds.remaining() > 0 )
+            {
+               object_type obj;
+               fc::raw::unpack( ds, obj );
+               const auto& result = DerivedIndex::insert( std::move( obj ) );
+               for( const auto& item : _sindex )
+                  item->object_inserted( result );
+            }
+         }
+
          object_id_type _next_id;
    };
 
@@ -28,10 +28,38 @@
 
 #include <fc/log/logger.hpp>
 
+#include <fstream>
+#include <functional>
 #include <map>
+#include <memory>
+#include <unordered_set>
 
 namespace graphene { namespace db {
 
+   /**
+    *  Runs task(i) for every i in [0,count) on a pool of up to threads workers, the calling thread included, and
+    *  rethrows the first failure once all of them have finished.  0 threads picks one per core.
+    */
+   void run_in_parallel( size_t count, uint32_t threads, const std::function<void(size_t)>& task );
+
+   /** a state being saved into a directory a slice at a time, see object_database::save_state_slice() */
+   struct state_save_progress
+   {
+      fc::path                              target;
+      size_t                                index_num = 0;  ///< position of the index being saved in all indexes
+      std::unique_ptr<std::ofstream>        out;
+      std::unique_ptr<index_save_progress>  index;
+   };
+
+   /** a state being exported into a stream a slice at a time, see object_database::export_state_slice() */
+   struct state_export_progress
+   {
+      bool                                  started = false;
+      size_t                                index_num = 0;  ///< position of the index being exported in all indexes
+      std::streampos                        size_pos;       ///< where the size of its section is patched in
+      std::unique_ptr<index_save_progress>  index;
+   };
+
    /**
     *   @class object_database
     *   @brief maintains a set of indexed objects that can be modified with multi-level rollback support
@@ -44,12 +72,47 @@ namespace graphene { namespace db {
 
          void reset_indexes() { _index.clear(); _index.resize(255); }
 
-         void open(const fc::path& data_dir );
+         /**
+          * Opens the database in data_dir, loading the objects from source instead of data_dir if one is given
+          */
+         void open( const fc::path& data_dir, const fc::path& source = fc::path() );
 
          /**
           * Saves the complete state of the object_database to disk, this could take a while
           */
          void flush();
+         /**
+          * Saves the state as it was before the newest undo_states undo states into dir, which is replaced atomically
+          */
+         void save_state( const fc::path& dir, size_t undo_states )const;
+         /**
+          * Writes the state before the newest undo_states undo states to a seekable stream, one section per index
+          */
+         void export_state( std::ostream& out, size_t undo_states )const;
+         /**
+          * Starts saving a state into dir a slice at a time, dir is only replaced once all of it has been saved
+          */
+         std::unique_ptr<state_save_progress> start_saving_state( const fc::path& dir )const;
+         /**
+          * Saves up to max_objects more objects of the state given by rewind, see index::save_slice()
+          * @return true once the whole state has been saved and has replaced the directory
+          */
+         bool save_state_slice( state_save_progress& progress, const rewound_state& rewind, size_t max_objects )const;
+         /**
+          * Writes up to max_objects more objects of the state given by rewind to out, in the layout of export_state()
+          * @return true once the whole state has been written
+          */
+         bool export_state_slice( std::ostream& out, state_export_progress& progress, const rewound_state& rewind,
+                                  size_t max_objects )const;
+         /**
+          * Loads a state written by export_state() into the empty indexes, skipping indexes that are not registered
+          */
+         void import_state( fc::datastream<const char*>& ds );
+
+         /** compress index files written by flush(), reading handles both layouts */
+         void set_compression( bool compress ) { _compress = compress; }
+         /** number of threads used to save and load indexes, 0 picks one per core */
+         void set_io_threads( uint32_t threads ) { _io_threads = threads; }
          void wipe(const fc::path& data_dir); // remove from disk
          void close();
 
@@ -141,6 +204,12 @@ namespace graphene { namespace db {
 
          void pop_undo();
 
+         /**
+          * While @p writes is set, the ids of all objects created, modified or removed are added to it, whether or
+          * not undo tracking is enabled.  Pass nullptr to stop.
+          */
+         void track_writes( std::unordered_set<object_id_type>* writes ) { _tracked_writes = writes; }
+
          fc::path get_data_dir()const { return _data_dir; }
 
          /** public for testing purposes only... should be private in practice. */
@@ -164,8 +233,14 @@ namespace graphene { namespace db {
          void save_undo_add( const object& obj );
          void save_undo_remove( const object& obj );
 
+         vector<index*> all_indexes()const;
+         void save_to( const fc::path& target, const rewound_state* rewind )const;
+
          fc::path                                                  _data_dir;
          vector< vector< unique_ptr<index> > >                     _index;
+         bool                                                      _compress = false;
+         uint32_t                                                  _io_threads = 0;
+         std::unordered_set<object_id_type>*                       _tracked_writes = nullptr;
    };
 
 } } // graphene::db
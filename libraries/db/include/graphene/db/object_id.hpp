@@ -219,4 +219,11 @@ namespace std {
               return std::hash<uint64_t>()(x.number);
           }
      };
+     template <uint8_t SpaceID, uint8_t TypeID, typename T> struct hash<graphene::db::object_id<SpaceID,TypeID,T>>
+     {
+          size_t operator()(const graphene::db::object_id<SpaceID,TypeID,T>& x) const
+          {
+              return std::hash<uint64_t>()(x.instance.value);
+          }
+     };
 }
@@ -23,6 +23,7 @@
  */
 #pragma once
 #include <graphene/db/object.hpp>
+#include <graphene/db/index.hpp>
 #include <deque>
 #include <fc/exception/exception.hpp>
 
@@ -132,6 +133,12 @@ namespace graphene { namespace db {
 
          const undo_state& head()const;
 
+         /**
+          *  Describes the state before the newest count undo states without touching the database.  The result
+          *  points into the undo history and is only valid until the next change.
+          */
+         rewound_state rewind( size_t count )const;
+
          void set_reindex_status(bool is_in_progess){_reindex_in_progress=is_in_progess;}
 
       private:
@@ -27,6 +27,10 @@
 #include <fc/container/flat.hpp>
 #include <fc/uint128.hpp>
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+
 namespace graphene { namespace db {
 
 object_database::object_database()
@@ -68,17 +72,221 @@ index& object_database::get_mutable_index(uint8_t space_id, uint8_t type_id)
    return *idx;
 }
 
+void run_in_parallel( size_t count, uint32_t threads, const std::function<void(size_t)>& task )
+{
+   if( threads == 0 )
+      threads = std::max( 1u, std::thread::hardware_concurrency() );
+   threads = std::min<size_t>( threads, count );
+
+   std::atomic<size_t> next( 0 );
+   std::mutex          error_mutex;
+   std::exception_ptr  error;
+   auto worker = [&]() {
+      for( size_t i = next++; i < count; i = next++ )
+      {
+         try {
+            task( i );
+         } catch( ... ) {
+            std::lock_guard<std::mutex> lock( error_mutex );
+            if( !error )
+               error = std::current_exception();
+         }
+      }
+   };
+
+   vector<std::thread> pool;
+   for( uint32_t t = 1; t < threads; ++t )
+      pool.emplace_back( worker );
+   worker();
+   for( auto& t : pool )
+      t.join();
+
+   if( error )
+      std::rethrow_exception( error );
+}
+
+vector<index*> object_database::all_indexes()const
+{
+   vector<index*> result;
+   for( const auto& space : _index )
+      for( const auto& idx : space )
+         if( idx )
+            result.push_back( idx.get() );
+   return result;
+}
+
+static fc::path index_file( const fc::path& dir, const index& idx )
+{
+   return dir / fc::to_string( idx.object_space_id() ) / fc::to_string( idx.object_type_id() );
+}
+
 void object_database::flush()
 {
 //   ilog("Save object_database in ${d}", ("d", _data_dir));
-   for( uint32_t space = 0; space < _index.size(); ++space )
+   save_to( _data_dir / "object_database", nullptr );
+}
+
+void object_database::save_state( const fc::path& dir, size_t undo_states )const
+{
+   const rewound_state rewind = _undo_db.rewind( undo_states );
+   save_to( dir, &rewind );
+}
+
+static fc::path staging_path( const fc::path& target )
+{
+   return target.parent_path() / ( target.filename().string() + ".tmp" );
+}
+
+/// replaces target with a completely written staging directory
+static void replace_with_staging( const fc::path& staging, const fc::path& target )
+{
+   const fc::path backup = target.parent_path() / ( target.filename().string() + ".old" );
+   fc::remove_all( backup );
+   if( fc::exists( target ) )
+      fc::rename( target, backup );
+   fc::rename( staging, target );
+   fc::remove_all( backup );
+}
+
+std::unique_ptr<state_save_progress> object_database::start_saving_state( const fc::path& dir )const
+{
+   const fc::path staging = staging_path( dir );
+   fc::remove_all( staging );
+   for( const index* idx : all_indexes() )
+      fc::create_directories( staging / fc::to_string( idx->object_space_id() ) );
+   std::unique_ptr<state_save_progress> progress( new state_save_progress );
+   progress->target = dir;
+   return progress;
+}
+
+bool object_database::save_state_slice( state_save_progress& progress, const rewound_state& rewind,
+                                        size_t max_objects )const
+{
+   const fc::path staging = staging_path( progress.target );
+   const auto indexes = all_indexes();
+   size_t budget = max_objects;
+   for( ; progress.index_num < indexes.size(); ++progress.index_num )
    {
-      fc::create_directories( _data_dir / "object_database" / fc::to_string(space) );
-      const auto types = _index[space].size();
-      for( uint32_t type = 0; type  <  types; ++type )
-         if( _index[space][type] )
-            _index[space][type]->save( _data_dir / "object_database" / fc::to_string(space)/fc::to_string(type) );
+      const index& idx = *indexes[progress.index_num];
+      const fc::path file = index_file( staging, idx );
+      if( !progress.out )
+      {
+         progress.out.reset( new std::ofstream( file.generic_string(),
+                                                std::ofstream::binary | std::ofstream::out | std::ofstream::trunc ) );
+         progress.index.reset( new index_save_progress );
+         FC_ASSERT( *progress.out, "Unable to create index file ${path}", ("path", file.generic_string()) );
+      }
+      if( !idx.save_slice( *progress.out, _compress, *progress.index, budget, rewind ) )
+         return false;
+      progress.out->flush();
+      FC_ASSERT( *progress.out, "Unable to write index file ${path}", ("path", file.generic_string()) );
+      progress.out.reset();
+      progress.index.reset();
    }
+   replace_with_staging( staging, progress.target );
+   return true;
+}
+
+void object_database::export_state( std::ostream& out, size_t undo_states )const
+{
+   const rewound_state rewind = _undo_db.rewind( undo_states );
+   const auto indexes = all_indexes();
+   fc::raw::pack( out, uint32_t( indexes.size() ) );
+   for( const index* idx : indexes )
+   {
+      fc::raw::pack( out, idx->object_space_id() );
+      fc::raw::pack( out, idx->object_type_id() );
+      // the section size is patched in once the index has been streamed
+      const auto size_pos = out.tellp();
+      fc::raw::pack( out, uint64_t( 0 ) );
+      const auto start = out.tellp();
+      idx->save( out, _compress, &rewind );
+      const auto end = out.tellp();
+      out.seekp( size_pos );
+      fc::raw::pack( out, uint64_t( end - start ) );
+      out.seekp( end );
+   }
+   FC_ASSERT( out, "Unable to write state" );
+}
+
+bool object_database::export_state_slice( std::ostream& out, state_export_progress& progress, const rewound_state& rewind,
+                                          size_t max_objects )const
+{
+   const auto indexes = all_indexes();
+   if( !progress.started )
+   {
+      fc::raw::pack( out, uint32_t( indexes.size() ) );
+      progress.started = true;
+   }
+   size_t budget = max_objects;
+   for( ; progress.index_num < indexes.size(); ++progress.index_num )
+   {
+      const index& idx = *indexes[progress.index_num];
+      if( !progress.index )
+      {
+         fc::raw::pack( out, idx.object_space_id() );
+         fc::raw::pack( out, idx.object_type_id() );
+         progress.size_pos = out.tellp();
+         fc::raw::pack( out, uint64_t( 0 ) );
+         progress.index.reset( new index_save_progress );
+      }
+      if( !idx.save_slice( out, _compress, *progress.index, budget, rewind ) )
+         return false;
+      const auto end = out.tellp();
+      out.seekp( progress.size_pos );
+      fc::raw::pack( out, uint64_t( end - progress.size_pos ) - sizeof( uint64_t ) );
+      out.seekp( end );
+      progress.index.reset();
+   }
+   FC_ASSERT( out, "Unable to write state" );
+   return true;
+}
+
+void object_database::import_state( fc::datastream<const char*>& ds )
+{
+   uint32_t count = 0;
+   fc::raw::unpack( ds, count );
+
+   vector< std::pair< index*, fc::datastream<const char*> > > sections;
+   for( uint32_t i = 0; i < count; ++i )
+   {
+      uint8_t space_id = 0;
+      uint8_t type_id = 0;
+      uint64_t size = 0;
+      fc::raw::unpack( ds, space_id );
+      fc::raw::unpack( ds, type_id );
+      fc::raw::unpack( ds, size );
+      FC_ASSERT( size <= ds.remaining(), "Truncated state section", ("space",space_id)("type",type_id) );
+
+      index* idx = _index.size() > space_id && _index[space_id].size() > type_id ? _index[space_id][type_id].get() : nullptr;
+      if( idx != nullptr )
+         sections.emplace_back( idx, fc::datastream<const char*>( ds.pos(), size ) );
+      else
+         wlog( "Skipping state of unknown index ${s}.${t}", ("s",space_id)("t",type_id) );
+      ds.skip( size );
+   }
+
+   run_in_parallel( sections.size(), _io_threads, [&]( size_t i ) {
+      sections[i].first->open( sections[i].second );
+   });
+}
+
+void object_database::save_to( const fc::path& target, const rewound_state* rewind )const
+{
+   // Everything is written to a staging directory which only replaces the target once complete, so a crash
+   // part way through leaves the previous state intact.
+   const fc::path staging = staging_path( target );
+
+   fc::remove_all( staging );
+   const auto indexes = all_indexes();
+   for( const index* idx : indexes )
+      fc::create_directories( staging / fc::to_string( idx->object_space_id() ) );
+
+   run_in_parallel( indexes.size(), _io_threads, [&]( size_t i ) {
+      indexes[i]->save( index_file( staging, *indexes[i] ), _compress, rewind );
+   });
+
+   replace_with_staging( staging, target );
 }
 
 void object_database::wipe(const fc::path& data_dir)
@@ -89,17 +297,27 @@ void object_database::wipe(const fc::path& data_dir)
    ilog("Done wiping object databse.");
 }
 
-void object_database::open(const fc::path& data_dir)
+void object_database::open( const fc::path& data_dir, const fc::path& source )
 { try {
-   ilog("Opening object database from ${d} ...", ("d", data_dir));
    _data_dir = data_dir;
-   for( uint32_t space = 0; space < _index.size(); ++space )
-      for( uint32_t type = 0; type  < _index[space].size(); ++type )
-         if( _index[space][type] )
-            _index[space][type]->open( _data_dir / "object_database" / fc::to_string(space)/fc::to_string(type) );
+
+   // finish or discard a flush that was interrupted
+   const fc::path target = _data_dir / "object_database";
+   const fc::path backup = _data_dir / "object_database.old";
+   if( !fc::exists( target ) && fc::exists( backup ) )
+      fc::rename( backup, target );
+   fc::remove_all( _data_dir / "object_database.tmp" );
+   fc::remove_all( backup );
+
+   const fc::path from = source.string().empty() ? target : source;
+   ilog("Opening object database from ${d} ...", ("d", from));
+   const auto indexes = all_indexes();
+   run_in_parallel( indexes.size(), _io_threads, [&]( size_t i ) {
+      indexes[i]->open( index_file( from, *indexes[i] ) );
+   });
    ilog( "Done opening object database." );
 
-} FC_CAPTURE_AND_RETHROW( (data_dir) ) }
+} FC_CAPTURE_AND_RETHROW( (data_dir)(source) ) }
 
 
 void object_database::pop_undo()
@@ -111,18 +329,24 @@ void object_database::pop_undo()
 void object_database::save_undo( const object& obj )
 {
 //	dlog("object_database::save_undo. id: ${id}", ("id", obj.id));
+   if( _tracked_writes )
+      _tracked_writes->insert( obj.id );
    _undo_db.on_modify( obj );
 }
 
 void object_database::save_undo_add( const object& obj )
 {
 //	dlog("object_database::save_undo_add. id: ${id}", ("id", obj.id));
+   if( _tracked_writes )
+      _tracked_writes->insert( obj.id );
    _undo_db.on_create( obj );
 }
 
 void object_database::save_undo_remove(const object& obj)
 {
 //	dlog("object_database::save_undo_remove. id: ${id}", ("id", obj.id));
+   if( _tracked_writes )
+      _tracked_writes->insert( obj.id );
    _undo_db.on_remove( obj );
 }
 
@@ -295,6 +295,26 @@ void undo_database::pop_commit()
    }
    enable();
 }
+rewound_state undo_database::rewind( size_t count )const
+{
+   FC_ASSERT( count <= _stack.size(), "Not enough undo history", ("count",count)("size",_stack.size()) );
+
+   // walk from the newest state to the oldest so that the earliest recorded value of every object wins
+   rewound_state result;
+   for( auto itr = _stack.rbegin(); itr != _stack.rbegin() + count; ++itr )
+   {
+      for( const auto& item : itr->old_values )
+         result.objects[item.first] = item.second.get();
+      for( const auto& item : itr->removed )
+         result.objects[item.first] = item.second.get();
+      for( const auto& id : itr->new_ids )
+         result.objects[id] = nullptr;
+      for( const auto& item : itr->old_index_next_ids )
+         result.next_ids[item.first] = item.second;
+   }
+   return result;
+}
+
 const undo_state& undo_database::head()const
 {
    FC_ASSERT( !_stack.empty() );
@@ -6,5 +6,6 @@ namespace fc
 {
 
   string zlib_compress(const string& in);
+  string zlib_decompress(const string& in);
 
 } // namespace fc
@@ -8,13 +8,24 @@
 namespace fc {
     class path;
 
+    /**
+     *  Block cipher modes of aes_encoder and aes_decoder.  Both run on AES-NI through OpenSSL
+     *  where the CPU has it, but only ctr can encrypt several blocks in parallel, cbc chains
+     *  every block to the previous one.
+     */
+    enum class aes_mode
+    {
+       cbc,
+       ctr
+    };
+
     class aes_encoder
     {
        public:
          aes_encoder();
          ~aes_encoder();
      
-         void init( const fc::sha256& key, const fc::uint128& init_value );
+         void init( const fc::sha256& key, const fc::uint128& init_value, aes_mode mode = aes_mode::cbc );
          uint32_t encode( const char* plaintxt, uint32_t len, char* ciphertxt );
  //        uint32_t final_encode( char* ciphertxt );
 
@@ -28,7 +39,7 @@ namespace fc {
          aes_decoder();
          ~aes_decoder();
      
-         void     init( const fc::sha256& key, const fc::uint128& init_value );
+         void     init( const fc::sha256& key, const fc::uint128& init_value, aes_mode mode = aes_mode::cbc );
          uint32_t decode( const char* ciphertxt, uint32_t len, char* plaintext );
 //         uint32_t final_decode( char* plaintext );
 
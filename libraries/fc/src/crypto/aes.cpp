@@ -36,10 +36,11 @@ aes_encoder::~aes_encoder()
 {
 }
 
-void aes_encoder::init( const fc::sha256& key, const fc::uint128& init_value )
+void aes_encoder::init( const fc::sha256& key, const fc::uint128& init_value, aes_mode mode )
 {
-    my->ctx.obj = EVP_CIPHER_CTX_new();
-    /* Create and initialise the context */
+    /* Create and initialise the context, a context which was initialised before is reused */
+    if(!my->ctx)
+       my->ctx.obj = EVP_CIPHER_CTX_new();
     if(!my->ctx)
     {
         FC_THROW_EXCEPTION( aes_exception, "error allocating evp cipher context", 
@@ -51,9 +52,10 @@ void aes_encoder::init( const fc::sha256& key, const fc::uint128& init_value )
     *    In this example we are using 256 bit AES (i.e. a 256 bit key). The
     *    IV size for *most* modes is the same as the block size. For AES this
     *    is 128 bits */
-    if(1 != EVP_EncryptInit_ex(my->ctx, EVP_aes_256_cbc(), NULL, (unsigned char*)&key, (unsigned char*)&init_value))
+    const EVP_CIPHER* cipher = mode == aes_mode::ctr ? EVP_aes_256_ctr() : EVP_aes_256_cbc();
+    if(1 != EVP_EncryptInit_ex(my->ctx, cipher, NULL, (unsigned char*)&key, (unsigned char*)&init_value))
     {
-        FC_THROW_EXCEPTION( aes_exception, "error during aes 256 cbc encryption init", 
+        FC_THROW_EXCEPTION( aes_exception, "error during aes 256 encryption init", 
                            ("s", ERR_error_string( ERR_get_error(), nullptr) ) );
     }
     EVP_CIPHER_CTX_set_padding( my->ctx, 0 );
@@ -67,7 +69,7 @@ uint32_t aes_encoder::encode( const char* plaintxt, uint32_t plaintext_len, char
     *       */
     if(1 != EVP_EncryptUpdate(my->ctx, (unsigned char*)ciphertxt, &ciphertext_len, (const unsigned char*)plaintxt, plaintext_len))
     {
-        FC_THROW_EXCEPTION( aes_exception, "error during aes 256 cbc encryption update", 
+        FC_THROW_EXCEPTION( aes_exception, "error during aes 256 encryption update", 
                            ("s", ERR_error_string( ERR_get_error(), nullptr) ) );
     }
     FC_ASSERT( ciphertext_len == plaintext_len, "", ("ciphertext_len",ciphertext_len)("plaintext_len",plaintext_len) );
@@ -100,10 +102,11 @@ aes_decoder::aes_decoder()
   static int init = init_openssl();
   }
 
-void aes_decoder::init( const fc::sha256& key, const fc::uint128& init_value )
+void aes_decoder::init( const fc::sha256& key, const fc::uint128& init_value, aes_mode mode )
 {
-    my->ctx.obj = EVP_CIPHER_CTX_new();
-    /* Create and initialise the context */
+    /* Create and initialise the context, a context which was initialised before is reused */
+    if(!my->ctx)
+       my->ctx.obj = EVP_CIPHER_CTX_new();
     if(!my->ctx)
     {
         FC_THROW_EXCEPTION( aes_exception, "error allocating evp cipher context", 
@@ -115,9 +118,10 @@ void aes_decoder::init( const fc::sha256& key, const fc::uint128& init_value )
     *    In this example we are using 256 bit AES (i.e. a 256 bit key). The
     *    IV size for *most* modes is the same as the block size. For AES this
     *    is 128 bits */
-    if(1 != EVP_DecryptInit_ex(my->ctx, EVP_aes_256_cbc(), NULL, (unsigned char*)&key, (unsigned char*)&init_value))
+    const EVP_CIPHER* cipher = mode == aes_mode::ctr ? EVP_aes_256_ctr() : EVP_aes_256_cbc();
+    if(1 != EVP_DecryptInit_ex(my->ctx, cipher, NULL, (unsigned char*)&key, (unsigned char*)&init_value))
     {
-        FC_THROW_EXCEPTION( aes_exception, "error during aes 256 cbc encryption init", 
+        FC_THROW_EXCEPTION( aes_exception, "error during aes 256 encryption init", 
                            ("s", ERR_error_string( ERR_get_error(), nullptr) ) );
     }
     EVP_CIPHER_CTX_set_padding( my->ctx, 0 );
@@ -134,7 +138,7 @@ uint32_t aes_decoder::decode( const char* ciphertxt, uint32_t ciphertxt_len, cha
     *       */
 	if (1 != EVP_DecryptUpdate(my->ctx, (unsigned char*)plaintext, &plaintext_len, (const unsigned char*)ciphertxt, ciphertxt_len))
     {
-        FC_THROW_EXCEPTION( aes_exception, "error during aes 256 cbc decryption update", 
+        FC_THROW_EXCEPTION( aes_exception, "error during aes 256 decryption update", 
                            ("s", ERR_error_string( ERR_get_error(), nullptr) ) );
     }
     FC_ASSERT( ciphertxt_len == plaintext_len, "", ("ciphertxt_len",ciphertxt_len)("plaintext_len",plaintext_len) );
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/net/compact_block.hpp>
+
+#include <graphene/chain/protocol/fee_schedule.hpp>
+
+#include <fc/smart_ref_impl.hpp>
+
+#include <unordered_set>
+
+namespace graphene { namespace net {
+
+  compact_block_reconstruction::compact_block_reconstruction( const compact_block_message& compact,
+                                                              const blockchain_tied_message_cache& cache ) :
+    _compact( compact )
+  {
+    _transactions.resize( _compact.transactions.size() );
+    for( const auto& prefilled : _compact.prefilled_transactions )
+    {
+      FC_ASSERT( prefilled.first < _transactions.size(), "Compact block ${block_id} prefills transaction ${i} of ${n}",
+                 ("block_id", _compact.block_id)("i", prefilled.first)("n", _transactions.size()) );
+      _transactions[prefilled.first] = prefilled.second;
+    }
+
+    std::unordered_set<uint64_t> wanted_short_ids;
+    for( uint32_t i = 0; i < _transactions.size(); ++i )
+      if( !_transactions[i] )
+        wanted_short_ids.insert( _compact.transactions[i].short_id );
+    if( wanted_short_ids.empty() )
+      return;
+
+    std::unordered_map<uint64_t, signed_transaction> cached_transactions =
+      cache.find_transactions_by_short_id( _compact.block_id, wanted_short_ids );
+    for( uint32_t i = 0; i < _transactions.size(); ++i )
+    {
+      if( _transactions[i] )
+        continue;
+      auto iter = cached_transactions.find( _compact.transactions[i].short_id );
+      if( iter == cached_transactions.end() )
+        continue;
+      graphene::chain::processed_transaction transaction( iter->second );
+      transaction.operation_results = _compact.transactions[i].operation_results;
+      _transactions[i] = std::move( transaction );
+    }
+  }
+
+  std::vector<uint32_t> compact_block_reconstruction::missing_indexes() const
+  {
+    std::vector<uint32_t> result;
+    for( uint32_t i = 0; i < _transactions.size(); ++i )
+      if( !_transactions[i] )
+        result.push_back( i );
+    return result;
+  }
+
+  bool compact_block_reconstruction::add_transactions( const std::vector<graphene::chain::signed_transaction>& transactions )
+  {
+    const std::vector<uint32_t> missing = missing_indexes();
+    if( missing.size() != transactions.size() )
+      return false;
+    for( uint32_t k = 0; k < missing.size(); ++k )
+    {
+      graphene::chain::processed_transaction transaction( transactions[k] );
+      transaction.operation_results = _compact.transactions[missing[k]].operation_results;
+      _transactions[missing[k]] = std::move( transaction );
+    }
+    return true;
+  }
+
+  fc::optional<block_message> compact_block_reconstruction::finish()
+  {
+    FC_ASSERT( missing_indexes().empty() );
+    block_message full_block_message;
+    static_cast<graphene::chain::signed_block_header&>( full_block_message.block ) = _compact.header;
+    full_block_message.block.transactions.reserve( _transactions.size() );
+    for( const auto& transaction : _transactions )
+      full_block_message.block.transactions.push_back( *transaction );
+    full_block_message.block_id = _compact.block_id;
+
+    if( !_requested_all && full_block_message.block.calculate_merkle_root() != _compact.header.transaction_merkle_root )
+    {
+      for( uint32_t i = 0; i < _transactions.size(); ++i )
+        if( _compact.transactions[i].short_id != 0 )
+          _transactions[i].reset();
+      _requested_all = true;
+      return fc::optional<block_message>();
+    }
+    return full_block_message;
+  }
+
+} } // graphene::net
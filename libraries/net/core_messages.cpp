@@ -22,6 +22,7 @@
  * THE SOFTWARE.
  */
 #include <graphene/net/core_messages.hpp>
+#include <graphene/net/message.hpp>
 
 
 namespace graphene { namespace net {
@@ -45,6 +46,32 @@ namespace graphene { namespace net {
   const core_message_type_enum check_firewall_reply_message::type            = core_message_type_enum::check_firewall_reply_message_type;
   const core_message_type_enum get_current_connections_request_message::type = core_message_type_enum::get_current_connections_request_message_type;
   const core_message_type_enum get_current_connections_reply_message::type   = core_message_type_enum::get_current_connections_reply_message_type;
+  const core_message_type_enum compact_block_message::type                   = core_message_type_enum::compact_block_message_type;
+  const core_message_type_enum fetch_compact_block_transactions_message::type = core_message_type_enum::fetch_compact_block_transactions_message_type;
+  const core_message_type_enum compact_block_transactions_message::type      = core_message_type_enum::compact_block_transactions_message_type;
+  const core_message_type_enum transport_cipher_message::type                = core_message_type_enum::transport_cipher_message_type;
+
+  uint64_t compact_block_short_id( const block_id_type& block_id, const transaction_id_type& trx_id )
+  {
+    fc::ripemd160::encoder enc;
+    fc::raw::pack( enc, block_id );
+    fc::raw::pack( enc, trx_id );
+    fc::ripemd160 hash = enc.result();
+    uint64_t result = ( uint64_t( hash._hash[1] ) << 32 ) | hash._hash[0];
+    // zero marks prefilled transactions
+    return result != 0 ? result : 1;
+  }
+
+  message packed_block_message( const block_id_type& block_id, std::vector<char> packed_block )
+  {
+    message result;
+    result.msg_type = block_message_type;
+    result.data = std::move( packed_block );
+    const std::vector<char> packed_id = fc::raw::pack( block_id );
+    result.data.insert( result.data.end(), packed_id.begin(), packed_id.end() );
+    result.size = (uint32_t)result.data.size();
+    return result;
+  }
 
 } } // graphene::net
 
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/net/core_messages.hpp>
+#include <graphene/net/message_cache.hpp>
+
+#include <fc/optional.hpp>
+
+#include <vector>
+
+namespace graphene { namespace net {
+
+  /**
+   *  A compact block being turned back into the full block, from its prefilled transactions, the ones found
+   *  in our message cache by short id and the ones fetched from the peer that sent it.
+   */
+  class compact_block_reconstruction
+  {
+  public:
+    compact_block_reconstruction() {}
+    /** @throws fc::exception if the compact block prefills a transaction it doesn't have */
+    compact_block_reconstruction( const compact_block_message& compact, const blockchain_tied_message_cache& cache );
+
+    const compact_block_message& compact() const { return _compact; }
+    /// true once every transaction not prefilled has been asked from the peer, after a merkle root mismatch
+    bool requested_all() const { return _requested_all; }
+
+    /** the indexes of the transactions we don't have yet, to fetch from the peer */
+    std::vector<uint32_t> missing_indexes() const;
+    /** fills in the transactions at missing_indexes(), in order; false if there isn't exactly one for each */
+    bool add_transactions( const std::vector<graphene::chain::signed_transaction>& transactions );
+
+    /**
+     *  Builds the block once no transaction is missing.  If it doesn't match the header's merkle root, two
+     *  transactions shared a short id and the cache gave us the wrong one, so every transaction that wasn't
+     *  prefilled is dropped to be fetched from the peer, and nothing is returned.  Once they all came from the
+     *  peer the block is returned whatever its merkle root, to be rejected like any other invalid block.
+     */
+    fc::optional<block_message> finish();
+
+  private:
+    compact_block_message                                                _compact;
+    std::vector< fc::optional<graphene::chain::processed_transaction> > _transactions;
+    bool                                                                 _requested_all = false;
+  };
+
+} } // graphene::net
@@ -23,7 +23,18 @@
  */
 #pragma once
 
-#define GRAPHENE_NET_PROTOCOL_VERSION                        106
+#define GRAPHENE_NET_PROTOCOL_VERSION                        108
+
+/**
+ * The first protocol version able to relay blocks in compact form
+ */
+#define GRAPHENE_NET_COMPACT_BLOCKS_PROTOCOL_VERSION         107
+
+/**
+ * The first protocol version able to switch the transport cipher to AES-256-CTR
+ */
+#define GRAPHENE_NET_AES_CTR_PROTOCOL_VERSION                108
+#define GRAPHENE_NET_AES_CTR_CIPHER                          "aes-256-ctr"
 
 /**
  * Define this to enable debugging code in the p2p network interface.
@@ -60,6 +71,16 @@
 
 #define GRAPHENE_NET_MAXIMUM_QUEUED_MESSAGES_IN_BYTES        (1024 * 1024)
 
+/**
+ * Each peer's outgoing messages are queued by class.  Control messages are sent as soon as
+ * the connection is free; blocks, block ids and transactions then share the connection in
+ * proportion to these weights, each getting its weight times the quantum in bytes per round.
+ */
+#define GRAPHENE_NET_BLOCK_SEND_WEIGHT                       8
+#define GRAPHENE_NET_ITEM_IDS_SEND_WEIGHT                    4
+#define GRAPHENE_NET_TRANSACTION_SEND_WEIGHT                 1
+#define GRAPHENE_NET_SEND_QUANTUM_IN_BYTES                   (16 * 1024)
+
 /**
  * When we receive a message from the network, we advertise it to
  * our peers and save a copy in a cache were we will find it if
@@ -82,8 +103,41 @@
 
 #define GRAPHENE_NET_MAX_INVENTORY_SIZE_IN_MINUTES           2
 
+/**
+ * The peer database keeps at most this many endpoints.  Beyond it, the record seen longest ago
+ * is evicted, where each failed connection attempt in excess of the successful ones counts as
+ * having last seen the peer this much earlier.
+ */
+#define GRAPHENE_NET_MAXIMUM_PEER_DATABASE_SIZE              10000
+#define GRAPHENE_NET_PEER_DATABASE_FAILURE_PENALTY_SEC       (60 * 60)
+
+/**
+ * Changes to the peer database are appended to its file, which is rewritten once the log holds
+ * this many more records than there are peers in the database.
+ */
+#define GRAPHENE_NET_PEER_DATABASE_COMPACTION_SLACK          1000
+
 #define GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING      200
 
+/**
+ * Sync windows adapt to each peer between these bounds and the maximum above: a peer may have
+ * as many blocks outstanding as it delivers in GRAPHENE_NET_SYNC_TARGET_LATENCY_MS plus its
+ * base round trip time.  New peers start at the initial window and grow by one block for
+ * every block they deliver.
+ */
+#define GRAPHENE_NET_MIN_BLOCKS_PER_PEER_DURING_SYNCING      4
+#define GRAPHENE_NET_INITIAL_BLOCKS_PER_PEER_DURING_SYNCING  20
+#define GRAPHENE_NET_SYNC_TARGET_LATENCY_MS                  2000
+
+/**
+ * A sync block outstanding for longer than the peer's smoothed round trip time plus four
+ * deviations, and at least this long, is asked from a faster peer.  A peer is disconnected
+ * once a block has been outstanding for GRAPHENE_NET_SYNC_STALLS_BEFORE_DISCONNECT such
+ * timeouts.
+ */
+#define GRAPHENE_NET_MIN_SYNC_STALL_TIMEOUT_MS               1000
+#define GRAPHENE_NET_SYNC_STALLS_BEFORE_DISCONNECT           4
+
 /**
  * During normal operation, how many items will be fetched from each
  * peer at a time.  This will only come into play when the network
@@ -106,3 +160,20 @@
 #define GRAPHENE_NET_MIN_BLOCK_IDS_TO_PREFETCH               10000
 
 #define GRAPHENE_NET_MAX_TRX_PER_SECOND                      1000
+
+/**
+ * When a peer asks for blocks that aren't in the message cache, up to this many bytes of them are
+ * read from the block database in one go; the rest are read one at a time as they are sent.
+ */
+#define GRAPHENE_NET_MAX_BLOCK_BYTES_READ_PER_REQUEST        (8 * 1024 * 1024)
+
+/**
+ * Each peer may send us GRAPHENE_NET_PEER_TRX_PER_SECOND transactions, in bursts of up to
+ * GRAPHENE_NET_PEER_TRX_BURST.  A transaction that is expired, oversized or fails validation costs
+ * the peer GRAPHENE_NET_INVALID_TRX_PENALTY more.  Duplicates, unknown TaPoS blocks and expirations
+ * too far ahead aren't penalized, since honest peers send them whenever a transaction makes it into
+ * a block while we are fetching it or our head is behind theirs.
+ */
+#define GRAPHENE_NET_PEER_TRX_PER_SECOND                     GRAPHENE_NET_MAX_TRX_PER_SECOND
+#define GRAPHENE_NET_PEER_TRX_BURST                          (2 * GRAPHENE_NET_MAX_TRX_PER_SECOND)
+#define GRAPHENE_NET_INVALID_TRX_PENALTY                     100
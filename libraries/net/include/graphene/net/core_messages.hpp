@@ -86,11 +86,28 @@ namespace graphene { namespace net {
     check_firewall_reply_message_type            = 5015,
     get_current_connections_request_message_type = 5016,
     get_current_connections_reply_message_type   = 5017,
+    compact_block_message_type                   = 5018,
+    fetch_compact_block_transactions_message_type = 5019,
+    compact_block_transactions_message_type      = 5020,
+    transport_cipher_message_type                = 5021,
     core_message_type_last                       = 5099
   };
 
   const uint32_t core_protocol_version = GRAPHENE_NET_PROTOCOL_VERSION;
 
+  /**
+   * The 64-bit id a transaction is referred to by in a compact block.  It is salted with the block id, so that
+   * a collision between two transactions cannot be precomputed to break relay of every block containing them.
+   */
+  uint64_t compact_block_short_id( const block_id_type& block_id, const transaction_id_type& trx_id );
+
+  struct message;
+  /**
+   * A block_message for a block that is still packed, as it is in the block database.  The message carries the
+   * packed block followed by its id, so the block never needs to be unpacked and packed again.
+   */
+  message packed_block_message( const block_id_type& block_id, std::vector<char> packed_block );
+
    struct trx_message
    {
       static const core_message_type_enum type;
@@ -108,13 +125,64 @@ namespace graphene { namespace net {
 
       block_message(){}
       block_message(const signed_block& blk )
-      :block(blk),block_id(blk.id()){}
+      :block(blk),block_id(block.cached_id()){}
 
       signed_block    block;
       block_id_type   block_id;
 
    };
 
+   struct compact_block_transaction
+   {
+      uint64_t                                      short_id = 0; ///< zero if the transaction is prefilled
+      std::vector<graphene::chain::operation_result> operation_results;
+   };
+
+   /**
+    * Sent instead of a block_message to peers that announced compact block support.  It carries the header and
+    * short ids of the transactions, which the receiver looks up in its message cache.  Transactions the sender
+    * does not expect the peer to have seen are included in full.
+    */
+   struct compact_block_message
+   {
+      static const core_message_type_enum type;
+
+      item_hash_t                                   block_message_hash; ///< the id of the block_message this replaces
+      block_id_type                                 block_id;
+      graphene::chain::signed_block_header          header;
+      std::vector<compact_block_transaction>        transactions;
+      std::vector<std::pair<uint32_t, graphene::chain::processed_transaction> > prefilled_transactions;
+   };
+
+   /// requests the transactions of a compact block the receiver could not find in its cache
+   struct fetch_compact_block_transactions_message
+   {
+      static const core_message_type_enum type;
+
+      block_id_type         block_id;
+      std::vector<uint32_t> indexes;
+   };
+
+   struct compact_block_transactions_message
+   {
+      static const core_message_type_enum type;
+
+      block_id_type                   block_id;
+      std::vector<signed_transaction> transactions; ///< in the order they were requested
+   };
+
+   /**
+    * Sent to peers that announced AES-256-CTR support in their hello.  Every byte the sender writes after
+    * this message is encrypted with the named cipher; message_oriented_connection switches both ends and
+    * never passes the message on to its delegate.
+    */
+   struct transport_cipher_message
+   {
+      static const core_message_type_enum type;
+
+      std::string cipher;
+   };
+
   struct item_ids_inventory_message
   {
     static const core_message_type_enum type;
@@ -424,10 +492,19 @@ FC_REFLECT_ENUM( graphene::net::core_message_type_enum,
                  (check_firewall_reply_message_type)
                  (get_current_connections_request_message_type)
                  (get_current_connections_reply_message_type)
+                 (compact_block_message_type)
+                 (fetch_compact_block_transactions_message_type)
+                 (compact_block_transactions_message_type)
+                 (transport_cipher_message_type)
                  (core_message_type_last) )
 
 FC_REFLECT( graphene::net::trx_message, (trx) )
 FC_REFLECT( graphene::net::block_message, (block)(block_id) )
+FC_REFLECT( graphene::net::compact_block_transaction, (short_id)(operation_results) )
+FC_REFLECT( graphene::net::compact_block_message, (block_message_hash)(block_id)(header)(transactions)(prefilled_transactions) )
+FC_REFLECT( graphene::net::fetch_compact_block_transactions_message, (block_id)(indexes) )
+FC_REFLECT( graphene::net::compact_block_transactions_message, (block_id)(transactions) )
+FC_REFLECT( graphene::net::transport_cipher_message, (cipher) )
 
 FC_REFLECT( graphene::net::item_id, (item_type)
                                (item_hash) )
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/net/config.hpp>
+#include <graphene/net/core_messages.hpp>
+#include <graphene/net/message.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/tag.hpp>
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace graphene { namespace net {
+
+  // during network development, we need to track message propagation across the network
+  // using a structure like this:
+  struct message_propagation_data
+  {
+    fc::time_point received_time;
+    fc::time_point validated_time;
+    node_id_t originating_peer;
+  };
+
+  /** a packed message that is never modified once built, so any number of send queues can hold it */
+  typedef std::shared_ptr<const message> shared_message;
+
+  /** counters of the message cache, as reported by node::get_message_cache_statistics() */
+  struct message_cache_statistics
+  {
+    uint32_t entries = 0;
+    uint64_t bytes = 0;              ///< packed size of the cached messages, each counted once
+    uint64_t messages_cached = 0;
+    uint64_t messages_expired = 0;
+    uint64_t duplicates_ignored = 0; ///< messages that were already in the cache when cached again
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t bytes_served = 0;       ///< packed size of the messages handed out on hits
+  };
+
+  /**
+   *  The blocks and transactions we've recently received and might be asked for by other peers,
+   *  kept for GRAPHENE_NET_MESSAGE_CACHE_DURATION_IN_BLOCKS blocks.
+   *
+   *  Each message is stored once, and lookups hand out a reference to it rather than a copy, so
+   *  relaying an item to every peer costs the same memory as relaying it to one.
+   */
+  class blockchain_tied_message_cache
+  {
+  private:
+    static const uint32_t cache_duration_in_blocks = GRAPHENE_NET_MESSAGE_CACHE_DURATION_IN_BLOCKS;
+
+    struct message_hash_index{};
+    struct message_contents_hash_index{};
+    struct block_clock_index{};
+    struct message_info
+    {
+      message_hash_type message_hash;
+      shared_message    message_body;
+      uint32_t          block_clock_when_received;
+
+      // for network performance stats
+      message_propagation_data propagation_data;
+      fc::uint160_t     message_contents_hash; // hash of whatever the message contains (if it's a transaction, this is the transaction id, if it's a block, it's the block_id)
+
+      message_info( const message_hash_type& message_hash,
+                    shared_message           message_body,
+                    uint32_t                 block_clock_when_received,
+                    const message_propagation_data& propagation_data,
+                    fc::uint160_t            message_contents_hash ) :
+        message_hash( message_hash ),
+        message_body( std::move(message_body) ),
+        block_clock_when_received( block_clock_when_received ),
+        propagation_data( propagation_data ),
+        message_contents_hash( message_contents_hash )
+      {}
+    };
+    typedef boost::multi_index_container
+      < message_info,
+          boost::multi_index::indexed_by<
+            boost::multi_index::hashed_unique< boost::multi_index::tag<message_hash_index>,
+                                               boost::multi_index::member<message_info, message_hash_type, &message_info::message_hash>,
+                                               std::hash<message_hash_type> >,
+            boost::multi_index::hashed_non_unique< boost::multi_index::tag<message_contents_hash_index>,
+                                                   boost::multi_index::member<message_info, fc::uint160_t, &message_info::message_contents_hash>,
+                                                   std::hash<fc::uint160_t> >,
+            boost::multi_index::ordered_non_unique< boost::multi_index::tag<block_clock_index>,
+                                                    boost::multi_index::member<message_info, uint32_t, &message_info::block_clock_when_received> > >
+      > message_cache_container;
+
+    message_cache_container _message_cache;
+
+    /// the id of every cached transaction, by the hash of its message
+    std::unordered_map<message_hash_type, transaction_id_type, std::hash<message_hash_type> > _transaction_ids;
+    /// the cached transactions by their short id within _short_id_block, built by the first lookup for that block
+    mutable block_id_type _short_id_block;
+    mutable std::unordered_map<uint64_t, message_hash_type> _short_id_index;
+
+    uint32_t block_clock;
+
+    mutable message_cache_statistics _statistics;
+
+  public:
+    blockchain_tied_message_cache() :
+      block_clock( 0 )
+    {}
+    void block_accepted();
+    /** caches @p message_to_cache under its already computed hash, and returns the cached copy */
+    shared_message cache_message( message message_to_cache, const message_hash_type& hash_of_message_to_cache,
+                                  const message_propagation_data& propagation_data, const fc::uint160_t& message_content_hash );
+    /** @throws fc::key_not_found_exception if the message is not in the cache */
+    shared_message get_message( const message_hash_type& hash_of_message_to_lookup ) const;
+    message_propagation_data get_message_propagation_data( const fc::uint160_t& hash_of_message_contents_to_lookup ) const;
+    /**
+     *  the cached transactions whose compact block short id within @p block_id is one of @p short_ids.  The short
+     *  ids within a block are computed once, by the first lookup for it, and kept up to date until the next block
+     */
+    std::unordered_map<uint64_t, signed_transaction> find_transactions_by_short_id( const block_id_type& block_id,
+                                                                                    const std::unordered_set<uint64_t>& short_ids ) const;
+    size_t size() const { return _message_cache.size(); }
+    const message_cache_statistics& get_statistics() const { return _statistics; }
+  };
+
+} } // graphene::net
+
+FC_REFLECT(graphene::net::message_propagation_data, (received_time)(validated_time)(originating_peer));
+FC_REFLECT( graphene::net::message_cache_statistics,
+            (entries)(bytes)(messages_cached)(messages_expired)(duplicates_ignored)(hits)(misses)(bytes_served) )
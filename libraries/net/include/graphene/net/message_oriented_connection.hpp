@@ -23,8 +23,11 @@
  */
 #pragma once
 #include <fc/network/tcp_socket.hpp>
+#include <fc/optional.hpp>
 #include <graphene/net/message.hpp>
 
+#include <functional>
+
 namespace graphene { namespace net {
 
   namespace detail { class message_oriented_connection_impl; }
@@ -39,6 +42,18 @@ namespace graphene { namespace net {
     virtual void on_connection_closed(message_oriented_connection* originating_connection) = 0;
   };
 
+  /** the delays of a simulated network link, see message_oriented_connection::set_link_model() */
+  struct link_model
+  {
+    fc::microseconds latency;               ///< from the end of a message's transmission to its delivery
+    fc::microseconds jitter;                ///< up to this much is added to the latency of each message
+    uint64_t         bytes_per_second = 0;  ///< transmission rate, 0 for no limit
+    uint64_t         seed = 0;              ///< seeds the jitter of the link
+  };
+
+  /** gives the link a connection between two endpoints crosses, or none to leave the connection alone */
+  typedef std::function<fc::optional<link_model>( const fc::ip::endpoint& local, const fc::ip::endpoint& remote )> link_model_function;
+
   /** uses a secure socket to create a connection that reads and writes a stream of `fc::net::message` objects */
   class message_oriented_connection
   {
@@ -61,6 +76,14 @@ namespace graphene { namespace net {
        fc::time_point get_last_message_received_time() const;
        fc::time_point get_connection_time() const;
        fc::sha512     get_shared_secret() const;
+
+       /**
+        * Makes the connections established from now on deliver the messages they receive as if they had crossed
+        * the link @p model gives for their endpoints, so that nodes running in one process over loopback can be
+        * measured over slower links.  Each end delays the messages it receives, a busy link stops reading so that
+        * the sender backs up.  Benchmarks only, @p model is called from every node's thread.
+        */
+       static void set_link_model( link_model_function model );
      private:
        std::unique_ptr<detail::message_oriented_connection_impl> my;
   };
@@ -25,7 +25,11 @@
 
 #include <graphene/net/core_messages.hpp>
 #include <graphene/net/message.hpp>
+#include <graphene/net/message_cache.hpp>
 #include <graphene/net/peer_database.hpp>
+#include <graphene/net/send_queue.hpp>
+#include <graphene/net/sync_window.hpp>
+#include <graphene/net/transaction_admission.hpp>
 
 #include <graphene/chain/protocol/types.hpp>
 
@@ -45,15 +49,6 @@ namespace graphene { namespace net {
     };
   }
 
-  // during network development, we need to track message propagation across the network
-  // using a structure like this:
-  struct message_propagation_data
-  {
-    fc::time_point received_time;
-    fc::time_point validated_time;
-    node_id_t originating_peer;
-  };
-
    /**
     *  @class node_delegate
     *  @brief used by node reports status to client or fetch data from client
@@ -88,6 +83,14 @@ namespace graphene { namespace net {
           */
          virtual void handle_transaction( const graphene::net::trx_message& trx_msg ) = 0;
 
+         /**
+          *  @brief Called before handle_transaction() with checks that are cheap compared to validating
+          *         the transaction: duplicates, expiration, size and the TaPoS reference block.
+          *
+          *  A transaction that fails them is dropped without being passed to handle_transaction().
+          */
+         virtual transaction_precheck_result precheck_transaction( const graphene::net::trx_message& trx_msg ) = 0;
+
          /**
           *  @brief Called when a new message comes in from the network other than a
           *         block or a transaction.  Currently there are no other possible 
@@ -114,6 +117,13 @@ namespace graphene { namespace net {
           */
          virtual message get_item( const item_id& id ) = 0;
 
+         /**
+          *  Given the ids of consecutive blocks of our chain, fetch them in one go.  Returns a block_message
+          *  for each id in order, stopping at the first block that can't be read this way or before the
+          *  messages add up to more than @p max_total_size bytes (the first block is returned regardless).
+          */
+         virtual std::vector<message> get_blocks( const std::vector<item_hash_t>& block_ids, uint64_t max_total_size ) = 0;
+
          virtual chain_id_type get_chain_id()const = 0;
 
          /**
@@ -252,6 +262,28 @@ namespace graphene { namespace net {
         /** return the number of peers we're actively connected to */
         virtual uint32_t get_connection_count() const;
 
+        /**
+         *  @return the block sync window, delivery rate and round trip time measured for each connected peer
+         */
+        std::vector<peer_sync_statistics> get_sync_statistics() const;
+
+        /**
+         *  @return the size and hit counters of the cache of recent blocks and transactions we relay to peers
+         */
+        message_cache_statistics get_message_cache_statistics() const;
+
+        /**
+         *  @return the bytes and messages sent to and received from each connected peer, by message type and
+         *          by send queue
+         */
+        std::vector<peer_traffic_statistics> get_peer_traffic_statistics() const;
+
+        /**
+         *  @return how many transactions were received from the network and why those that weren't relayed were
+         *          dropped, in total and for each connected peer
+         */
+        transaction_admission_statistics get_transaction_admission_statistics() const;
+
         /**
          *  Add message to outgoing inventory list, notify peers that
          *  I have a message ready.
@@ -324,5 +356,4 @@ namespace graphene { namespace net {
 
 } } // graphene::net
 
-FC_REFLECT(graphene::net::message_propagation_data, (received_time)(validated_time)(originating_peer));
 FC_REFLECT( graphene::net::peer_status, (version)(host)(info) );
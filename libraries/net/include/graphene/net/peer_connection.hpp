@@ -24,9 +24,13 @@
 #pragma once
 
 #include <graphene/net/node.hpp>
+#include <graphene/net/compact_block.hpp>
 #include <graphene/net/peer_database.hpp>
 #include <graphene/net/message_oriented_connection.hpp>
 #include <graphene/net/stcp_socket.hpp>
+#include <graphene/net/send_queue.hpp>
+#include <graphene/net/sync_window.hpp>
+#include <graphene/net/transaction_admission.hpp>
 #include <graphene/net/config.hpp>
 
 #include <boost/tuple/tuple.hpp>
@@ -40,6 +44,7 @@
 #include <boost/multi_index/sequenced_index.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 
+#include <map>
 #include <queue>
 #include <boost/container/deque.hpp>
 #include <fc/thread/future.hpp>
@@ -68,7 +73,7 @@ namespace graphene { namespace net
       virtual void on_message(peer_connection* originating_peer,
                               const message& received_message) = 0;
       virtual void on_connection_closed(peer_connection* originating_peer) = 0;
-      virtual message get_message_for_item(const item_id& item) = 0;
+      virtual shared_message get_message_for_item(const item_id& item) = 0;
     };
 
     class peer_connection;
@@ -123,7 +128,7 @@ namespace graphene { namespace net
           enqueue_time(enqueue_time)
         {}
 
-        virtual message get_message(peer_connection_delegate* node) = 0;
+        virtual shared_message get_message(peer_connection_delegate* node) = 0;
         /** returns roughly the number of bytes of memory the message is consuming while
          * it is sitting on the queue
          */
@@ -136,16 +141,31 @@ namespace graphene { namespace net
        */
       struct real_queued_message : queued_message
       {
-        message        message_to_send;
+        std::shared_ptr<message> message_to_send;
         size_t         message_send_time_field_offset;
 
         real_queued_message(message message_to_send,
                             size_t message_send_time_field_offset = (size_t)-1) :
-          message_to_send(std::move(message_to_send)),
+          message_to_send(std::make_shared<message>(std::move(message_to_send))),
           message_send_time_field_offset(message_send_time_field_offset)
         {}
 
-        message get_message(peer_connection_delegate* node) override;
+        shared_message get_message(peer_connection_delegate* node) override;
+        size_t get_size_in_queue() override;
+      };
+
+      /* a 'shared_queued_message' refers to a message that other queues or the node's
+       * message cache may also hold, like a block being relayed to all our peers
+       */
+      struct shared_queued_message : queued_message
+      {
+        shared_message message_to_send;
+
+        shared_queued_message(shared_message message_to_send) :
+          message_to_send(std::move(message_to_send))
+        {}
+
+        shared_message get_message(peer_connection_delegate* node) override;
         size_t get_size_in_queue() override;
       };
 
@@ -161,14 +181,22 @@ namespace graphene { namespace net
           item_to_send(std::move(item_to_send))
         {}
 
-        message get_message(peer_connection_delegate* node) override;
+        shared_message get_message(peer_connection_delegate* node) override;
         size_t get_size_in_queue() override;
       };
 
 
+      typedef std::queue<std::unique_ptr<queued_message>, std::list<std::unique_ptr<queued_message> > > queued_message_queue;
+
       size_t _total_queued_messages_size;
-      std::queue<std::unique_ptr<queued_message>, std::list<std::unique_ptr<queued_message> > > _queued_messages;
+      size_t _total_queued_messages_count;
+      std::array<queued_message_queue, message_priority_count> _queued_messages; /// indexed by message_priority
+      std::array<size_t, message_priority_count> _queued_messages_size;
+      send_scheduler _send_scheduler;
       fc::future<void> _send_queued_messages_done;
+
+      std::map<uint32_t, message_type_traffic> _traffic_by_message_type;
+      std::array<send_queue_statistics, message_priority_count> _send_queue_statistics;
     public:
       fc::time_point connection_initiation_time;
       fc::time_point connection_closed_time;
@@ -253,11 +281,22 @@ namespace graphene { namespace net
       timestamped_items_set_type inventory_advertised_to_peer;
 
       item_to_time_map_type items_requested_from_peer;  /// items we've requested from this peer during normal operation.  fetch from another peer if this peer disconnects
+
+      sync_window sync_flow; /// how many sync blocks may be outstanding at this peer, adapted to its measured delivery
+      /// sync blocks this peer stalled on, with when they were requested from it; a late delivery is dropped quietly
+      std::map<item_hash_t, fc::time_point> sync_items_rerequested_elsewhere;
+
+      bool supports_compact_blocks = false; /// the peer announced in its hello that it accepts compact blocks
+      bool supports_aes_ctr = false; /// the peer announced in its hello that it can switch the transport to AES-256-CTR
+      /// compact blocks this peer sent us, waiting for the transactions we could not find in our cache
+      std::map<block_id_type, compact_block_reconstruction> compact_blocks_being_reconstructed;
       /// @}
 
       // if they're flooding us with transactions, we set this to avoid fetching for a few seconds to let the
       // blockchain catch up
       fc::time_point transaction_fetching_inhibited_until;
+      token_bucket transaction_tokens; /// paid for each transaction the peer sends us, and charged a penalty for invalid ones
+      transaction_admission_counters transaction_admission;
 
       uint32_t last_known_fork_block_number;
 
@@ -283,8 +322,10 @@ namespace graphene { namespace net
       void on_message(message_oriented_connection* originating_connection, const message& received_message) override;
       void on_connection_closed(message_oriented_connection* originating_connection) override;
 
-      void send_queueable_message(std::unique_ptr<queued_message>&& message_to_send);
+      void send_queueable_message(std::unique_ptr<queued_message>&& message_to_send, message_priority priority);
       void send_message(const message& message_to_send, size_t message_send_time_field_offset = (size_t)-1);
+      /** queues a message without copying it, for messages that are sent to several peers */
+      void send_shared_message(shared_message message_to_send);
       void send_item(const item_id& item_to_send);
       void close_connection();
       void destroy_connection();
@@ -295,6 +336,9 @@ namespace graphene { namespace net
       fc::time_point get_last_message_sent_time() const;
       fc::time_point get_last_message_received_time() const;
 
+      /** what has been sent and received over this connection, by message type and by send queue */
+      peer_traffic_statistics get_traffic_statistics() const;
+
       fc::optional<fc::ip::endpoint> get_remote_endpoint();
       fc::ip::endpoint get_local_endpoint();
       void set_remote_endpoint(fc::optional<fc::ip::endpoint> new_remote_endpoint);
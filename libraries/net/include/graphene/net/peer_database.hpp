@@ -98,13 +98,23 @@ namespace graphene { namespace net {
     peer_database();
     ~peer_database();
 
+    /**
+     *  Loads the database from its binary log, and from then on appends every change to it.  The log is
+     *  rewritten on open, on close and whenever it has grown well past the records it describes.
+     */
     void open(const fc::path& databaseFilename);
     void close();
     void clear();
 
+    /** adds the records of a peer database exported as JSON, or of a peers.json from older versions */
+    void import_json(const fc::path& jsonFilename);
+    void export_json(const fc::path& jsonFilename) const;
+
     void erase(const fc::ip::endpoint& endpointToErase);
 
     void update_entry(const potential_peer_record& updatedRecord);
+    /** applies many changes at once, saving the database a single time instead of logging each one */
+    void update_entries(const std::vector<potential_peer_record>& updatedRecords);
     potential_peer_record lookup_or_create_entry_for_endpoint(const fc::ip::endpoint& endpointToLookup);
     fc::optional<potential_peer_record> lookup_entry_for_endpoint(const fc::ip::endpoint& endpointToLookup);
 
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/net/config.hpp>
+
+#include <fc/network/ip.hpp>
+#include <fc/reflect/reflect.hpp>
+
+#include <array>
+#include <vector>
+
+namespace graphene { namespace net {
+
+  /** the send queues of a peer, in the order they are served */
+  enum message_priority
+  {
+    control_priority,      ///< handshakes, requests and everything else that keeps the connection going
+    block_priority,        ///< full and compact blocks, and the transactions completing compact blocks
+    item_ids_priority,     ///< inventory and block id lists
+    transaction_priority,  ///< transactions, and messages of types the core protocol doesn't define
+    message_priority_count
+  };
+
+  /** the send queue messages of type @p msg_type go to */
+  message_priority message_priority_of( uint32_t msg_type );
+
+  /**
+   *  Weighted fair scheduling between a peer's send queues, by deficit round robin.
+   *
+   *  The control queue has strict priority.  The others are visited in turn, each visit adding
+   *  the queue's weight times GRAPHENE_NET_SEND_QUANTUM_IN_BYTES to its allowance, and a queue is
+   *  served while its allowance lasts.  Messages are charged after they have been sent, so a
+   *  message larger than the allowance simply leaves the queue in debt for the following rounds.
+   */
+  class send_scheduler
+  {
+  public:
+    typedef std::array<size_t, message_priority_count> queue_lengths;
+
+    /** the queue to send the next message from, given how many messages are waiting in each */
+    message_priority next( const queue_lengths& queued_messages );
+    /** charges @p bytes sent from the @p priority queue */
+    void on_sent( message_priority priority, size_t bytes );
+
+    static uint32_t weight( message_priority priority );
+
+  private:
+    std::array<int64_t, message_priority_count> _allowance{};
+    uint32_t _current = block_priority; ///< the queue being served in the round robin
+  };
+
+  /** what has been sent and received of one message type over a connection */
+  struct message_type_traffic
+  {
+    uint32_t message_type = 0;
+    uint64_t messages_sent = 0;
+    uint64_t bytes_sent = 0;
+    uint64_t messages_received = 0;
+    uint64_t bytes_received = 0;
+  };
+
+  struct send_queue_statistics
+  {
+    message_priority priority = control_priority;
+    uint32_t         queued_messages = 0;
+    uint64_t         queued_bytes = 0;
+    uint64_t         messages_sent = 0;
+    uint64_t         bytes_sent = 0;
+  };
+
+  /** a peer's traffic, as reported by node::get_peer_traffic_statistics() */
+  struct peer_traffic_statistics
+  {
+    fc::ip::endpoint                   host;
+    uint64_t                           total_bytes_sent = 0;     ///< including framing and encryption
+    uint64_t                           total_bytes_received = 0; ///< including framing and encryption
+    std::vector<message_type_traffic>  message_types;
+    std::vector<send_queue_statistics> send_queues;
+  };
+
+} } // graphene::net
+
+FC_REFLECT_ENUM( graphene::net::message_priority,
+                 (control_priority)(block_priority)(item_ids_priority)(transaction_priority)(message_priority_count) )
+FC_REFLECT( graphene::net::message_type_traffic,
+            (message_type)(messages_sent)(bytes_sent)(messages_received)(bytes_received) )
+FC_REFLECT( graphene::net::send_queue_statistics,
+            (priority)(queued_messages)(queued_bytes)(messages_sent)(bytes_sent) )
+FC_REFLECT( graphene::net::peer_traffic_statistics,
+            (host)(total_bytes_sent)(total_bytes_received)(message_types)(send_queues) )
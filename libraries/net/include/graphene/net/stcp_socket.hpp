@@ -50,24 +50,52 @@ class stcp_socket : public virtual fc::iostream
     virtual size_t   writesome( const char* buffer, size_t len );
     virtual size_t   writesome( const std::shared_ptr<const char>& buf, size_t len, size_t offset );
 
+    typedef std::pair<const char*, size_t> buffer_region;
+    /**
+     *  Encrypts the concatenation of @p regions, zero padded to a multiple of 16 bytes, and
+     *  writes it to the socket in a single call.  The ciphertext is produced directly in a
+     *  per-connection buffer that is reused across calls, so callers never have to assemble
+     *  a padded plaintext copy first.
+     *
+     *  @return the number of bytes written, including padding
+     */
+    size_t           write_regions( const buffer_region* regions, size_t count );
+
     virtual void     flush();
     virtual void     close();
 
     using istream::get;
     void             get( char& c ) { read( &c, 1 ); }
     fc::sha512       get_shared_secret() const { return _shared_secret; }
+
+    /**
+     *  Switch one direction of the stream from the AES-256-CBC set up by the key exchange to
+     *  AES-256-CTR, effective from the next byte written or read.  Each direction gets a key
+     *  of its own, derived from the shared secret and the sender's public key, so the two
+     *  counter streams never share a keystream.  Both ends must switch the same direction at
+     *  the same byte offset, which the caller negotiates.
+     */
+    void             use_aes_ctr_for_sending();
+    void             use_aes_ctr_for_receiving();
+    /** the most ciphertext a single readsome() will pull from the socket */
+    static const size_t max_read_buffer_size = 256 * 1024;
   private:
     void do_key_exchange();
+    void derive_ctr_key( const fc::ecc::public_key_data& sender, fc::sha256& key, fc::uint128& init_value )const;
 
     fc::sha512           _shared_secret;
     fc::ecc::private_key _priv_key;
+    fc::ecc::public_key_data _local_public_key;
+    fc::ecc::public_key_data _remote_public_key;
     fc::array<char,8>    _buf;
     //uint32_t             _buf_len;
     fc::tcp_socket       _sock;
     fc::aes_encoder      _send_aes;
     fc::aes_decoder      _recv_aes;
     std::shared_ptr<char> _read_buffer;
+    size_t                _read_buffer_size;
     std::shared_ptr<char> _write_buffer;
+    size_t                _write_buffer_size;
 #ifndef NDEBUG
     bool _read_buffer_in_use;
     bool _write_buffer_in_use;
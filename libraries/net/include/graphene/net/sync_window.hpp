@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/net/config.hpp>
+
+#include <fc/network/ip.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/time.hpp>
+
+namespace graphene { namespace net {
+
+  /**
+   *  What a node has measured about one of the peers it syncs blocks from, as reported by
+   *  node::get_sync_statistics()
+   */
+  struct peer_sync_statistics
+  {
+    fc::ip::endpoint host;
+    uint32_t         window = 0;             ///< most sync blocks this peer may have outstanding
+    uint32_t         outstanding = 0;        ///< sync blocks requested from this peer and not yet received
+    uint64_t         blocks_received = 0;
+    uint64_t         bytes_received = 0;
+    uint64_t         blocks_rerequested = 0; ///< blocks this peer stalled on that were asked from another peer
+    double           blocks_per_second = 0;  ///< smoothed delivery rate
+    fc::microseconds round_trip_time;        ///< smoothed delay between requesting and receiving a block
+    fc::microseconds stall_timeout;          ///< blocks outstanding for longer are asked from another peer
+  };
+
+  /**
+   *  Flow control for the sync blocks requested from a single peer.
+   *
+   *  The window is the number of blocks the peer delivers in GRAPHENE_NET_SYNC_TARGET_LATENCY_MS
+   *  plus its base round trip time, so a fast peer keeps a deep pipeline while a slow one is
+   *  never holding more blocks than it can deliver before the rest of the chain catches up.
+   *  Until the first blocks arrive the window starts small and grows by one block per block
+   *  received.  The stall timeout is derived from the round trip time the same way TCP derives
+   *  its retransmission timeout.
+   */
+  class sync_window
+  {
+  public:
+    sync_window( uint32_t maximum_window = GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING );
+
+    void     set_maximum_window( uint32_t maximum_window );
+
+    /** how many more blocks may be requested from a peer that has @p outstanding sync requests */
+    uint32_t available( size_t outstanding )const;
+
+    void     on_request( size_t outstanding_before, fc::time_point now );
+    void     on_block_received( fc::time_point requested, fc::time_point now, uint64_t bytes );
+    /** @p count outstanding blocks took longer than stall_timeout() and are being asked from another peer */
+    void     on_stall( uint32_t count );
+
+    fc::microseconds stall_timeout()const;
+    double   blocks_per_second()const { return _statistics.blocks_per_second; }
+
+    const peer_sync_statistics& get_statistics()const { return _statistics; }
+
+  private:
+    void update_window();
+
+    uint32_t             _maximum_window;
+    fc::time_point       _last_delivery;
+    fc::time_point       _busy_since;
+    fc::microseconds     _average_delivery_interval;
+    fc::microseconds     _round_trip_deviation;
+    fc::microseconds     _minimum_round_trip_time = fc::microseconds::maximum();
+    peer_sync_statistics _statistics;
+  };
+
+} } // graphene::net
+
+FC_REFLECT( graphene::net::peer_sync_statistics,
+            (host)(window)(outstanding)(blocks_received)(bytes_received)(blocks_rerequested)
+            (blocks_per_second)(round_trip_time)(stall_timeout) )
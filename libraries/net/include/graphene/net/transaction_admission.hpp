@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/net/config.hpp>
+
+#include <fc/network/ip.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/time.hpp>
+
+#include <vector>
+
+namespace graphene { namespace net {
+
+  /** the outcome of the checks node_delegate::precheck_transaction() makes before full validation */
+  enum transaction_precheck_result
+  {
+    transaction_precheck_passed,
+    transaction_duplicate,            ///< already in the chain or in our pending transactions
+    transaction_expired,
+    transaction_expiration_too_far,   ///< expires later than the chain parameters allow
+    transaction_oversized,            ///< larger than the chain's maximum transaction size
+    transaction_unknown_tapos_block   ///< ref_block_num and ref_block_prefix don't match a block on our chain
+  };
+
+  /** what became of the transactions received from the network, or from one peer */
+  struct transaction_admission_counters
+  {
+    uint64_t received = 0;
+    uint64_t admitted = 0;            ///< passed full validation and were relayed
+    uint64_t rate_limited = 0;        ///< dropped unvalidated because the peer had run out of tokens
+    uint64_t duplicate = 0;
+    uint64_t expired = 0;
+    uint64_t expiration_too_far = 0;
+    uint64_t oversized = 0;
+    uint64_t unknown_tapos_block = 0;
+    uint64_t failed_validation = 0;   ///< passed the prechecks but were rejected by the blockchain
+
+    void count_precheck_failure( transaction_precheck_result result );
+  };
+
+  struct peer_transaction_admission_statistics
+  {
+    fc::ip::endpoint               host;
+    double                         tokens = 0;       ///< transactions the peer may send before being throttled
+    fc::time_point                 throttled_until;  ///< no transactions are fetched from the peer until then
+    transaction_admission_counters counters;
+  };
+
+  /** as reported by node::get_transaction_admission_statistics() */
+  struct transaction_admission_statistics
+  {
+    transaction_admission_counters                     totals; ///< since the node started, including disconnected peers
+    std::vector<peer_transaction_admission_statistics> peers;
+  };
+
+  /**
+   *  Rate limits the transactions accepted from a peer.
+   *
+   *  The bucket fills at a steady rate up to its capacity, and every transaction received from the
+   *  peer takes a token.  A transaction that turns out to be invalid is charged a penalty on top,
+   *  which may leave the balance negative, so a peer relaying junk is throttled to a small fraction
+   *  of the rate an honest peer gets.
+   */
+  class token_bucket
+  {
+  public:
+    token_bucket( double tokens_per_second = GRAPHENE_NET_PEER_TRX_PER_SECOND,
+                  double capacity = GRAPHENE_NET_PEER_TRX_BURST );
+
+    /** takes @p count tokens if that many are available */
+    bool           try_consume( fc::time_point now, double count = 1 );
+    /** takes @p count tokens regardless; the balance never drops below minus the capacity */
+    void           charge( fc::time_point now, double count );
+    double         available( fc::time_point now );
+    /** when @p count tokens will be available, if nothing else is taken */
+    fc::time_point when_available( fc::time_point now, double count = 1 );
+
+  private:
+    void refill( fc::time_point now );
+
+    double         _tokens_per_second;
+    double         _capacity;
+    double         _tokens;
+    fc::time_point _last_refill;
+  };
+
+} } // graphene::net
+
+FC_REFLECT_ENUM( graphene::net::transaction_precheck_result,
+                 (transaction_precheck_passed)(transaction_duplicate)(transaction_expired)
+                 (transaction_expiration_too_far)(transaction_oversized)(transaction_unknown_tapos_block) )
+FC_REFLECT( graphene::net::transaction_admission_counters,
+            (received)(admitted)(rate_limited)(duplicate)(expired)(expiration_too_far)(oversized)
+            (unknown_tapos_block)(failed_validation) )
+FC_REFLECT( graphene::net::peer_transaction_admission_statistics, (host)(tokens)(throttled_until)(counters) )
+FC_REFLECT( graphene::net::transaction_admission_statistics, (totals)(peers) )
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/net/message_cache.hpp>
+
+#include <graphene/chain/protocol/fee_schedule.hpp>
+
+#include <fc/smart_ref_impl.hpp>
+
+namespace graphene { namespace net {
+
+  void blockchain_tied_message_cache::block_accepted()
+  {
+    // compact blocks refer to the block being accepted, the next one will have a different id
+    _short_id_block = block_id_type();
+    _short_id_index.clear();
+
+    ++block_clock;
+    if( block_clock > cache_duration_in_blocks )
+    {
+      auto& clock_index = _message_cache.get<block_clock_index>();
+      auto expired_end = clock_index.lower_bound( block_clock - cache_duration_in_blocks );
+      for( auto iter = clock_index.begin(); iter != expired_end; ++iter )
+      {
+        _statistics.bytes -= iter->message_body->data.size();
+        ++_statistics.messages_expired;
+        _transaction_ids.erase( iter->message_hash );
+      }
+      clock_index.erase( clock_index.begin(), expired_end );
+      _statistics.entries = _message_cache.size();
+    }
+  }
+
+  shared_message blockchain_tied_message_cache::cache_message( message message_to_cache,
+                                                               const message_hash_type& hash_of_message_to_cache,
+                                                               const message_propagation_data& propagation_data,
+                                                               const fc::uint160_t& message_content_hash )
+  {
+    auto& hash_index = _message_cache.get<message_hash_index>();
+    auto existing = hash_index.find( hash_of_message_to_cache );
+    if( existing != hash_index.end() )
+    {
+      ++_statistics.duplicates_ignored;
+      return existing->message_body;
+    }
+
+    shared_message message_body = std::make_shared<const message>( std::move(message_to_cache) );
+    _message_cache.insert( message_info( hash_of_message_to_cache,
+                                         message_body,
+                                         block_clock,
+                                         propagation_data,
+                                         message_content_hash ) );
+    if( message_body->msg_type == trx_message_type )
+    {
+      // for transactions the contents hash is the transaction id
+      _transaction_ids.emplace( hash_of_message_to_cache, message_content_hash );
+      if( _short_id_block != block_id_type() )
+        _short_id_index.emplace( compact_block_short_id( _short_id_block, message_content_hash ), hash_of_message_to_cache );
+    }
+    ++_statistics.messages_cached;
+    _statistics.bytes += message_body->data.size();
+    _statistics.entries = _message_cache.size();
+    return message_body;
+  }
+
+  shared_message blockchain_tied_message_cache::get_message( const message_hash_type& hash_of_message_to_lookup ) const
+  {
+    auto iter = _message_cache.get<message_hash_index>().find( hash_of_message_to_lookup );
+    if( iter != _message_cache.get<message_hash_index>().end() )
+    {
+      ++_statistics.hits;
+      _statistics.bytes_served += iter->message_body->data.size();
+      return iter->message_body;
+    }
+    ++_statistics.misses;
+    FC_THROW_EXCEPTION( fc::key_not_found_exception, "Requested message not in cache" );
+  }
+
+  message_propagation_data blockchain_tied_message_cache::get_message_propagation_data( const fc::uint160_t& hash_of_message_contents_to_lookup ) const
+  {
+    if( hash_of_message_contents_to_lookup != fc::uint160_t() )
+    {
+      auto iter = _message_cache.get<message_contents_hash_index>().find( hash_of_message_contents_to_lookup );
+      if( iter != _message_cache.get<message_contents_hash_index>().end() )
+        return iter->propagation_data;
+    }
+    FC_THROW_EXCEPTION( fc::key_not_found_exception, "Requested message not in cache" );
+  }
+
+  std::unordered_map<uint64_t, signed_transaction>
+  blockchain_tied_message_cache::find_transactions_by_short_id( const block_id_type& block_id,
+                                                                const std::unordered_set<uint64_t>& short_ids ) const
+  {
+    if( block_id != _short_id_block || block_id == block_id_type() )
+    {
+      _short_id_block = block_id;
+      _short_id_index.clear();
+      _short_id_index.reserve( _transaction_ids.size() );
+      for( const auto& hash_and_id : _transaction_ids )
+        _short_id_index.emplace( compact_block_short_id( block_id, hash_and_id.second ), hash_and_id.first );
+    }
+
+    std::unordered_map<uint64_t, signed_transaction> result;
+    auto& hash_index = _message_cache.get<message_hash_index>();
+    for( uint64_t short_id : short_ids )
+    {
+      auto index_iter = _short_id_index.find( short_id );
+      if( index_iter == _short_id_index.end() )
+        continue;
+      auto iter = hash_index.find( index_iter->second );
+      if( iter != hash_index.end() )
+        result[short_id] = iter->message_body->as<trx_message>().trx;
+    }
+    return result;
+  }
+
+} } // graphene::net
@@ -30,8 +30,13 @@
 
 #include <graphene/net/message_oriented_connection.hpp>
 #include <graphene/net/stcp_socket.hpp>
+#include <graphene/net/core_messages.hpp>
 #include <graphene/net/config.hpp>
 
+#include <algorithm>
+#include <deque>
+#include <random>
+
 #ifdef DEFAULT_LOGGER
 # undef DEFAULT_LOGGER
 #endif
@@ -46,6 +51,9 @@
 namespace graphene { namespace net {
   namespace detail
   {
+    /** set by message_oriented_connection::set_link_model(), empty unless a benchmark simulates links */
+    static link_model_function link_model_for_connections;
+
     class message_oriented_connection_impl
     {
     private:
@@ -62,12 +70,22 @@ namespace graphene { namespace net {
 
       bool _send_message_in_progress;
 
+      /** the simulated link the received messages cross, if any */
+      fc::optional<link_model> _link;
+      std::mt19937_64 _link_random;
+      fc::time_point _link_busy_until;
+      /** received messages held back until the link would have delivered them, with when it would */
+      std::deque< std::pair<fc::time_point, message> > _delayed_messages;
+      fc::future<void> _delayed_delivery_done;
+
 #ifndef NDEBUG
       fc::thread* _thread;
 #endif
 
       void read_loop();
       void start_read_loop();
+      void delay_message( message&& received_message );
+      void deliver_delayed_messages();
     public:
       fc::tcp_socket& get_socket();
       void accept();
@@ -146,6 +164,12 @@ namespace graphene { namespace net {
       static_assert(BUFFER_SIZE >= sizeof(message_header), "insufficient buffer");
 
       _connected_time = fc::time_point::now();
+      if( link_model_for_connections )
+      {
+        _link = link_model_for_connections( _sock.get_socket().local_endpoint(), _sock.get_socket().remote_endpoint() );
+        if( _link )
+          _link_random.seed( _link->seed );
+      }
 
       fc::oexception exception_to_rethrow;
       bool call_on_connection_closed = false;
@@ -174,6 +198,22 @@ namespace graphene { namespace net {
 
           _last_message_received_time = fc::time_point::now();
 
+          if (m.msg_type == core_message_type_enum::transport_cipher_message_type)
+          {
+            // the next byte the peer sends is encrypted with the new cipher, so switch before reading it
+            const transport_cipher_message switch_cipher = m.as<transport_cipher_message>();
+            FC_ASSERT( switch_cipher.cipher == GRAPHENE_NET_AES_CTR_CIPHER, "peer switched to an unsupported transport cipher",
+                       ("cipher", switch_cipher.cipher) );
+            _sock.use_aes_ctr_for_receiving();
+            continue;
+          }
+
+          if( _link )
+          {
+            delay_message( std::move( m ) );
+            continue;
+          }
+
           try
           {
             // message handling errors are warnings...
@@ -219,6 +259,8 @@ namespace graphene { namespace net {
         exception_to_rethrow = fc::unhandled_exception(FC_LOG_MESSAGE(warn, "disconnected: ${e}", ("e", fc::except_str())));
       }
 
+      // messages still crossing the link are lost with it
+      _delayed_messages.clear();
       if (call_on_connection_closed)
         _delegate->on_connection_closed(_self);
 
@@ -226,6 +268,63 @@ namespace graphene { namespace net {
         throw *exception_to_rethrow;
     }
 
+    void message_oriented_connection_impl::delay_message( message&& received_message )
+    {
+      VERIFY_CORRECT_THREAD();
+      // the link transmits one message after the other, and stops reading while it is busy so that a sender
+      // outrunning it backs up the way it would on a real link
+      const fc::time_point now = fc::time_point::now();
+      fc::time_point transmitted = std::max( now, _link_busy_until );
+      if( _link->bytes_per_second )
+        transmitted += fc::microseconds( int64_t( ( sizeof(message_header) + received_message.size ) * 1000000
+                                                  / _link->bytes_per_second ) );
+      _link_busy_until = transmitted;
+      if( transmitted > now )
+        fc::usleep( transmitted - now );
+
+      fc::microseconds latency = _link->latency;
+      if( _link->jitter.count() > 0 )
+        latency += fc::microseconds( std::uniform_int_distribution<int64_t>( 0, _link->jitter.count() )( _link_random ) );
+      // delivered in the order sent, however the jitter falls
+      fc::time_point due = transmitted + latency;
+      if( !_delayed_messages.empty() )
+        due = std::max( due, _delayed_messages.back().first );
+      _delayed_messages.emplace_back( due, std::move( received_message ) );
+      if( !_delayed_delivery_done.valid() || _delayed_delivery_done.ready() )
+        _delayed_delivery_done = fc::async( [=](){ deliver_delayed_messages(); }, "delayed message delivery" );
+    }
+
+    void message_oriented_connection_impl::deliver_delayed_messages()
+    {
+      VERIFY_CORRECT_THREAD();
+      while( !_delayed_messages.empty() )
+      {
+        const fc::time_point due = _delayed_messages.front().first;
+        const fc::time_point now = fc::time_point::now();
+        if( due > now )
+        {
+          // the connection may close meanwhile, dropping what it still held
+          fc::usleep( due - now );
+          continue;
+        }
+        const message m = std::move( _delayed_messages.front().second );
+        _delayed_messages.pop_front();
+        try
+        {
+          _delegate->on_message(_self, m);
+        }
+        catch ( const fc::canceled_exception& ) { throw; }
+        catch ( const fc::exception& e )
+        {
+          // as in read_loop(), which notices the closed socket and tells the delegate
+          wlog( "message transmission failed ${er}", ("er", e.to_detail_string() ) );
+          _delayed_messages.clear();
+          _sock.close();
+          return;
+        }
+      }
+    }
+
     void message_oriented_connection_impl::send_message(const message& message_to_send)
     {
       VERIFY_CORRECT_THREAD();
@@ -255,16 +354,18 @@ namespace graphene { namespace net {
 
       try
       {
-        size_t size_of_message_and_header = sizeof(message_header) + message_to_send.size;
         if( message_to_send.size > MAX_MESSAGE_SIZE )
            elog("Trying to send a message larger than MAX_MESSAGE_SIZE. This probably won't work...");
-        //pad the message we send to a multiple of 16 bytes
-        size_t size_with_padding = 16 * ((size_of_message_and_header + 15) / 16);
-        std::unique_ptr<char[]> padded_message(new char[size_with_padding]);
-        memcpy(padded_message.get(), (char*)&message_to_send, sizeof(message_header));
-        memcpy(padded_message.get() + sizeof(message_header), message_to_send.data.data(), message_to_send.size );
-        _sock.write(padded_message.get(), size_with_padding);
+        //the socket pads the message we send to a multiple of 16 bytes
+        const stcp_socket::buffer_region regions[] = {
+          stcp_socket::buffer_region( (const char*)&message_to_send, sizeof(message_header) ),
+          stcp_socket::buffer_region( message_to_send.data.data(), message_to_send.size )
+        };
+        size_t size_with_padding = _sock.write_regions( regions, 2 );
         _sock.flush();
+        // the peer switches its decoder after reading this message, so everything after it is sent with the new cipher
+        if (message_to_send.msg_type == core_message_type_enum::transport_cipher_message_type)
+          _sock.use_aes_ctr_for_sending();
         _bytes_sent += size_with_padding;
         _last_message_sent_time = fc::time_point::now();
       } FC_RETHROW_EXCEPTIONS( warn, "unable to send message" );
@@ -302,6 +403,19 @@ namespace graphene { namespace net {
       {
         wlog( "Exception thrown while canceling message_oriented_connection's read_loop, ignoring" );
       }
+
+      if( _delayed_delivery_done.valid() && !_delayed_delivery_done.ready() )
+      {
+        try
+        {
+          _delayed_delivery_done.cancel_and_wait(__FUNCTION__);
+        }
+        catch ( const fc::exception& e )
+        {
+          wlog( "Exception thrown while canceling the delayed message delivery, ignoring: ${e}", ("e",e) );
+        }
+      }
+      _delayed_messages.clear();
     }
 
     uint64_t message_oriented_connection_impl::get_total_bytes_sent() const
@@ -409,4 +523,9 @@ namespace graphene { namespace net {
     return my->get_shared_secret();
   }
 
+  void message_oriented_connection::set_link_model( link_model_function model )
+  {
+    detail::link_model_for_connections = std::move( model );
+  }
+
 } } // end namespace graphene::net
@@ -25,6 +25,7 @@
 #include <iomanip>
 #include <deque>
 #include <unordered_set>
+#include <unordered_map>
 #include <list>
 #include <forward_list>
 #include <iostream>
@@ -123,104 +124,6 @@ namespace graphene { namespace net {
 
   namespace detail
   {
-    namespace bmi = boost::multi_index;
-    class blockchain_tied_message_cache
-    {
-    private:
-      static const uint32_t cache_duration_in_blocks = GRAPHENE_NET_MESSAGE_CACHE_DURATION_IN_BLOCKS;
-
-      struct message_hash_index{};
-      struct message_contents_hash_index{};
-      struct block_clock_index{};
-      struct message_info
-      {
-        message_hash_type message_hash;
-        message           message_body;
-        uint32_t          block_clock_when_received;
-
-        // for network performance stats
-        message_propagation_data propagation_data;
-        fc::uint160_t     message_contents_hash; // hash of whatever the message contains (if it's a transaction, this is the transaction id, if it's a block, it's the block_id)
-
-        message_info( const message_hash_type& message_hash,
-                      const message&           message_body,
-                      uint32_t                 block_clock_when_received,
-                      const message_propagation_data& propagation_data,
-                      fc::uint160_t            message_contents_hash ) :
-          message_hash( message_hash ),
-          message_body( message_body ),
-          block_clock_when_received( block_clock_when_received ),
-          propagation_data( propagation_data ),
-          message_contents_hash( message_contents_hash )
-        {}
-      };
-      typedef boost::multi_index_container
-        < message_info,
-            bmi::indexed_by< bmi::ordered_unique< bmi::tag<message_hash_index>,
-                                                  bmi::member<message_info, message_hash_type, &message_info::message_hash> >,
-                             bmi::ordered_non_unique< bmi::tag<message_contents_hash_index>,
-                                                      bmi::member<message_info, fc::uint160_t, &message_info::message_contents_hash> >,
-                             bmi::ordered_non_unique< bmi::tag<block_clock_index>,
-                                                      bmi::member<message_info, uint32_t, &message_info::block_clock_when_received> > >
-        > message_cache_container;
-
-      message_cache_container _message_cache;
-
-      uint32_t block_clock;
-
-    public:
-      blockchain_tied_message_cache() :
-        block_clock( 0 )
-      {}
-      void block_accepted();
-      void cache_message( const message& message_to_cache, const message_hash_type& hash_of_message_to_cache,
-                        const message_propagation_data& propagation_data, const fc::uint160_t& message_content_hash );
-      message get_message( const message_hash_type& hash_of_message_to_lookup );
-      message_propagation_data get_message_propagation_data( const fc::uint160_t& hash_of_message_contents_to_lookup ) const;
-      size_t size() const { return _message_cache.size(); }
-    };
-
-    void blockchain_tied_message_cache::block_accepted()
-    {
-      ++block_clock;
-      if( block_clock > cache_duration_in_blocks )
-        _message_cache.get<block_clock_index>().erase(_message_cache.get<block_clock_index>().begin(),
-                                                      _message_cache.get<block_clock_index>().lower_bound(block_clock - cache_duration_in_blocks ) );
-    }
-
-    void blockchain_tied_message_cache::cache_message( const message& message_to_cache,
-                                                     const message_hash_type& hash_of_message_to_cache,
-                                                     const message_propagation_data& propagation_data,
-                                                     const fc::uint160_t& message_content_hash )
-    {
-      _message_cache.insert( message_info(hash_of_message_to_cache,
-                                         message_to_cache,
-                                         block_clock,
-                                         propagation_data,
-                                         message_content_hash ) );
-    }
-
-    message blockchain_tied_message_cache::get_message( const message_hash_type& hash_of_message_to_lookup )
-    {
-      message_cache_container::index<message_hash_index>::type::const_iterator iter =
-         _message_cache.get<message_hash_index>().find(hash_of_message_to_lookup );
-      if( iter != _message_cache.get<message_hash_index>().end() )
-        return iter->message_body;
-      FC_THROW_EXCEPTION(  fc::key_not_found_exception, "Requested message not in cache" );
-    }
-
-    message_propagation_data blockchain_tied_message_cache::get_message_propagation_data( const fc::uint160_t& hash_of_message_contents_to_lookup ) const
-    {
-      if( hash_of_message_contents_to_lookup != fc::uint160_t() )
-      {
-        message_cache_container::index<message_contents_hash_index>::type::const_iterator iter =
-           _message_cache.get<message_contents_hash_index>().find(hash_of_message_contents_to_lookup );
-        if( iter != _message_cache.get<message_contents_hash_index>().end() )
-          return iter->propagation_data;
-      }
-      FC_THROW_EXCEPTION(  fc::key_not_found_exception, "Requested message not in cache" );
-    }
-
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
 
     // This specifies configuration info for the local node.  It's stored as JSON
@@ -289,8 +192,10 @@ namespace graphene { namespace net { namespace detail {
                                    (handle_message) \
                                    (handle_block) \
                                    (handle_transaction) \
+                                   (precheck_transaction) \
                                    (get_block_ids) \
                                    (get_item) \
+                                   (get_blocks) \
                                    (get_chain_id) \
                                    (get_blockchain_synopsis) \
                                    (sync_status) \
@@ -385,10 +290,12 @@ namespace graphene { namespace net { namespace detail {
       void handle_message( const message& ) override;
       bool handle_block( const graphene::net::block_message& block_message, bool sync_mode, std::vector<fc::uint160_t>& contained_transaction_message_ids ) override;
       void handle_transaction( const graphene::net::trx_message& transaction_message ) override;
+      transaction_precheck_result precheck_transaction( const graphene::net::trx_message& transaction_message ) override;
       std::vector<item_hash_t> get_block_ids(const std::vector<item_hash_t>& blockchain_synopsis,
                                              uint32_t& remaining_item_count,
                                              uint32_t limit = 2000) override;
       message get_item( const item_id& id ) override;
+      std::vector<message> get_blocks( const std::vector<item_hash_t>& block_ids, uint64_t max_total_size ) override;
       chain_id_type get_chain_id() const override;
       std::vector<item_hash_t> get_blockchain_synopsis(const item_hash_t& reference_point, 
                                                        uint32_t number_of_blocks_after_reference_point) override;
@@ -413,8 +320,9 @@ namespace graphene { namespace net { namespace detail {
       std::unique_ptr<statistics_gathering_node_delegate_wrapper> _delegate;
       fc::sha256           _chain_id;
 
-#define NODE_CONFIGURATION_FILENAME      "node_config.json"
-#define POTENTIAL_PEER_DATABASE_FILENAME "peers.json"
+#define NODE_CONFIGURATION_FILENAME             "node_config.json"
+#define POTENTIAL_PEER_DATABASE_FILENAME        "peers.dat"
+#define LEGACY_POTENTIAL_PEER_DATABASE_FILENAME "peers.json"
       fc::path             _node_configuration_directory;
       node_configuration   _node_configuration;
 
@@ -471,6 +379,7 @@ namespace graphene { namespace net { namespace detail {
       unsigned _items_to_fetch_sequence_counter;
       items_to_fetch_set_type _items_to_fetch; /// list of items we know another peer has and we want
       peer_connection::timestamped_items_set_type _recently_failed_items; /// list of transactions we've recently pushed and had rejected by the delegate
+      transaction_admission_counters _transaction_admission_totals; /// what became of the transactions peers sent us, the per-peer counters are in each peer_connection
       // @}
 
       /// used by the task that advertises inventory during normal operation
@@ -523,6 +432,15 @@ namespace graphene { namespace net { namespace detail {
 
       boost::circular_buffer<item_hash_t> _most_recent_blocks_accepted; // the /n/ most recent blocks we've accepted (currently tuned to the max number of connections)
 
+      /// per-transaction data of the last block we sent in compact form, computed once for all peers requesting it
+      struct compact_block_source
+      {
+        message_hash_type              block_message_hash;
+        std::vector<uint64_t>          short_ids;
+        std::vector<message_hash_type> transaction_message_hashes;
+      };
+      fc::optional<compact_block_source> _last_compact_block_source;
+
       uint32_t _sync_item_type;
       uint32_t _total_number_of_unfetched_items; /// the number of items we still need to fetch while syncing
       std::vector<uint32_t> _hard_fork_block_numbers; /// list of all block numbers where there are hard forks
@@ -677,6 +595,24 @@ namespace graphene { namespace net { namespace detail {
       void on_get_current_connections_reply_message(peer_connection* originating_peer,
                                                     const get_current_connections_reply_message& get_current_connections_reply_message_received);
 
+      compact_block_message build_compact_block_message(peer_connection* peer,
+                                                        const message_hash_type& block_message_hash,
+                                                        const graphene::net::block_message& full_block_message);
+
+      void on_compact_block_message(peer_connection* originating_peer,
+                                    const compact_block_message& compact_block_message_received);
+
+      void on_fetch_compact_block_transactions_message(peer_connection* originating_peer,
+                                                       const fetch_compact_block_transactions_message& fetch_compact_block_transactions_message_received);
+
+      void on_compact_block_transactions_message(peer_connection* originating_peer,
+                                                 const compact_block_transactions_message& compact_block_transactions_message_received);
+
+      void request_compact_block_transactions(peer_connection* peer,
+                                              const compact_block_reconstruction& reconstruction);
+
+      void finish_compact_block(peer_connection* originating_peer, const block_id_type& block_id);
+
       void on_connection_closed(peer_connection* originating_peer) override;
 
       void send_sync_block_to_node_delegate(const graphene::net::block_message& block_message_to_send);
@@ -687,6 +623,9 @@ namespace graphene { namespace net { namespace detail {
       void process_block_message(peer_connection* originating_peer, const message& message_to_process, const message_hash_type& message_hash);
 
       void process_ordinary_message(peer_connection* originating_peer, const message& message_to_process, const message_hash_type& message_hash);
+      bool admit_transaction(peer_connection* originating_peer, const trx_message& transaction_message, const message_hash_type& message_hash);
+      void penalize_invalid_transaction(peer_connection* originating_peer, fc::time_point now);
+      void inhibit_transaction_fetching_until_tokens_available(peer_connection* peer, fc::time_point now);
 
       void start_synchronizing();
       void start_synchronizing_with_peer(const peer_connection_ptr& peer);
@@ -732,8 +671,14 @@ namespace graphene { namespace net { namespace detail {
       fc::ip::endpoint         get_actual_listening_endpoint() const;
       std::vector<peer_status> get_connected_peers() const;
       uint32_t                 get_connection_count() const;
+      std::vector<peer_sync_statistics> get_sync_statistics() const;
+      message_cache_statistics get_message_cache_statistics() const;
+      std::vector<peer_traffic_statistics> get_peer_traffic_statistics() const;
+      transaction_admission_statistics get_transaction_admission_statistics() const;
 
       void broadcast(const message& item_to_broadcast, const message_propagation_data& propagation_data);
+      void broadcast(message item_to_broadcast, const message_hash_type& hash_of_item_to_broadcast,
+                     const fc::uint160_t& hash_of_message_contents, const message_propagation_data& propagation_data);
       void broadcast(const message& item_to_broadcast);
       void sync_from(const item_id& current_head_block, const std::vector<uint32_t>& hard_fork_block_numbers);
       bool is_connected() const;
@@ -750,7 +695,7 @@ namespace graphene { namespace net { namespace detail {
       void                       set_total_bandwidth_limit( uint32_t upload_bytes_per_second, uint32_t download_bytes_per_second );
       void                       disable_peer_advertising();
       fc::variant_object         get_call_statistics() const;
-      message                    get_message_for_item(const item_id& item) override;
+      shared_message             get_message_for_item(const item_id& item) override;
 
       fc::variant_object         network_get_info() const;
       fc::variant_object         network_get_usage_stats() const;
@@ -1002,6 +947,7 @@ namespace graphene { namespace net { namespace detail {
       VERIFY_CORRECT_THREAD();
       dlog( "requesting item ${item_hash} from peer ${endpoint}", ("item_hash", item_to_request )("endpoint", peer->get_remote_endpoint() ) );
       item_id item_id_to_request( graphene::net::block_message_type, item_to_request );
+      peer->sync_flow.on_request( peer->sync_items_requested_from_peer.size(), fc::time_point::now() );
       _active_sync_requests.insert( active_sync_requests_map::value_type(item_to_request, fc::time_point::now() ) );
       peer->sync_items_requested_from_peer.insert( peer_connection::item_to_time_map_type::value_type(item_id_to_request, fc::time_point::now() ) );
       std::vector<item_hash_t> items_to_fetch;
@@ -1013,6 +959,7 @@ namespace graphene { namespace net { namespace detail {
       VERIFY_CORRECT_THREAD();
       dlog( "requesting ${item_count} item(s) ${items_to_request} from peer ${endpoint}",
             ("item_count", items_to_request.size())("items_to_request", items_to_request)("endpoint", peer->get_remote_endpoint()) );
+      peer->sync_flow.on_request( peer->sync_items_requested_from_peer.size(), fc::time_point::now() );
       for (const item_hash_t& item_to_request : items_to_request)
       {
         _active_sync_requests.insert( active_sync_requests_map::value_type(item_to_request, fc::time_point::now() ) );
@@ -1037,34 +984,84 @@ namespace graphene { namespace net { namespace detail {
           {
             ASSERT_TASK_NOT_PREEMPTED();
             std::set<item_hash_t> sync_items_to_request;
+            const fc::time_point now = fc::time_point::now();
 
-            // for each idle peer that we're syncing with
+            // the peers we can ask for sync blocks now, fastest first so that they get the blocks we need soonest.
+            // Unlike other requests, sync requests are topped up whenever the peer's window has room.
+            std::vector<peer_connection_ptr> syncing_peers;
             for( const peer_connection_ptr& peer : _active_connections )
             {
+              peer->sync_flow.set_maximum_window(_maximum_blocks_per_peer_during_syncing);
               if( peer->we_need_sync_items_from_peer &&
-                  sync_item_requests_to_send.find(peer) == sync_item_requests_to_send.end() && // if we've already scheduled a request for this peer, don't consider scheduling another
-                  peer->idle() )
+                  !peer->inhibit_fetching_sync_blocks &&
+                  peer->items_requested_from_peer.empty() &&
+                  !peer->item_ids_requested_from_peer )
+                syncing_peers.push_back(peer);
+            }
+            std::stable_sort(syncing_peers.begin(), syncing_peers.end(),
+                             [](const peer_connection_ptr& a, const peer_connection_ptr& b) {
+                               return a->sync_flow.blocks_per_second() > b->sync_flow.blocks_per_second();
+                             });
+
+            // take blocks a peer has been sitting on for longer than its stall timeout away from it, if a faster
+            // peer has them and room to fetch them.  The scheduling below then asks the faster peer for them.
+            for( const peer_connection_ptr& peer : _active_connections )
+            {
+              const fc::time_point stall_threshold = now - peer->sync_flow.stall_timeout();
+              std::vector<item_hash_t> stalled_items;
+              for( const peer_connection::item_to_time_map_type::value_type& item_and_time : peer->sync_items_requested_from_peer )
               {
-                if (!peer->inhibit_fetching_sync_blocks)
-                {
-                  // loop through the items it has that we don't yet have on our blockchain
-                  for( unsigned i = 0; i < peer->ids_of_items_to_get.size(); ++i )
+                if( item_and_time.second >= stall_threshold )
+                  continue;
+                const item_hash_t& stalled_item = item_and_time.first.item_hash;
+                for( const peer_connection_ptr& other_peer : syncing_peers )
+                  if( other_peer != peer &&
+                      other_peer->sync_flow.blocks_per_second() > peer->sync_flow.blocks_per_second() &&
+                      other_peer->sync_flow.available(other_peer->sync_items_requested_from_peer.size()) > 0 &&
+                      std::find(other_peer->ids_of_items_to_get.begin(), other_peer->ids_of_items_to_get.end(), stalled_item) != other_peer->ids_of_items_to_get.end() )
                   {
-                    item_hash_t item_to_potentially_request = peer->ids_of_items_to_get[i];
-                    // if we don't already have this item in our temporary storage and we haven't requested from another syncing peer
-                    if( !have_already_received_sync_item(item_to_potentially_request) && // already got it, but for some reson it's still in our list of items to fetch
-                        sync_items_to_request.find(item_to_potentially_request) == sync_items_to_request.end() &&  // we have already decided to request it from another peer during this iteration
-                        _active_sync_requests.find(item_to_potentially_request) == _active_sync_requests.end() ) // we've requested it in a previous iteration and we're still waiting for it to arrive
-                    {
-                      // then schedule a request from this peer
-                      sync_item_requests_to_send[peer].push_back(item_to_potentially_request);
-                      sync_items_to_request.insert( item_to_potentially_request );
-                      if (sync_item_requests_to_send[peer].size() >= _maximum_blocks_per_peer_during_syncing)
-                        break;
-                    }
+                    stalled_items.push_back(stalled_item);
+                    break;
                   }
+              }
+              if( stalled_items.empty() )
+                continue;
+              wlog( "peer ${peer} stalled on ${count} sync block(s), requesting them from faster peers",
+                    ("peer", peer->get_remote_endpoint())("count", stalled_items.size()) );
+              for( const item_hash_t& stalled_item : stalled_items )
+              {
+                auto request = peer->sync_items_requested_from_peer.find(item_id(graphene::net::block_message_type, stalled_item));
+                peer->sync_items_rerequested_elsewhere[stalled_item] = request->second;
+                peer->sync_items_requested_from_peer.erase(request);
+                _active_sync_requests.erase(stalled_item);
+              }
+              peer->sync_flow.on_stall(stalled_items.size());
+            }
+
+            for( const peer_connection_ptr& peer : syncing_peers )
+            {
+              const uint32_t available = peer->sync_flow.available(peer->sync_items_requested_from_peer.size());
+              if( available == 0 )
+                continue;
+              std::vector<item_hash_t> items_for_peer;
+              // loop through the items it has that we don't yet have on our blockchain
+              for( unsigned i = 0; i < peer->ids_of_items_to_get.size(); ++i )
+              {
+                item_hash_t item_to_potentially_request = peer->ids_of_items_to_get[i];
+                // if we don't already have this item in our temporary storage and we haven't requested from another syncing peer
+                if( !have_already_received_sync_item(item_to_potentially_request) && // already got it, but for some reson it's still in our list of items to fetch
+                    sync_items_to_request.find(item_to_potentially_request) == sync_items_to_request.end() &&  // we have already decided to request it from another peer during this iteration
+                    _active_sync_requests.find(item_to_potentially_request) == _active_sync_requests.end() ) // we've requested it in a previous iteration and we're still waiting for it to arrive
+                {
+                  // then schedule a request from this peer
+                  items_for_peer.push_back(item_to_potentially_request);
+                  sync_items_to_request.insert( item_to_potentially_request );
+                  if (items_for_peer.size() >= available)
+                    break;
                 }
               }
+              if( !items_for_peer.empty() )
+                sync_item_requests_to_send[peer] = std::move(items_for_peer);
             }
           } // end non-preemptable section
 
@@ -1314,6 +1311,7 @@ namespace graphene { namespace net { namespace detail {
       std::list<peer_connection_ptr> peers_to_disconnect_forcibly;
       std::list<peer_connection_ptr> peers_to_send_keep_alive;
       std::list<peer_connection_ptr> peers_to_terminate;
+      bool sync_requests_stalled = false;
 
       _recent_block_interval_in_seconds = _delegate->get_current_block_interval_in_seconds();
 
@@ -1382,15 +1380,46 @@ namespace graphene { namespace net { namespace detail {
           }
           else
           {
+            // a compact block is only finished while its block is still requested from the peer, so forget the ones
+            // whose request timed out or was given up on
+            for (auto iter = active_peer->compact_blocks_being_reconstructed.begin();
+                 iter != active_peer->compact_blocks_being_reconstructed.end();)
+            {
+              auto request = active_peer->items_requested_from_peer.find(item_id(block_message_type, iter->second.compact().block_message_hash));
+              if (request == active_peer->items_requested_from_peer.end() || request->second < active_ignored_request_threshold)
+                iter = active_peer->compact_blocks_being_reconstructed.erase(iter);
+              else
+                ++iter;
+            }
+
             bool disconnect_due_to_request_timeout = false;
+            // sync blocks get the peer's adaptive stall timeout instead: once it passes, the fetch loop asks a
+            // faster peer for them, and only a peer that keeps sitting on a block well past it is disconnected
+            const fc::microseconds sync_stall_timeout = active_peer->sync_flow.stall_timeout();
+            const fc::time_point sync_stall_threshold = fc::time_point::now() - sync_stall_timeout;
+            const fc::time_point sync_request_threshold = fc::time_point::now() - fc::microseconds(sync_stall_timeout.count() * GRAPHENE_NET_SYNC_STALLS_BEFORE_DISCONNECT);
             for (const peer_connection::item_to_time_map_type::value_type& item_and_time : active_peer->sync_items_requested_from_peer)
-              if (item_and_time.second < active_ignored_request_threshold)
+            {
+              if (item_and_time.second < sync_request_threshold)
               {
                 wlog("Disconnecting peer ${peer} because they didn't respond to my request for sync item ${id}",
                       ("peer", active_peer->get_remote_endpoint())("id", item_and_time.first.item_hash));
                 disconnect_due_to_request_timeout = true;
                 break;
               }
+              if (item_and_time.second < sync_stall_threshold)
+                sync_requests_stalled = true;
+            }
+            // a block the peer stalled on is no longer expected from it once it would have been disconnected for
+            // sitting on it, after that a delivery is as unrequested as any other
+            for (auto iter = active_peer->sync_items_rerequested_elsewhere.begin();
+                 iter != active_peer->sync_items_rerequested_elsewhere.end();)
+            {
+              if (iter->second < sync_request_threshold)
+                iter = active_peer->sync_items_rerequested_elsewhere.erase(iter);
+              else
+                ++iter;
+            }
             if (!disconnect_due_to_request_timeout &&
                 active_peer->item_ids_requested_from_peer &&
                 active_peer->item_ids_requested_from_peer->get<1>() < active_ignored_request_threshold)
@@ -1489,6 +1518,10 @@ namespace graphene { namespace net { namespace detail {
                            offsetof(current_time_request_message, request_sent_time));
       peers_to_send_keep_alive.clear();
 
+      // give the fetch loop a chance to move stalled sync blocks to faster peers
+      if (sync_requests_stalled)
+        trigger_fetch_sync_items_loop();
+
       if (!_node_is_shutting_down && !_terminate_inactive_connections_loop_done.canceled())
          _terminate_inactive_connections_loop_done = fc::schedule( [this](){ terminate_inactive_connections_loop(); },
                                                                    fc::time_point::now() + fc::seconds(GRAPHENE_NET_PEER_HANDSHAKE_INACTIVITY_TIMEOUT / 2),
@@ -1808,6 +1841,15 @@ namespace graphene { namespace net { namespace detail {
       case core_message_type_enum::get_current_connections_reply_message_type:
         on_get_current_connections_reply_message(originating_peer, received_message.as<get_current_connections_reply_message>());
         break;
+      case core_message_type_enum::compact_block_message_type:
+        on_compact_block_message(originating_peer, received_message.as<compact_block_message>());
+        break;
+      case core_message_type_enum::fetch_compact_block_transactions_message_type:
+        on_fetch_compact_block_transactions_message(originating_peer, received_message.as<fetch_compact_block_transactions_message>());
+        break;
+      case core_message_type_enum::compact_block_transactions_message_type:
+        on_compact_block_transactions_message(originating_peer, received_message.as<compact_block_transactions_message>());
+        break;
 
       default:
         // ignore any message in between core_message_type_first and _last that we don't handle above
@@ -1840,6 +1882,8 @@ namespace graphene { namespace net { namespace detail {
       user_data["platform"] = "other";
 #endif
       user_data["bitness"] = sizeof(void*) * 8;
+      user_data["compact_blocks"] = true;
+      user_data["aes_ctr"] = true;
 
       user_data["node_id"] = _node_id;
 
@@ -1873,6 +1917,12 @@ namespace graphene { namespace net { namespace detail {
         originating_peer->node_id = user_data["node_id"].as<node_id_t>();
       if (user_data.contains("last_known_fork_block_number"))
         originating_peer->last_known_fork_block_number = user_data["last_known_fork_block_number"].as<uint32_t>();
+      if (user_data.contains("compact_blocks") &&
+          originating_peer->core_protocol_version >= GRAPHENE_NET_COMPACT_BLOCKS_PROTOCOL_VERSION)
+        originating_peer->supports_compact_blocks = user_data["compact_blocks"].as_bool();
+      if (user_data.contains("aes_ctr") &&
+          originating_peer->core_protocol_version >= GRAPHENE_NET_AES_CTR_PROTOCOL_VERSION)
+        originating_peer->supports_aes_ctr = user_data["aes_ctr"].as_bool();
     }
 
     void node_impl::on_hello_message( peer_connection* originating_peer, const hello_message& hello_message_received )
@@ -2065,6 +2115,13 @@ namespace graphene { namespace net { namespace detail {
           else
           {
             originating_peer->their_state = peer_connection::their_connection_state::connection_accepted;
+            if (originating_peer->supports_aes_ctr)
+            {
+              // everything we send after this message, starting with the acceptance, is encrypted with AES-CTR
+              transport_cipher_message switch_cipher;
+              switch_cipher.cipher = GRAPHENE_NET_AES_CTR_CIPHER;
+              originating_peer->send_message(message(switch_cipher));
+            }
             originating_peer->send_message(message(connection_accepted_message()));
             dlog("Received a hello_message from peer ${peer}, sending reply to accept connection",
                  ("peer", originating_peer->get_remote_endpoint()));
@@ -2700,7 +2757,7 @@ namespace graphene { namespace net { namespace detail {
       }
     }
 
-    message node_impl::get_message_for_item(const item_id& item)
+    shared_message node_impl::get_message_for_item(const item_id& item)
     {
       try
       {
@@ -2710,11 +2767,11 @@ namespace graphene { namespace net { namespace detail {
       {}
       try
       {
-        return _delegate->get_item(item);
+        return std::make_shared<const message>(_delegate->get_item(item));
       }
       catch (fc::key_not_found_exception&)
       {}
-      return item_not_available_message(item);
+      return std::make_shared<const message>(item_not_available_message(item));
     }
 
     void node_impl::on_fetch_items_message(peer_connection* originating_peer, const fetch_items_message& fetch_items_message_received)
@@ -2725,62 +2782,137 @@ namespace graphene { namespace net { namespace detail {
            ("type", fetch_items_message_received.item_type)
            ("endpoint", originating_peer->get_remote_endpoint()));
 
-      fc::optional<message> last_block_message_sent;
+      const bool fetching_blocks = fetch_items_message_received.item_type == block_message_type;
+      fc::optional<item_hash_t> last_block_sent;
 
-      std::list<message> reply_messages;
+      std::vector<shared_message> cached_messages;
+      std::vector<item_hash_t> uncached_block_ids;
+      cached_messages.reserve(fetch_items_message_received.items_to_fetch.size());
       for (const item_hash_t& item_hash : fetch_items_message_received.items_to_fetch)
       {
         try
         {
-          message requested_message = _message_cache.get_message(item_hash);
+          cached_messages.push_back(_message_cache.get_message(item_hash));
+        }
+        catch (fc::key_not_found_exception&)
+        {
+          // it wasn't in our local cache, that's ok ask the client
+          cached_messages.push_back(shared_message());
+          if (fetching_blocks)
+            uncached_block_ids.push_back(item_hash);
+        }
+      }
+
+      // blocks that aren't in the cache are usually sync blocks, a run of consecutive blocks of our chain.  As many
+      // of them as fit in GRAPHENE_NET_MAX_BLOCK_BYTES_READ_PER_REQUEST are read from the database at once, still
+      // packed; the rest are queued by id and read when it's their turn to be sent, rather than holding them in
+      // memory while they wait.
+      std::map<item_hash_t, shared_message> blocks_read;
+      if (!uncached_block_ids.empty())
+      {
+        try
+        {
+          std::vector<message> blocks = _delegate->get_blocks(uncached_block_ids, GRAPHENE_NET_MAX_BLOCK_BYTES_READ_PER_REQUEST);
+          for (size_t i = 0; i < blocks.size(); ++i)
+            blocks_read[uncached_block_ids[i]] = std::make_shared<const message>(std::move(blocks[i]));
+        }
+        catch (const fc::exception& e)
+        {
+          wlog("unable to read the blocks requested by peer ${endpoint}: ${e}",
+               ("endpoint", originating_peer->get_remote_endpoint())("e", e));
+        }
+      }
+
+      // cached items are queued by reference, so every peer asking for a block we're relaying shares the one
+      // copy in the cache.
+      struct reply
+      {
+        shared_message message_to_send;
+        bool           queue_by_reference;
+      };
+      std::list<reply> reply_messages;
+      for (size_t i = 0; i < fetch_items_message_received.items_to_fetch.size(); ++i)
+      {
+        const item_hash_t& item_hash = fetch_items_message_received.items_to_fetch[i];
+        if (const shared_message& requested_message = cached_messages[i])
+        {
           dlog("received item request for item ${id} from peer ${endpoint}, returning the item from my message cache",
                ("endpoint", originating_peer->get_remote_endpoint())
-               ("id", requested_message.id()));
-          reply_messages.push_back(requested_message);
-          if (fetch_items_message_received.item_type == block_message_type)
-            last_block_message_sent = requested_message;
+               ("id", item_hash));
+          if (fetching_blocks)
+          {
+            last_block_sent = item_hash;
+            // blocks in the cache were just broadcast, so the peer most likely has their transactions already
+            if (originating_peer->supports_compact_blocks)
+            {
+              reply_messages.push_back(reply{std::make_shared<const message>(
+                                                 build_compact_block_message(originating_peer, item_hash,
+                                                                             requested_message->as<graphene::net::block_message>())),
+                                             true});
+              continue;
+            }
+          }
+          reply_messages.push_back(reply{requested_message, true});
           continue;
         }
-        catch (fc::key_not_found_exception&)
+
+        item_id item_to_fetch(fetch_items_message_received.item_type, item_hash);
+        if (fetching_blocks)
         {
-           // it wasn't in our local cache, that's ok ask the client
+          auto block_read = blocks_read.find(item_hash);
+          if (block_read != blocks_read.end())
+          {
+            dlog("received item request from peer ${endpoint}, returning block ${id} read from the database",
+                 ("id", item_hash)("endpoint", originating_peer->get_remote_endpoint()));
+            reply_messages.push_back(reply{block_read->second, true});
+            last_block_sent = item_hash;
+          }
+          else if (_delegate->has_item(item_to_fetch))
+          {
+            reply_messages.push_back(reply{shared_message(), false});
+            last_block_sent = item_hash;
+          }
+          else
+          {
+            reply_messages.push_back(reply{std::make_shared<const message>(item_not_available_message(item_to_fetch)), true});
+            dlog("received item request from peer ${endpoint} but we don't have it",
+                 ("endpoint", originating_peer->get_remote_endpoint()));
+          }
+          continue;
         }
 
-        item_id item_to_fetch(fetch_items_message_received.item_type, item_hash);
         try
         {
-          message requested_message = _delegate->get_item(item_to_fetch);
+          shared_message requested_message = std::make_shared<const message>(_delegate->get_item(item_to_fetch));
           dlog("received item request from peer ${endpoint}, returning the item from delegate with id ${id} size ${size}",
-               ("id", requested_message.id())
-               ("size", requested_message.size)
+               ("id", requested_message->id())
+               ("size", requested_message->size)
                ("endpoint", originating_peer->get_remote_endpoint()));
-          reply_messages.push_back(requested_message);
-          if (fetch_items_message_received.item_type == block_message_type)
-            last_block_message_sent = requested_message;
-          continue;
+          reply_messages.push_back(reply{requested_message, true});
         }
         catch (fc::key_not_found_exception&)
         {
-          reply_messages.push_back(item_not_available_message(item_to_fetch));
+          reply_messages.push_back(reply{std::make_shared<const message>(item_not_available_message(item_to_fetch)), true});
           dlog("received item request from peer ${endpoint} but we don't have it",
                ("endpoint", originating_peer->get_remote_endpoint()));
         }
       }
 
       // if we sent them a block, update our record of the last block they've seen accordingly
-      if (last_block_message_sent)
+      if (last_block_sent)
       {
-        graphene::net::block_message block = last_block_message_sent->as<graphene::net::block_message>();
-        originating_peer->last_block_delegate_has_seen = block.block_id;
-        originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(block.block_id);
+        originating_peer->last_block_delegate_has_seen = *last_block_sent;
+        originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(*last_block_sent);
       }
 
-      for (const message& reply : reply_messages)
+      auto item_hash_iter = fetch_items_message_received.items_to_fetch.begin();
+      for (reply& reply_to_send : reply_messages)
       {
-        if (reply.msg_type == block_message_type)
-          originating_peer->send_item(item_id(block_message_type, reply.as<graphene::net::block_message>().block_id));
+        const item_hash_t& item_hash = *item_hash_iter++;
+        if (reply_to_send.queue_by_reference)
+          originating_peer->send_shared_message(std::move(reply_to_send.message_to_send));
         else
-          originating_peer->send_message(reply);
+          originating_peer->send_item(item_id(block_message_type, item_hash));
       }
     }
 
@@ -3386,7 +3518,7 @@ namespace graphene { namespace net { namespace detail {
           peer->clear_old_inventory();
         }
         message_propagation_data propagation_data{message_receive_time, message_validated_time, originating_peer->node_id};
-        broadcast( block_message_to_process, propagation_data );
+        broadcast( block_message_to_process, message_hash, block_message_to_process.block_id, propagation_data );
         _message_cache.block_accepted();
 
         if (is_hard_fork_block(block_number))
@@ -3483,6 +3615,7 @@ namespace graphene { namespace net { namespace detail {
                                                                                             block_message_to_process.block_id));
         if (sync_item_iter != originating_peer->sync_items_requested_from_peer.end())
         {
+          originating_peer->sync_flow.on_block_received(sync_item_iter->second, fc::time_point::now(), message_to_process.size);
           originating_peer->sync_items_requested_from_peer.erase(sync_item_iter);
           _active_sync_requests.erase(block_message_to_process.block_id);
           process_block_during_sync(originating_peer, block_message_to_process, message_hash);
@@ -3496,6 +3629,18 @@ namespace graphene { namespace net { namespace detail {
             else
               trigger_fetch_sync_items_loop();
           }
+          else if (originating_peer->sync_flow.available(originating_peer->sync_items_requested_from_peer.size()) * 2 >=
+                   originating_peer->sync_flow.get_statistics().window)
+          {
+            // half of the window is free, top it up rather than waiting for the whole batch to arrive
+            trigger_fetch_sync_items_loop();
+          }
+          return;
+        }
+        if (originating_peer->sync_items_rerequested_elsewhere.erase(block_message_to_process.block_id))
+        {
+          dlog("dropping sync block ${id} from ${peer}, it was requested from another peer after this one stalled",
+               ("id", block_message_to_process.block_id)("peer", originating_peer->get_remote_endpoint()));
           return;
         }
       }
@@ -3772,6 +3917,188 @@ namespace graphene { namespace net { namespace detail {
     }
 
 
+    compact_block_message node_impl::build_compact_block_message(peer_connection* peer,
+                                                                 const message_hash_type& block_message_hash,
+                                                                 const graphene::net::block_message& full_block_message)
+    {
+      VERIFY_CORRECT_THREAD();
+      const signed_block& block = full_block_message.block;
+      if (!_last_compact_block_source || _last_compact_block_source->block_message_hash != block_message_hash)
+      {
+        compact_block_source source;
+        source.block_message_hash = block_message_hash;
+        source.short_ids.reserve(block.transactions.size());
+        source.transaction_message_hashes.reserve(block.transactions.size());
+        for (const graphene::chain::processed_transaction& transaction : block.transactions)
+        {
+          source.short_ids.push_back(compact_block_short_id(full_block_message.block_id, transaction.id()));
+          source.transaction_message_hashes.push_back(message(trx_message(transaction)).id());
+        }
+        _last_compact_block_source = std::move(source);
+      }
+
+      compact_block_message result;
+      result.block_message_hash = block_message_hash;
+      result.block_id = full_block_message.block_id;
+      result.header = block;
+      result.transactions.resize(block.transactions.size());
+      for (uint32_t i = 0; i < block.transactions.size(); ++i)
+      {
+        // a transaction that went over this connection in either direction is in the peer's cache,
+        // anything else is sent in full
+        item_id transaction_item(trx_message_type, _last_compact_block_source->transaction_message_hashes[i]);
+        if (peer->inventory_peer_advertised_to_us.find(transaction_item) != peer->inventory_peer_advertised_to_us.end() ||
+            peer->inventory_advertised_to_peer.find(transaction_item) != peer->inventory_advertised_to_peer.end())
+        {
+          result.transactions[i].short_id = _last_compact_block_source->short_ids[i];
+          result.transactions[i].operation_results = block.transactions[i].operation_results;
+        }
+        else
+          result.prefilled_transactions.emplace_back(i, block.transactions[i]);
+      }
+      dlog("sending block ${id} to peer ${endpoint} in compact form, ${n} of ${total} transactions prefilled",
+           ("id", result.block_id)("endpoint", peer->get_remote_endpoint())
+           ("n", result.prefilled_transactions.size())("total", block.transactions.size()));
+      return result;
+    }
+
+    void node_impl::on_compact_block_message(peer_connection* originating_peer,
+                                             const compact_block_message& compact_block_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      const block_id_type& block_id = compact_block_message_received.block_id;
+      item_id requested_item(block_message_type, compact_block_message_received.block_message_hash);
+      if (originating_peer->items_requested_from_peer.find(requested_item) == originating_peer->items_requested_from_peer.end())
+      {
+        wlog("received a compact block ${block_id} I didn't ask for from peer ${endpoint}, disconnecting from peer",
+             ("endpoint", originating_peer->get_remote_endpoint())
+             ("block_id", block_id));
+        fc::exception detailed_error(FC_LOG_MESSAGE(error, "You sent me a block that I didn't ask for, block_id: ${block_id}",
+                                                    ("block_id", block_id)));
+        disconnect_from_peer(originating_peer, "You sent me a block that I didn't ask for", true, detailed_error);
+        return;
+      }
+
+      compact_block_reconstruction reconstruction;
+      try
+      {
+        reconstruction = compact_block_reconstruction(compact_block_message_received, _message_cache);
+      }
+      catch (const fc::exception& e)
+      {
+        disconnect_from_peer(originating_peer, "You sent me an invalid compact block", true, e);
+        return;
+      }
+
+      originating_peer->compact_blocks_being_reconstructed[block_id] = std::move(reconstruction);
+      finish_compact_block(originating_peer, block_id);
+    }
+
+    void node_impl::request_compact_block_transactions(peer_connection* peer,
+                                                       const compact_block_reconstruction& reconstruction)
+    {
+      VERIFY_CORRECT_THREAD();
+      fetch_compact_block_transactions_message request;
+      request.block_id = reconstruction.compact().block_id;
+      request.indexes = reconstruction.missing_indexes();
+      dlog("requesting ${n} of the ${total} transactions of compact block ${id} from peer ${endpoint}",
+           ("n", request.indexes.size())("total", reconstruction.compact().transactions.size())
+           ("id", request.block_id)("endpoint", peer->get_remote_endpoint()));
+      peer->send_message(request);
+    }
+
+    void node_impl::finish_compact_block(peer_connection* originating_peer, const block_id_type& block_id)
+    {
+      VERIFY_CORRECT_THREAD();
+      auto iter = originating_peer->compact_blocks_being_reconstructed.find(block_id);
+      if (iter == originating_peer->compact_blocks_being_reconstructed.end())
+        return;
+      compact_block_reconstruction& reconstruction = iter->second;
+      if (!reconstruction.missing_indexes().empty())
+      {
+        request_compact_block_transactions(originating_peer, reconstruction);
+        return;
+      }
+
+      fc::optional<graphene::net::block_message> full_block_message = reconstruction.finish();
+      if (!full_block_message)
+      {
+        // two transactions shared a short id and we picked the wrong one from our cache, so get every
+        // transaction that wasn't prefilled from the peer.  If the block is still wrong after that,
+        // the peer is at fault and the block is rejected like any other invalid block.
+        wlog("compact block ${id} from peer ${endpoint} did not match its merkle root, fetching all of its transactions",
+             ("id", block_id)("endpoint", originating_peer->get_remote_endpoint()));
+        request_compact_block_transactions(originating_peer, reconstruction);
+        return;
+      }
+
+      message_hash_type block_message_hash = reconstruction.compact().block_message_hash;
+      originating_peer->compact_blocks_being_reconstructed.erase(iter);
+
+      auto item_iter = originating_peer->items_requested_from_peer.find(item_id(block_message_type, block_message_hash));
+      if (item_iter == originating_peer->items_requested_from_peer.end())
+        return; // we gave up on this request while waiting for the transactions
+      originating_peer->items_requested_from_peer.erase(item_iter);
+      process_block_during_normal_operation(originating_peer, *full_block_message, block_message_hash);
+      if (originating_peer->idle())
+        trigger_fetch_items_loop();
+    }
+
+    void node_impl::on_fetch_compact_block_transactions_message(peer_connection* originating_peer,
+                                                                const fetch_compact_block_transactions_message& fetch_compact_block_transactions_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      compact_block_transactions_message reply;
+      reply.block_id = fetch_compact_block_transactions_message_received.block_id;
+      try
+      {
+        graphene::net::block_message full_block_message =
+          _delegate->get_item(item_id(block_message_type, reply.block_id)).as<graphene::net::block_message>();
+        reply.transactions.reserve(fetch_compact_block_transactions_message_received.indexes.size());
+        for (uint32_t index : fetch_compact_block_transactions_message_received.indexes)
+        {
+          if (index >= full_block_message.block.transactions.size())
+          {
+            reply.transactions.clear();
+            break;
+          }
+          reply.transactions.push_back(full_block_message.block.transactions[index]);
+        }
+      }
+      catch (fc::key_not_found_exception&)
+      {
+        // an empty reply makes the peer fetch the block from someone else
+      }
+      originating_peer->send_message(reply);
+    }
+
+    void node_impl::on_compact_block_transactions_message(peer_connection* originating_peer,
+                                                          const compact_block_transactions_message& compact_block_transactions_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      const block_id_type& block_id = compact_block_transactions_message_received.block_id;
+      auto iter = originating_peer->compact_blocks_being_reconstructed.find(block_id);
+      if (iter == originating_peer->compact_blocks_being_reconstructed.end())
+      {
+        dlog("received transactions of compact block ${id} from peer ${endpoint} that I'm not reconstructing",
+             ("id", block_id)("endpoint", originating_peer->get_remote_endpoint()));
+        return;
+      }
+      compact_block_reconstruction& reconstruction = iter->second;
+      if (!reconstruction.add_transactions(compact_block_transactions_message_received.transactions))
+      {
+        wlog("peer ${endpoint} did not send the transactions I requested for compact block ${id}",
+             ("id", block_id)("endpoint", originating_peer->get_remote_endpoint()));
+        item_id requested_item(block_message_type, reconstruction.compact().block_message_hash);
+        originating_peer->compact_blocks_being_reconstructed.erase(iter);
+        // treat it like any other item the peer turned out not to have, so it is fetched from someone else
+        on_item_not_available_message(originating_peer, item_not_available_message(requested_item));
+        return;
+      }
+
+      finish_compact_block(originating_peer, block_id);
+    }
+
     // this handles any message we get that doesn't require any special processing.
     // currently, this is any message other than block messages and p2p-specific
     // messages.  (transaction messages would be handled here, for example)
@@ -3802,13 +4129,19 @@ namespace graphene { namespace net { namespace detail {
 
         // Next: have the delegate process the message
         fc::time_point message_validated_time;
+        fc::uint160_t hash_of_message_contents;
         try
         {
           if (message_to_process.msg_type == trx_message_type)
           {
             trx_message transaction_message_to_process = message_to_process.as<trx_message>();
-            dlog("passing message containing transaction ${trx} to client", ("trx", transaction_message_to_process.trx.id()));
+            hash_of_message_contents = transaction_message_to_process.trx.id();
+            if (!admit_transaction(originating_peer, transaction_message_to_process, message_hash))
+              return;
+            dlog("passing message containing transaction ${trx} to client", ("trx", hash_of_message_contents));
             _delegate->handle_transaction(transaction_message_to_process);
+            ++originating_peer->transaction_admission.admitted;
+            ++_transaction_admission_totals.admitted;
           }
           else
             _delegate->handle_message( message_to_process );
@@ -3823,13 +4156,73 @@ namespace graphene { namespace net { namespace detail {
           wlog( "client rejected message sent by peer ${peer}, ${e}", ("peer", originating_peer->get_remote_endpoint() )("e", e) );
           // record it so we don't try to fetch this item again
           _recently_failed_items.insert(peer_connection::timestamped_item_id(item_id(message_to_process.msg_type, message_hash ), fc::time_point::now()));
+          if (message_to_process.msg_type == trx_message_type)
+          {
+            ++originating_peer->transaction_admission.failed_validation;
+            ++_transaction_admission_totals.failed_validation;
+            penalize_invalid_transaction(originating_peer, fc::time_point::now());
+          }
           return;
         }
 
         // finally, if the delegate validated the message, broadcast it to our other peers
         message_propagation_data propagation_data{message_receive_time, message_validated_time, originating_peer->node_id};
-        broadcast( message_to_process, propagation_data );
+        broadcast( message_to_process, message_hash, hash_of_message_contents, propagation_data );
+      }
+    }
+
+    // Validating a transaction is expensive, so each peer gets a budget of transactions (see token_bucket) and
+    // the delegate gets a chance to reject a transaction with cheap checks before validating it.  Returns
+    // false if the transaction should be dropped.
+    bool node_impl::admit_transaction( peer_connection* originating_peer, const trx_message& transaction_message,
+                                       const message_hash_type& message_hash )
+    {
+      VERIFY_CORRECT_THREAD();
+      const fc::time_point now = fc::time_point::now();
+      ++originating_peer->transaction_admission.received;
+      ++_transaction_admission_totals.received;
+
+      if (!originating_peer->transaction_tokens.try_consume(now))
+      {
+        dlog("peer ${peer} is sending transactions faster than we accept them, dropping ${trx}",
+             ("peer", originating_peer->get_remote_endpoint())("trx", transaction_message.trx.id()));
+        ++originating_peer->transaction_admission.rate_limited;
+        ++_transaction_admission_totals.rate_limited;
+        inhibit_transaction_fetching_until_tokens_available(originating_peer, now);
+        return false;
+      }
+
+      const transaction_precheck_result result = _delegate->precheck_transaction(transaction_message);
+      if (result == transaction_precheck_passed)
+        return true;
+
+      dlog("transaction ${trx} from peer ${peer} failed the prechecks: ${result}",
+           ("trx", transaction_message.trx.id())("peer", originating_peer->get_remote_endpoint())("result", result));
+      originating_peer->transaction_admission.count_precheck_failure(result);
+      _transaction_admission_totals.count_precheck_failure(result);
+      // only a transaction that is invalid whatever our own head is the peer's fault.  A duplicate is usually a
+      // transaction that made it into a block while we were fetching it, and a node a block or two behind the peer
+      // judges the TaPoS block and the expiration limit against an older head than the peer did
+      if (result == transaction_expired || result == transaction_oversized)
+      {
+        _recently_failed_items.insert(peer_connection::timestamped_item_id(item_id(trx_message_type, message_hash), now));
+        penalize_invalid_transaction(originating_peer, now);
       }
+      return false;
+    }
+
+    void node_impl::penalize_invalid_transaction( peer_connection* originating_peer, fc::time_point now )
+    {
+      VERIFY_CORRECT_THREAD();
+      originating_peer->transaction_tokens.charge(now, GRAPHENE_NET_INVALID_TRX_PENALTY);
+      inhibit_transaction_fetching_until_tokens_available(originating_peer, now);
+    }
+
+    void node_impl::inhibit_transaction_fetching_until_tokens_available( peer_connection* peer, fc::time_point now )
+    {
+      VERIFY_CORRECT_THREAD();
+      peer->transaction_fetching_inhibited_until = std::max(peer->transaction_fetching_inhibited_until,
+                                                            peer->transaction_tokens.when_available(now));
     }
 
     void node_impl::start_synchronizing_with_peer( const peer_connection_ptr& peer )
@@ -4408,16 +4801,35 @@ namespace graphene { namespace net { namespace detail {
       fc::path potential_peer_database_file_name(_node_configuration_directory / POTENTIAL_PEER_DATABASE_FILENAME);
       try
       {
+        const bool import_legacy_database = !fc::exists(potential_peer_database_file_name) &&
+                                            fc::exists(_node_configuration_directory / LEGACY_POTENTIAL_PEER_DATABASE_FILENAME);
         _potential_peer_db.open(potential_peer_database_file_name);
+        if (import_legacy_database)
+        {
+          fc::path legacy_file_name(_node_configuration_directory / LEGACY_POTENTIAL_PEER_DATABASE_FILENAME);
+          ilog("importing peer database ${filename}", ("filename", legacy_file_name));
+          try
+          {
+            _potential_peer_db.import_json(legacy_file_name);
+          }
+          catch (const fc::exception& except)
+          {
+            elog("unable to import peer database ${filename}, starting with a clean database: ${error}",
+                 ("filename", legacy_file_name)("error", except));
+          }
+        }
 
         // push back the time on all peers loaded from the database so we will be able to retry them immediately
+        std::vector<potential_peer_record> updated_peer_records;
+        updated_peer_records.reserve(_potential_peer_db.size());
         for (peer_database::iterator itr = _potential_peer_db.begin(); itr != _potential_peer_db.end(); ++itr)
         {
           potential_peer_record updated_peer_record = *itr;
           updated_peer_record.last_connection_attempt_time = std::min<fc::time_point_sec>(updated_peer_record.last_connection_attempt_time,
                                                                                           fc::time_point::now() - fc::seconds(_peer_connection_retry_timeout));
-          _potential_peer_db.update_entry(updated_peer_record);
+          updated_peer_records.push_back(updated_peer_record);
         }
+        _potential_peer_db.update_entries(updated_peer_records);
 
         trigger_p2p_network_connect_loop();
       }
@@ -4680,7 +5092,7 @@ namespace graphene { namespace net { namespace detail {
       ilog( "node._new_received_sync_items size: ${size}", ("size", _new_received_sync_items.size() ) );
       ilog( "node._items_to_fetch size: ${size}", ("size", _items_to_fetch.size() ) );
       ilog( "node._new_inventory size: ${size}", ("size", _new_inventory.size() ) );
-      ilog( "node._message_cache size: ${size}", ("size", _message_cache.size() ) );
+      ilog( "node._message_cache size: ${size}, ${stats}", ("size", _message_cache.size() )("stats", _message_cache.get_statistics() ) );
       for( const peer_connection_ptr& peer : _active_connections )
       {
         ilog( "  peer ${endpoint}", ("endpoint", peer->get_remote_endpoint() ) );
@@ -4852,6 +5264,22 @@ namespace graphene { namespace net { namespace detail {
       return (uint32_t)_active_connections.size();
     }
 
+    std::vector<peer_sync_statistics> node_impl::get_sync_statistics() const
+    {
+      VERIFY_CORRECT_THREAD();
+      std::vector<peer_sync_statistics> statistics;
+      statistics.reserve(_active_connections.size());
+      for (const peer_connection_ptr& peer : _active_connections)
+      {
+        peer_sync_statistics peer_statistics = peer->sync_flow.get_statistics();
+        if (peer->get_remote_endpoint())
+          peer_statistics.host = *peer->get_remote_endpoint();
+        peer_statistics.outstanding = (uint32_t)peer->sync_items_requested_from_peer.size();
+        statistics.push_back(peer_statistics);
+      }
+      return statistics;
+    }
+
     void node_impl::broadcast( const message& item_to_broadcast, const message_propagation_data& propagation_data )
     {
       VERIFY_CORRECT_THREAD();
@@ -4859,22 +5287,64 @@ namespace graphene { namespace net { namespace detail {
       if( item_to_broadcast.msg_type == graphene::net::block_message_type )
       {
         graphene::net::block_message block_message_to_broadcast = item_to_broadcast.as<graphene::net::block_message>();
-        hash_of_message_contents = block_message_to_broadcast.block_id; // for debugging
-        _most_recent_blocks_accepted.push_back( block_message_to_broadcast.block_id );
+        hash_of_message_contents = block_message_to_broadcast.block_id;
       }
       else if( item_to_broadcast.msg_type == graphene::net::trx_message_type )
       {
         graphene::net::trx_message transaction_message_to_broadcast = item_to_broadcast.as<graphene::net::trx_message>();
-        hash_of_message_contents = transaction_message_to_broadcast.trx.id(); // for debugging
+        hash_of_message_contents = transaction_message_to_broadcast.trx.id();
         dlog( "broadcasting trx: ${trx}", ("trx", transaction_message_to_broadcast) );
       }
-      message_hash_type hash_of_item_to_broadcast = item_to_broadcast.id();
+      broadcast( item_to_broadcast, item_to_broadcast.id(), hash_of_message_contents, propagation_data );
+    }
 
-      _message_cache.cache_message( item_to_broadcast, hash_of_item_to_broadcast, propagation_data, hash_of_message_contents );
-      _new_inventory.insert( item_id(item_to_broadcast.msg_type, hash_of_item_to_broadcast ) );
+    void node_impl::broadcast( message item_to_broadcast, const message_hash_type& hash_of_item_to_broadcast,
+                               const fc::uint160_t& hash_of_message_contents, const message_propagation_data& propagation_data )
+    {
+      VERIFY_CORRECT_THREAD();
+      if( item_to_broadcast.msg_type == graphene::net::block_message_type )
+        _most_recent_blocks_accepted.push_back( hash_of_message_contents );
+      const uint32_t item_type = item_to_broadcast.msg_type;
+      _message_cache.cache_message( std::move(item_to_broadcast), hash_of_item_to_broadcast, propagation_data, hash_of_message_contents );
+      _new_inventory.insert( item_id(item_type, hash_of_item_to_broadcast ) );
       trigger_advertise_inventory_loop();
     }
 
+    message_cache_statistics node_impl::get_message_cache_statistics() const
+    {
+      VERIFY_CORRECT_THREAD();
+      return _message_cache.get_statistics();
+    }
+
+    std::vector<peer_traffic_statistics> node_impl::get_peer_traffic_statistics() const
+    {
+      VERIFY_CORRECT_THREAD();
+      std::vector<peer_traffic_statistics> statistics;
+      statistics.reserve(_active_connections.size());
+      for (const peer_connection_ptr& peer : _active_connections)
+        statistics.push_back(peer->get_traffic_statistics());
+      return statistics;
+    }
+
+    transaction_admission_statistics node_impl::get_transaction_admission_statistics() const
+    {
+      VERIFY_CORRECT_THREAD();
+      transaction_admission_statistics statistics;
+      statistics.totals = _transaction_admission_totals;
+      const fc::time_point now = fc::time_point::now();
+      for (const peer_connection_ptr& peer : _active_connections)
+      {
+        peer_transaction_admission_statistics peer_statistics;
+        if (peer->get_remote_endpoint())
+          peer_statistics.host = *peer->get_remote_endpoint();
+        peer_statistics.tokens = peer->transaction_tokens.available(now);
+        peer_statistics.throttled_until = peer->transaction_fetching_inhibited_until;
+        peer_statistics.counters = peer->transaction_admission;
+        statistics.peers.push_back(peer_statistics);
+      }
+      return statistics;
+    }
+
     void node_impl::broadcast( const message& item_to_broadcast )
     {
       VERIFY_CORRECT_THREAD();
@@ -5139,6 +5609,26 @@ namespace graphene { namespace net { namespace detail {
     INVOKE_IN_IMPL(get_connection_count);
   }
 
+  std::vector<peer_sync_statistics> node::get_sync_statistics() const
+  {
+    INVOKE_IN_IMPL(get_sync_statistics);
+  }
+
+  message_cache_statistics node::get_message_cache_statistics() const
+  {
+    INVOKE_IN_IMPL(get_message_cache_statistics);
+  }
+
+  std::vector<peer_traffic_statistics> node::get_peer_traffic_statistics() const
+  {
+    INVOKE_IN_IMPL(get_peer_traffic_statistics);
+  }
+
+  transaction_admission_statistics node::get_transaction_admission_statistics() const
+  {
+    INVOKE_IN_IMPL(get_transaction_admission_statistics);
+  }
+
   void node::broadcast( const message& msg )
   {
     INVOKE_IN_IMPL(broadcast, msg);
@@ -5402,6 +5892,11 @@ namespace graphene { namespace net { namespace detail {
       INVOKE_AND_COLLECT_STATISTICS(handle_transaction, transaction_message);
     }
 
+    transaction_precheck_result statistics_gathering_node_delegate_wrapper::precheck_transaction( const graphene::net::trx_message& transaction_message )
+    {
+      INVOKE_AND_COLLECT_STATISTICS(precheck_transaction, transaction_message);
+    }
+
     std::vector<item_hash_t> statistics_gathering_node_delegate_wrapper::get_block_ids(const std::vector<item_hash_t>& blockchain_synopsis,
                                                                                        uint32_t& remaining_item_count,
                                                                                        uint32_t limit /* = 2000 */)
@@ -5414,6 +5909,11 @@ namespace graphene { namespace net { namespace detail {
       INVOKE_AND_COLLECT_STATISTICS(get_item, id);
     }
 
+    std::vector<message> statistics_gathering_node_delegate_wrapper::get_blocks( const std::vector<item_hash_t>& block_ids, uint64_t max_total_size )
+    {
+      INVOKE_AND_COLLECT_STATISTICS(get_blocks, block_ids, max_total_size);
+    }
+
     chain_id_type statistics_gathering_node_delegate_wrapper::get_chain_id() const
     {
       INVOKE_AND_COLLECT_STATISTICS(get_chain_id);
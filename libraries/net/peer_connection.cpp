@@ -42,24 +42,33 @@
 
 namespace graphene { namespace net
   {
-    message peer_connection::real_queued_message::get_message(peer_connection_delegate*)
+    shared_message peer_connection::real_queued_message::get_message(peer_connection_delegate*)
     {
       if (message_send_time_field_offset != (size_t)-1)
       {
         // patch the current time into the message.  Since this operates on the packed version of the structure,
         // it won't work for anything after a variable-length field
         std::vector<char> packed_current_time = fc::raw::pack(fc::time_point::now());
-        assert(message_send_time_field_offset + packed_current_time.size() <= message_to_send.data.size());
-        memcpy(message_to_send.data.data() + message_send_time_field_offset,
+        assert(message_send_time_field_offset + packed_current_time.size() <= message_to_send->data.size());
+        memcpy(message_to_send->data.data() + message_send_time_field_offset,
                packed_current_time.data(), packed_current_time.size());
       }
       return message_to_send;
     }
     size_t peer_connection::real_queued_message::get_size_in_queue()
     {
-      return message_to_send.data.size();
+      return message_to_send->data.size();
     }
-    message peer_connection::virtual_queued_message::get_message(peer_connection_delegate* node)
+    shared_message peer_connection::shared_queued_message::get_message(peer_connection_delegate*)
+    {
+      return message_to_send;
+    }
+    size_t peer_connection::shared_queued_message::get_size_in_queue()
+    {
+      // the memory is shared, but the queue limit is about how far behind this peer is, so count it in full
+      return message_to_send->data.size();
+    }
+    shared_message peer_connection::virtual_queued_message::get_message(peer_connection_delegate* node)
     {
       return node->get_message_for_item(item_to_send);
     }
@@ -73,6 +82,8 @@ namespace graphene { namespace net
       _node(delegate),
       _message_connection(this),
       _total_queued_messages_size(0),
+      _total_queued_messages_count(0),
+      _queued_messages_size(),
       direction(peer_connection_direction::unknown),
       is_firewalled(firewalled_state::unknown),
       our_state(our_connection_state::disconnected),
@@ -265,6 +276,9 @@ namespace graphene { namespace net
     void peer_connection::on_message( message_oriented_connection* originating_connection, const message& received_message )
     {
       VERIFY_CORRECT_THREAD();
+      message_type_traffic& traffic = _traffic_by_message_type[received_message.msg_type];
+      ++traffic.messages_received;
+      traffic.bytes_received += sizeof(message_header) + received_message.data.size();
       _node->on_message( this, received_message );
     }
 
@@ -285,16 +299,22 @@ namespace graphene { namespace net
         ~counter() { assert(_send_message_queue_tasks_counter == 1); --_send_message_queue_tasks_counter; /* dlog("leaving peer_connection::send_queued_messages_task()"); */ }
       } concurrent_invocation_counter(_send_message_queue_tasks_running);
 #endif
-      while (!_queued_messages.empty())
+      while (_total_queued_messages_count > 0)
       {
-        _queued_messages.front()->transmission_start_time = fc::time_point::now();
-        message message_to_send = _queued_messages.front()->get_message(_node);
+        send_scheduler::queue_lengths queue_lengths;
+        for (unsigned i = 0; i < message_priority_count; ++i)
+          queue_lengths[i] = _queued_messages[i].size();
+        const message_priority priority = _send_scheduler.next(queue_lengths);
+        queued_message_queue& queue = _queued_messages[priority];
+
+        queue.front()->transmission_start_time = fc::time_point::now();
+        shared_message message_to_send = queue.front()->get_message(_node);
         try
         {
           //dlog("peer_connection::send_queued_messages_task() calling message_oriented_connection::send_message() "
           //     "to send message of type ${type} for peer ${endpoint}",
           //     ("type", message_to_send.msg_type)("endpoint", get_remote_endpoint()));
-          _message_connection.send_message(message_to_send);
+          _message_connection.send_message(*message_to_send);
           //dlog("peer_connection::send_queued_messages_task()'s call to message_oriented_connection::send_message() completed normally for peer ${endpoint}",
           //     ("endpoint", get_remote_endpoint()));
         }
@@ -324,18 +344,32 @@ namespace graphene { namespace net
         {
           elog("message_oriented_exception::send_message() threw an unhandled exception");
         }
-        _queued_messages.front()->transmission_finish_time = fc::time_point::now();
-        _total_queued_messages_size -= _queued_messages.front()->get_size_in_queue();
-        _queued_messages.pop();
+        const size_t bytes_sent = sizeof(message_header) + message_to_send->data.size();
+        _send_scheduler.on_sent(priority, bytes_sent);
+        message_type_traffic& traffic = _traffic_by_message_type[message_to_send->msg_type];
+        ++traffic.messages_sent;
+        traffic.bytes_sent += bytes_sent;
+        ++_send_queue_statistics[priority].messages_sent;
+        _send_queue_statistics[priority].bytes_sent += bytes_sent;
+
+        queue.front()->transmission_finish_time = fc::time_point::now();
+        const size_t size_in_queue = queue.front()->get_size_in_queue();
+        _total_queued_messages_size -= size_in_queue;
+        _queued_messages_size[priority] -= size_in_queue;
+        --_total_queued_messages_count;
+        queue.pop();
       }
       //dlog("leaving peer_connection::send_queued_messages_task() due to queue exhaustion");
     }
 
-    void peer_connection::send_queueable_message(std::unique_ptr<queued_message>&& message_to_send)
+    void peer_connection::send_queueable_message(std::unique_ptr<queued_message>&& message_to_send, message_priority priority)
     {
       VERIFY_CORRECT_THREAD();
-      _total_queued_messages_size += message_to_send->get_size_in_queue();
-      _queued_messages.emplace(std::move(message_to_send));
+      const size_t size_in_queue = message_to_send->get_size_in_queue();
+      _total_queued_messages_size += size_in_queue;
+      _queued_messages_size[priority] += size_in_queue;
+      ++_total_queued_messages_count;
+      _queued_messages[priority].emplace(std::move(message_to_send));
       if (_total_queued_messages_size > GRAPHENE_NET_MAXIMUM_QUEUED_MESSAGES_IN_BYTES)
       {
         elog("send queue exceeded maximum size of ${max} bytes (current size ${current} bytes)",
@@ -369,7 +403,15 @@ namespace graphene { namespace net
       //dlog("peer_connection::send_message() enqueueing message of type ${type} for peer ${endpoint}",
       //     ("type", message_to_send.msg_type)("endpoint", get_remote_endpoint()));
       std::unique_ptr<queued_message> message_to_enqueue(new real_queued_message(message_to_send, message_send_time_field_offset));
-      send_queueable_message(std::move(message_to_enqueue));
+      send_queueable_message(std::move(message_to_enqueue), message_priority_of(message_to_send.msg_type));
+    }
+
+    void peer_connection::send_shared_message(shared_message message_to_send)
+    {
+      VERIFY_CORRECT_THREAD();
+      const message_priority priority = message_priority_of(message_to_send->msg_type);
+      std::unique_ptr<queued_message> message_to_enqueue(new shared_queued_message(std::move(message_to_send)));
+      send_queueable_message(std::move(message_to_enqueue), priority);
     }
 
     void peer_connection::send_item(const item_id& item_to_send)
@@ -378,7 +420,7 @@ namespace graphene { namespace net
       //dlog("peer_connection::send_item() enqueueing message of type ${type} for peer ${endpoint}",
       //     ("type", item_to_send.item_type)("endpoint", get_remote_endpoint()));
       std::unique_ptr<queued_message> message_to_enqueue(new virtual_queued_message(item_to_send));
-      send_queueable_message(std::move(message_to_enqueue));
+      send_queueable_message(std::move(message_to_enqueue), message_priority_of(item_to_send.item_type));
     }
 
     void peer_connection::close_connection()
@@ -421,6 +463,31 @@ namespace graphene { namespace net
       return _message_connection.get_last_message_received_time();
     }
 
+    peer_traffic_statistics peer_connection::get_traffic_statistics() const
+    {
+      VERIFY_CORRECT_THREAD();
+      peer_traffic_statistics statistics;
+      if (_remote_endpoint)
+        statistics.host = *_remote_endpoint;
+      statistics.total_bytes_sent = _message_connection.get_total_bytes_sent();
+      statistics.total_bytes_received = _message_connection.get_total_bytes_received();
+      statistics.message_types.reserve(_traffic_by_message_type.size());
+      for (const auto& type_and_traffic : _traffic_by_message_type)
+      {
+        statistics.message_types.push_back(type_and_traffic.second);
+        statistics.message_types.back().message_type = type_and_traffic.first;
+      }
+      for (unsigned i = 0; i < message_priority_count; ++i)
+      {
+        send_queue_statistics queue_statistics = _send_queue_statistics[i];
+        queue_statistics.priority = message_priority(i);
+        queue_statistics.queued_messages = (uint32_t)_queued_messages[i].size();
+        queue_statistics.queued_bytes = _queued_messages_size[i];
+        statistics.send_queues.push_back(queue_statistics);
+      }
+      return statistics;
+    }
+
     fc::optional<fc::ip::endpoint> peer_connection::get_remote_endpoint()
     {
       VERIFY_CORRECT_THREAD();
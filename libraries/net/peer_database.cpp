@@ -27,13 +27,18 @@
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/mem_fun.hpp>
 #include <boost/multi_index/tag.hpp>
+#include <boost/multi_index/global_fun.hpp>
 
 #include <fc/io/raw.hpp>
 #include <fc/io/raw_variant.hpp>
+#include <fc/io/fstream.hpp>
 #include <fc/log/logger.hpp>
 #include <fc/io/json.hpp>
 
 #include <graphene/net/peer_database.hpp>
+#include <graphene/net/config.hpp>
+
+#include <fstream>
 
 
 
@@ -42,11 +47,31 @@ namespace graphene { namespace net {
   {
     using namespace boost::multi_index;
 
+    /**
+     *  The database file starts with peer_database_magic, followed by a log of changes, each one an operation
+     *  byte, the size of the packed payload and the payload: a potential_peer_record for upsert_record, an
+     *  endpoint for erase_record.
+     */
+    static const char peer_database_magic[8] = { 'G', 'P', 'E', 'E', 'R', 'D', 'B', '1' };
+    enum peer_log_operation : uint8_t
+    {
+      upsert_record = 1,
+      erase_record = 2
+    };
+
+    /** records are evicted lowest first: when they were last seen, set back for each net failure to connect */
+    int64_t peer_eviction_key(const potential_peer_record& record)
+    {
+      const int64_t net_failures = int64_t(record.number_of_failed_connection_attempts) - record.number_of_successful_connection_attempts;
+      return int64_t(record.last_seen_time.sec_since_epoch()) - std::max<int64_t>(net_failures, 0) * GRAPHENE_NET_PEER_DATABASE_FAILURE_PENALTY_SEC;
+    }
+
     class peer_database_impl
     {
     public:
       struct last_seen_time_index {};
       struct endpoint_index {};
+      struct eviction_index {};
       typedef boost::multi_index_container<potential_peer_record, 
                                            indexed_by<ordered_non_unique<tag<last_seen_time_index>, 
                                                                          member<potential_peer_record, 
@@ -56,11 +81,24 @@ namespace graphene { namespace net {
                                                                     member<potential_peer_record, 
                                                                            fc::ip::endpoint, 
                                                                            &potential_peer_record::endpoint>, 
-                                                                    std::hash<fc::ip::endpoint> > > > potential_peer_set;
+                                                                    std::hash<fc::ip::endpoint> >,
+                                                      ordered_non_unique<tag<eviction_index>,
+                                                                         global_fun<const potential_peer_record&,
+                                                                                    int64_t,
+                                                                                    &peer_eviction_key> > > > potential_peer_set;
 
     private:
       potential_peer_set     _potential_peer_set;
       fc::path _peer_database_filename;
+      std::ofstream _log;
+      size_t _log_records = 0; /// records in the log, including the ones later changes have superseded
+
+      static void write_log_record(std::ostream& stream, peer_log_operation operation, const std::vector<char>& payload);
+      void append_to_log(peer_log_operation operation, const std::vector<char>& payload);
+      void read_log();
+      void write_snapshot();
+      /// applies a change to the records, returning the endpoint evicted to make room for a new one, if any
+      fc::optional<fc::ip::endpoint> store_entry(const potential_peer_record& updatedRecord);
 
     public:
       void open(const fc::path& databaseFilename);
@@ -68,8 +106,11 @@ namespace graphene { namespace net {
       void clear();
       void erase(const fc::ip::endpoint& endpointToErase);
       void update_entry(const potential_peer_record& updatedRecord);
+      void update_entries(const std::vector<potential_peer_record>& updatedRecords);
       potential_peer_record lookup_or_create_entry_for_endpoint(const fc::ip::endpoint& endpointToLookup);
       fc::optional<potential_peer_record> lookup_entry_for_endpoint(const fc::ip::endpoint& endpointToLookup);
+      void import_json(const fc::path& jsonFilename);
+      void export_json(const fc::path& jsonFilename) const;
 
       peer_database::iterator begin() const;
       peer_database::iterator end() const;
@@ -88,72 +129,227 @@ namespace graphene { namespace net {
     peer_database_iterator::peer_database_iterator( const peer_database_iterator& c ) :
       boost::iterator_facade<peer_database_iterator, const potential_peer_record, boost::forward_traversal_tag>(c){}
 
-    void peer_database_impl::open(const fc::path& peer_database_filename)
+    void peer_database_impl::write_log_record(std::ostream& stream, peer_log_operation operation, const std::vector<char>& payload)
     {
-      _peer_database_filename = peer_database_filename;
-      if (fc::exists(_peer_database_filename))
+      const uint32_t payload_size = (uint32_t)payload.size();
+      stream.put((char)operation);
+      stream.write((const char*)&payload_size, sizeof(payload_size));
+      stream.write(payload.data(), payload.size());
+    }
+
+    void peer_database_impl::append_to_log(peer_log_operation operation, const std::vector<char>& payload)
+    {
+      if (!_log.is_open())
+        return;
+      write_log_record(_log, operation, payload);
+      // a change is only as safe as what reached the file, keep nothing buffered for a crash to lose
+      _log.flush();
+      ++_log_records;
+      if (_log_records > _potential_peer_set.size() + GRAPHENE_NET_PEER_DATABASE_COMPACTION_SLACK)
       {
         try
         {
-          std::vector<potential_peer_record> peer_records = fc::json::from_file(_peer_database_filename).as<std::vector<potential_peer_record> >();
-          std::copy(peer_records.begin(), peer_records.end(), std::inserter(_potential_peer_set, _potential_peer_set.end()));
-#define MAXIMUM_PEERDB_SIZE 1000
-          if (_potential_peer_set.size() > MAXIMUM_PEERDB_SIZE)
-          {
-            // prune database to a reasonable size
-            auto iter = _potential_peer_set.begin();
-            std::advance(iter, MAXIMUM_PEERDB_SIZE);
-            _potential_peer_set.erase(iter, _potential_peer_set.end());
-          }
+          write_snapshot();
         }
         catch (const fc::exception& e)
         {
-          elog("error opening peer database file ${peer_database_filename}, starting with a clean database", 
-               ("peer_database_filename", _peer_database_filename));
+          elog("error compacting peer database ${peer_database_filename}: ${e}",
+               ("peer_database_filename", _peer_database_filename)("e", e));
         }
       }
     }
 
-    void peer_database_impl::close()
+    void peer_database_impl::read_log()
     {
-      std::vector<potential_peer_record> peer_records;
-      peer_records.reserve(_potential_peer_set.size());
-      std::copy(_potential_peer_set.begin(), _potential_peer_set.end(), std::back_inserter(peer_records));
+      std::string contents;
+      fc::read_file_contents(_peer_database_filename, contents);
+      FC_ASSERT(contents.size() >= sizeof(peer_database_magic) &&
+                memcmp(contents.data(), peer_database_magic, sizeof(peer_database_magic)) == 0,
+                "not a peer database");
+
+      // the log ends at the last complete record, a change being appended when the node stopped is lost
+      fc::datastream<const char*> stream(contents.data() + sizeof(peer_database_magic), contents.size() - sizeof(peer_database_magic));
+      while (stream.remaining() >= sizeof(uint8_t) + sizeof(uint32_t))
+      {
+        uint8_t operation;
+        uint32_t payload_size;
+        fc::raw::unpack(stream, operation);
+        fc::raw::unpack(stream, payload_size);
+        if (stream.remaining() < payload_size)
+          break;
+        fc::datastream<const char*> payload(stream.pos(), payload_size);
+        stream.skip(payload_size);
+        if (operation == upsert_record)
+        {
+          potential_peer_record record;
+          fc::raw::unpack(payload, record);
+          store_entry(record);
+        }
+        else if (operation == erase_record)
+        {
+          fc::ip::endpoint endpoint;
+          fc::raw::unpack(payload, endpoint);
+          _potential_peer_set.get<endpoint_index>().erase(endpoint);
+        }
+      }
+    }
+
+    void peer_database_impl::write_snapshot()
+    {
+      _log.close();
+      fc::path peer_database_filename_dir = _peer_database_filename.parent_path();
+      if (!fc::exists(peer_database_filename_dir))
+        fc::create_directories(peer_database_filename_dir);
 
+      const fc::path temporary_filename(_peer_database_filename.generic_string() + ".tmp");
+      {
+        std::ofstream snapshot(temporary_filename.generic_string().c_str(), std::ios::binary | std::ios::trunc);
+        snapshot.write(peer_database_magic, sizeof(peer_database_magic));
+        for (const potential_peer_record& record : _potential_peer_set)
+          write_log_record(snapshot, upsert_record, fc::raw::pack(record));
+        snapshot.close();
+        FC_ASSERT(snapshot, "unable to write ${filename}", ("filename", temporary_filename));
+      }
+      fc::rename(temporary_filename, _peer_database_filename);
+
+      _log.open(_peer_database_filename.generic_string().c_str(), std::ios::binary | std::ios::app);
+      _log_records = _potential_peer_set.size();
+    }
+
+    void peer_database_impl::open(const fc::path& peer_database_filename)
+    {
+      _log.close();
+      _potential_peer_set.clear();
+      _peer_database_filename = peer_database_filename;
+      if (fc::exists(_peer_database_filename))
+      {
+        try
+        {
+          read_log();
+        }
+        catch (const fc::exception& e)
+        {
+          elog("error reading peer database file ${peer_database_filename}, keeping the ${count} peers read before the error: ${e}", 
+               ("peer_database_filename", _peer_database_filename)("count", _potential_peer_set.size())("e", e));
+        }
+      }
       try
       {
-        fc::path peer_database_filename_dir = _peer_database_filename.parent_path();
-        if (!fc::exists(peer_database_filename_dir))
-          fc::create_directories(peer_database_filename_dir);
-        fc::json::save_to_file(peer_records, _peer_database_filename);
+        write_snapshot();
       }
       catch (const fc::exception& e)
       {
-        elog("error saving peer database to file ${peer_database_filename}", 
-             ("peer_database_filename", _peer_database_filename));
+        elog("error writing peer database file ${peer_database_filename}, changes will not be saved: ${e}",
+             ("peer_database_filename", _peer_database_filename)("e", e));
+      }
+    }
+
+    void peer_database_impl::close()
+    {
+      if (!_peer_database_filename.generic_string().empty())
+      {
+        try
+        {
+          write_snapshot();
+        }
+        catch (const fc::exception& e)
+        {
+          elog("error saving peer database to file ${peer_database_filename}: ${e}", 
+               ("peer_database_filename", _peer_database_filename)("e", e));
+        }
       }
+      _log.close();
       _potential_peer_set.clear();
+      _peer_database_filename = fc::path();
     }
 
     void peer_database_impl::clear()
     {
       _potential_peer_set.clear();
+      if (_log.is_open())
+      {
+        try
+        {
+          write_snapshot();
+        }
+        catch (const fc::exception& e)
+        {
+          elog("error clearing peer database file ${peer_database_filename}: ${e}",
+               ("peer_database_filename", _peer_database_filename)("e", e));
+        }
+      }
+    }
+
+    void peer_database_impl::import_json(const fc::path& json_filename)
+    {
+      update_entries(fc::json::from_file(json_filename).as<std::vector<potential_peer_record> >());
+    }
+
+    void peer_database_impl::export_json(const fc::path& json_filename) const
+    {
+      std::vector<potential_peer_record> peer_records;
+      peer_records.reserve(_potential_peer_set.size());
+      std::copy(_potential_peer_set.begin(), _potential_peer_set.end(), std::back_inserter(peer_records));
+      fc::json::save_to_file(peer_records, json_filename);
     }
 
     void peer_database_impl::erase(const fc::ip::endpoint& endpointToErase)
     {
       auto iter = _potential_peer_set.get<endpoint_index>().find(endpointToErase);
       if (iter != _potential_peer_set.get<endpoint_index>().end())
+      {
         _potential_peer_set.get<endpoint_index>().erase(iter);
+        append_to_log(erase_record, fc::raw::pack(endpointToErase));
+      }
     }
 
-    void peer_database_impl::update_entry(const potential_peer_record& updatedRecord)
+    fc::optional<fc::ip::endpoint> peer_database_impl::store_entry(const potential_peer_record& updatedRecord)
     {
       auto iter = _potential_peer_set.get<endpoint_index>().find(updatedRecord.endpoint);
       if (iter != _potential_peer_set.get<endpoint_index>().end())
+      {
         _potential_peer_set.get<endpoint_index>().modify(iter, [&updatedRecord](potential_peer_record& record) { record = updatedRecord; });
-      else
-        _potential_peer_set.get<endpoint_index>().insert(updatedRecord);
+        return fc::optional<fc::ip::endpoint>();
+      }
+
+      // make room before inserting, so a record that has not been seen yet is not itself the one evicted
+      fc::optional<fc::ip::endpoint> evicted;
+      if (_potential_peer_set.size() >= GRAPHENE_NET_MAXIMUM_PEER_DATABASE_SIZE)
+      {
+        auto eviction_candidate = _potential_peer_set.get<eviction_index>().begin();
+        evicted = eviction_candidate->endpoint;
+        _potential_peer_set.get<eviction_index>().erase(eviction_candidate);
+      }
+      _potential_peer_set.get<endpoint_index>().insert(updatedRecord);
+      return evicted;
+    }
+
+    void peer_database_impl::update_entry(const potential_peer_record& updatedRecord)
+    {
+      fc::optional<fc::ip::endpoint> evicted = store_entry(updatedRecord);
+      if (evicted)
+        append_to_log(erase_record, fc::raw::pack(*evicted));
+      append_to_log(upsert_record, fc::raw::pack(updatedRecord));
+    }
+
+    void peer_database_impl::update_entries(const std::vector<potential_peer_record>& updatedRecords)
+    {
+      if (updatedRecords.empty())
+        return;
+      for (const potential_peer_record& record : updatedRecords)
+        store_entry(record);
+      if (_log.is_open())
+      {
+        try
+        {
+          write_snapshot();
+        }
+        catch (const fc::exception& e)
+        {
+          elog("error saving peer database to file ${peer_database_filename}: ${e}",
+               ("peer_database_filename", _peer_database_filename)("e", e));
+        }
+      }
     }
 
     potential_peer_record peer_database_impl::lookup_or_create_entry_for_endpoint(const fc::ip::endpoint& endpointToLookup)
@@ -240,6 +436,16 @@ namespace graphene { namespace net {
     my->clear();
   }
 
+  void peer_database::import_json(const fc::path& jsonFilename)
+  {
+    my->import_json(jsonFilename);
+  }
+
+  void peer_database::export_json(const fc::path& jsonFilename) const
+  {
+    my->export_json(jsonFilename);
+  }
+
   void peer_database::erase(const fc::ip::endpoint& endpointToErase)
   {
     my->erase(endpointToErase);
@@ -250,6 +456,11 @@ namespace graphene { namespace net {
     my->update_entry(updatedRecord);
   }
 
+  void peer_database::update_entries(const std::vector<potential_peer_record>& updatedRecords)
+  {
+    my->update_entries(updatedRecords);
+  }
+
   potential_peer_record peer_database::lookup_or_create_entry_for_endpoint(const fc::ip::endpoint& endpointToLookup)
   {
     return my->lookup_or_create_entry_for_endpoint(endpointToLookup);
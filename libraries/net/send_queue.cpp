@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/net/send_queue.hpp>
+#include <graphene/net/core_messages.hpp>
+
+#include <algorithm>
+
+namespace graphene { namespace net {
+
+  message_priority message_priority_of( uint32_t msg_type )
+  {
+    switch( msg_type )
+    {
+      case block_message_type:
+      case compact_block_message_type:
+      case compact_block_transactions_message_type:
+        return block_priority;
+      case item_ids_inventory_message_type:
+      case blockchain_item_ids_inventory_message_type:
+        return item_ids_priority;
+      case trx_message_type:
+        return transaction_priority;
+      default:
+        if( msg_type > core_message_type_first && msg_type < core_message_type_last )
+          return control_priority;
+        return transaction_priority;
+    }
+  }
+
+  uint32_t send_scheduler::weight( message_priority priority )
+  {
+    switch( priority )
+    {
+      case block_priority:
+        return GRAPHENE_NET_BLOCK_SEND_WEIGHT;
+      case item_ids_priority:
+        return GRAPHENE_NET_ITEM_IDS_SEND_WEIGHT;
+      case transaction_priority:
+        return GRAPHENE_NET_TRANSACTION_SEND_WEIGHT;
+      default:
+        return 0;
+    }
+  }
+
+  message_priority send_scheduler::next( const queue_lengths& queued_messages )
+  {
+    if( queued_messages[control_priority] ||
+        std::all_of( queued_messages.begin() + 1, queued_messages.end(), []( size_t length ) { return length == 0; } ) )
+      return control_priority;
+
+    for( ;; )
+    {
+      const message_priority priority = message_priority( _current );
+      if( queued_messages[priority] == 0 )
+        // an idle queue doesn't bank allowance for later, but keeps any debt
+        _allowance[priority] = std::min<int64_t>( _allowance[priority], 0 );
+      else if( _allowance[priority] > 0 )
+        return priority;
+      else
+        _allowance[priority] += int64_t( weight( priority ) ) * GRAPHENE_NET_SEND_QUANTUM_IN_BYTES;
+      _current = _current + 1 < message_priority_count ? _current + 1 : uint32_t( block_priority );
+    }
+  }
+
+  void send_scheduler::on_sent( message_priority priority, size_t bytes )
+  {
+    if( priority != control_priority )
+      _allowance[priority] -= int64_t( bytes );
+  }
+
+} } // graphene::net
@@ -36,10 +36,14 @@
 
 namespace graphene { namespace net {
 
+const size_t stcp_socket::max_read_buffer_size;
+
 stcp_socket::stcp_socket()
 //:_buf_len(0)
+   : _read_buffer_size(0),
+     _write_buffer_size(0)
 #ifndef NDEBUG
-   : _read_buffer_in_use(false),
+   , _read_buffer_in_use(false),
      _write_buffer_in_use(false)
 #endif
 {
@@ -53,12 +57,14 @@ void stcp_socket::do_key_exchange()
   _priv_key = fc::ecc::private_key::generate();
   fc::ecc::public_key pub = _priv_key.get_public_key();
   fc::ecc::public_key_data s = pub.serialize();
+  _local_public_key = s;
   std::shared_ptr<char> serialized_key_buffer(new char[sizeof(fc::ecc::public_key_data)], [](char* p){ delete[] p; });
   memcpy(serialized_key_buffer.get(), (char*)&s, sizeof(fc::ecc::public_key_data));
   _sock.write( serialized_key_buffer, sizeof(fc::ecc::public_key_data) );
   _sock.read( serialized_key_buffer, sizeof(fc::ecc::public_key_data) );
   fc::ecc::public_key_data rpub;
   memcpy((char*)&rpub, serialized_key_buffer.get(), sizeof(fc::ecc::public_key_data));
+  _remote_public_key = rpub;
 
   _shared_secret = _priv_key.get_shared_secret( rpub );
 //    ilog("shared secret ${s}", ("s", shared_secret) );
@@ -69,6 +75,32 @@ void stcp_socket::do_key_exchange()
 }
 
 
+void stcp_socket::derive_ctr_key( const fc::ecc::public_key_data& sender, fc::sha256& key, fc::uint128& init_value )const
+{
+  fc::sha512::encoder enc;
+  enc.write( (const char*)&_shared_secret, sizeof(_shared_secret) );
+  enc.write( (const char*)&sender, sizeof(sender) );
+  const fc::sha512 direction_secret = enc.result();
+  key = fc::sha256::hash( (const char*)&direction_secret, sizeof(direction_secret) );
+  init_value = fc::city_hash_crc_128( (const char*)&direction_secret, sizeof(direction_secret) );
+}
+
+void stcp_socket::use_aes_ctr_for_sending()
+{
+  fc::sha256 key;
+  fc::uint128 init_value;
+  derive_ctr_key( _local_public_key, key, init_value );
+  _send_aes.init( key, init_value, fc::aes_mode::ctr );
+}
+
+void stcp_socket::use_aes_ctr_for_receiving()
+{
+  fc::sha256 key;
+  fc::uint128 init_value;
+  derive_ctr_key( _remote_public_key, key, init_value );
+  _recv_aes.init( key, init_value, fc::aes_mode::ctr );
+}
+
 void stcp_socket::connect_to( const fc::ip::endpoint& remote_endpoint )
 {
   _sock.connect_to( remote_endpoint );
@@ -82,8 +114,13 @@ void stcp_socket::bind( const fc::ip::endpoint& local_endpoint )
 
 /**
  *   This method must read at least 16 bytes at a time from
- *   the underlying TCP socket so that it can decrypt them. It
- *   will buffer any left-over.
+ *   the underlying TCP socket so that it can decrypt them.
+ *   The ciphertext lands in a per-connection buffer that the
+ *   socket owns (so a canceled read never writes into freed
+ *   memory) and is decrypted straight into the caller's buffer.
+ *   The buffer grows with the reads requested of it, up to
+ *   max_read_buffer_size, so large messages are received in a
+ *   few big reads instead of many 4 KiB ones.
  */
 size_t stcp_socket::readsome( char* buffer, size_t len )
 { try {
@@ -91,8 +128,7 @@ size_t stcp_socket::readsome( char* buffer, size_t len )
 
 #ifndef NDEBUG
     // This code was written with the assumption that you'd only be making one call to readsome 
-    // at a time so it reuses _read_buffer.  If you really need to make concurrent calls to 
-    // readsome(), you'll need to prevent reusing _read_buffer here
+    // at a time, concurrent reads would interleave the decryption stream
     struct check_buffer_in_use {
       bool& _buffer_in_use;
       check_buffer_in_use(bool& buffer_in_use) : _buffer_in_use(buffer_in_use) { assert(!_buffer_in_use); _buffer_in_use = true; }
@@ -100,11 +136,12 @@ size_t stcp_socket::readsome( char* buffer, size_t len )
     } buffer_in_use_checker(_read_buffer_in_use);
 #endif
 
-    const size_t read_buffer_length = 4096;
-    if (!_read_buffer)
-      _read_buffer.reset(new char[read_buffer_length], [](char* p){ delete[] p; });
-
-    len = std::min<size_t>(read_buffer_length, len);
+    if( len > _read_buffer_size && _read_buffer_size < max_read_buffer_size )
+    {
+      _read_buffer_size = std::min( len, max_read_buffer_size );
+      _read_buffer.reset(new char[_read_buffer_size], [](char* p){ delete[] p; });
+    }
+    len = std::min(_read_buffer_size, len);
 
     size_t s = _sock.readsome( _read_buffer, len, 0 );
     if( s % 16 ) 
@@ -127,13 +164,18 @@ bool stcp_socket::eof()const
 }
 
 size_t stcp_socket::writesome( const char* buffer, size_t len )
-{ try {
+{
     assert( len > 0 && (len % 16) == 0 );
+    const buffer_region region( buffer, len );
+    return write_regions( &region, 1 );
+}
 
+size_t stcp_socket::write_regions( const buffer_region* regions, size_t count )
+{ try {
 #ifndef NDEBUG
-    // This code was written with the assumption that you'd only be making one call to writesome
+    // This code was written with the assumption that you'd only be making one call to write_regions
     // at a time so it reuses _write_buffer.  If you really need to make concurrent calls to 
-    // writesome(), you'll need to prevent reusing _write_buffer here
+    // write_regions(), you'll need to prevent reusing _write_buffer here
     struct check_buffer_in_use {
       bool& _buffer_in_use;
       check_buffer_in_use(bool& buffer_in_use) : _buffer_in_use(buffer_in_use) { assert(!_buffer_in_use); _buffer_in_use = true; }
@@ -141,22 +183,64 @@ size_t stcp_socket::writesome( const char* buffer, size_t len )
     } buffer_in_use_checker(_write_buffer_in_use);
 #endif
 
-    const std::size_t write_buffer_length = 4096;
-    if (!_write_buffer)
-      _write_buffer.reset(new char[write_buffer_length], [](char* p){ delete[] p; });
-    len = std::min<size_t>(write_buffer_length, len);
-    memset(_write_buffer.get(), 0, len); // just in case aes.encode screws up
-    /**
-     * every sizeof(crypt_buf) bytes the aes channel
-     * has an error and doesn't decrypt properly...  disable
-     * for now because we are going to upgrade to something
-     * better.
-     */
-    uint32_t ciphertext_len = _send_aes.encode( buffer, len, _write_buffer.get() );
-    assert(ciphertext_len == len);
-    _sock.write( _write_buffer, ciphertext_len );
-    return ciphertext_len;
-} FC_RETHROW_EXCEPTIONS( warn, "", ("len",len) ) }
+    size_t len = 0;
+    for( size_t i = 0; i < count; ++i )
+      len += regions[i].second;
+    const size_t len_with_padding = 16 * ((len + 15) / 16);
+    if( len_with_padding == 0 )
+      return 0;
+
+    // The buffer grows to the largest message sent on this connection and is kept for the next one.
+    // A write that was canceled may still hold a reference to the old buffer, so it is replaced rather
+    // than resized in place.
+    if( len_with_padding > _write_buffer_size )
+    {
+      _write_buffer.reset(new char[len_with_padding], [](char* p){ delete[] p; });
+      _write_buffer_size = len_with_padding;
+    }
+
+    // The AES stream runs over whole blocks, so only blocks that straddle a region boundary and the
+    // final padded block are staged through a 16 byte block, everything else is encrypted straight
+    // from the caller's memory into _write_buffer.
+    char* out = _write_buffer.get();
+    char block[16];
+    size_t block_len = 0;
+    for( size_t i = 0; i < count; ++i )
+    {
+      const char* in = regions[i].first;
+      size_t remaining = regions[i].second;
+      if( block_len > 0 )
+      {
+        const size_t n = std::min( remaining, sizeof(block) - block_len );
+        memcpy( block + block_len, in, n );
+        block_len += n;
+        in += n;
+        remaining -= n;
+        if( block_len < sizeof(block) )
+          continue;
+        out += _send_aes.encode( block, sizeof(block), out );
+        block_len = 0;
+      }
+      const size_t whole_blocks = remaining & ~size_t(15);
+      if( whole_blocks > 0 )
+      {
+        out += _send_aes.encode( in, whole_blocks, out );
+        in += whole_blocks;
+        remaining -= whole_blocks;
+      }
+      memcpy( block, in, remaining );
+      block_len = remaining;
+    }
+    if( block_len > 0 )
+    {
+      memset( block + block_len, 0, sizeof(block) - block_len );
+      out += _send_aes.encode( block, sizeof(block), out );
+    }
+    assert( size_t(out - _write_buffer.get()) == len_with_padding );
+
+    _sock.write( _write_buffer, len_with_padding );
+    return len_with_padding;
+} FC_RETHROW_EXCEPTIONS( warn, "", ("count",count) ) }
 
 size_t stcp_socket::writesome( const std::shared_ptr<const char>& buf, size_t len, size_t offset )
 {
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/net/sync_window.hpp>
+#include <graphene/net/config.hpp>
+
+#include <algorithm>
+
+namespace graphene { namespace net {
+
+  sync_window::sync_window( uint32_t maximum_window )
+  {
+    set_maximum_window( maximum_window );
+    _statistics.window = std::min<uint32_t>( _maximum_window, GRAPHENE_NET_INITIAL_BLOCKS_PER_PEER_DURING_SYNCING );
+    _statistics.stall_timeout = stall_timeout();
+  }
+
+  void sync_window::set_maximum_window( uint32_t maximum_window )
+  {
+    _maximum_window = std::max<uint32_t>( maximum_window, GRAPHENE_NET_MIN_BLOCKS_PER_PEER_DURING_SYNCING );
+    _statistics.window = std::min( _statistics.window, _maximum_window );
+  }
+
+  uint32_t sync_window::available( size_t outstanding )const
+  {
+    return outstanding < _statistics.window ? _statistics.window - uint32_t( outstanding ) : 0;
+  }
+
+  void sync_window::on_request( size_t outstanding_before, fc::time_point now )
+  {
+    // delivery intervals only count time in which the peer had something to deliver
+    if( outstanding_before == 0 )
+      _busy_since = now;
+  }
+
+  void sync_window::on_block_received( fc::time_point requested, fc::time_point now, uint64_t bytes )
+  {
+    const bool first = _statistics.blocks_received == 0;
+    ++_statistics.blocks_received;
+    _statistics.bytes_received += bytes;
+
+    // smoothed round trip time and its mean deviation, with the gains TCP uses (RFC 6298)
+    const fc::microseconds sample = std::max( now - requested, fc::microseconds( 0 ) );
+    if( first )
+    {
+      _statistics.round_trip_time = sample;
+      _round_trip_deviation = fc::microseconds( sample.count() / 2 );
+    }
+    else
+    {
+      const int64_t delta = sample.count() - _statistics.round_trip_time.count();
+      _round_trip_deviation += fc::microseconds( ( std::abs( delta ) - _round_trip_deviation.count() ) / 4 );
+      _statistics.round_trip_time += fc::microseconds( delta / 8 );
+    }
+    _minimum_round_trip_time = std::min( _minimum_round_trip_time, sample );
+
+    // the delivery rate is the inverse of the smoothed gap between blocks
+    const fc::microseconds interval = std::max( now - std::max( _last_delivery, _busy_since ), fc::microseconds( 1 ) );
+    if( first )
+      _average_delivery_interval = interval;
+    else
+      _average_delivery_interval += fc::microseconds( ( interval.count() - _average_delivery_interval.count() ) / 8 );
+    _average_delivery_interval = std::max( _average_delivery_interval, fc::microseconds( 1 ) );
+    _statistics.blocks_per_second = 1000000.0 / _average_delivery_interval.count();
+    _last_delivery = now;
+
+    update_window();
+  }
+
+  void sync_window::on_stall( uint32_t count )
+  {
+    _statistics.blocks_rerequested += count;
+    _statistics.window = std::max<uint32_t>( _statistics.window / 2, GRAPHENE_NET_MIN_BLOCKS_PER_PEER_DURING_SYNCING );
+  }
+
+  fc::microseconds sync_window::stall_timeout()const
+  {
+    const fc::microseconds minimum = fc::milliseconds( GRAPHENE_NET_MIN_SYNC_STALL_TIMEOUT_MS );
+    if( _statistics.blocks_received == 0 )
+      return std::max( minimum, fc::milliseconds( 2 * GRAPHENE_NET_SYNC_TARGET_LATENCY_MS ) );
+    return std::max( minimum, _statistics.round_trip_time + fc::microseconds( 4 * _round_trip_deviation.count() ) );
+  }
+
+  void sync_window::update_window()
+  {
+    const double horizon_seconds = ( GRAPHENE_NET_SYNC_TARGET_LATENCY_MS * 1000 + _minimum_round_trip_time.count() ) / 1000000.0;
+    const double target = std::min<double>( _statistics.blocks_per_second * horizon_seconds, _maximum_window );
+    // never grow faster than one block per block received, so a burst of deliveries cannot open the window at once
+    _statistics.window = std::min( uint32_t( target ), _statistics.window + 1 );
+    _statistics.window = std::max<uint32_t>( _statistics.window, GRAPHENE_NET_MIN_BLOCKS_PER_PEER_DURING_SYNCING );
+    _statistics.window = std::min( _statistics.window, _maximum_window );
+    _statistics.stall_timeout = stall_timeout();
+  }
+
+} } // graphene::net
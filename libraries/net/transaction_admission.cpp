@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/net/transaction_admission.hpp>
+
+#include <algorithm>
+
+namespace graphene { namespace net {
+
+  void transaction_admission_counters::count_precheck_failure( transaction_precheck_result result )
+  {
+    switch( result )
+    {
+      case transaction_precheck_passed:
+        break;
+      case transaction_duplicate:
+        ++duplicate;
+        break;
+      case transaction_expired:
+        ++expired;
+        break;
+      case transaction_expiration_too_far:
+        ++expiration_too_far;
+        break;
+      case transaction_oversized:
+        ++oversized;
+        break;
+      case transaction_unknown_tapos_block:
+        ++unknown_tapos_block;
+        break;
+    }
+  }
+
+  token_bucket::token_bucket( double tokens_per_second, double capacity )
+    : _tokens_per_second( tokens_per_second ),
+      _capacity( capacity ),
+      _tokens( capacity ),
+      _last_refill( fc::time_point::min() )
+  {
+  }
+
+  void token_bucket::refill( fc::time_point now )
+  {
+    if( _last_refill != fc::time_point::min() && now > _last_refill )
+      _tokens = std::min( _capacity, _tokens + ( now - _last_refill ).count() * _tokens_per_second / 1000000 );
+    _last_refill = std::max( _last_refill, now );
+  }
+
+  bool token_bucket::try_consume( fc::time_point now, double count )
+  {
+    refill( now );
+    if( _tokens < count )
+      return false;
+    _tokens -= count;
+    return true;
+  }
+
+  void token_bucket::charge( fc::time_point now, double count )
+  {
+    refill( now );
+    _tokens = std::max( -_capacity, _tokens - count );
+  }
+
+  double token_bucket::available( fc::time_point now )
+  {
+    refill( now );
+    return _tokens;
+  }
+
+  fc::time_point token_bucket::when_available( fc::time_point now, double count )
+  {
+    refill( now );
+    // tokens may have been taken at a later time than the one asked about
+    const fc::time_point from = std::max( now, _last_refill );
+    if( _tokens >= count || _tokens_per_second <= 0 )
+      return from;
+    return from + fc::microseconds( int64_t( ( count - _tokens ) * 1000000 / _tokens_per_second ) + 1 );
+  }
+
+} } // graphene::net
@@ -106,7 +106,35 @@ struct order_history_object : public abstract_object<order_history_object>
   fill_order_operation op;
 };
 
+/**
+ *  Rolling 24 hour summary of a single market, kept up to date as fills are applied so that tickers can be
+ *  served without walking the trade history.  The market is always stored with base < quote.
+ */
+struct market_ticker_object : public abstract_object<market_ticker_object>
+{
+   static const uint8_t space_id = ACCOUNT_HISTORY_SPACE_ID;
+   static const uint8_t type_id  = 3; // market_history_plugin type, referenced from account_history_plugin.hpp
+
+   price latest()const { return asset( latest_base, base ) / asset( latest_quote, quote ); }
+   price open()const { return asset( open_base, base ) / asset( open_quote, quote ); }
+
+   asset_id_type       base;
+   asset_id_type       quote;
+   share_type          latest_base;
+   share_type          latest_quote;
+   /** the last trade that has dropped out of the 24 hour window, zero if there was none */
+   share_type          open_base;
+   share_type          open_quote;
+   share_type          base_volume;
+   share_type          quote_volume;
+   /** history sequence of the oldest trade still inside the window, or of the next trade if the window is empty */
+   int64_t             oldest_sequence = 0;
+   fc::time_point_sec  oldest_time = fc::time_point_sec::maximum();
+};
+
 struct by_key;
+struct by_market;
+struct by_oldest_time;
 typedef multi_index_container<
    bucket_object,
    indexed_by<
@@ -123,9 +151,24 @@ typedef multi_index_container<
    >
 > order_history_multi_index_type;
 
+typedef multi_index_container<
+   market_ticker_object,
+   indexed_by<
+      hashed_unique< tag<by_id>, member< object, object_id_type, &object::id > >,
+      ordered_unique< tag<by_market>,
+         composite_key< market_ticker_object,
+            member< market_ticker_object, asset_id_type, &market_ticker_object::base >,
+            member< market_ticker_object, asset_id_type, &market_ticker_object::quote >
+         >
+      >,
+      ordered_non_unique< tag<by_oldest_time>, member< market_ticker_object, fc::time_point_sec, &market_ticker_object::oldest_time > >
+   >
+> market_ticker_multi_index_type;
+
 
 typedef generic_index<bucket_object, bucket_object_multi_index_type> bucket_index;
 typedef generic_index<order_history_object, order_history_multi_index_type> history_index;
+typedef generic_index<market_ticker_object, market_ticker_multi_index_type> market_ticker_index;
 
 
 namespace detail
@@ -136,7 +179,8 @@ namespace detail
 /**
  *  The market history plugin can be configured to track any number of intervals via its configuration.  Once per block it
  *  will scan the virtual operations and look for fill_order_operations and then adjust the appropriate bucket objects for
- *  each fill order.
+ *  each fill order.  It also keeps a rolling 24 hour ticker per market, adding fills as they happen and retiring
+ *  them once they fall out of the window.
  */
 class market_history_plugin : public graphene::app::plugin
 {
@@ -172,4 +216,9 @@ FC_REFLECT_DERIVED( graphene::market_history::bucket_object, (graphene::db::obje
                     (open_base)(open_quote)
                     (close_base)(close_quote)
                     (base_volume)(quote_volume) )
-
+FC_REFLECT_DERIVED( graphene::market_history::market_ticker_object, (graphene::db::object),
+                    (base)(quote)
+                    (latest_base)(latest_quote)
+                    (open_base)(open_quote)
+                    (base_volume)(quote_volume)
+                    (oldest_sequence)(oldest_time) )
@@ -53,6 +53,9 @@ class market_history_plugin_impl
        */
       void update_market_histories( const signed_block& b );
 
+      /** retires trades that have dropped out of the rolling 24 hour ticker window */
+      void expire_ticker_window( fc::time_point_sec now );
+
       graphene::chain::database& database()
       {
          return _self.database();
@@ -78,6 +81,35 @@ struct operation_process_fill_order
    template<typename T>
    void operator()( const T& )const{}
 
+   /**
+    *  Adds a fill to the rolling ticker of its market.  Both fill operations of a match are recorded in the history,
+    *  but only the one paying the lower asset id counts towards volume and price.
+    */
+   void update_ticker( database& db, const history_key& hkey, fc::time_point_sec time, const fill_order_operation& o )const
+   {
+      const auto& ticker_idx = db.get_index_type<market_ticker_index>().indices().get<by_market>();
+      auto itr = ticker_idx.find( boost::make_tuple( hkey.base, hkey.quote ) );
+      if( itr == ticker_idx.end() )
+         itr = ticker_idx.iterator_to( db.create<market_ticker_object>( [&]( market_ticker_object& t ) {
+            t.base = hkey.base;
+            t.quote = hkey.quote;
+            t.oldest_sequence = hkey.sequence;
+         }));
+
+      const bool counted = o.pays.asset_id < o.receives.asset_id;
+      db.modify( *itr, [&]( market_ticker_object& t ) {
+         if( t.oldest_time == fc::time_point_sec::maximum() )
+            t.oldest_time = time;
+         if( counted )
+         {
+            t.base_volume += o.pays.amount;
+            t.quote_volume += o.receives.amount;
+            t.latest_base = o.pays.amount;
+            t.latest_quote = o.receives.amount;
+         }
+      });
+   }
+
    void operator()( const fill_order_operation& o )const 
    {
       //ilog( "processing ${o}", ("o",o) );
@@ -108,6 +140,8 @@ struct operation_process_fill_order
          ho.op = o;
       });
 
+      update_ticker( db, hkey, time, o );
+
       hkey.sequence += 200;
       itr = history_idx.lower_bound( hkey );
       /*
@@ -216,8 +250,8 @@ market_history_plugin_impl::~market_history_plugin_impl()
 
 void market_history_plugin_impl::update_market_histories( const signed_block& b )
 {
+   // trade history and tickers are kept even when no buckets are tracked
    if( _maximum_history_per_bucket_size == 0 ) return;
-   if( _tracked_buckets.size() == 0 ) return;
 
    graphene::chain::database& db = database();
    const vector<optional< operation_history_object > >& hist = db.get_applied_operations();
@@ -226,6 +260,50 @@ void market_history_plugin_impl::update_market_histories( const signed_block& b
       if( o_op.valid() )
          o_op->op.visit( operation_process_fill_order( _self, b.timestamp ) );
    }
+
+   expire_ticker_window( b.timestamp );
+}
+
+void market_history_plugin_impl::expire_ticker_window( fc::time_point_sec now )
+{
+   if( now.sec_since_epoch() < 86400 ) return;
+   const fc::time_point_sec cutoff( now.sec_since_epoch() - 86400 );
+
+   graphene::chain::database& db = database();
+   const auto& ticker_idx = db.get_index_type<market_ticker_index>().indices().get<by_oldest_time>();
+   const auto& history_idx = db.get_index_type<history_index>().indices().get<by_key>();
+
+   // History sequences count down as trades are added, so the next newer trade of a market is always sequence - 1.
+   auto ticker_itr = ticker_idx.begin();
+   while( ticker_itr != ticker_idx.end() && ticker_itr->oldest_time < cutoff )
+   {
+      const market_ticker_object& ticker = *ticker_itr;
+      ++ticker_itr;
+
+      db.modify( ticker, [&]( market_ticker_object& t ) {
+         history_key hkey;
+         hkey.base = t.base;
+         hkey.quote = t.quote;
+         hkey.sequence = t.oldest_sequence;
+
+         auto itr = history_idx.find( hkey );
+         while( itr != history_idx.end() && itr->time < cutoff )
+         {
+            if( itr->op.pays.asset_id < itr->op.receives.asset_id )
+            {
+               t.base_volume -= itr->op.pays.amount;
+               t.quote_volume -= itr->op.receives.amount;
+               t.open_base = itr->op.pays.amount;
+               t.open_quote = itr->op.receives.amount;
+            }
+            --hkey.sequence;
+            itr = history_idx.find( hkey );
+         }
+
+         t.oldest_sequence = hkey.sequence;
+         t.oldest_time = itr == history_idx.end() ? fc::time_point_sec::maximum() : itr->time;
+      });
+   }
 }
 
 } // end namespace detail
@@ -268,6 +346,7 @@ void market_history_plugin::plugin_initialize(const boost::program_options::vari
    database().applied_block.connect( [&]( const signed_block& b){ my->update_market_histories(b); } );
    database().add_index< primary_index< bucket_index  > >();
    database().add_index< primary_index< history_index  > >();
+   database().add_index< primary_index< market_ticker_index  > >();
 
    if( options.count( "bucket-size" ) )
    {
@@ -71,7 +71,8 @@ void witness_plugin::plugin_set_program_options(
          ("required-participation", bpo::bool_switch()->notifier([this](int e){_required_witness_participation = uint32_t(e*GRAPHENE_1_PERCENT);}), "Percent of witnesses (0-99) that must be participating in order to produce blocks")
          ("witness-id,w", bpo::value<vector<string>>()->composing()->multitoken(),
           ("ID of witness controlled by this node (e.g. " + witness_id_example + ", quotes are required, may specify multiple times)").c_str())
-         ("private-key", bpo::value<vector<string>>()->composing()->multitoken(), ("Tuple of [PublicKey, WIF private key] (may specify multiple times)"));
+         ("private-key", bpo::value<vector<string>>()->composing()->multitoken(), ("Tuple of [PublicKey, WIF private key] (may specify multiple times)"))
+         ("block-preassembly", bpo::value<bool>()->default_value(false), "Keep the next block assembled as transactions arrive, so producing it only needs signing (experimental)");
 /*       ("private-key", bpo::value<vector<string>>()->composing()->multitoken()->
           DEFAULT_VALUE_VECTOR(std::make_pair(chain::public_key_type(default_priv_key.get_public_key()), graphene::utilities::key_to_wif(default_priv_key))),
           "Tuple of [PublicKey, WIF private key] (may specify multiple times)")
@@ -90,6 +91,8 @@ void witness_plugin::plugin_initialize(const boost::program_options::variables_m
    ilog("witness plugin:  plugin_initialize() begin");
    _options = &options;
    LOAD_VALUE_SET(options, "witness-id", _witnesses, chain::witness_id_type)
+   if( options.count("block-preassembly") )
+      _block_preassembly = options["block-preassembly"].as<bool>();
 
    if( options.count("private-key") )
    {
@@ -134,6 +137,7 @@ void witness_plugin::plugin_startup()
             new_chain_banner(d);
          _production_skip_flags |= graphene::chain::database::skip_undo_history_check;
       }
+      d.set_block_preassembly( _block_preassembly );
       schedule_production_loop();
    } else
       elog("No witnesses configured! Please add witness IDs and private keys to configuration.");
@@ -279,6 +283,7 @@ block_production_condition::block_production_condition_enum witness_plugin::mayb
       return block_production_condition::lag;
    }
 
+   const bool preassembled = db.has_preassembled_block( _production_skip_flags );
    auto block = db.generate_block(
       scheduled_time,
       scheduled_witness,
@@ -286,6 +291,8 @@ block_production_condition::block_production_condition_enum witness_plugin::mayb
       _production_skip_flags
       );
    capture("n", block.block_num())("t", block.timestamp)("c", now);
+   if( preassembled )
+      dlog( "Block #${n} was preassembled with ${x} transactions", ("n", block.block_num())("x", block.transactions.size()) );
    fc::async( [this,block](){ p2p_node().broadcast(net::block_message(block)); } );
 
    return block_production_condition::produced;
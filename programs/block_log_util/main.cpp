@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <graphene/chain/block_database.hpp>
+#include <graphene/chain/config.hpp>
+#include <graphene/chain/protocol/fee_schedule.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/smart_ref_impl.hpp>
+#include <fc/time.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include <iostream>
+
+using namespace graphene::chain;
+namespace bpo = boost::program_options;
+
+/// reads every block in order and returns the average time per block in microseconds
+static double sequential_read_time( const block_database& blocks, uint32_t last_block_num )
+{
+   const auto start = fc::time_point::now();
+   for( uint32_t num = 1; num <= last_block_num; ++num )
+      blocks.fetch_by_number( num );
+   return double( ( fc::time_point::now() - start ).count() ) / std::max( last_block_num, 1u );
+}
+
+int main( int argc, char** argv )
+{
+   try
+   {
+      bpo::options_description cli_options("Convert a block log between uncompressed and chunked storage");
+      cli_options.add_options()
+            ("help,h", "Print this help message and exit.")
+            ("from,f", bpo::value<boost::filesystem::path>(), "Block database directory to read (data_dir/database/block_num_to_block)")
+            ("to,t", bpo::value<boost::filesystem::path>(), "Empty directory to write the converted block database to")
+            ("chunk-size,c", bpo::value<uint32_t>()->default_value(GRAPHENE_DEFAULT_BLOCK_LOG_CHUNK_SIZE),
+             "Blocks per compressed chunk, 0 to write an uncompressed block database")
+            ;
+
+      bpo::variables_map options;
+      try
+      {
+         bpo::store( bpo::parse_command_line(argc, argv, cli_options), options );
+      }
+      catch (const bpo::error& e)
+      {
+         std::cerr << "block_log_util:  error parsing command line: " << e.what() << "\n";
+         return 1;
+      }
+
+      if( options.count("help") || !options.count("from") || !options.count("to") )
+      {
+         std::cout << cli_options << "\n";
+         return 1;
+      }
+
+      const fc::path from = options["from"].as<boost::filesystem::path>();
+      const fc::path to = options["to"].as<boost::filesystem::path>();
+      if( !fc::exists( from / "index" ) )
+      {
+         std::cerr << "No block database in " << from.preferred_string() << "\n";
+         return 1;
+      }
+      if( fc::exists( to / "index" ) )
+      {
+         std::cerr << "Refusing to overwrite the block database in " << to.preferred_string() << "\n";
+         return 1;
+      }
+
+      block_database source;
+      source.open( from );
+      block_database target;
+      target.set_chunk_size( options["chunk-size"].as<uint32_t>() );
+      target.open( to );
+
+      const optional<block_id_type> last_id = source.last_id();
+      const uint32_t last_block_num = last_id.valid() ? block_header::num_from_id( *last_id ) : 0;
+      const auto start = fc::time_point::now();
+      for( uint32_t num = 1; num <= last_block_num; ++num )
+      {
+         const optional<signed_block> block = source.fetch_by_number( num );
+         if( !block.valid() )
+            continue;
+         target.store( block->id(), *block );
+         target.compress_until( num );
+         if( num % 100000 == 0 )
+            std::cerr << "block_log_util:  converted " << num << " of " << last_block_num << " blocks\n";
+      }
+      target.flush();
+      std::cerr << "block_log_util:  converted " << last_block_num << " blocks in "
+                << ( fc::time_point::now() - start ).count() / 1000000 << " s\n";
+
+      std::cout << "size before:  " << fc::directory_size( from ) << " bytes, "
+                << sequential_read_time( source, last_block_num ) << " us per block read\n";
+      std::cout << "size after:   " << fc::directory_size( to ) << " bytes, "
+                << sequential_read_time( target, last_block_num ) << " us per block read\n";
+   }
+   catch ( const fc::exception& e )
+   {
+      std::cout << e.to_detail_string() << "\n";
+      return 1;
+   }
+   return 0;
+}
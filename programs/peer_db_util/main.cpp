@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <graphene/net/peer_database.hpp>
+
+#include <fc/filesystem.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include <iostream>
+
+using namespace graphene::net;
+namespace bpo = boost::program_options;
+
+int main( int argc, char** argv )
+{
+   try
+   {
+      bpo::options_description cli_options("Convert a p2p peer database (data_dir/p2p/peers.dat) to and from JSON");
+      cli_options.add_options()
+            ("help,h", "Print this help message and exit.")
+            ("database,d", bpo::value<boost::filesystem::path>(), "Peer database to read or update")
+            ("export,e", bpo::value<boost::filesystem::path>(), "Write the peers in the database to this JSON file")
+            ("import,i", bpo::value<boost::filesystem::path>(), "Add the peers in this JSON file, such as a peers.json of an older node, to the database")
+            ;
+
+      bpo::variables_map options;
+      try
+      {
+         bpo::store( bpo::parse_command_line(argc, argv, cli_options), options );
+      }
+      catch (const bpo::error& e)
+      {
+         std::cerr << "peer_db_util:  error parsing command line: " << e.what() << "\n";
+         return 1;
+      }
+
+      if( options.count("help") || !options.count("database") || options.count("export") == options.count("import") )
+      {
+         std::cout << cli_options << "\n";
+         return 1;
+      }
+
+      const fc::path database_file = options["database"].as<boost::filesystem::path>();
+      if( options.count("export") && !fc::exists( database_file ) )
+      {
+         std::cerr << "No peer database at " << database_file.preferred_string() << "\n";
+         return 1;
+      }
+
+      peer_database database;
+      database.open( database_file );
+      if( options.count("import") )
+      {
+         database.import_json( options["import"].as<boost::filesystem::path>() );
+         std::cerr << "peer_db_util:  database now holds " << database.size() << " peers\n";
+      }
+      else
+      {
+         database.export_json( options["export"].as<boost::filesystem::path>() );
+         std::cerr << "peer_db_util:  exported " << database.size() << " peers\n";
+      }
+      database.close();
+   }
+   catch ( const fc::exception& e )
+   {
+      std::cout << e.to_detail_string() << "\n";
+      return 1;
+   }
+   return 0;
+}
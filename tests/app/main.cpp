@@ -21,6 +21,7 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  * THE SOFTWARE.
  */
+#include <graphene/app/api.hpp>
 #include <graphene/app/application.hpp>
 #include <graphene/app/plugin.hpp>
 
@@ -28,18 +29,42 @@
 
 #include <graphene/utilities/tempdir.hpp>
 
+#include <graphene/net/compact_block.hpp>
+#include <graphene/net/config.hpp>
+#include <graphene/net/message_cache.hpp>
+#include <graphene/net/message_oriented_connection.hpp>
+#include <graphene/net/node.hpp>
+#include <graphene/net/peer_database.hpp>
+#include <graphene/net/send_queue.hpp>
+#include <graphene/net/sync_window.hpp>
+#include <graphene/net/transaction_admission.hpp>
+
 #include <graphene/account_history/account_history_plugin.hpp>
 
+#include <fc/io/fstream.hpp>
+#include <fc/io/json.hpp>
 #include <fc/thread/thread.hpp>
 #include <fc/smart_ref_impl.hpp>
 
 #include <boost/filesystem/path.hpp>
+#include <boost/range/adaptor/reversed.hpp>
+
+#include <atomic>
+#include <deque>
+#include <fstream>
+#include <sstream>
 
 #define BOOST_TEST_MODULE Test Application
 #include <boost/test/included/unit_test.hpp>
 
 using namespace graphene;
 
+// hack:  import create_example_genesis() even though it's a way, way
+// specific internal detail
+namespace graphene { namespace app { namespace detail {
+graphene::chain::genesis_state_type create_example_genesis();
+} } } // graphene::app::detail
+
 BOOST_AUTO_TEST_CASE( two_node_network )
 {
    using namespace graphene::chain;
@@ -150,3 +175,726 @@ BOOST_AUTO_TEST_CASE( two_node_network )
       throw;
    }
 }
+
+/**
+ * Connects two nodes over a simulated link and checks that a block takes at least the link's latency to cross it.
+ */
+BOOST_AUTO_TEST_CASE( simulated_link_delays_messages )
+{
+   using namespace graphene::chain;
+   try {
+      const fc::microseconds latency = fc::milliseconds( 300 );
+      // each node asks from its own thread
+      std::atomic<uint32_t> links( 0 );
+      graphene::net::message_oriented_connection::set_link_model(
+         [&]( const fc::ip::endpoint&, const fc::ip::endpoint& ) {
+            ++links;
+            graphene::net::link_model link;
+            link.latency = latency;
+            link.bytes_per_second = 1000000;
+            return fc::optional<graphene::net::link_model>( link );
+         } );
+
+      fc::temp_directory app_dir( graphene::utilities::temp_directory_path() );
+      fc::temp_directory app2_dir( graphene::utilities::temp_directory_path() );
+
+      graphene::app::application app1;
+      boost::program_options::variables_map cfg;
+      cfg.emplace( "p2p-endpoint", boost::program_options::variable_value( string( "127.0.0.1:4747" ), false ) );
+      cfg.emplace( "seed-nodes", boost::program_options::variable_value( std::string( "[]" ), false ) );
+      app1.initialize( app_dir.path(), cfg );
+
+      graphene::app::application app2;
+      auto cfg2 = cfg;
+      cfg2.erase( "p2p-endpoint" );
+      cfg2.emplace( "p2p-endpoint", boost::program_options::variable_value( string( "127.0.0.1:4848" ), false ) );
+      cfg2.emplace( "seed-node", boost::program_options::variable_value( vector<string>{ "127.0.0.1:4747" }, false ) );
+      app2.initialize( app2_dir.path(), cfg2 );
+
+      app1.startup();
+      app2.startup();
+      // the handshake takes a few crossings of the link
+      fc::time_point deadline = fc::time_point::now() + fc::seconds( 10 );
+      while( app1.p2p_node()->get_connection_count() == 0 && fc::time_point::now() < deadline )
+         fc::usleep( fc::milliseconds( 50 ) );
+      BOOST_REQUIRE_EQUAL( app1.p2p_node()->get_connection_count(), 1 );
+      BOOST_CHECK_GE( links.load(), 2u );
+
+      std::shared_ptr<database> db1 = app1.chain_database();
+      fc::ecc::private_key nathan_key = fc::ecc::private_key::regenerate( fc::sha256::hash( string( "nathan" ) ) );
+      const fc::time_point sent = fc::time_point::now();
+      auto block = db1->generate_block( db1->get_slot_time( 1 ), db1->get_scheduled_witness( 1 ), nathan_key, database::skip_nothing );
+      app1.p2p_node()->broadcast( graphene::net::block_message( block ) );
+
+      deadline = fc::time_point::now() + fc::seconds( 10 );
+      while( app2.chain_database()->head_block_num() == 0 && fc::time_point::now() < deadline )
+         fc::usleep( fc::milliseconds( 10 ) );
+      BOOST_REQUIRE_EQUAL( app2.chain_database()->head_block_num(), 1u );
+      BOOST_CHECK_GE( ( fc::time_point::now() - sent ).count(), latency.count() );
+
+      graphene::net::message_oriented_connection::set_link_model( graphene::net::link_model_function() );
+   } catch( fc::exception& e ) {
+      graphene::net::message_oriented_connection::set_link_model( graphene::net::link_model_function() );
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+/**
+ * Drives the sync windows of a fast and a slow peer in virtual time.  Each simulated peer
+ * answers the requests it is sent one at a time, taking service_time per block after a
+ * fixed network delay, the way a peer limited by its upload bandwidth would.
+ */
+BOOST_AUTO_TEST_CASE( adaptive_sync_windows )
+{
+   using graphene::net::sync_window;
+
+   struct simulated_peer
+   {
+      fc::microseconds           delay;
+      fc::microseconds           service_time;
+      sync_window                flow;
+      std::deque<fc::time_point> requests;
+      fc::time_point             last_delivery;
+
+      simulated_peer( fc::microseconds delay, fc::microseconds service_time )
+         : delay( delay ), service_time( service_time ) {}
+
+      fc::time_point next_delivery()const
+      {
+         return std::max( requests.front() + delay, last_delivery + service_time );
+      }
+   };
+
+   simulated_peer fast( fc::milliseconds(50), fc::milliseconds(10) );
+   simulated_peer slow( fc::milliseconds(50), fc::milliseconds(500) );
+   const uint32_t maximum_window = fast.flow.get_statistics().window * 5;
+   fast.flow.set_maximum_window( maximum_window );
+   slow.flow.set_maximum_window( maximum_window );
+
+   fc::time_point now = fc::time_point::now();
+   const fc::time_point end = now + fc::seconds(60);
+   while( now < end )
+   {
+      for( simulated_peer* peer : { &fast, &slow } )
+         for( uint32_t i = peer->flow.available( peer->requests.size() ); i > 0; --i )
+         {
+            peer->flow.on_request( peer->requests.size(), now );
+            peer->requests.push_back( now );
+         }
+
+      simulated_peer& next = fast.next_delivery() <= slow.next_delivery() ? fast : slow;
+      now = next.next_delivery();
+      next.flow.on_block_received( next.requests.front(), now, 1000 );
+      next.requests.pop_front();
+      next.last_delivery = now;
+
+      // a window never has more requests outstanding than it allows
+      BOOST_CHECK_LE( fast.requests.size(), maximum_window );
+      BOOST_CHECK_LE( slow.requests.size(), maximum_window );
+   }
+
+   const graphene::net::peer_sync_statistics fast_statistics = fast.flow.get_statistics();
+   const graphene::net::peer_sync_statistics slow_statistics = slow.flow.get_statistics();
+   BOOST_TEST_MESSAGE( "fast peer: window " << fast_statistics.window << ", " << fast_statistics.blocks_per_second << " blocks/s" );
+   BOOST_TEST_MESSAGE( "slow peer: window " << slow_statistics.window << ", " << slow_statistics.blocks_per_second << " blocks/s" );
+
+   // the fast peer is asked for as much as it is allowed, the slow one only for what it delivers within the target latency
+   BOOST_CHECK_EQUAL( fast_statistics.window, maximum_window );
+   BOOST_CHECK_LT( slow_statistics.window, 10u );
+   BOOST_CHECK_GT( fast_statistics.blocks_per_second, 20 * slow_statistics.blocks_per_second );
+   BOOST_CHECK_GT( fast_statistics.blocks_received, 20 * slow_statistics.blocks_received );
+
+   // the slow peer's queue makes its round trips long, so it is given longer before a block counts as stalled
+   BOOST_CHECK( slow.flow.stall_timeout() > fast.flow.stall_timeout() );
+
+   // blocks moved to another peer shrink the window and are counted
+   fast.flow.on_stall( 3 );
+   BOOST_CHECK_EQUAL( fast.flow.get_statistics().window, maximum_window / 2 );
+   BOOST_CHECK_EQUAL( fast.flow.get_statistics().blocks_rerequested, 3u );
+   slow.flow.on_stall( 1 );
+   slow.flow.on_stall( 1 );
+   BOOST_CHECK_EQUAL( slow.flow.get_statistics().window, uint32_t(GRAPHENE_NET_MIN_BLOCKS_PER_PEER_DURING_SYNCING) );
+}
+
+/**
+ * Serves the blocks of another node's chain database to the p2p network, but only after sitting on
+ * every block request for a while, like a peer too loaded to keep up with a syncing node.
+ */
+class stalling_peer_delegate : public graphene::net::node_delegate
+{
+public:
+   stalling_peer_delegate( std::shared_ptr<graphene::chain::database> db, fc::microseconds delay )
+      : _db( db ), _delay( delay ) {}
+
+   virtual bool has_item( const graphene::net::item_id& id ) override
+   {
+      return id.item_type == graphene::net::block_message_type && _db->is_known_block( id.item_hash );
+   }
+   virtual bool handle_block( const graphene::net::block_message& blk_msg, bool sync_mode,
+                              std::vector<fc::uint160_t>& contained_transaction_message_ids ) override
+   {
+      return false;
+   }
+   virtual void handle_transaction( const graphene::net::trx_message& trx_msg ) override {}
+   virtual graphene::net::transaction_precheck_result precheck_transaction( const graphene::net::trx_message& trx_msg ) override
+   {
+      return graphene::net::transaction_duplicate;
+   }
+   virtual void handle_message( const graphene::net::message& message_to_process ) override {}
+
+   virtual std::vector<graphene::net::item_hash_t> get_block_ids( const std::vector<graphene::net::item_hash_t>& blockchain_synopsis,
+                                                                  uint32_t& remaining_item_count, uint32_t limit ) override
+   {
+      uint32_t first_block_num = 1;
+      for( const graphene::net::item_hash_t& block_id : boost::adaptors::reverse( blockchain_synopsis ) )
+         if( _db->is_known_block( block_id ) )
+         {
+            first_block_num = graphene::chain::block_header::num_from_id( block_id );
+            break;
+         }
+      const uint32_t count = std::min( limit, _db->head_block_num() - first_block_num + 1 );
+      remaining_item_count = _db->head_block_num() - first_block_num + 1 - count;
+      const std::vector<graphene::chain::block_id_type> ids = _db->get_block_ids_for_nums( first_block_num, count );
+      return std::vector<graphene::net::item_hash_t>( ids.begin(), ids.end() );
+   }
+   virtual graphene::net::message get_item( const graphene::net::item_id& id ) override
+   {
+      fc::usleep( _delay );
+      return graphene::net::block_message( *_db->fetch_block_by_id( id.item_hash ) );
+   }
+   virtual std::vector<graphene::net::message> get_blocks( const std::vector<graphene::net::item_hash_t>& block_ids,
+                                                           uint64_t max_total_size ) override
+   {
+      fc::usleep( _delay );
+      std::vector<graphene::net::message> blocks;
+      for( const graphene::net::item_hash_t& block_id : block_ids )
+         blocks.push_back( graphene::net::block_message( *_db->fetch_block_by_id( block_id ) ) );
+      return blocks;
+   }
+
+   virtual graphene::chain::chain_id_type get_chain_id()const override { return _db->get_chain_id(); }
+   virtual std::vector<graphene::net::item_hash_t> get_blockchain_synopsis( const graphene::net::item_hash_t& reference_point,
+                                                                            uint32_t number_of_blocks_after_reference_point ) override
+   {
+      // exponentially spaced back from the head, like the application's synopsis
+      std::vector<graphene::net::item_hash_t> synopsis;
+      for( uint32_t distance = 0; distance < _db->head_block_num(); distance = distance * 2 + 1 )
+         synopsis.insert( synopsis.begin(), _db->get_block_id_for_num( _db->head_block_num() - distance ) );
+      return synopsis;
+   }
+   virtual void sync_status( uint32_t item_type, uint32_t item_count ) override {}
+   virtual void connection_count_changed( uint32_t c ) override {}
+   virtual uint32_t get_block_number( const graphene::net::item_hash_t& block_id ) override
+   {
+      return graphene::chain::block_header::num_from_id( block_id );
+   }
+   virtual fc::time_point_sec get_block_time( const graphene::net::item_hash_t& block_id ) override
+   {
+      auto block = _db->fetch_block_by_id( block_id );
+      return block.valid() ? block->timestamp : fc::time_point_sec::min();
+   }
+   virtual graphene::net::item_hash_t get_head_block_id()const override { return _db->head_block_id(); }
+   virtual uint32_t estimate_last_known_fork_from_git_revision_timestamp( uint32_t unix_timestamp )const override { return 0; }
+   virtual void error_encountered( const std::string& message, const fc::oexception& error ) override {}
+   virtual uint8_t get_current_block_interval_in_seconds()const override
+   {
+      return _db->get_global_properties().parameters.block_interval;
+   }
+
+private:
+   std::shared_ptr<graphene::chain::database> _db;
+   fc::microseconds                           _delay;
+};
+
+/**
+ * Syncs a node from a fast peer and a peer that sits on every block request for longer than a
+ * peer's stall timeout before its first block.  The blocks the stalled peer holds are asked from
+ * the fast peer, and when the stalled peer finally delivers them they are dropped without
+ * disconnecting it.
+ */
+BOOST_AUTO_TEST_CASE( sync_from_stalled_peer )
+{
+   using namespace graphene::chain;
+   try {
+      const uint32_t block_count = 100;
+      // longer than the stall timeout of a peer that has not delivered a block yet, shorter than the
+      // time a peer may sit on a sync block before it is disconnected
+      const fc::microseconds stall_delay = fc::milliseconds( 3 * GRAPHENE_NET_SYNC_TARGET_LATENCY_MS );
+
+      fc::temp_directory fast_dir( graphene::utilities::temp_directory_path() );
+      fc::temp_directory stalled_dir( graphene::utilities::temp_directory_path() );
+      fc::temp_directory syncing_dir( graphene::utilities::temp_directory_path() );
+
+      // dated far enough back that every block has a slot before now, nodes reject blocks from the future
+      genesis_state_type genesis = graphene::app::detail::create_example_genesis();
+      const uint32_t interval = genesis.initial_parameters.block_interval;
+      uint32_t genesis_time = fc::time_point_sec( fc::time_point::now() ).sec_since_epoch() - ( block_count + 2 ) * interval;
+      genesis.initial_timestamp = fc::time_point_sec( genesis_time - genesis_time % interval );
+      const fc::path genesis_file = fast_dir.path() / "genesis.json";
+      fc::json::save_to_file( genesis, genesis_file );
+
+      auto node_config = [&]( const std::string& endpoint ) {
+         boost::program_options::variables_map cfg;
+         cfg.emplace( "p2p-endpoint", boost::program_options::variable_value( endpoint, false ) );
+         cfg.emplace( "genesis-json", boost::program_options::variable_value( boost::filesystem::path( genesis_file.generic_string() ), false ) );
+         cfg.emplace( "seed-nodes", boost::program_options::variable_value( std::string( "[]" ), false ) );
+         return cfg;
+      };
+
+      BOOST_TEST_MESSAGE( "Generating " << block_count << " blocks on the fast peer" );
+      graphene::app::application fast;
+      fast.initialize( fast_dir.path(), node_config( "127.0.0.1:4141" ) );
+      fast.startup();
+      std::shared_ptr<database> db = fast.chain_database();
+      fc::ecc::private_key nathan_key = fc::ecc::private_key::regenerate( fc::sha256::hash( string( "nathan" ) ) );
+      for( uint32_t i = 0; i < block_count; ++i )
+         db->generate_block( db->get_slot_time( 1 ), db->get_scheduled_witness( 1 ), nathan_key, database::skip_nothing );
+
+      BOOST_TEST_MESSAGE( "Starting the stalled peer" );
+      stalling_peer_delegate stalling_delegate( db, stall_delay );
+      graphene::net::node stalled( "stalled peer" );
+      stalled.load_configuration( stalled_dir.path() );
+      stalled.set_node_delegate( &stalling_delegate );
+      stalled.listen_on_endpoint( fc::ip::endpoint::from_string( "127.0.0.1:4242" ), true );
+      stalled.listen_to_p2p_network();
+      stalled.connect_to_p2p_network();
+      stalled.sync_from( graphene::net::item_id( graphene::net::block_message_type, db->head_block_id() ), std::vector<uint32_t>() );
+
+      BOOST_TEST_MESSAGE( "Syncing from both peers" );
+      graphene::app::application syncing;
+      auto cfg = node_config( "127.0.0.1:4343" );
+      cfg.emplace( "seed-node", boost::program_options::variable_value( vector<string>{ "127.0.0.1:4242", "127.0.0.1:4141" }, false ) );
+      syncing.initialize( syncing_dir.path(), cfg );
+      syncing.startup();
+
+      const fc::time_point deadline = fc::time_point::now() + fc::seconds( 30 );
+      while( syncing.chain_database()->head_block_num() < block_count && fc::time_point::now() < deadline )
+         fc::usleep( fc::milliseconds( 100 ) );
+      BOOST_REQUIRE_EQUAL( syncing.chain_database()->head_block_num(), block_count );
+
+      // give the stalled peer time to deliver the blocks it was sitting on
+      fc::usleep( stall_delay + fc::seconds( 1 ) );
+
+      bool stalled_peer_connected = false;
+      for( const graphene::net::peer_sync_statistics& statistics : syncing.p2p_node()->get_sync_statistics() )
+         if( statistics.host.port() == 4242 )
+         {
+            stalled_peer_connected = true;
+            BOOST_CHECK_GT( statistics.blocks_rerequested, 0u );
+         }
+      BOOST_CHECK( stalled_peer_connected );
+
+      bool stalled_peer_delivered = false;
+      for( const graphene::net::peer_traffic_statistics& traffic : syncing.p2p_node()->get_peer_traffic_statistics() )
+         if( traffic.host.port() == 4242 )
+            for( const graphene::net::message_type_traffic& message_type : traffic.message_types )
+               if( message_type.message_type == graphene::net::block_message_type && message_type.messages_received > 0 )
+                  stalled_peer_delivered = true;
+      BOOST_CHECK( stalled_peer_delivered );
+
+      stalled.close();
+   } catch( fc::exception& e ) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+/**
+ * Requests a state snapshot through the API while blocks keep being produced and starts a second node from it.
+ * The snapshot is written a few objects at a time between the blocks, and holds the state of the block that was
+ * irreversible when it was requested.
+ */
+BOOST_AUTO_TEST_CASE( state_snapshot_through_api )
+{
+   using namespace graphene::chain;
+   try {
+      const uint32_t block_count = 50;
+      const uint32_t max_blocks_meanwhile = 200;
+
+      fc::temp_directory source_dir( graphene::utilities::temp_directory_path() );
+      fc::temp_directory clone_dir( graphene::utilities::temp_directory_path() );
+
+      // dated far enough back that every block has a slot before now, nodes reject blocks from the future
+      genesis_state_type genesis = graphene::app::detail::create_example_genesis();
+      const uint32_t interval = genesis.initial_parameters.block_interval;
+      uint32_t genesis_time = fc::time_point_sec( fc::time_point::now() ).sec_since_epoch()
+                              - ( block_count + max_blocks_meanwhile + 2 ) * interval;
+      genesis.initial_timestamp = fc::time_point_sec( genesis_time - genesis_time % interval );
+      const fc::path genesis_file = source_dir.path() / "genesis.json";
+      fc::json::save_to_file( genesis, genesis_file );
+
+      auto node_config = [&]( const std::string& endpoint ) {
+         boost::program_options::variables_map cfg;
+         cfg.emplace( "p2p-endpoint", boost::program_options::variable_value( endpoint, false ) );
+         cfg.emplace( "genesis-json", boost::program_options::variable_value( boost::filesystem::path( genesis_file.generic_string() ), false ) );
+         cfg.emplace( "seed-nodes", boost::program_options::variable_value( std::string( "[]" ), false ) );
+         return cfg;
+      };
+      auto state_hash = []( const database& d ) -> fc::sha256
+      {
+         std::stringstream state;
+         d.export_state( state, 0 );
+         return fc::sha256::hash( state.str() );
+      };
+
+      graphene::app::application source;
+      auto source_cfg = node_config( "127.0.0.1:4545" );
+      source_cfg.emplace( "state-snapshot-objects-per-slice", boost::program_options::variable_value( uint32_t( 10 ), false ) );
+      source.initialize( source_dir.path(), source_cfg );
+      source.startup();
+      std::shared_ptr<database> db = source.chain_database();
+      fc::ecc::private_key nathan_key = fc::ecc::private_key::regenerate( fc::sha256::hash( string( "nathan" ) ) );
+      for( uint32_t i = 0; i < block_count; ++i )
+         db->generate_block( db->get_slot_time( 1 ), db->get_scheduled_witness( 1 ), nathan_key, database::skip_nothing );
+
+      BOOST_TEST_MESSAGE( "Requesting a snapshot" );
+      const uint32_t irreversible_num = db->get_dynamic_global_properties().last_irreversible_block_num;
+      BOOST_REQUIRE_LT( irreversible_num, db->head_block_num() );
+      graphene::app::network_node_api node_api( source );
+      const state_snapshot_header header = node_api.create_state_snapshot( "snapshot" );
+      BOOST_CHECK_EQUAL( header.head_block.block_num(), irreversible_num );
+      BOOST_CHECK_THROW( node_api.create_state_snapshot( "../snapshot" ), fc::exception );
+
+      // the call only starts the snapshot, it is written while blocks keep being produced
+      const fc::path snapshot = db->get_data_dir() / "snapshots" / "snapshot";
+      BOOST_CHECK( !fc::exists( snapshot ) );
+      uint32_t blocks_meanwhile = 0;
+      while( db->is_writing_state_snapshot() && blocks_meanwhile < max_blocks_meanwhile )
+      {
+         db->generate_block( db->get_slot_time( 1 ), db->get_scheduled_witness( 1 ), nathan_key, database::skip_nothing );
+         ++blocks_meanwhile;
+         // lets the snapshot task write a slice
+         fc::yield();
+      }
+      BOOST_REQUIRE( fc::exists( snapshot ) );
+      BOOST_CHECK_GT( blocks_meanwhile, 1u );
+      BOOST_CHECK_GT( db->get_dynamic_global_properties().last_irreversible_block_num, irreversible_num );
+
+      BOOST_TEST_MESSAGE( "Starting a node from the snapshot" );
+      graphene::app::application clone;
+      auto clone_cfg = node_config( "127.0.0.1:4646" );
+      clone_cfg.emplace( "load-snapshot", boost::program_options::variable_value( boost::filesystem::path( snapshot.generic_string() ), false ) );
+      clone_cfg.emplace( "seed-node", boost::program_options::variable_value( vector<string>{ "127.0.0.1:4545" }, false ) );
+      clone.initialize( clone_dir.path(), clone_cfg );
+      clone.startup();
+      BOOST_CHECK_EQUAL( clone.chain_database()->first_stored_block_num(), irreversible_num );
+
+      // it follows the chain from the snapshot's block on to the same state
+      const fc::time_point deadline = fc::time_point::now() + fc::seconds( 30 );
+      while( clone.chain_database()->head_block_num() < db->head_block_num() && fc::time_point::now() < deadline )
+         fc::usleep( fc::milliseconds( 100 ) );
+      BOOST_REQUIRE( clone.chain_database()->head_block_id() == db->head_block_id() );
+      BOOST_CHECK( state_hash( *clone.chain_database() ) == state_hash( *db ) );
+   } catch( fc::exception& e ) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( message_cache_shares_payloads )
+{
+   using namespace graphene::net;
+
+   blockchain_tied_message_cache cache;
+   graphene::chain::signed_transaction trx;
+   trx.set_expiration( fc::time_point_sec( 1000 ) );
+   message trx_msg( trx_message{ trx } );
+   const message_hash_type trx_msg_hash = trx_msg.id();
+   const size_t packed_size = trx_msg.data.size();
+   message_propagation_data propagation_data{ fc::time_point::now(), fc::time_point::now(), node_id_t() };
+
+   shared_message cached = cache.cache_message( trx_msg, trx_msg_hash, propagation_data, trx.id() );
+   BOOST_CHECK( cache.cache_message( trx_msg, trx_msg_hash, propagation_data, trx.id() ) == cached );
+   BOOST_CHECK_EQUAL( cache.get_statistics().duplicates_ignored, 1u );
+
+   // every peer asking for the item gets the one cached copy
+   for( int peer = 0; peer < 10; ++peer )
+      BOOST_CHECK( cache.get_message( trx_msg_hash ) == cached );
+   BOOST_CHECK_EQUAL( cache.get_statistics().entries, 1u );
+   BOOST_CHECK_EQUAL( cache.get_statistics().bytes, packed_size );
+   BOOST_CHECK_EQUAL( cache.get_statistics().hits, 10u );
+   BOOST_CHECK_EQUAL( cache.get_statistics().bytes_served, 10 * packed_size );
+   BOOST_CHECK( cache.get_message_propagation_data( trx.id() ).received_time == propagation_data.received_time );
+   BOOST_CHECK_EQUAL( cache.find_transactions_by_short_id( graphene::chain::block_id_type(),
+                                                           { compact_block_short_id( graphene::chain::block_id_type(), trx.id() ) } ).size(), 1u );
+
+   BOOST_CHECK_THROW( cache.get_message( message_hash_type() ), fc::key_not_found_exception );
+   BOOST_CHECK_EQUAL( cache.get_statistics().misses, 1u );
+
+   for( uint32_t i = 0; i <= GRAPHENE_NET_MESSAGE_CACHE_DURATION_IN_BLOCKS; ++i )
+      cache.block_accepted();
+   BOOST_CHECK_THROW( cache.get_message( trx_msg_hash ), fc::key_not_found_exception );
+   BOOST_CHECK_EQUAL( cache.get_statistics().entries, 0u );
+   BOOST_CHECK_EQUAL( cache.get_statistics().bytes, 0u );
+   BOOST_CHECK_EQUAL( cache.get_statistics().messages_expired, 1u );
+   // peers still sending the message keep it alive after it leaves the cache
+   BOOST_CHECK_EQUAL( cached->data.size(), packed_size );
+}
+
+/**
+ * Rebuilds a block from a compact block: prefilled transactions, transactions found in the message
+ * cache by short id, and the round trip for the ones that are missing.  A cached transaction that
+ * answers to the short id of one in the block stands in for a short id collision.
+ */
+BOOST_AUTO_TEST_CASE( compact_block_reconstruction )
+{
+   using namespace graphene::net;
+
+   auto make_transaction = []( uint32_t i ) {
+      graphene::chain::signed_transaction trx;
+      trx.set_expiration( fc::time_point_sec( 1000 + i ) );
+      return trx;
+   };
+   const message_propagation_data propagation_data{ fc::time_point::now(), fc::time_point::now(), node_id_t() };
+   auto cache_transaction = [&]( blockchain_tied_message_cache& cache, const graphene::chain::signed_transaction& trx ) {
+      message trx_msg( trx_message{ trx } );
+      cache.cache_message( trx_msg, trx_msg.id(), propagation_data, trx.id() );
+   };
+
+   graphene::chain::signed_block block;
+   block.timestamp = fc::time_point_sec( 1000 );
+   for( uint32_t i = 0; i < 3; ++i )
+      block.transactions.push_back( graphene::chain::processed_transaction( make_transaction( i ) ) );
+   block.transaction_merkle_root = block.calculate_merkle_root();
+   const graphene::chain::block_id_type block_id = block.id();
+   const graphene::chain::signed_transaction decoy = make_transaction( 100 );
+
+   // the first transaction is prefilled, the others go by short id
+   compact_block_message compact;
+   compact.block_message_hash = message( block_message( block ) ).id();
+   compact.block_id = block_id;
+   compact.header = block;
+   compact.transactions.resize( block.transactions.size() );
+   compact.prefilled_transactions.emplace_back( 0, block.transactions[0] );
+   for( uint32_t i = 1; i < block.transactions.size(); ++i )
+      compact.transactions[i].short_id = compact_block_short_id( block_id, block.transactions[i].id() );
+
+   {
+      // the second transaction is cached, the third is fetched from the peer
+      blockchain_tied_message_cache cache;
+      cache_transaction( cache, block.transactions[1] );
+      cache_transaction( cache, decoy );
+      graphene::net::compact_block_reconstruction reconstruction( compact, cache );
+      BOOST_REQUIRE_EQUAL( reconstruction.missing_indexes().size(), 1u );
+      BOOST_CHECK_EQUAL( reconstruction.missing_indexes()[0], 2u );
+      BOOST_CHECK( !reconstruction.add_transactions( {} ) );
+      BOOST_CHECK( reconstruction.add_transactions( { block.transactions[2] } ) );
+      fc::optional<block_message> rebuilt = reconstruction.finish();
+      BOOST_REQUIRE( rebuilt );
+      BOOST_CHECK( rebuilt->block_id == block_id );
+      BOOST_CHECK( rebuilt->block.id() == block_id );
+      BOOST_CHECK( !reconstruction.requested_all() );
+   }
+
+   {
+      // the cache answers the second short id with another transaction, as if the two collided, so the
+      // merkle root doesn't match and every transaction not prefilled is fetched from the peer
+      compact_block_message colliding = compact;
+      colliding.transactions[1].short_id = compact_block_short_id( block_id, decoy.id() );
+      blockchain_tied_message_cache cache;
+      cache_transaction( cache, decoy );
+      graphene::net::compact_block_reconstruction reconstruction( colliding, cache );
+      BOOST_CHECK( reconstruction.add_transactions( { block.transactions[2] } ) );
+      BOOST_CHECK( !reconstruction.finish() );
+      BOOST_CHECK( reconstruction.requested_all() );
+      BOOST_CHECK( reconstruction.missing_indexes() == std::vector<uint32_t>( { 1, 2 } ) );
+      BOOST_CHECK( reconstruction.add_transactions( { block.transactions[1], block.transactions[2] } ) );
+      fc::optional<block_message> rebuilt = reconstruction.finish();
+      BOOST_REQUIRE( rebuilt );
+      BOOST_CHECK( rebuilt->block.id() == block_id );
+   }
+
+   {
+      // a peer still sending the wrong transactions gets its block built, for validation to reject
+      compact_block_message colliding = compact;
+      colliding.transactions[1].short_id = compact_block_short_id( block_id, decoy.id() );
+      blockchain_tied_message_cache cache;
+      cache_transaction( cache, decoy );
+      graphene::net::compact_block_reconstruction reconstruction( colliding, cache );
+      BOOST_CHECK( reconstruction.add_transactions( { block.transactions[2] } ) );
+      BOOST_CHECK( !reconstruction.finish() );
+      BOOST_CHECK( reconstruction.add_transactions( { decoy, block.transactions[2] } ) );
+      fc::optional<block_message> rebuilt = reconstruction.finish();
+      BOOST_REQUIRE( rebuilt );
+      BOOST_CHECK( rebuilt->block.calculate_merkle_root() != block.transaction_merkle_root );
+   }
+
+   // a compact block prefilling a transaction past its end is rejected
+   compact_block_message invalid = compact;
+   invalid.prefilled_transactions.emplace_back( 3, block.transactions[0] );
+   blockchain_tied_message_cache cache;
+   BOOST_CHECK_THROW( graphene::net::compact_block_reconstruction( invalid, cache ), fc::exception );
+}
+
+/**
+ * A flood of transactions queued for a peer delays the blocks queued behind it only by the
+ * transactions' share of the connection.
+ */
+BOOST_AUTO_TEST_CASE( send_queue_fair_scheduling )
+{
+   using namespace graphene::net;
+
+   BOOST_CHECK_EQUAL( message_priority_of( block_message_type ), block_priority );
+   BOOST_CHECK_EQUAL( message_priority_of( compact_block_message_type ), block_priority );
+   BOOST_CHECK_EQUAL( message_priority_of( item_ids_inventory_message_type ), item_ids_priority );
+   BOOST_CHECK_EQUAL( message_priority_of( trx_message_type ), transaction_priority );
+   BOOST_CHECK_EQUAL( message_priority_of( hello_message_type ), control_priority );
+
+   send_scheduler scheduler;
+   send_scheduler::queue_lengths queued{};
+   std::array<uint64_t, message_priority_count> bytes_sent{};
+   const std::array<size_t, message_priority_count> message_size{ { 100, 20000, 2000, 500 } };
+
+   // every queue backlogged: control first, then the others share by weight
+   queued.fill( 1000 );
+   queued[control_priority] = 3;
+   for( int i = 0; i < 100000; ++i )
+   {
+      message_priority priority = scheduler.next( queued );
+      if( i < 3 )
+         BOOST_CHECK_EQUAL( priority, control_priority );
+      else
+         BOOST_REQUIRE( priority != control_priority );
+      if( priority == control_priority )
+         --queued[control_priority];
+      scheduler.on_sent( priority, message_size[priority] );
+      bytes_sent[priority] += message_size[priority];
+   }
+   const double total = bytes_sent[block_priority] + bytes_sent[item_ids_priority] + bytes_sent[transaction_priority];
+   const double total_weight = GRAPHENE_NET_BLOCK_SEND_WEIGHT + GRAPHENE_NET_ITEM_IDS_SEND_WEIGHT + GRAPHENE_NET_TRANSACTION_SEND_WEIGHT;
+   BOOST_CHECK_CLOSE( bytes_sent[block_priority] / total, GRAPHENE_NET_BLOCK_SEND_WEIGHT / total_weight, 2 );
+   BOOST_CHECK_CLOSE( bytes_sent[item_ids_priority] / total, GRAPHENE_NET_ITEM_IDS_SEND_WEIGHT / total_weight, 2 );
+   BOOST_CHECK_CLOSE( bytes_sent[transaction_priority] / total, GRAPHENE_NET_TRANSACTION_SEND_WEIGHT / total_weight, 2 );
+
+   // a queue on its own gets the whole connection
+   queued.fill( 0 );
+   queued[transaction_priority] = 1;
+   for( int i = 0; i < 100; ++i )
+   {
+      BOOST_CHECK_EQUAL( scheduler.next( queued ), transaction_priority );
+      scheduler.on_sent( transaction_priority, 500 );
+   }
+}
+
+BOOST_AUTO_TEST_CASE( transaction_token_bucket )
+{
+   using namespace graphene::net;
+
+   const fc::time_point start = fc::time_point::now();
+   token_bucket bucket( 10, 20 );
+
+   // a full bucket allows a burst, then the peer gets the steady rate
+   for( int i = 0; i < 20; ++i )
+      BOOST_CHECK( bucket.try_consume( start ) );
+   BOOST_CHECK( !bucket.try_consume( start ) );
+   BOOST_CHECK( bucket.when_available( start ) > start );
+   BOOST_CHECK( bucket.try_consume( start + fc::milliseconds( 100 ) ) );
+   BOOST_CHECK( !bucket.try_consume( start + fc::milliseconds( 100 ) ) );
+
+   // refilling stops at the capacity
+   const fc::time_point later = start + fc::seconds( 60 );
+   BOOST_CHECK_CLOSE( bucket.available( later ), 20, 0.001 );
+
+   // penalties go into debt, but no deeper than the capacity
+   bucket.charge( later, 100 );
+   BOOST_CHECK_CLOSE( bucket.available( later ), -20, 0.001 );
+   BOOST_CHECK( !bucket.try_consume( later + fc::seconds( 2 ) ) );
+   const fc::time_point available = bucket.when_available( later );
+   BOOST_CHECK( available > later + fc::milliseconds( 2000 ) && available <= later + fc::milliseconds( 2200 ) );
+   BOOST_CHECK( bucket.try_consume( available ) );
+
+   transaction_admission_counters counters;
+   counters.count_precheck_failure( transaction_unknown_tapos_block );
+   counters.count_precheck_failure( transaction_expired );
+   counters.count_precheck_failure( transaction_precheck_passed );
+   BOOST_CHECK_EQUAL( counters.unknown_tapos_block, 1u );
+   BOOST_CHECK_EQUAL( counters.expired, 1u );
+   BOOST_CHECK_EQUAL( counters.duplicate, 0u );
+}
+
+BOOST_AUTO_TEST_CASE( peer_database_log )
+{
+   using namespace graphene::net;
+
+   fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+   const fc::path database_file = data_dir.path() / "peers.dat";
+   const fc::path crashed_file = data_dir.path() / "crashed.dat";
+   const fc::time_point_sec now( 1500000000 );
+   auto endpoint = []( uint32_t i ) { return fc::ip::endpoint( fc::ip::address( 0x0a000000 + i ), 1776 ); };
+
+   {
+      peer_database database;
+      database.open( database_file );
+      for( uint32_t i = 1; i <= 3; ++i )
+         database.update_entry( potential_peer_record( endpoint( i ), now + i ) );
+      potential_peer_record failed = database.lookup_or_create_entry_for_endpoint( endpoint( 2 ) );
+      failed.number_of_failed_connection_attempts = 2;
+      failed.last_connection_disposition = last_connection_failed;
+      database.update_entry( failed );
+      database.erase( endpoint( 3 ) );
+      database.export_json( data_dir.path() / "peers.json" );
+      const uint64_t complete_size = fc::file_size( database_file );
+      database.update_entry( potential_peer_record( endpoint( 4 ), now + 4 ) );
+
+      // take the file as a crash would leave it while the database is still open: every change logged before
+      // the crash, and the last one torn part way through its payload
+      std::string contents;
+      fc::read_file_contents( database_file, contents );
+      BOOST_REQUIRE_GT( contents.size(), complete_size + 8 );
+      contents.resize( contents.size() - 8 );
+      std::ofstream crashed( crashed_file.generic_string().c_str(), std::ios::binary | std::ios::trunc );
+      crashed.write( contents.data(), contents.size() );
+   }
+
+   peer_database database;
+   database.open( crashed_file );
+   BOOST_CHECK_EQUAL( database.size(), 2u );
+   BOOST_REQUIRE( database.lookup_entry_for_endpoint( endpoint( 2 ) ) );
+   BOOST_CHECK_EQUAL( database.lookup_entry_for_endpoint( endpoint( 2 ) )->number_of_failed_connection_attempts, 2u );
+   BOOST_CHECK( !database.lookup_entry_for_endpoint( endpoint( 3 ) ) );
+   BOOST_CHECK( !database.lookup_entry_for_endpoint( endpoint( 4 ) ) );
+
+   database.clear();
+   database.import_json( data_dir.path() / "peers.json" );
+   BOOST_CHECK_EQUAL( database.size(), 2u );
+   BOOST_CHECK( database.lookup_entry_for_endpoint( endpoint( 1 ) )->last_seen_time == now + 1 );
+
+   // a full database evicts the peer seen longest ago, counting net connection failures against it
+   for( uint32_t i = 3; i <= GRAPHENE_NET_MAXIMUM_PEER_DATABASE_SIZE; ++i )
+      database.update_entry( potential_peer_record( endpoint( i ), now + i ) );
+   BOOST_CHECK_EQUAL( database.size(), GRAPHENE_NET_MAXIMUM_PEER_DATABASE_SIZE );
+   database.update_entry( potential_peer_record( endpoint( GRAPHENE_NET_MAXIMUM_PEER_DATABASE_SIZE + 1 ), now + 100000 ) );
+   BOOST_CHECK_EQUAL( database.size(), GRAPHENE_NET_MAXIMUM_PEER_DATABASE_SIZE );
+   BOOST_CHECK( !database.lookup_entry_for_endpoint( endpoint( 2 ) ) );
+   BOOST_CHECK( database.lookup_entry_for_endpoint( endpoint( 1 ) ) );
+
+   potential_peer_record unreachable = *database.lookup_entry_for_endpoint( endpoint( GRAPHENE_NET_MAXIMUM_PEER_DATABASE_SIZE ) );
+   unreachable.number_of_failed_connection_attempts = 100;
+   database.update_entry( unreachable );
+   database.update_entry( potential_peer_record( endpoint( GRAPHENE_NET_MAXIMUM_PEER_DATABASE_SIZE + 2 ), now + 100000 ) );
+   BOOST_CHECK( !database.lookup_entry_for_endpoint( endpoint( GRAPHENE_NET_MAXIMUM_PEER_DATABASE_SIZE ) ) );
+
+   // a peer only just heard of has never been seen, yet it makes room for itself rather than being evicted
+   database.update_entry( potential_peer_record( endpoint( GRAPHENE_NET_MAXIMUM_PEER_DATABASE_SIZE + 3 ) ) );
+   BOOST_CHECK_EQUAL( database.size(), GRAPHENE_NET_MAXIMUM_PEER_DATABASE_SIZE );
+   BOOST_CHECK( database.lookup_entry_for_endpoint( endpoint( GRAPHENE_NET_MAXIMUM_PEER_DATABASE_SIZE + 3 ) ) );
+   BOOST_CHECK( !database.lookup_entry_for_endpoint( endpoint( 1 ) ) );
+
+   // a batch of changes is saved once, and survives the same as logged ones
+   std::vector<potential_peer_record> retried;
+   for( auto itr = database.begin(); itr != database.end(); ++itr )
+   {
+      retried.push_back( *itr );
+      retried.back().last_connection_attempt_time = now;
+   }
+   database.update_entries( retried );
+   database.close();
+
+   database.open( crashed_file );
+   BOOST_CHECK_EQUAL( database.size(), GRAPHENE_NET_MAXIMUM_PEER_DATABASE_SIZE );
+   BOOST_CHECK( database.lookup_entry_for_endpoint( endpoint( GRAPHENE_NET_MAXIMUM_PEER_DATABASE_SIZE + 2 ) ) );
+   BOOST_CHECK( database.lookup_entry_for_endpoint( endpoint( GRAPHENE_NET_MAXIMUM_PEER_DATABASE_SIZE + 3 ) ) );
+   BOOST_CHECK( database.lookup_entry_for_endpoint( endpoint( 2 ) )->last_connection_attempt_time == now );
+   database.close();
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/account_object.hpp>
+
+#include <fc/crypto/digest.hpp>
+
+#include <boost/test/auto_unit_test.hpp>
+
+#include "../common/database_fixture.hpp"
+
+using namespace graphene::chain;
+
+BOOST_FIXTURE_TEST_CASE( account_update_bench, database_fixture )
+{
+   try {
+#ifdef NDEBUG
+      const uint32_t updates = 1000000;
+#else
+      const uint32_t updates = 20000;
+#endif
+      ACTOR( alice );
+      const public_key_type other_key = fc::ecc::private_key::regenerate( fc::digest( 1 ) ).get_public_key();
+
+      // modifications which leave the authorities alone, such as vote or statistics pointer updates
+      auto start = fc::time_point::now();
+      for( uint32_t i = 0; i < updates; ++i )
+         db.modify( alice, [&]( account_object& a ) { a.options.num_witness = i % 2; } );
+      const auto unchanged_time = fc::time_point::now() - start;
+
+      // modifications which replace a key of the active authority
+      start = fc::time_point::now();
+      for( uint32_t i = 0; i < updates; ++i )
+         db.modify( alice, [&]( account_object& a ) {
+            a.active = authority( 1, i % 2 ? other_key : alice_public_key, 1 );
+         } );
+      const auto changed_time = fc::time_point::now() - start;
+
+      const auto& refs = db.get_index_type<primary_index<account_index>>().get_secondary_index<key_reference_index>();
+      BOOST_CHECK( refs.is_key_referenced( alice_public_key ) );
+
+      ilog( "${n} account updates: ${u} ns each without authority changes, ${c} ns each with authority changes",
+            ("n",updates)
+            ("u",unchanged_time.count() * 1000 / updates)
+            ("c",changed_time.count() * 1000 / updates) );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/block_database.hpp>
+#include <graphene/chain/config.hpp>
+#include <graphene/chain/protocol/fee_schedule.hpp>
+#include <graphene/utilities/tempdir.hpp>
+
+#include <graphene/net/core_messages.hpp>
+#include <graphene/net/message.hpp>
+
+#include <fc/crypto/digest.hpp>
+#include <fc/smart_ref_impl.hpp>
+
+#include <boost/test/auto_unit_test.hpp>
+
+#include <random>
+
+using namespace graphene::chain;
+
+namespace {
+
+signed_block make_block( uint32_t num, const block_id_type& previous, uint32_t transactions_per_block )
+{
+   signed_block b;
+   b.previous = previous;
+   b.timestamp = fc::time_point_sec( GRAPHENE_DEFAULT_BLOCK_INTERVAL * num );
+   b.witness = witness_id_type( num % 21 );
+   for( uint32_t i = 0; i < transactions_per_block; ++i )
+   {
+      transfer_operation op;
+      op.from = account_id_type( 100 + ( num * 7 + i ) % 1000 );
+      op.to = account_id_type( 100 + ( num * 13 + i ) % 1000 );
+      op.amount = asset( num * 1000 + i );
+      op.fee = asset( 20000 );
+      signed_transaction tx;
+      tx.operations.push_back( op );
+      tx.set_expiration( b.timestamp + 30 );
+      tx.signatures.push_back( fc::ecc::compact_signature() );
+      b.transactions.push_back( processed_transaction( tx ) );
+   }
+   b.transaction_merkle_root = b.calculate_merkle_root();
+   return b;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE( block_log_compression_bench )
+{
+   try {
+#ifdef NDEBUG
+      const uint32_t blocks_to_store = 200000;
+#else
+      const uint32_t blocks_to_store = 5000;
+#endif
+      const uint32_t fetches = 20000;
+
+      for( uint32_t chunk_size : { 0u, uint32_t(GRAPHENE_DEFAULT_BLOCK_LOG_CHUNK_SIZE) } )
+      {
+         fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+         block_database bdb;
+         bdb.set_chunk_size( chunk_size );
+         bdb.open( data_dir.path() );
+
+         auto start = fc::time_point::now();
+         block_id_type previous;
+         for( uint32_t num = 1; num <= blocks_to_store; ++num )
+         {
+            const signed_block b = make_block( num, previous, 10 );
+            previous = b.id();
+            bdb.store( previous, b );
+            bdb.compress_until( num );
+         }
+         bdb.flush();
+         const auto store_time = fc::time_point::now() - start;
+
+         std::mt19937 rng( 42 );
+         std::uniform_int_distribution<uint32_t> random_block( 1, blocks_to_store );
+         start = fc::time_point::now();
+         for( uint32_t i = 0; i < fetches; ++i )
+            BOOST_REQUIRE( bdb.fetch_by_number( random_block( rng ) ).valid() );
+         const auto random_time = fc::time_point::now() - start;
+
+         start = fc::time_point::now();
+         for( uint32_t num = 1; num <= blocks_to_store; ++num )
+            BOOST_REQUIRE( bdb.fetch_by_number( num ).valid() );
+         const auto sequential_time = fc::time_point::now() - start;
+
+         ilog( "Block log with chunk size ${c}: ${s} bytes for ${n} blocks, stored in ${st} ms, "
+               "${r} us per random fetch, ${q} us per sequential fetch",
+               ("c",chunk_size)("s",fc::directory_size( data_dir.path() ))("n",blocks_to_store)
+               ("st",store_time.count() / 1000)
+               ("r",double( random_time.count() ) / fetches)
+               ("q",double( sequential_time.count() ) / blocks_to_store) );
+         bdb.close();
+      }
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+/**
+ * How fast a node answers sync peers: block id lists for fetch_blockchain_item_ids_message, and full blocks for
+ * fetch_items_message, comparing one lookup per block with ranged reads of the block database.
+ */
+BOOST_AUTO_TEST_CASE( sync_serving_bench )
+{
+   try {
+#ifdef NDEBUG
+      const uint32_t blocks_to_store = 100000;
+#else
+      const uint32_t blocks_to_store = 5000;
+#endif
+      const uint32_t ids_per_request = 2000;   // the limit of node_delegate::get_block_ids
+      const uint32_t blocks_per_request = 100; // a sync window
+
+      for( uint32_t chunk_size : { 0u, uint32_t(GRAPHENE_DEFAULT_BLOCK_LOG_CHUNK_SIZE) } )
+      {
+         fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+         block_database bdb;
+         bdb.set_chunk_size( chunk_size );
+         bdb.open( data_dir.path() );
+         block_id_type previous;
+         for( uint32_t num = 1; num <= blocks_to_store; ++num )
+         {
+            const signed_block b = make_block( num, previous, 10 );
+            previous = b.id();
+            bdb.store( previous, b );
+            bdb.compress_until( num );
+         }
+         bdb.flush();
+
+         uint64_t ids_served = 0;
+         auto start = fc::time_point::now();
+         for( uint32_t first = 1; first <= blocks_to_store; first += ids_per_request )
+            for( uint32_t num = first; num < first + ids_per_request && num <= blocks_to_store; ++num, ++ids_served )
+               bdb.fetch_block_id( num );
+         const auto ids_one_by_one = fc::time_point::now() - start;
+
+         start = fc::time_point::now();
+         for( uint32_t first = 1; first <= blocks_to_store; first += ids_per_request )
+            BOOST_REQUIRE( !bdb.fetch_block_ids( first, ids_per_request ).empty() );
+         const auto ids_ranged = fc::time_point::now() - start;
+
+         uint64_t bytes_served = 0;
+         start = fc::time_point::now();
+         for( uint32_t num = 1; num <= blocks_to_store; ++num )
+         {
+            const optional<signed_block> b = bdb.fetch_by_number( num );
+            BOOST_REQUIRE( b.valid() );
+            bytes_served += graphene::net::message( graphene::net::block_message( *b ) ).size;
+         }
+         const auto blocks_one_by_one = fc::time_point::now() - start;
+
+         start = fc::time_point::now();
+         for( uint32_t first = 1; first <= blocks_to_store; first += blocks_per_request )
+            for( packed_block& b : bdb.fetch_packed_blocks( first, blocks_per_request ) )
+               BOOST_REQUIRE( graphene::net::packed_block_message( b.id, std::move( b.data ) ).size > 0 );
+         const auto blocks_ranged = fc::time_point::now() - start;
+
+         const auto per_second = []( uint64_t count, const fc::microseconds& time )
+         {
+            return uint64_t( count * 1000000.0 / std::max<int64_t>( time.count(), 1 ) );
+         };
+         ilog( "Sync serving with chunk size ${c}: ${i1} -> ${i2} block ids/s, ${b1} -> ${b2} blocks/s (${m1} -> ${m2} MB/s) "
+               "going from one lookup per block to ranged reads",
+               ("c",chunk_size)
+               ("i1",per_second( ids_served, ids_one_by_one ))("i2",per_second( ids_served, ids_ranged ))
+               ("b1",per_second( blocks_to_store, blocks_one_by_one ))("b2",per_second( blocks_to_store, blocks_ranged ))
+               ("m1",per_second( bytes_served, blocks_one_by_one ) / 1000000)
+               ("m2",per_second( bytes_served, blocks_ranged ) / 1000000) );
+         bdb.close();
+      }
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
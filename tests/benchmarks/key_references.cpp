@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/account_object.hpp>
+#include <graphene/chain/protocol/fee_schedule.hpp>
+
+#include <fc/crypto/digest.hpp>
+#include <fc/smart_ref_impl.hpp>
+
+#include <boost/test/auto_unit_test.hpp>
+
+using namespace graphene::chain;
+
+BOOST_AUTO_TEST_CASE( key_references_bench )
+{
+   try {
+#ifdef NDEBUG
+      const uint32_t account_count = 200000;
+#else
+      const uint32_t account_count = 10000;
+#endif
+
+      // the ordered maps get_key_references searched before the hashed index
+      map< public_key_type, set<account_id_type> > key_memberships;
+      map< address, set<account_id_type> >         address_memberships;
+      key_reference_index references;
+      vector<public_key_type> keys;
+      keys.reserve( account_count );
+      for( uint32_t i = 0; i < account_count; ++i )
+      {
+         const public_key_type key = fc::ecc::private_key::regenerate( fc::digest( i ) ).get_public_key();
+         account_object a;
+         a.id = account_id_type( i );
+         a.owner.add_authority( key, 1 );
+         a.active.add_authority( key, 1 );
+         a.options.memo_key = key;
+         key_memberships[key].insert( a.id );
+         address_memberships[address( key )].insert( a.id );
+         references.object_inserted( a );
+         keys.push_back( key );
+      }
+
+      size_t found = 0;
+      auto start = fc::time_point::now();
+      for( const public_key_type& key : keys )
+      {
+         for( const address& a : { address( pts_address( key, false, 56 ) ), address( pts_address( key, true, 56 ) ),
+                                   address( pts_address( key, false, 0 ) ), address( pts_address( key, true, 0 ) ),
+                                   address( key ) } )
+         {
+            auto itr = address_memberships.find( a );
+            if( itr != address_memberships.end() )
+               found += itr->second.size();
+         }
+         auto itr = key_memberships.find( key );
+         if( itr != key_memberships.end() )
+            found += itr->second.size();
+      }
+      const auto ordered_maps_time = fc::time_point::now() - start;
+      BOOST_CHECK_GE( found, account_count );
+
+      found = 0;
+      start = fc::time_point::now();
+      for( const public_key_type& key : keys )
+         found += references.get_key_references( key ).size();
+      const auto reference_index_time = fc::time_point::now() - start;
+      BOOST_CHECK_EQUAL( found, account_count );
+
+      ilog( "Key references of ${n} accounts: ${m} ns per key with ordered maps, ${r} ns per key with key_reference_index",
+            ("n",account_count)
+            ("m",ordered_maps_time.count() * 1000 / account_count)
+            ("r",reference_index_time.count() * 1000 / account_count) );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/account_object.hpp>
+#include <graphene/chain/market_object.hpp>
+
+#include <boost/test/auto_unit_test.hpp>
+
+#include "../common/database_fixture.hpp"
+
+using namespace graphene::chain;
+using namespace graphene::chain::test;
+
+BOOST_AUTO_TEST_CASE( price_arithmetic_bench )
+{
+#ifdef NDEBUG
+   const uint32_t iterations = 10000000;
+#else
+   const uint32_t iterations = 1000000;
+#endif
+   const asset_id_type core_id;
+   const asset_id_type usd_id( 1 );
+   vector<price> prices;
+   for( uint32_t i = 0; i < 1024; ++i )
+      prices.push_back( asset( 1000000 + i * 7919, usd_id ) / asset( 3000000 - i * 104729 % 1000000, core_id ) );
+
+   uint32_t less = 0;
+   auto start = fc::time_point::now();
+   for( uint32_t i = 0; i < iterations; ++i )
+      less += prices[i % 1024] < prices[(i * 31 + 7) % 1024];
+   const auto compare_time = fc::time_point::now() - start;
+
+   share_type total = 0;
+   start = fc::time_point::now();
+   for( uint32_t i = 0; i < iterations; ++i )
+      total += ( asset( 100 + i % 1000, usd_id ) * prices[i % 1024] ).amount;
+   const auto multiply_time = fc::time_point::now() - start;
+
+   BOOST_CHECK( less > 0 && total > 0 );
+   ilog( "${n} price comparisons: ${c} ns each, asset * price: ${m} ns each",
+         ("n",iterations)
+         ("c",compare_time.count() * 1000 / iterations)
+         ("m",multiply_time.count() * 1000 / iterations) );
+}
+
+/**
+ *  Fill a deep book with one maker order per price level, then sweep it with a single
+ *  taker order.  The sweep is dominated by match() and fill_order(), so the matched
+ *  orders per second reported here track the cost of a single match step.
+ */
+BOOST_FIXTURE_TEST_CASE( order_matching_bench, database_fixture )
+{
+   try {
+#ifdef NDEBUG
+      const uint32_t depth = 100000;
+#else
+      const uint32_t depth = 5000;
+#endif
+      const share_type lot = 1000;
+
+      ACTORS( (maker)(taker) );
+      const asset_id_type book_id = create_user_issued_asset( "BOOK" ).id;
+      issue_uia( maker, asset( lot * depth, book_id ) );
+      transfer( committee_account, maker_id, asset( 100 * depth ) );
+
+      // each order pays for its own price level, so the sweep costs the sum of all levels
+      share_type sweep_cost = 0;
+      for( uint32_t i = 0; i < depth; ++i )
+         sweep_cost += lot + i;
+      transfer( committee_account, taker_id, asset( sweep_cost + 100000 ) );
+
+      limit_order_create_operation op;
+      op.seller = maker_id;
+      op.expiration = time_point_sec::maximum();
+      set_expiration( db, trx );
+      auto start = fc::time_point::now();
+      for( uint32_t i = 0; i < depth; ++i )
+      {
+         op.amount_to_sell = asset( lot, book_id );
+         op.min_to_receive = asset( lot + i );
+         trx.operations.assign( 1, op );
+         db.current_fee_schedule().set_fee( trx.operations.back() );
+         db.push_transaction( trx, ~0 );
+      }
+      const auto fill_time = fc::time_point::now() - start;
+
+      const auto& by_seller = db.get_index_type<limit_order_index>().indices().get<by_account>();
+      BOOST_REQUIRE_EQUAL( std::distance( by_seller.lower_bound( maker_id ), by_seller.upper_bound( maker_id ) ), depth );
+
+      op.seller = taker_id;
+      op.amount_to_sell = asset( sweep_cost );
+      op.min_to_receive = asset( 1, book_id );
+      trx.operations.assign( 1, op );
+      db.current_fee_schedule().set_fee( trx.operations.back() );
+      start = fc::time_point::now();
+      db.push_transaction( trx, ~0 );
+      const auto sweep_time = fc::time_point::now() - start;
+      trx.clear();
+
+      BOOST_CHECK( by_seller.lower_bound( maker_id ) == by_seller.upper_bound( maker_id ) );
+      BOOST_CHECK_EQUAL( get_balance( taker_id, book_id ), ( lot * depth ).value );
+
+      ilog( "Placed ${n} orders in ${f} ms, swept them in ${s} ms: ${r} matched orders per second",
+            ("n",depth)
+            ("f",fill_time.count() / 1000)
+            ("s",sweep_time.count() / 1000)
+            ("r",uint64_t( depth ) * 1000000 / std::max<int64_t>( sweep_time.count(), 1 )) );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/net/config.hpp>
+#include <graphene/net/message_oriented_connection.hpp>
+
+#include <fc/network/tcp_socket.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <boost/test/auto_unit_test.hpp>
+
+using namespace graphene::net;
+
+namespace {
+
+class counting_delegate : public message_oriented_connection_delegate
+{
+public:
+   counting_delegate( uint32_t expected_messages ) : expected( expected_messages ), done( new fc::promise<void>( "all messages received" ) ) {}
+
+   virtual void on_message( message_oriented_connection*, const message& received_message ) override
+   {
+      bytes += received_message.size;
+      if( ++received == expected )
+         done->set_value();
+   }
+   virtual void on_connection_closed( message_oriented_connection* ) override {}
+
+   const uint32_t           expected;
+   uint32_t                 received = 0;
+   uint64_t                 bytes = 0;
+   fc::promise<void>::ptr   done;
+};
+
+/**
+ *  Sends @p count messages of @p size bytes through an encrypted connection over loopback
+ *  and logs the throughput seen by the receiver.
+ */
+void run_framing_bench( uint32_t count, uint32_t size )
+{
+   counting_delegate receiver_delegate( count );
+   counting_delegate sender_delegate( 0 );
+   message_oriented_connection receiver( &receiver_delegate );
+   message_oriented_connection sender( &sender_delegate );
+
+   fc::tcp_server server;
+   server.listen( fc::ip::endpoint( fc::ip::address( "127.0.0.1" ), 0 ) );
+   fc::future<void> accepted = fc::async( [&]() {
+      server.accept( receiver.get_socket() );
+      receiver.accept();
+   }, "accept benchmark connection" );
+   sender.connect_to( fc::ip::endpoint( fc::ip::address( "127.0.0.1" ), server.get_port() ) );
+   accepted.wait();
+
+   message m;
+   m.msg_type = 0;
+   m.data.resize( size );
+   for( uint32_t i = 0; i < size; ++i )
+      m.data[i] = char( i * 131 );
+   m.size = size;
+
+   const auto start = fc::time_point::now();
+   for( uint32_t i = 0; i < count; ++i )
+      sender.send_message( m );
+   receiver_delegate.done->wait( fc::seconds( 300 ) );
+   const auto elapsed = std::max<int64_t>( ( fc::time_point::now() - start ).count(), 1 );
+
+   BOOST_CHECK_EQUAL( receiver_delegate.received, count );
+   BOOST_CHECK_EQUAL( receiver_delegate.bytes, uint64_t( count ) * size );
+   ilog( "${n} messages of ${s} bytes: ${mbps} MB/s, ${mps} messages per second",
+         ("n",count)
+         ("s",size)
+         ("mbps",receiver_delegate.bytes / uint64_t( elapsed ))
+         ("mps",uint64_t( count ) * 1000000 / uint64_t( elapsed )) );
+
+   sender.destroy_connection();
+   receiver.destroy_connection();
+   server.close();
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE( p2p_framing_bench )
+{
+   try {
+#ifdef NDEBUG
+      const uint32_t scale = 10;
+#else
+      const uint32_t scale = 1;
+#endif
+      // block sized messages, the case the read and write buffers are sized for
+      run_framing_bench( 50 * scale, MAX_MESSAGE_SIZE - 16 );
+      // transaction sized messages, where per-message overhead dominates
+      run_framing_bench( 10000 * scale, 300 );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
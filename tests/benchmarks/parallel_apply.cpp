@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/account_object.hpp>
+#include <graphene/utilities/tempdir.hpp>
+
+#include <fc/crypto/digest.hpp>
+
+#include <boost/test/auto_unit_test.hpp>
+
+#include "../common/database_fixture.hpp"
+
+#include <random>
+#include <sstream>
+#include <thread>
+
+using namespace graphene::chain;
+
+BOOST_FIXTURE_TEST_CASE( parallel_apply_bench, database_fixture )
+{
+   try {
+#ifdef NDEBUG
+      const uint32_t num_accounts = 2000;
+      const uint32_t num_blocks = 20;
+      const uint32_t transfers_per_block = 1000;
+#else
+      const uint32_t num_accounts = 200;
+      const uint32_t num_blocks = 5;
+      const uint32_t transfers_per_block = 100;
+#endif
+      auto generate_block = [&]( uint32_t skip ) -> signed_block
+      {
+         return db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, skip);
+      };
+
+      vector<account_id_type> accounts;
+      vector<fc::ecc::private_key> keys;
+      for( uint32_t i = 0; i < num_accounts; ++i )
+      {
+         keys.push_back( fc::ecc::private_key::regenerate( fc::digest( i ) ) );
+         accounts.push_back( create_account( "bench" + fc::to_string(i), public_key_type( keys.back().get_public_key() ) ).id );
+      }
+      generate_block( database::skip_authority_check );
+      for( const auto& id : accounts )
+         transfer( account_id_type(), id, asset( 1000000 ) );
+      generate_block( database::skip_authority_check );
+      const uint32_t setup_blocks = db.head_block_num();
+
+      // signed transfers between random accounts, most of them touching disjoint objects
+      std::mt19937 rng( 1 );
+      for( uint32_t b = 0; b < num_blocks; ++b )
+      {
+         for( uint32_t n = 0; n < transfers_per_block; ++n )
+         {
+            const uint32_t from = rng() % num_accounts;
+            signed_transaction tx;
+            transfer_operation xfer_op;
+            xfer_op.from = accounts[from];
+            xfer_op.to = accounts[rng() % num_accounts];
+            xfer_op.amount = asset( 1 + rng() % 1000, asset_id_type() );
+            xfer_op.fee = asset( 0, asset_id_type() );
+            tx.operations.push_back( xfer_op );
+            tx.set_expiration( db.head_block_time() + 10 * db.get_global_properties().parameters.block_interval );
+            sign( tx, keys[from] );
+            try {
+               PUSH_TX( db, tx );
+            } catch( const fc::exception& ) {
+               // self transfers and duplicates are left out
+            }
+         }
+         generate_block( database::skip_nothing );
+      }
+
+      vector<uint32_t> thread_counts = { 1, 2, 4, 8 };
+      const uint32_t cores = std::max( 1u, std::thread::hardware_concurrency() );
+      if( cores > 8 )
+         thread_counts.push_back( cores );
+
+      optional<fc::sha256> serial_state;
+      int64_t serial_time = 0;
+      for( uint32_t threads : thread_counts )
+      {
+         fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+         database replica;
+         replica.open( data_dir.path(), [this]{ return genesis_state; } );
+         replica.set_parallel_apply_threads( threads );
+         for( uint32_t num = 1; num <= setup_blocks; ++num )
+            replica.push_block( *db.fetch_block_by_number( num ), database::skip_witness_signature | database::skip_authority_check );
+
+         const auto start = fc::time_point::now();
+         for( uint32_t num = setup_blocks + 1; num <= db.head_block_num(); ++num )
+            replica.push_block( *db.fetch_block_by_number( num ), database::skip_witness_signature );
+         const int64_t elapsed = ( fc::time_point::now() - start ).count();
+
+         std::stringstream state;
+         replica.export_state( state, 0 );
+         const auto state_hash = fc::sha256::hash( state.str() );
+         if( !serial_state.valid() )
+         {
+            serial_state = state_hash;
+            serial_time = elapsed;
+         }
+         BOOST_CHECK( state_hash == *serial_state );
+
+         const auto& counters = replica.get_parallel_apply_counters();
+         ilog( "Applied ${b} blocks of ${t} transfers with ${n} threads in ${ms} ms, ${x}x the serial speed "
+               "(${a} transactions checked ahead, ${r} again)",
+               ("b",num_blocks)("t",transfers_per_block)("n",threads)("ms",elapsed / 1000)
+               ("x",double( serial_time ) / std::max<int64_t>( elapsed, 1 ))
+               ("a",counters.verified_ahead)("r",counters.reverified) );
+      }
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
@@ -0,0 +1,575 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ *  net_bench: measures how blocks and transactions propagate across a P2P topology.
+ *
+ *  Every node is a full application with its own database, running in this process and listening on its own
+ *  loopback port, so what is measured is node_impl itself.  The topology is a ring with chords drawn from the
+ *  seed, and node::set_allowed_peers keeps peer exchange from adding connections to it.  Each connection crosses
+ *  a simulated link, see message_oriented_connection::set_link_model(), whose latency, jitter and bandwidth are
+ *  drawn from the seed as well.  The nodes take turns broadcasting transfers and producing blocks, each
+ *  database's signals record when its node accepted an item, and the traffic comes from the nodes' own per-peer
+ *  statistics.  Nothing leaves the machine.
+ *
+ *  The topology, the links and the workload are the same for a seed, but the nodes run on the wall clock and
+ *  their own threads, so latencies and what is relayed through which peer vary from run to run.
+ */
+
+#include <graphene/app/application.hpp>
+
+#include <graphene/chain/account_object.hpp>
+#include <graphene/chain/balance_object.hpp>
+
+#include <graphene/net/core_messages.hpp>
+#include <graphene/net/message_oriented_connection.hpp>
+#include <graphene/net/node.hpp>
+
+#include <graphene/utilities/tempdir.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/smart_ref_impl.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/variant_object.hpp>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+
+using namespace graphene::chain;
+namespace bpo = boost::program_options;
+
+// hack:  import create_example_genesis() even though it's a way, way
+// specific internal detail
+namespace graphene { namespace app { namespace detail {
+genesis_state_type create_example_genesis();
+} } } // graphene::app::detail
+
+namespace {
+
+struct bench_options
+{
+   uint32_t nodes;
+   uint32_t peers;
+   uint32_t blocks;
+   uint32_t transactions;
+   uint32_t latency_ms;
+   uint32_t latency_spread_ms;
+   uint32_t jitter_ms;
+   uint32_t bandwidth_kbps;
+   uint16_t base_port;
+   uint32_t timeout_ms;
+   uint64_t seed;
+};
+
+/** a block or transaction and when each node accepted it */
+struct item
+{
+   bool                        is_block = false;
+   uint32_t                    origin = 0;
+   fc::time_point              created;
+   std::vector<fc::time_point> arrival;   ///< per node, left at the epoch until the node accepted the item
+};
+
+struct traffic
+{
+   uint64_t messages = 0;
+   uint64_t bytes = 0;
+};
+
+class bench_network
+{
+   public:
+      explicit bench_network( const bench_options& options );
+      ~bench_network();
+
+      void start();
+      void run();
+      void report( std::ostream& out ) const;
+
+   private:
+      fc::ip::endpoint endpoint( uint32_t node )const;
+      uint32_t add_item( bool is_block, uint32_t origin );
+      void accepted( uint32_t item_number, uint32_t node );
+      bool reached_everyone( uint32_t first_item )const;
+      /// lets the nodes run until @p done or the timeout, returning whether it was done
+      bool wait_until( const std::function<bool()>& done )const;
+
+      void choose_topology();
+      fc::optional<graphene::net::link_model> link_between( const fc::ip::endpoint& local, const fc::ip::endpoint& remote );
+      void connect();
+      void claim_balance();
+      void broadcast_transfer( uint32_t origin );
+      void produce_block( uint32_t producer );
+
+      bench_options                                         _options;
+      std::mt19937_64                                       _random;
+      std::set< std::pair<uint32_t, uint32_t> >             _connections;
+      std::vector<uint32_t>                                 _connection_count;
+      /// the link each connection end receives over, by its own and the sending node's port
+      std::map< std::pair<uint16_t, uint16_t>, graphene::net::link_model > _links;
+      std::atomic<uint32_t>                                 _unshaped_connections{ 0 };
+      fc::ecc::private_key                                  _nathan_key;
+      account_id_type                                       _nathan;
+      uint64_t                                              _transfers = 0;
+      uint32_t                                              _rounds_timed_out = 0;
+
+      std::vector<item>                                     _items;
+      std::map<transaction_id_type, uint32_t>               _transaction_items;
+      std::map<uint32_t, uint32_t>                          _block_items;  ///< block number -> item
+
+      fc::temp_directory                                    _data_dir;
+      /// last, so the nodes are gone before anything their signals write to
+      std::vector< std::unique_ptr<graphene::app::application> > _nodes;
+};
+
+bench_network::bench_network( const bench_options& options )
+   : _options( options ),
+     _random( options.seed ),
+     _nathan_key( fc::ecc::private_key::regenerate( fc::sha256::hash( std::string( "nathan" ) ) ) ),
+     _data_dir( graphene::utilities::temp_directory_path() )
+{
+}
+
+bench_network::~bench_network()
+{
+   graphene::net::message_oriented_connection::set_link_model( graphene::net::link_model_function() );
+}
+
+fc::ip::endpoint bench_network::endpoint( uint32_t node )const
+{
+   return fc::ip::endpoint( fc::ip::address( "127.0.0.1" ), uint16_t( _options.base_port + node ) );
+}
+
+uint32_t bench_network::add_item( bool is_block, uint32_t origin )
+{
+   item new_item;
+   new_item.is_block = is_block;
+   new_item.origin = origin;
+   new_item.created = fc::time_point::now();
+   new_item.arrival.resize( _nodes.size() );
+   _items.push_back( new_item );
+   return uint32_t( _items.size() - 1 );
+}
+
+void bench_network::accepted( uint32_t item_number, uint32_t node )
+{
+   fc::time_point& arrival = _items[item_number].arrival[node];
+   if( arrival == fc::time_point() )
+      arrival = fc::time_point::now();
+}
+
+bool bench_network::reached_everyone( uint32_t first_item )const
+{
+   for( uint32_t i = first_item; i < _items.size(); ++i )
+      for( const fc::time_point& arrival : _items[i].arrival )
+         if( arrival == fc::time_point() )
+            return false;
+   return true;
+}
+
+bool bench_network::wait_until( const std::function<bool()>& done )const
+{
+   const fc::time_point deadline = fc::time_point::now() + fc::milliseconds( _options.timeout_ms );
+   while( !done() )
+   {
+      if( fc::time_point::now() >= deadline )
+         return false;
+      fc::usleep( fc::milliseconds( 2 ) );
+   }
+   return true;
+}
+
+void bench_network::choose_topology()
+{
+   const uint32_t node_count = _options.nodes;
+   _connection_count.assign( node_count, 0 );
+   auto add_connection = [this]( uint32_t a, uint32_t b ) {
+      if( a == b || !_connections.insert( std::make_pair( std::min( a, b ), std::max( a, b ) ) ).second )
+         return;
+      ++_connection_count[a];
+      ++_connection_count[b];
+   };
+
+   // a ring keeps every node reachable, chords between nodes still short of peers shorten the paths
+   for( uint32_t i = 0; i < node_count; ++i )
+      add_connection( i, ( i + 1 ) % node_count );
+   std::uniform_int_distribution<uint32_t> any_node( 0, node_count - 1 );
+   for( uint32_t attempt = 0; attempt < node_count * _options.peers * 10; ++attempt )
+   {
+      const uint32_t a = any_node( _random );
+      const uint32_t b = any_node( _random );
+      if( _connection_count[a] < _options.peers && _connection_count[b] < _options.peers )
+         add_connection( a, b );
+   }
+
+   // the same latency and bandwidth both ways, with jitter of its own in each direction
+   std::uniform_int_distribution<uint32_t> spread( 0, _options.latency_spread_ms );
+   for( const auto& connection : _connections )
+   {
+      graphene::net::link_model link;
+      link.latency = fc::milliseconds( _options.latency_ms + spread( _random ) );
+      link.jitter = fc::milliseconds( _options.jitter_ms );
+      link.bytes_per_second = uint64_t( _options.bandwidth_kbps ) * 125;
+      const uint16_t first_port = endpoint( connection.first ).port();
+      const uint16_t second_port = endpoint( connection.second ).port();
+      link.seed = _random();
+      _links[ std::make_pair( first_port, second_port ) ] = link;
+      link.seed = _random();
+      _links[ std::make_pair( second_port, first_port ) ] = link;
+   }
+}
+
+fc::optional<graphene::net::link_model> bench_network::link_between( const fc::ip::endpoint& local, const fc::ip::endpoint& remote )
+{
+   // both ends are known by their nodes' listening ports, as nodes bind their outgoing connections to them
+   auto itr = _links.find( std::make_pair( local.port(), remote.port() ) );
+   if( itr == _links.end() )
+   {
+      ++_unshaped_connections;
+      return fc::optional<graphene::net::link_model>();
+   }
+   return itr->second;
+}
+
+void bench_network::start()
+{
+   genesis_state_type genesis = graphene::app::detail::create_example_genesis();
+   // far enough in the past that every block of the run has a slot before now, nodes reject blocks from the future
+   const uint32_t interval = genesis.initial_parameters.block_interval;
+   uint32_t genesis_time = fc::time_point_sec( fc::time_point::now() ).sec_since_epoch() - ( _options.blocks + 2 ) * interval;
+   genesis.initial_timestamp = fc::time_point_sec( genesis_time - genesis_time % interval );
+   const fc::path genesis_file = _data_dir.path() / "genesis.json";
+   fc::json::save_to_file( genesis, genesis_file );
+
+   for( uint32_t i = 0; i < _options.nodes; ++i )
+   {
+      bpo::variables_map cfg;
+      cfg.emplace( "p2p-endpoint", bpo::variable_value( std::string( endpoint( i ) ), false ) );
+      cfg.emplace( "genesis-json", bpo::variable_value( boost::filesystem::path( genesis_file.generic_string() ), false ) );
+      // no seed nodes, the topology is all the connections there are
+      cfg.emplace( "seed-nodes", bpo::variable_value( std::string( "[]" ), false ) );
+      // every transfer comes from the same account
+      cfg.emplace( "pending-tx-max-per-account", bpo::variable_value( uint32_t( _options.transactions * 4 + 16 ), false ) );
+
+      std::unique_ptr<graphene::app::application> node( new graphene::app::application );
+      node->initialize( _data_dir.path() / ( "node" + fc::to_string( uint64_t( i ) ) ), cfg );
+      node->startup();
+
+      const std::shared_ptr<database> db = node->chain_database();
+      db->applied_block.connect( [this, i]( const signed_block& block ) {
+         auto itr = _block_items.find( block.block_num() );
+         if( itr != _block_items.end() )
+            accepted( itr->second, i );
+      } );
+      db->on_pending_transaction.connect( [this, i]( const signed_transaction& trx ) {
+         auto itr = _transaction_items.find( trx.id() );
+         if( itr != _transaction_items.end() )
+            accepted( itr->second, i );
+      } );
+      _nodes.push_back( std::move( node ) );
+   }
+
+   choose_topology();
+   connect();
+   claim_balance();
+}
+
+void bench_network::connect()
+{
+   std::vector< std::vector<graphene::net::node_id_t> > allowed_peers( _nodes.size() );
+   for( const auto& connection : _connections )
+   {
+      allowed_peers[connection.first].push_back( _nodes[connection.second]->p2p_node()->get_node_id() );
+      allowed_peers[connection.second].push_back( _nodes[connection.first]->p2p_node()->get_node_id() );
+   }
+   for( uint32_t i = 0; i < _nodes.size(); ++i )
+   {
+      const graphene::net::node_ptr p2p = _nodes[i]->p2p_node();
+      p2p->set_allowed_peers( allowed_peers[i] );
+      // only the connections made below, none the node would look for itself
+      p2p->set_advanced_node_parameters( fc::mutable_variant_object( "desired_number_of_connections", 0 ) );
+   }
+
+   // the links are all drawn and no longer change, the nodes' threads only look them up
+   graphene::net::message_oriented_connection::set_link_model(
+      [this]( const fc::ip::endpoint& local, const fc::ip::endpoint& remote ) { return link_between( local, remote ); } );
+   for( const auto& connection : _connections )
+      _nodes[connection.first]->p2p_node()->connect_to_endpoint( endpoint( connection.second ) );
+   const bool connected = wait_until( [this]() {
+      for( uint32_t i = 0; i < _nodes.size(); ++i )
+         if( _nodes[i]->p2p_node()->get_connection_count() != _connection_count[i] )
+            return false;
+      return true;
+   } );
+   if( !connected )
+      std::cerr << "net_bench:  not every connection of the topology was established, continuing anyway\n";
+   if( _unshaped_connections )
+      std::cerr << "net_bench:  " << _unshaped_connections << " connection ends could not be matched to a link and run "
+                << "at loopback speed, continuing anyway\n";
+}
+
+void bench_network::claim_balance()
+{
+   // a block moving the genesis balance to nathan, whose transfers are the workload
+   const std::shared_ptr<database> db = _nodes[0]->chain_database();
+   _nathan = db->get_index_type<account_index>().indices().get<by_name>().find( "nathan" )->id;
+
+   signed_transaction trx;
+   balance_claim_operation claim_op;
+   claim_op.deposit_to_account = _nathan;
+   claim_op.balance_to_claim = balance_id_type();
+   claim_op.balance_owner_key = _nathan_key.get_public_key();
+   claim_op.total_claimed = balance_id_type()( *db ).balance;
+   trx.operations.push_back( claim_op );
+   db->current_fee_schedule().set_fee( trx.operations.back() );
+   trx.set_reference_block( db->head_block_id() );
+   trx.set_expiration( db->get_slot_time( 10 ) );
+   trx.sign( _nathan_key, db->get_chain_id() );
+   db->push_transaction( trx );
+
+   produce_block( 0 );
+   if( !wait_until( [this]() { return reached_everyone( 0 ); } ) )
+      std::cerr << "net_bench:  not every node got the first block, continuing anyway\n";
+   _items.clear();
+   _block_items.clear();
+}
+
+void bench_network::broadcast_transfer( uint32_t origin )
+{
+   const std::shared_ptr<database> db = _nodes[origin]->chain_database();
+   signed_transaction trx;
+   transfer_operation xfer_op;
+   xfer_op.from = _nathan;
+   xfer_op.to = GRAPHENE_NULL_ACCOUNT;
+   xfer_op.amount = asset( ++_transfers );
+   trx.operations.push_back( xfer_op );
+   db->current_fee_schedule().set_fee( trx.operations.back() );
+   trx.set_reference_block( db->head_block_id() );
+   trx.set_expiration( db->get_slot_time( 10 ) );
+   trx.sign( _nathan_key, db->get_chain_id() );
+
+   _transaction_items[trx.id()] = add_item( false, origin );
+   db->push_transaction( trx );
+   _nodes[origin]->p2p_node()->broadcast( graphene::net::trx_message( trx ) );
+}
+
+void bench_network::produce_block( uint32_t producer )
+{
+   const std::shared_ptr<database> db = _nodes[producer]->chain_database();
+   _block_items[db->head_block_num() + 1] = add_item( true, producer );
+   const signed_block block = db->generate_block( db->get_slot_time( 1 ), db->get_scheduled_witness( 1 ),
+                                                  _nathan_key, database::skip_nothing );
+   _nodes[producer]->p2p_node()->broadcast( graphene::net::block_message( block ) );
+}
+
+void bench_network::run()
+{
+   for( uint32_t round = 0; round < _options.blocks; ++round )
+   {
+      uint32_t first_item = uint32_t( _items.size() );
+      for( uint32_t i = 0; i < _options.transactions; ++i )
+         broadcast_transfer( ( round * _options.transactions + i ) % _nodes.size() );
+      if( !wait_until( [this, first_item]() { return reached_everyone( first_item ); } ) )
+         ++_rounds_timed_out;
+
+      first_item = uint32_t( _items.size() );
+      produce_block( round % _nodes.size() );
+      if( !wait_until( [this, first_item]() { return reached_everyone( first_item ); } ) )
+         ++_rounds_timed_out;
+   }
+}
+
+void bench_network::report( std::ostream& out ) const
+{
+   uint32_t fewest_peers = *std::min_element( _connection_count.begin(), _connection_count.end() );
+   uint32_t most_peers = *std::max_element( _connection_count.begin(), _connection_count.end() );
+   out << std::fixed << std::setprecision( 1 );
+   out << "nodes " << _nodes.size() << ", " << _connections.size() << " connections (" << fewest_peers << " to "
+       << most_peers << " per node), seed " << _options.seed << "\n";
+   out << "links: latency " << _options.latency_ms << " to " << _options.latency_ms + _options.latency_spread_ms
+       << " ms, jitter up to " << _options.jitter_ms << " ms, bandwidth ";
+   if( _options.bandwidth_kbps )
+      out << _options.bandwidth_kbps << " kbit/s";
+   else
+      out << "unlimited";
+   out << "\n";
+   if( _rounds_timed_out )
+      out << _rounds_timed_out << " blocks or transaction floods did not reach every node within "
+          << _options.timeout_ms << " ms\n";
+   out << "\n";
+
+   // what each node accepted from the network, to tell the items it was sent more than once
+   std::vector<uint64_t> blocks_accepted( _nodes.size() ), transactions_accepted( _nodes.size() );
+
+   out << "propagation latency (ms)  items     p50       p90       p99       max    reached\n";
+   for( bool blocks : { true, false } )
+   {
+      std::vector<int64_t> latencies;
+      uint32_t count = 0;
+      uint64_t reached = 0, expected = 0;
+      for( const item& i : _items )
+      {
+         if( i.is_block != blocks )
+            continue;
+         ++count;
+         for( uint32_t node = 0; node < i.arrival.size(); ++node )
+         {
+            if( node == i.origin )
+               continue;
+            ++expected;
+            if( i.arrival[node] != fc::time_point() )
+            {
+               ++reached;
+               latencies.push_back( ( i.arrival[node] - i.created ).count() );
+               ++( blocks ? blocks_accepted : transactions_accepted )[node];
+            }
+         }
+      }
+      std::sort( latencies.begin(), latencies.end() );
+      auto percentile = [&]( double p ) {
+         return latencies.empty() ? 0.0 : latencies[std::min( latencies.size() - 1, size_t( p * latencies.size() ) )] / 1000.0;
+      };
+      out << std::left << std::setw( 24 ) << ( blocks ? "  blocks" : "  transactions" ) << std::right
+          << std::setw( 8 ) << count
+          << std::setw( 9 ) << percentile( 0.5 ) << " " << std::setw( 9 ) << percentile( 0.9 ) << " "
+          << std::setw( 9 ) << percentile( 0.99 ) << " " << std::setw( 9 ) << percentile( 1.0 ) << " "
+          << std::setw( 8 ) << ( expected ? 100.0 * reached / expected : 100.0 ) << "%\n";
+   }
+
+   std::map<uint32_t, traffic> sent_by_type;
+   std::vector<uint64_t> bytes_per_node;
+   int64_t duplicate_blocks = 0, duplicate_transactions = 0;
+   for( uint32_t node = 0; node < _nodes.size(); ++node )
+   {
+      uint64_t bytes = 0;
+      int64_t blocks_received = 0, transactions_received = 0;
+      for( const graphene::net::peer_traffic_statistics& peer : _nodes[node]->p2p_node()->get_peer_traffic_statistics() )
+      {
+         bytes += peer.total_bytes_sent + peer.total_bytes_received;
+         for( const graphene::net::message_type_traffic& type : peer.message_types )
+         {
+            sent_by_type[type.message_type].messages += type.messages_sent;
+            sent_by_type[type.message_type].bytes += type.bytes_sent;
+            if( type.message_type == graphene::net::block_message_type ||
+                type.message_type == graphene::net::compact_block_message_type )
+               blocks_received += type.messages_received;
+            else if( type.message_type == graphene::net::trx_message_type )
+               transactions_received += type.messages_received;
+         }
+      }
+      bytes_per_node.push_back( bytes );
+      duplicate_blocks += std::max<int64_t>( blocks_received - int64_t( blocks_accepted[node] ), 0 );
+      duplicate_transactions += std::max<int64_t>( transactions_received - int64_t( transactions_accepted[node] ), 0 );
+   }
+
+   out << "\nduplicates: " << duplicate_transactions << " transactions, " << duplicate_blocks
+       << " blocks received by a node that already had them\n";
+
+   std::sort( bytes_per_node.begin(), bytes_per_node.end() );
+   uint64_t total_bytes = 0;
+   for( uint64_t bytes : bytes_per_node )
+      total_bytes += bytes;
+   out << "bytes sent + received per node: mean " << total_bytes / std::max<size_t>( bytes_per_node.size(), 1 )
+       << ", median " << bytes_per_node[bytes_per_node.size() / 2] << ", max " << bytes_per_node.back() << "\n\n";
+
+   out << "message type                                        messages         bytes\n";
+   for( const auto& type_and_traffic : sent_by_type )
+      out << "  " << std::left << std::setw( 48 )
+          << fc::reflector<graphene::net::core_message_type_enum>::to_string( type_and_traffic.first ) << std::right
+          << std::setw( 10 ) << type_and_traffic.second.messages << std::setw( 14 ) << type_and_traffic.second.bytes << "\n";
+}
+
+} // anonymous namespace
+
+int main( int argc, char** argv )
+{
+   try
+   {
+      bpo::options_description cli_options( "Measure block and transaction propagation across in-process nodes over simulated links" );
+      cli_options.add_options()
+            ("help,h", "Print this help message and exit.")
+            ("nodes,n", bpo::value<uint32_t>()->default_value( 8 ), "Number of nodes")
+            ("peers,p", bpo::value<uint32_t>()->default_value( 3 ), "Connections each node gets, at least 2 for the ring")
+            ("blocks", bpo::value<uint32_t>()->default_value( 20 ), "Number of blocks produced")
+            ("transactions", bpo::value<uint32_t>()->default_value( 50 ), "Transactions broadcast before each block")
+            ("latency", bpo::value<uint32_t>()->default_value( 20 ), "Least one-way latency of a link in milliseconds")
+            ("latency-spread", bpo::value<uint32_t>()->default_value( 80 ), "Each link's latency exceeds the least by up to this many milliseconds")
+            ("jitter", bpo::value<uint32_t>()->default_value( 5 ), "Up to this many milliseconds are added to the latency of each message")
+            ("bandwidth", bpo::value<uint32_t>()->default_value( 10000 ), "Bandwidth of each link and direction in kbit/s, 0 for no limit")
+            ("base-port", bpo::value<uint16_t>()->default_value( 29100 ), "Loopback port of the first node, the others follow it")
+            ("timeout", bpo::value<uint32_t>()->default_value( 5000 ), "Milliseconds to wait for an item to reach every node")
+            ("seed", bpo::value<uint64_t>()->default_value( 1 ), "Seed for the topology and the links")
+            ;
+
+      bpo::variables_map options;
+      try
+      {
+         bpo::store( bpo::parse_command_line( argc, argv, cli_options ), options );
+      }
+      catch( const bpo::error& e )
+      {
+         std::cerr << "net_bench:  error parsing command line: " << e.what() << "\n";
+         return 1;
+      }
+      if( options.count( "help" ) )
+      {
+         std::cout << cli_options << "\n";
+         return 0;
+      }
+
+      bench_options bench;
+      bench.nodes = std::max( options["nodes"].as<uint32_t>(), 2u );
+      bench.peers = std::min( std::max( options["peers"].as<uint32_t>(), 2u ), bench.nodes - 1 );
+      bench.blocks = options["blocks"].as<uint32_t>();
+      bench.transactions = options["transactions"].as<uint32_t>();
+      bench.latency_ms = options["latency"].as<uint32_t>();
+      bench.latency_spread_ms = options["latency-spread"].as<uint32_t>();
+      bench.jitter_ms = options["jitter"].as<uint32_t>();
+      bench.bandwidth_kbps = options["bandwidth"].as<uint32_t>();
+      bench.base_port = options["base-port"].as<uint16_t>();
+      bench.timeout_ms = options["timeout"].as<uint32_t>();
+      bench.seed = options["seed"].as<uint64_t>();
+
+      bench_network network( bench );
+      network.start();
+      network.run();
+      network.report( std::cout );
+   }
+   catch( const fc::exception& e )
+   {
+      std::cerr << e.to_detail_string() << "\n";
+      return 1;
+   }
+   return 0;
+}
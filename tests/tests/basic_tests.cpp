@@ -410,4 +410,40 @@ BOOST_AUTO_TEST_CASE( merkle_root )
    BOOST_CHECK( block.calculate_merkle_root() == c(dO) );
 }
 
+BOOST_AUTO_TEST_CASE( cached_ids )
+{
+   signed_transaction trx;
+   transfer_operation op;
+   op.amount = asset(1);
+   trx.operations.push_back( op );
+   trx.set_expiration( fc::time_point_sec( 1000 ) );
+
+   const uint64_t reused_before = get_id_cache_counters().reused;
+   BOOST_CHECK( trx.cached_id() == trx.id() );
+   BOOST_CHECK( trx.cached_id() == trx.id() );
+   BOOST_CHECK_EQUAL( get_id_cache_counters().reused - reused_before, 1u );
+
+   // setters drop the memoized id, direct edits require an explicit invalidation
+   auto old_id = trx.id();
+   trx.set_expiration( fc::time_point_sec( 2000 ) );
+   BOOST_CHECK( trx.cached_id() != old_id );
+   BOOST_CHECK( trx.cached_id() == trx.id() );
+   trx.operations.push_back( op );
+   BOOST_CHECK( trx.cached_id() != trx.id() );
+   trx.invalidate_cached_id();
+   BOOST_CHECK( trx.cached_id() == trx.id() );
+   BOOST_CHECK( trx.cached_sig_digest( db.get_chain_id() ) == trx.sig_digest( db.get_chain_id() ) );
+
+   signed_block block;
+   block.transactions.push_back( trx );
+   block.timestamp = fc::time_point_sec( 10 );
+   BOOST_CHECK( block.cached_id() == block.id() );
+   block.sign( fc::ecc::private_key::regenerate( fc::sha256::hash( string( "null_key" ) ) ) );
+   BOOST_CHECK( block.cached_id() == block.id() );
+
+   block.transactions.back().operations.clear();
+   block.invalidate_cached_ids();
+   BOOST_CHECK( block.transactions.back().cached_id() == block.transactions.back().id() );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
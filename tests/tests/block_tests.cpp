@@ -35,10 +35,16 @@
 
 #include <graphene/utilities/tempdir.hpp>
 
+#include <graphene/net/core_messages.hpp>
+#include <graphene/net/message.hpp>
+
 #include <fc/crypto/digest.hpp>
 
 #include "../common/database_fixture.hpp"
 
+#include <random>
+#include <sstream>
+
 using namespace graphene::chain;
 using namespace graphene::chain::test;
 
@@ -125,6 +131,134 @@ BOOST_AUTO_TEST_CASE( block_database_test )
    }
 }
 
+BOOST_AUTO_TEST_CASE( chunked_block_database )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      const fc::path raw_dir = data_dir.path() / "raw";
+
+      block_database bdb;
+      bdb.set_chunk_size( 4 );
+      bdb.open( data_dir.path() );
+      BOOST_CHECK_EQUAL( bdb.blocks_per_chunk(), 4u );
+
+      vector<signed_block> blocks;
+      signed_block b;
+      for( uint32_t i = 0; i < 10; ++i )
+      {
+         if( i > 0 ) b.previous = b.id();
+         b.witness = witness_id_type(i+1);
+         bdb.store( b.id(), b );
+         blocks.push_back( b );
+      }
+
+      auto check_blocks = [&]()
+      {
+         for( const signed_block& blk : blocks )
+         {
+            const auto fetched = bdb.fetch_by_number( blk.block_num() );
+            BOOST_REQUIRE( fetched.valid() );
+            BOOST_CHECK( fetched->id() == blk.id() );
+            BOOST_CHECK( bdb.fetch_optional( blk.id() ).valid() );
+            BOOST_CHECK( bdb.contains( blk.id() ) );
+         }
+         BOOST_CHECK( bdb.last()->id() == blocks.back().id() );
+      };
+
+      // blocks 1 to 7 fill chunks 0 and 1, blocks 8 to 10 stay in the raw file of chunk 2
+      bdb.compress_until( 9 );
+      BOOST_CHECK( !fc::exists( raw_dir / "0" ) );
+      BOOST_CHECK( !fc::exists( raw_dir / "1" ) );
+      BOOST_CHECK( fc::exists( raw_dir / "2" ) );
+      check_blocks();
+
+      // a replaced block goes to a raw file until its chunk is compressed again
+      signed_block fork = blocks[5];
+      fork.witness = witness_id_type(100);
+      bdb.remove( blocks[5].id() );
+      BOOST_CHECK( !bdb.fetch_by_number( 6 ).valid() );
+      bdb.store( fork.id(), fork );
+      BOOST_CHECK( bdb.fetch_by_number( 6 )->witness == fork.witness );
+      bdb.compress_until( 9 );
+      BOOST_CHECK( !fc::exists( raw_dir / "1" ) );
+      BOOST_CHECK( bdb.fetch_by_number( 6 )->witness == fork.witness );
+      BOOST_CHECK( bdb.fetch_by_number( 7 )->id() == blocks[6].id() );
+      bdb.remove( fork.id() );
+      bdb.store( blocks[5].id(), blocks[5] );
+
+      // an existing database keeps its storage mode
+      bdb.close();
+      bdb.set_chunk_size( 0 );
+      bdb.open( data_dir.path() );
+      BOOST_CHECK_EQUAL( bdb.blocks_per_chunk(), 4u );
+      check_blocks();
+      bdb.compress_until( 11 );
+      BOOST_CHECK( !fc::exists( raw_dir / "1" ) );
+      BOOST_CHECK( !fc::exists( raw_dir / "2" ) );
+      check_blocks();
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( block_database_ranges )
+{
+   try {
+      for( uint32_t chunk_size : { 0u, 4u } )
+      {
+         fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+         block_database bdb;
+         bdb.set_chunk_size( chunk_size );
+         bdb.open( data_dir.path() );
+
+         vector<signed_block> blocks;
+         signed_block b;
+         for( uint32_t i = 0; i < 10; ++i )
+         {
+            if( i > 0 ) b.previous = b.id();
+            b.witness = witness_id_type(i+1);
+            bdb.store( b.id(), b );
+            blocks.push_back( b );
+         }
+         // when chunked, blocks 1 to 7 are compressed and the rest are in a raw file
+         bdb.compress_until( 8 );
+
+         const vector<block_id_type> ids = bdb.fetch_block_ids( 1, 20 );
+         BOOST_REQUIRE_EQUAL( ids.size(), blocks.size() );
+         for( size_t i = 0; i < ids.size(); ++i )
+            BOOST_CHECK( ids[i] == blocks[i].id() );
+         BOOST_CHECK( bdb.fetch_block_ids( 11, 5 ).empty() );
+
+         vector<packed_block> packed = bdb.fetch_packed_blocks( 3, 8 );
+         BOOST_REQUIRE_EQUAL( packed.size(), 8u );
+         for( size_t i = 0; i < packed.size(); ++i )
+         {
+            const signed_block& expected = blocks[i + 2];
+            BOOST_CHECK( packed[i].id == expected.id() );
+            BOOST_CHECK( packed[i].data == fc::raw::pack( expected ) );
+            // served to peers without being unpacked
+            const graphene::net::message served = graphene::net::packed_block_message( packed[i].id, packed[i].data );
+            BOOST_CHECK( served.data == graphene::net::message( graphene::net::block_message( expected ) ).data );
+         }
+
+         // the size limit stops the range, but the first block is always returned
+         const uint64_t block_size = fc::raw::pack_size( blocks[0] );
+         BOOST_CHECK_EQUAL( bdb.fetch_packed_blocks( 1, 10, 3 * block_size ).size(), 3u );
+         BOOST_CHECK_EQUAL( bdb.fetch_packed_blocks( 1, 10, 1 ).size(), 1u );
+
+         // a removed block ends the range
+         bdb.remove( blocks.back().id() );
+         bdb.remove( blocks[8].id() );
+         BOOST_CHECK_EQUAL( bdb.fetch_packed_blocks( 5, 10 ).size(), 4u );
+         bdb.close();
+      }
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( generate_empty_blocks )
 {
    try {
@@ -180,6 +314,183 @@ BOOST_AUTO_TEST_CASE( generate_empty_blocks )
    }
 }
 
+BOOST_AUTO_TEST_CASE( compressed_object_database )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+      size_t account_count = 0;
+      {
+         database db;
+         db.set_compression( true );
+         db.set_io_threads( 2 );
+         db.open(data_dir.path(), make_genesis );
+         for( uint32_t i = 0; i < 10; ++i )
+            db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+         account_count = db.get_index_type<account_index>().indices().size();
+         db.close();
+      }
+      BOOST_CHECK( fc::exists( data_dir.path() / "object_database" ) );
+      BOOST_CHECK( !fc::exists( data_dir.path() / "object_database.tmp" ) );
+      BOOST_CHECK( !fc::exists( data_dir.path() / "object_database.old" ) );
+      {
+         database db;
+         db.open(data_dir.path(), []{return genesis_state_type();});
+         BOOST_CHECK_EQUAL( db.get_index_type<account_index>().indices().size(), account_count );
+         db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+      }
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( resume_from_state_checkpoint )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+      uint32_t head_num = 0;
+      {
+         database db;
+         db.open(data_dir.path(), make_genesis );
+         db.set_state_checkpoint_interval( 10 );
+         for( uint32_t i = 0; i < 50; ++i )
+            db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+         head_num = db.head_block_num();
+         // not closed, as if the node had been killed
+      }
+      BOOST_CHECK( fc::exists( data_dir.path() / "state_checkpoints" ) );
+      {
+         database db;
+         BOOST_REQUIRE( db.resume_from_state_checkpoint( data_dir.path() ) );
+         BOOST_CHECK_EQUAL( db.head_block_num(), head_num );
+         db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+         BOOST_CHECK_EQUAL( db.head_block_num(), head_num + 1 );
+      }
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( state_checkpoint_written_in_slices )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+      auto state_hash = []( const database& d ) -> fc::sha256
+      {
+         std::stringstream state;
+         d.export_state( state, 0 );
+         return fc::sha256::hash( state.str() );
+      };
+      const fc::path checkpoints_dir = data_dir.path() / "state_checkpoints";
+      fc::sha256 head_state;
+      {
+         database db;
+         db.open(data_dir.path(), make_genesis );
+         db.set_state_checkpoint_interval( 10, 20 );
+         while( db.get_dynamic_global_properties().last_irreversible_block_num < 10 )
+            db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+
+         // the block that crosses the interval only starts the checkpoint
+         const uint32_t checkpoint_num = db.get_dynamic_global_properties().last_irreversible_block_num;
+         const fc::path checkpoint_dir = checkpoints_dir / fc::to_string( checkpoint_num );
+         BOOST_REQUIRE( fc::exists( checkpoint_dir ) );
+         BOOST_CHECK( !fc::exists( checkpoint_dir / "head_block_id" ) );
+
+         // the rest is saved with the following blocks, which keep changing the state it was taken of
+         uint32_t blocks = 0;
+         while( !fc::exists( checkpoint_dir / "head_block_id" ) && blocks++ < 1000 )
+            db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+         BOOST_REQUIRE( fc::exists( checkpoint_dir / "head_block_id" ) );
+         BOOST_CHECK_GT( blocks, 1u );
+         BOOST_CHECK_GT( db.head_block_num(), db.get_dynamic_global_properties().last_irreversible_block_num );
+
+         head_state = state_hash( db );
+         // not closed, as if the node had been killed
+      }
+      {
+         database db;
+         BOOST_REQUIRE( db.resume_from_state_checkpoint( data_dir.path() ) );
+         BOOST_CHECK( state_hash( db ) == head_state );
+      }
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( state_snapshot )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      fc::temp_directory clone_dir( graphene::utilities::temp_directory_path() );
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+
+      database db;
+      db.open(data_dir.path(), make_genesis );
+      for( uint32_t i = 0; i < 30; ++i )
+         db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+
+      const auto header = db.create_state_snapshot( data_dir.path() / "snapshot" );
+      BOOST_CHECK_EQUAL( header.head_block.block_num(), db.get_dynamic_global_properties().last_irreversible_block_num );
+
+      database clone;
+      clone.open_from_state_snapshot( clone_dir.path(), data_dir.path() / "snapshot" );
+      BOOST_CHECK( clone.head_block_id() == header.head_block.id() );
+
+      // the clone follows the chain from the snapshot's block on
+      for( uint32_t num = clone.head_block_num() + 1; num <= db.head_block_num(); ++num )
+         clone.push_block( *db.fetch_block_by_number( num ) );
+      BOOST_CHECK( clone.head_block_id() == db.head_block_id() );
+
+      // the clone has no blocks before the snapshot and says so
+      const uint32_t snapshot_num = header.head_block.block_num();
+      BOOST_CHECK_EQUAL( clone.first_stored_block_num(), snapshot_num );
+      BOOST_CHECK_EQUAL( db.first_stored_block_num(), 1u );
+      BOOST_CHECK( !clone.fetch_block_by_number( snapshot_num - 1 ).valid() );
+      clone.close( false );
+
+      // after a crash it resumes from the checkpoint written when the snapshot was loaded
+      {
+         database recovered;
+         BOOST_CHECK( recovered.resume_from_state_checkpoint( clone_dir.path() ) );
+         BOOST_CHECK( recovered.head_block_id() == db.head_block_id() );
+         BOOST_CHECK_EQUAL( recovered.first_stored_block_num(), snapshot_num );
+         recovered.close();
+      }
+
+      // but it cannot be rebuilt from genesis
+      database replayed;
+      GRAPHENE_REQUIRE_THROW( replayed.reindex( clone_dir.path(), make_genesis() ), fc::exception );
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( state_snapshot_after_replay )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+      {
+         database db;
+         db.open(data_dir.path(), make_genesis );
+         for( uint32_t i = 0; i < 30; ++i )
+            db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+         db.close( false );
+      }
+
+      // a replay keeps no undo history, so the blocks after the last irreversible one cannot be rewound
+      database db;
+      db.reindex( data_dir.path(), make_genesis() );
+      const uint32_t replayed_num = db.head_block_num();
+      BOOST_REQUIRE_LT( db.get_dynamic_global_properties().last_irreversible_block_num, replayed_num );
+      GRAPHENE_REQUIRE_THROW( db.create_state_snapshot( data_dir.path() / "snapshot" ), fc::exception );
+      BOOST_CHECK( !db.is_writing_state_snapshot() );
+      BOOST_CHECK( !fc::exists( data_dir.path() / "snapshot.tmp" ) );
+
+      // once the replayed blocks are irreversible it can
+      while( db.get_dynamic_global_properties().last_irreversible_block_num < replayed_num )
+         db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+      const auto header = db.create_state_snapshot( data_dir.path() / "snapshot" );
+      BOOST_CHECK_EQUAL( header.head_block.block_num(), db.get_dynamic_global_properties().last_irreversible_block_num );
+      BOOST_CHECK( fc::exists( data_dir.path() / "snapshot" ) );
+      db.close();
+   } FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_CASE( undo_block )
 {
    try {
@@ -1189,6 +1500,326 @@ BOOST_FIXTURE_TEST_CASE( transaction_invalidated_in_cache, database_fixture )
    }
 }
 
+BOOST_FIXTURE_TEST_CASE( pending_transactions_reverified_after_authority_change, database_fixture )
+{
+   try
+   {
+      ACTORS( (alice)(bob) );
+
+      auto generate_block = [&]( database& d, uint32_t skip ) -> signed_block
+      {
+         return d.generate_block(d.get_slot_time(1), d.get_scheduled_witness(1), init_account_priv_key, skip);
+      };
+
+      // tx's created by ACTORS() have bogus authority, so we need to
+      // skip_authority_check in the block where they're included
+      generate_block(db, database::skip_authority_check);
+      transfer( account_id_type(), alice_id, asset( 1000 ) );
+      transfer( account_id_type(),   bob_id, asset( 1000 ) );
+      generate_block(db, database::skip_authority_check);
+
+      fc::temp_directory data_dir2( graphene::utilities::temp_directory_path() );
+      database db2;
+      db2.open(data_dir2.path(), make_genesis);
+      while( db2.head_block_num() < db.head_block_num() )
+      {
+         optional< signed_block > b = db.fetch_block_by_number( db2.head_block_num()+1 );
+         db2.push_block(*b, database::skip_witness_signature | database::skip_authority_check);
+      }
+
+      auto generate_xfer_tx = [&]( account_id_type from, account_id_type to, share_type amount,
+                                   const fc::ecc::private_key& key ) -> signed_transaction
+      {
+         signed_transaction tx;
+         transfer_operation xfer_op;
+         xfer_op.from = from;
+         xfer_op.to = to;
+         xfer_op.amount = asset( amount, asset_id_type() );
+         xfer_op.fee = asset( 0, asset_id_type() );
+         tx.operations.push_back( xfer_op );
+         tx.set_expiration( db.head_block_time() + 10 * db.get_global_properties().parameters.block_interval );
+         sign( tx, key );
+         return tx;
+      };
+
+      // both transfers are pending in db
+      PUSH_TX( db, generate_xfer_tx( alice_id, bob_id, 100, alice_private_key ) );
+      PUSH_TX( db, generate_xfer_tx( bob_id, alice_id, 200, bob_private_key ) );
+      BOOST_CHECK_EQUAL(db.get_balance(alice_id, asset_id_type()).amount.value, 1100);
+
+      // meanwhile db2 includes a block replacing alice's active key
+      fc::ecc::private_key new_key = generate_private_key( "alice2" );
+      signed_transaction update_tx;
+      account_update_operation uop;
+      uop.account = alice_id;
+      uop.active = authority( 1, public_key_type( new_key.get_public_key() ), 1 );
+      update_tx.operations.push_back( uop );
+      update_tx.set_expiration( db2.head_block_time() + db2.get_global_properties().parameters.block_interval * 10 );
+      update_tx.sign( alice_private_key, db2.get_chain_id() );
+      PUSH_TX( db2, update_tx );
+      PUSH_BLOCK( db, generate_block(db2, database::skip_nothing) );
+
+      // alice's transfer no longer verifies and is dropped, bob's is restored untouched
+      BOOST_CHECK_EQUAL(db.get_balance(alice_id, asset_id_type()).amount.value, 1200);
+      BOOST_CHECK_EQUAL(db.get_balance(  bob_id, asset_id_type()).amount.value, 800);
+
+      signed_block b = generate_block(db, database::skip_nothing);
+      BOOST_CHECK_EQUAL( b.transactions.size(), 1u );
+      PUSH_BLOCK( db2, b );
+      BOOST_CHECK_EQUAL(db2.get_balance(alice_id, asset_id_type()).amount.value, 1200);
+   }
+   catch (fc::exception& e)
+   {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_FIXTURE_TEST_CASE( parallel_apply_matches_serial, database_fixture )
+{
+   try
+   {
+      auto generate_block = [&]( database& d, uint32_t skip ) -> signed_block
+      {
+         return d.generate_block(d.get_slot_time(1), d.get_scheduled_witness(1), init_account_priv_key, skip);
+      };
+      auto state_hash = []( const database& d ) -> fc::sha256
+      {
+         std::stringstream state;
+         d.export_state( state, 0 );
+         return fc::sha256::hash( state.str() );
+      };
+
+      const uint32_t num_accounts = 8;
+      vector<account_id_type> accounts;
+      vector<fc::ecc::private_key> keys;
+      for( uint32_t i = 0; i < num_accounts; ++i )
+      {
+         keys.push_back( generate_private_key( "parallel" + fc::to_string(i) ) );
+         accounts.push_back( create_account( "parallel" + fc::to_string(i), public_key_type( keys.back().get_public_key() ) ).id );
+      }
+      // tx's created by create_account() have bogus authority, so we need to
+      // skip_authority_check in the blocks where they're included
+      generate_block(db, database::skip_authority_check);
+      for( const auto& id : accounts )
+         transfer( account_id_type(), id, asset( 100000 ) );
+      generate_block(db, database::skip_authority_check);
+
+      fc::temp_directory serial_dir( graphene::utilities::temp_directory_path() );
+      fc::temp_directory parallel_dir( graphene::utilities::temp_directory_path() );
+      database serial;
+      serial.open(serial_dir.path(), make_genesis);
+      database parallel;
+      parallel.open(parallel_dir.path(), make_genesis);
+      parallel.set_parallel_apply_threads( 4 );
+      while( serial.head_block_num() < db.head_block_num() )
+      {
+         optional< signed_block > b = db.fetch_block_by_number( serial.head_block_num()+1 );
+         serial.push_block(*b, database::skip_witness_signature | database::skip_authority_check);
+         parallel.push_block(*b, database::skip_witness_signature | database::skip_authority_check);
+      }
+
+      auto make_transfer = [&]( uint32_t from, uint32_t to, share_type amount,
+                                const fc::ecc::private_key& key ) -> signed_transaction
+      {
+         signed_transaction tx;
+         transfer_operation xfer_op;
+         xfer_op.from = accounts[from];
+         xfer_op.to = accounts[to];
+         xfer_op.amount = asset( amount, asset_id_type() );
+         xfer_op.fee = asset( 0, asset_id_type() );
+         tx.operations.push_back( xfer_op );
+         tx.set_expiration( db.head_block_time() + 10 * db.get_global_properties().parameters.block_interval );
+         sign( tx, key );
+         return tx;
+      };
+      auto make_key_update = [&]( uint32_t account, const fc::ecc::private_key& new_key ) -> signed_transaction
+      {
+         signed_transaction tx;
+         account_update_operation uop;
+         uop.account = accounts[account];
+         uop.active = authority( 1, public_key_type( new_key.get_public_key() ), 1 );
+         tx.operations.push_back( uop );
+         tx.set_expiration( db.head_block_time() + 10 * db.get_global_properties().parameters.block_interval );
+         sign( tx, keys[account] );
+         return tx;
+      };
+
+      // random transfers, with some active keys replaced in the middle of a block so that the checks done
+      // ahead of transfers signed with the new key fail and have to be repeated
+      std::mt19937 rng( 7 );
+      uint32_t key_updates = 0;
+      for( uint32_t round = 0; round < 20; ++round )
+      {
+         for( uint32_t n = 0; n < 30; ++n )
+         {
+            const uint32_t from = rng() % num_accounts;
+            try
+            {
+               if( rng() % 8 == 0 )
+               {
+                  fc::ecc::private_key new_key = generate_private_key( "parallel" + fc::to_string(from) + "-" + fc::to_string(++key_updates) );
+                  PUSH_TX( db, make_key_update( from, new_key ) );
+                  keys[from] = new_key;
+               }
+               else
+                  PUSH_TX( db, make_transfer( from, rng() % num_accounts, 1 + rng() % 1000, keys[from] ) );
+            }
+            catch( const fc::exception& )
+            {
+               // duplicates of earlier transfers and overdrafts are simply left out
+            }
+         }
+         signed_block b = generate_block(db, database::skip_nothing);
+         PUSH_BLOCK( serial, b );
+         PUSH_BLOCK( parallel, b );
+         BOOST_CHECK( state_hash( serial ) == state_hash( parallel ) );
+      }
+      BOOST_CHECK( parallel.head_block_id() == db.head_block_id() );
+      BOOST_CHECK_GT( parallel.get_parallel_apply_counters().verified_ahead, 0u );
+      BOOST_CHECK_GT( parallel.get_parallel_apply_counters().reverified, 0u );
+
+      // a transfer still signed with the key replaced earlier in the same block passes the check done ahead,
+      // which read the replaced key, so it must be checked again and reject the block
+      const auto state_before = state_hash( parallel );
+      fc::ecc::private_key new_key = generate_private_key( "parallel-stale" );
+      signed_block stale;
+      stale.previous = parallel.head_block_id();
+      stale.timestamp = parallel.get_slot_time(1);
+      stale.witness = parallel.get_scheduled_witness(1);
+      stale.transactions.push_back( processed_transaction( make_key_update( 0, new_key ) ) );
+      stale.transactions.push_back( processed_transaction( make_transfer( 0, 1, 1, keys[0] ) ) );
+      stale.transaction_merkle_root = stale.calculate_merkle_root();
+      stale.sign( init_account_priv_key );
+      const auto reverified = parallel.get_parallel_apply_counters().reverified;
+      GRAPHENE_REQUIRE_THROW( PUSH_BLOCK( serial, stale ), fc::exception );
+      GRAPHENE_REQUIRE_THROW( PUSH_BLOCK( parallel, stale ), fc::exception );
+      BOOST_CHECK_EQUAL( parallel.get_parallel_apply_counters().reverified, reverified + 1 );
+      BOOST_CHECK( state_hash( parallel ) == state_before );
+      BOOST_CHECK( state_hash( serial ) == state_before );
+   }
+   catch (fc::exception& e)
+   {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_FIXTURE_TEST_CASE( pending_pool_evicts_lowest_fee_rate, database_fixture )
+{
+   try
+   {
+      ACTORS( (alice)(bob) );
+      transfer( account_id_type(), alice_id, asset( 10000 ) );
+      transfer( account_id_type(),   bob_id, asset( 10000 ) );
+      generate_block();
+
+      pending_transaction_pool_limits limits;
+      limits.max_bytes = 0;
+      limits.max_transactions = 2;
+      limits.max_per_account = 0;
+      db.set_pending_transaction_pool_limits( limits );
+
+      auto xfer = [&]( account_id_type from, account_id_type to, share_type amount, share_type fee ) -> signed_transaction
+      {
+         signed_transaction tx;
+         transfer_operation xfer_op;
+         xfer_op.from = from;
+         xfer_op.to = to;
+         xfer_op.amount = asset( amount );
+         xfer_op.fee = asset( fee );
+         tx.operations.push_back( xfer_op );
+         tx.set_expiration( db.head_block_time() + 10 * db.get_global_properties().parameters.block_interval );
+         return tx;
+      };
+
+      signed_transaction cheap = xfer( alice_id, bob_id, 1, 10 );
+      PUSH_TX( db, cheap, ~0 );
+      PUSH_TX( db, xfer( bob_id, alice_id, 2, 30 ), ~0 );
+      // the pool is full, so the cheapest transaction makes room
+      PUSH_TX( db, xfer( alice_id, bob_id, 3, 20 ), ~0 );
+      const pending_transaction_pool& pool = db.get_pending_transaction_pool();
+      BOOST_CHECK_EQUAL( pool.size(), 2u );
+      BOOST_CHECK( !pool.contains( cheap.id() ) );
+      BOOST_CHECK_EQUAL( pool.get_stats().evicted, 1u );
+      // the pending state was rebuilt without the evicted transfer
+      BOOST_CHECK_EQUAL( db.get_balance( alice_id, asset_id_type() ).amount.value, 10000 + 2 - 3 - 20 );
+      BOOST_CHECK_EQUAL( db.get_balance( bob_id, asset_id_type() ).amount.value, 10000 - 2 - 30 + 3 );
+
+      // paying less than everything pending is refused before evaluation
+      GRAPHENE_REQUIRE_THROW( PUSH_TX( db, xfer( bob_id, alice_id, 4, 5 ), ~0 ), pending_pool_full );
+      BOOST_CHECK_EQUAL( pool.get_stats().rejected, 1u );
+
+      // once there is room again the evicted transfer is accepted, it is not a duplicate
+      limits.max_transactions = 3;
+      db.set_pending_transaction_pool_limits( limits );
+      PUSH_TX( db, cheap, ~0 );
+      BOOST_CHECK( pool.contains( cheap.id() ) );
+      BOOST_CHECK_EQUAL( db.get_balance( alice_id, asset_id_type() ).amount.value, 10000 + 2 - 3 - 20 - 1 - 10 );
+
+      limits.max_transactions = 0;
+      limits.max_per_account = 1;
+      db.set_pending_transaction_pool_limits( limits );
+      GRAPHENE_REQUIRE_THROW( PUSH_TX( db, xfer( bob_id, alice_id, 5, 50 ), ~0 ), pending_pool_full );
+
+      signed_block b = generate_block();
+      BOOST_CHECK_EQUAL( b.transactions.size(), 3u );
+      BOOST_CHECK( pool.empty() );
+      BOOST_CHECK_EQUAL( db.get_balance( alice_id, asset_id_type() ).amount.value, 10000 + 2 - 3 - 20 - 1 - 10 );
+      BOOST_CHECK_EQUAL( db.get_balance( bob_id, asset_id_type() ).amount.value, 10000 - 2 - 30 + 3 + 1 );
+   }
+   catch (fc::exception& e)
+   {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_FIXTURE_TEST_CASE( preassembled_block, database_fixture )
+{
+   try
+   {
+      ACTORS( (alice)(bob) );
+      transfer( account_id_type(), alice_id, asset( 10000 ) );
+      generate_block();
+      db.set_block_preassembly( true );
+
+      auto xfer = [&]( share_type amount ) -> signed_transaction
+      {
+         signed_transaction tx;
+         transfer_operation xfer_op;
+         xfer_op.from = alice_id;
+         xfer_op.to = bob_id;
+         xfer_op.amount = asset( amount );
+         tx.operations.push_back( xfer_op );
+         tx.set_expiration( db.head_block_time() + 10 * db.get_global_properties().parameters.block_interval );
+         return tx;
+      };
+
+      PUSH_TX( db, xfer( 100 ), ~0 );
+      PUSH_TX( db, xfer( 200 ), ~0 );
+      BOOST_CHECK( db.has_preassembled_block( ~0 ) );
+      // the transactions were applied without their signatures being checked
+      BOOST_CHECK( !db.has_preassembled_block( database::skip_nothing ) );
+
+      signed_block b = generate_block();
+      BOOST_CHECK_EQUAL( b.transactions.size(), 2u );
+      BOOST_CHECK( b.transaction_merkle_root == b.calculate_merkle_root() );
+      BOOST_CHECK_EQUAL( db.get_balance( bob_id, asset_id_type() ).amount.value, 300 );
+
+      // transactions pending on top of a block that is popped have to be applied again
+      PUSH_TX( db, xfer( 300 ), ~0 );
+      BOOST_CHECK( db.has_preassembled_block( ~0 ) );
+      db.pop_block();
+      BOOST_CHECK( !db.has_preassembled_block( ~0 ) );
+   }
+   catch (fc::exception& e)
+   {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( genesis_reserve_ids )
 {
    try
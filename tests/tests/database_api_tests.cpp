@@ -68,4 +68,72 @@ BOOST_FIXTURE_TEST_SUITE(database_api_tests, database_fixture)
       } FC_LOG_AND_RETHROW()
   }
 
+  BOOST_AUTO_TEST_CASE(rolling_ticker) {
+      try {
+          ACTORS((buyer)(seller));
+          const auto& core = asset_id_type()(db);
+          const auto& test = create_user_issued_asset( "TICKER" );
+          issue_uia( seller, test.amount(1000) );
+          transfer( committee_account, buyer_id, core.amount(10000) );
+
+          create_sell_order( seller, test.amount(100), core.amount(200) );
+          create_sell_order( buyer, core.amount(200), test.amount(100) );
+          generate_block();
+
+          graphene::app::database_api db_api(db);
+          auto ticker = db_api.get_ticker( core.symbol, test.symbol );
+          BOOST_CHECK_EQUAL( ticker.base_volume, 200 / pow( 10, core.precision ) );
+          BOOST_CHECK_EQUAL( ticker.quote_volume, 100 / pow( 10, test.precision ) );
+          BOOST_CHECK_GT( ticker.latest, 0 );
+
+          auto flipped = db_api.get_ticker( test.symbol, core.symbol );
+          BOOST_CHECK_EQUAL( flipped.base_volume, ticker.quote_volume );
+          BOOST_CHECK_CLOSE( flipped.latest * ticker.latest, 1, 0.0001 );
+          BOOST_CHECK_EQUAL( db_api.get_all_tickers().size(), 1 );
+
+          // once the trade is older than 24 hours only the last price remains
+          generate_blocks( db.head_block_time() + 86400 + db.get_global_properties().parameters.block_interval );
+          auto expired = db_api.get_ticker( core.symbol, test.symbol );
+          BOOST_CHECK_EQUAL( expired.base_volume, 0 );
+          BOOST_CHECK_EQUAL( expired.quote_volume, 0 );
+          BOOST_CHECK_EQUAL( expired.latest, ticker.latest );
+          BOOST_CHECK_EQUAL( expired.percent_change, 0 );
+      } FC_LOG_AND_RETHROW()
+  }
+
+  BOOST_AUTO_TEST_CASE(full_accounts_paged) {
+      try {
+          ACTORS((seller));
+          const auto& core = asset_id_type()(db);
+          const auto& test = create_user_issued_asset( "PAGED" );
+          issue_uia( seller, test.amount(1000) );
+          for( int i = 1; i <= 5; ++i )
+             create_sell_order( seller, test.amount(10), core.amount(10 * i) );
+          generate_block();
+
+          graphene::app::database_api db_api(db);
+          graphene::app::full_account_query query;
+          query.limit = 2;
+          vector<limit_order_id_type> orders;
+          for( int page = 0; page < 3; ++page )
+          {
+             auto result = db_api.get_full_accounts_paged( { "seller" }, false, query ).at( "seller" );
+             BOOST_CHECK_EQUAL( result.more_data_available.limit_orders, page < 2 );
+             BOOST_REQUIRE( !result.limit_orders.empty() );
+             for( const auto& order : result.limit_orders )
+                orders.push_back( order.id );
+             query.limit_orders_start = orders.back() + 1;
+          }
+          BOOST_CHECK_EQUAL( orders.size(), 5 );
+          BOOST_CHECK( std::is_sorted( orders.begin(), orders.end() ) );
+
+          // a cached result is dropped as soon as a transaction changes the account
+          BOOST_CHECK_EQUAL( db_api.get_full_accounts( { "seller" }, false ).at( "seller" ).limit_orders.size(), 5 );
+          create_sell_order( seller, test.amount(10), core.amount(100) );
+          BOOST_CHECK_EQUAL( db_api.get_full_accounts( { "seller" }, false ).at( "seller" ).limit_orders.size(), 6 );
+          generate_block();
+          BOOST_CHECK_EQUAL( db_api.get_full_accounts( { "seller" }, false ).at( "seller" ).limit_orders.size(), 6 );
+      } FC_LOG_AND_RETHROW()
+  }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -1193,6 +1193,87 @@ BOOST_AUTO_TEST_CASE( witness_feeds )
    }
 }
 
+BOOST_AUTO_TEST_CASE( feed_expiration_schedule )
+{
+   using namespace graphene::chain;
+   try {
+      ACTOR( feeder );
+      const asset_id_type usd_id = create_bitasset( "USDBIT", feeder_id ).id;
+      const asset_id_type eur_id = create_bitasset( "EURBIT", feeder_id ).id;
+      for( asset_id_type id : { usd_id, eur_id } )
+      {
+         update_feed_producers( id(db), { feeder_id } );
+         db.modify( id(db).bitasset_data(db), []( asset_bitasset_data_object& b ) {
+            b.options.feed_lifetime_sec = 60;
+         });
+      }
+
+      // Before scheduling, update_expired_feeds scanned every market issued asset after each block.  Replaying that
+      // scan against copies of the current objects must not change their hashes, otherwise the scheduled version
+      // skipped an asset the scan would have touched.
+      auto check_scan_is_noop = [&]()
+      {
+         const time_point_sec now = db.head_block_time();
+         const auto& idx = db.get_index_type<asset_index>().indices().get<by_type>();
+         for( auto itr = idx.lower_bound( true ); itr != idx.end(); ++itr )
+         {
+            const asset_bitasset_data_object& b = itr->bitasset_data(db);
+            asset_bitasset_data_object scanned_b = b;
+            asset_object scanned_a = *itr;
+            if( now >= HARDFORK_615_TIME ? b.feed_is_expired( now ) : b.feed_is_expired_before_hardfork_615( now ) )
+               scanned_b.update_median_feeds( now );
+            if( !scanned_b.current_feed.core_exchange_rate.is_null() )
+               scanned_a.options.core_exchange_rate = scanned_b.current_feed.core_exchange_rate;
+            BOOST_CHECK( fc::sha256::hash( scanned_b ) == fc::sha256::hash( b ) );
+            BOOST_CHECK( fc::sha256::hash( scanned_a ) == fc::sha256::hash( *itr ) );
+         }
+      };
+
+      auto publish = [&]( asset_id_type id, share_type core_amount )
+      {
+         price_feed feed;
+         feed.settlement_price = price( id(db).amount(1), asset(core_amount) );
+         publish_feed( id(db), feeder_id(db), feed );
+      };
+
+      publish( usd_id, 5 );
+      publish( eur_id, 7 );
+      generate_block();
+      check_scan_is_noop();
+
+      // A core exchange rate changed outside of a feed publication is put back in sync on the next block
+      db.modify( usd_id(db), []( asset_object& a ) {
+         a.options.core_exchange_rate = price( a.amount(1), asset(11) );
+      });
+      generate_block();
+      check_scan_is_noop();
+      BOOST_CHECK( usd_id(db).options.core_exchange_rate == price( usd_id(db).amount(1), asset(5) ) );
+
+      generate_blocks( HARDFORK_615_TIME );
+      generate_block();
+      check_scan_is_noop();
+
+      publish( usd_id, 6 );
+      publish( eur_id, 8 );
+      generate_block();
+      check_scan_is_noop();
+      publish( eur_id, 9 );
+
+      // Walk block by block past the feed lifetime so that both feeds expire while being watched
+      const time_point_sec stop = db.head_block_time() + 2 * usd_id(db).bitasset_data(db).options.feed_lifetime_sec;
+      while( db.head_block_time() < stop )
+      {
+         generate_block();
+         check_scan_is_noop();
+      }
+      BOOST_CHECK( usd_id(db).bitasset_data(db).current_feed.settlement_price.is_null() );
+      BOOST_CHECK( eur_id(db).bitasset_data(db).current_feed.settlement_price.is_null() );
+   } catch (const fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 
 /**
  *  Create an order such that when the trade executes at the